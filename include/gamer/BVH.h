@@ -0,0 +1,463 @@
+/*
+ * ***************************************************************************
+ * This file is part of the GAMer software.
+ * Copyright (C) 2016-2018
+ * by Christopher Lee, John Moody, Rommie Amaro, J. Andrew McCammon,
+ *    and Michael Holst
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * ***************************************************************************
+ */
+
+/**
+ * @file  BVH.h
+ * @brief Bounding volume hierarchy over the faces of a SurfaceMesh
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "gamer/gamer.h"
+#include "gamer/SurfaceMesh.h"
+
+/// Namespace for all things gamer
+namespace gamer
+{
+/**
+ * @brief      Axis aligned bounding box
+ */
+struct AABB
+{
+    Vector lower;   ///< Minimum corner
+    Vector upper;   ///< Maximum corner
+
+    /**
+     * @brief      Default constructor creates an empty box
+     */
+    AABB() : lower(std::numeric_limits<REAL>::max()),
+             upper(std::numeric_limits<REAL>::lowest()) {}
+
+    /**
+     * @brief      Construct a box from its corners
+     */
+    AABB(const Vector &lower, const Vector &upper) : lower(lower), upper(upper) {}
+
+    /**
+     * @brief      Grow the box to contain a point
+     */
+    void expand(const Vector &p)
+    {
+        for (std::size_t i = 0; i < 3; ++i)
+        {
+            lower[i] = std::min(lower[i], p[i]);
+            upper[i] = std::max(upper[i], p[i]);
+        }
+    }
+
+    /**
+     * @brief      Grow the box to contain another box
+     */
+    void expand(const AABB &box)
+    {
+        for (std::size_t i = 0; i < 3; ++i)
+        {
+            lower[i] = std::min(lower[i], box.lower[i]);
+            upper[i] = std::max(upper[i], box.upper[i]);
+        }
+    }
+
+    /**
+     * @brief      Whether the box contains no points
+     */
+    bool empty() const
+    {
+        return lower[0] > upper[0] || lower[1] > upper[1] || lower[2] > upper[2];
+    }
+
+    /**
+     * @brief      Whether two boxes share at least one point
+     */
+    bool overlaps(const AABB &box) const
+    {
+        for (std::size_t i = 0; i < 3; ++i)
+        {
+            if (lower[i] > box.upper[i] || box.lower[i] > upper[i])
+                return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief      Squared distance from a point to the box, zero inside
+     */
+    REAL squaredDistance(const Vector &p) const
+    {
+        REAL d2 = 0;
+        for (std::size_t i = 0; i < 3; ++i)
+        {
+            REAL d = std::max(std::max(lower[i] - p[i], p[i] - upper[i]), REAL(0));
+            d2 += d*d;
+        }
+        return d2;
+    }
+
+    /**
+     * @brief      Slab test of a ray against the box
+     *
+     * @param[in]  origin  The ray origin
+     * @param[in]  invDir  Componentwise inverse of the ray direction
+     * @param[in]  tMax    Largest ray parameter of interest
+     * @param[out] tEnter  Ray parameter where the ray enters the box
+     *
+     * @return     True if the ray meets the box within [0, tMax]
+     */
+    bool intersectRay(const Vector &origin, const Vector &invDir, REAL tMax, REAL &tEnter) const
+    {
+        REAL t0 = 0, t1 = tMax;
+        for (std::size_t i = 0; i < 3; ++i)
+        {
+            REAL tNear = (lower[i] - origin[i])*invDir[i];
+            REAL tFar  = (upper[i] - origin[i])*invDir[i];
+            if (tNear > tFar)
+                std::swap(tNear, tFar);
+            // Written so that NaN from 0*inf leaves the interval unchanged
+            t0 = tNear > t0 ? tNear : t0;
+            t1 = tFar < t1 ? tFar : t1;
+            if (t0 > t1)
+                return false;
+        }
+        tEnter = t0;
+        return true;
+    }
+};
+
+/**
+ * @brief      Result of a ray query
+ */
+struct RayHit
+{
+    std::size_t face;   ///< Index of the face in the BVH
+    REAL        t;      ///< Ray parameter of the hit
+    REAL        u;      ///< Barycentric coordinate of the second vertex
+    REAL        v;      ///< Barycentric coordinate of the third vertex
+};
+
+/**
+ * @brief      Result of a closest point query
+ */
+struct ClosestPoint
+{
+    std::size_t face;               ///< Index of the face in the BVH
+    Vector      point;              ///< Closest point on the surface
+    REAL        squaredDistance;    ///< Squared distance to the query point
+};
+
+/**
+ * @brief      Intersect a ray with a triangle (Moller-Trumbore)
+ *
+ * @param[in]  origin  The ray origin
+ * @param[in]  dir     The ray direction
+ * @param[in]  a       First vertex of the triangle
+ * @param[in]  b       Second vertex of the triangle
+ * @param[in]  c       Third vertex of the triangle
+ * @param[out] t       Ray parameter of the hit
+ * @param[out] u       Barycentric coordinate of b
+ * @param[out] v       Barycentric coordinate of c
+ *
+ * @return     True if the ray hits the triangle at t >= 0
+ */
+bool rayTriangleIntersect(const Vector &origin, const Vector &dir,
+                          const Vector &a, const Vector &b, const Vector &c,
+                          REAL &t, REAL &u, REAL &v);
+
+/**
+ * @brief      Closest point on a triangle to a point
+ *
+ * @param[in]  p     The query point
+ * @param[in]  a     First vertex of the triangle
+ * @param[in]  b     Second vertex of the triangle
+ * @param[in]  c     Third vertex of the triangle
+ *
+ * @return     The closest point
+ */
+Vector closestPointOnTriangle(const Vector &p,
+                              const Vector &a, const Vector &b, const Vector &c);
+
+/**
+ * @brief      Test whether two closed triangles share at least one point
+ *
+ * Separating axis test over the two face normals, the nine edge-edge cross
+ * products and the in-plane edge normals which separate coplanar
+ * triangles. Triangles which merely touch count as intersecting, so
+ * neighbouring faces of a mesh always intersect. A segment pq may be
+ * passed as the degenerate triangle (p, q, q).
+ *
+ * @return     True if the triangles intersect
+ */
+bool trianglesIntersect(const Vector &a0, const Vector &a1, const Vector &a2,
+                        const Vector &b0, const Vector &b1, const Vector &b2);
+
+/**
+ * @brief      Bounding volume hierarchy over the faces of a SurfaceMesh
+ *
+ * The hierarchy is a linear BVH: face centroids are sorted along a 30 bit
+ * Morton curve and the tree is formed by splitting each range at the
+ * highest differing bit of the codes. Nodes are stored in depth first
+ * order so that refit() is a single reverse sweep. Face positions are
+ * copied out of the mesh, which makes queries independent of the casc
+ * lookup structures and safe to run concurrently.
+ *
+ * Faces are numbered 0..size()-1 in get_level_id<3>() order at the time of
+ * construction. Vertices of each face are stored in winding order so that
+ * the normal of the triangle follows the face orientation. The BVH must be
+ * rebuilt if faces are added or removed; after vertices move refit() is
+ * enough.
+ */
+class FaceBVH
+{
+public:
+    /**
+     * @brief      Build the hierarchy
+     *
+     * @param[in]  mesh      The surface mesh. It must outlive the BVH.
+     * @param[in]  leafSize  Maximum number of faces per leaf
+     */
+    explicit FaceBVH(const SurfaceMesh &mesh, std::size_t leafSize = 4);
+
+    /**
+     * @brief      Reload vertex positions and recompute the bounding boxes
+     *             without changing the tree topology.
+     */
+    void refit();
+
+    /**
+     * @brief      Number of faces
+     */
+    std::size_t size() const
+    {
+        return faceIDs.size();
+    }
+
+    /**
+     * @brief      The face with index i
+     */
+    SurfaceMesh::SimplexID<3> faceID(std::size_t i) const
+    {
+        return faceIDs[i];
+    }
+
+    /**
+     * @brief      Dense vertex indices of face i in winding order
+     */
+    const std::array<std::size_t, 3> &face(std::size_t i) const
+    {
+        return faces[i];
+    }
+
+    /**
+     * @brief      Number of vertices
+     */
+    std::size_t numVertices() const
+    {
+        return positions.size();
+    }
+
+    /**
+     * @brief      Position of the dense vertex index i
+     */
+    const Vector &position(std::size_t i) const
+    {
+        return positions[i];
+    }
+
+    /**
+     * @brief      Corners of face i in winding order
+     */
+    std::array<Vector, 3> triangle(std::size_t i) const
+    {
+        return {{positions[faces[i][0]], positions[faces[i][1]], positions[faces[i][2]]}};
+    }
+
+    /**
+     * @brief      Bounding box of the whole mesh
+     */
+    AABB bounds() const
+    {
+        return nodes.empty() ? AABB() : nodes[0].box;
+    }
+
+    /**
+     * @brief      Find the first face hit by a ray
+     *
+     * @param[in]  origin  The ray origin
+     * @param[in]  dir     The ray direction, need not be normalized
+     * @param[out] hit     The nearest hit
+     * @param[in]  tMax    Largest ray parameter of interest
+     *
+     * @return     True if a face was hit
+     */
+    bool intersectRay(const Vector &origin, const Vector &dir, RayHit &hit,
+                      REAL tMax = std::numeric_limits<REAL>::infinity()) const;
+
+    /**
+     * @brief      Find every face hit by a ray
+     *
+     * @param[in]  origin  The ray origin
+     * @param[in]  dir     The ray direction, need not be normalized
+     * @param[in]  tMax    Largest ray parameter of interest
+     *
+     * @return     The hits in no particular order
+     */
+    std::vector<RayHit> intersectRayAll(const Vector &origin, const Vector &dir,
+                                        REAL tMax = std::numeric_limits<REAL>::infinity()) const;
+
+    /**
+     * @brief      Test whether a point lies strictly inside a closed surface
+     *
+     * Counts the parity of crossings along several fixed rays. Rays which
+     * pass close to an edge or vertex or graze a face are discarded and the
+     * remaining rays vote, so that the result is robust for points which are
+     * not on the surface itself. Points on the surface are reported as
+     * outside.
+     *
+     * @param[in]  p     The query point
+     *
+     * @return     True if p is inside
+     */
+    bool contains(const Vector &p) const;
+
+    /**
+     * @brief      Find the closest point on the surface
+     *
+     * @param[in]  p            The query point
+     * @param[in]  maxDistance  Only points closer than this are considered
+     *
+     * @return     The closest point. face is size() if there is none.
+     */
+    ClosestPoint closestPoint(const Vector &p,
+                              REAL maxDistance = std::numeric_limits<REAL>::infinity()) const;
+
+    /**
+     * @brief      Faces whose bounding box overlaps a box
+     *
+     * @param[in]  box   The query box
+     *
+     * @return     Indices of the faces
+     */
+    std::vector<std::size_t> overlapBox(const AABB &box) const;
+
+    /**
+     * @brief      Faces which intersect a triangle
+     *
+     * @param[in]  a     First vertex of the triangle
+     * @param[in]  b     Second vertex of the triangle
+     * @param[in]  c     Third vertex of the triangle
+     *
+     * @return     Indices of the faces
+     */
+    std::vector<std::size_t> overlapTriangle(const Vector &a, const Vector &b, const Vector &c) const;
+
+    /**
+     * @brief      Visit the faces whose bounding box overlaps a box
+     *
+     * @param[in]  box    The query box
+     * @param[in]  visit  Callable invoked with each face index
+     */
+    template <typename Visitor>
+    void forEachOverlap(const AABB &box, Visitor &&visit) const
+    {
+        if (nodes.empty())
+            return;
+        std::vector<std::size_t> stack{0};
+        while (!stack.empty())
+        {
+            std::size_t curr = stack.back();
+            stack.pop_back();
+            const Node &node = nodes[curr];
+            if (!node.box.overlaps(box))
+                continue;
+            if (node.count > 0)
+            {
+                for (std::size_t i = node.first; i < node.first + node.count; ++i)
+                {
+                    if (faceBoxes[order[i]].overlaps(box))
+                        visit(order[i]);
+                }
+            }
+            else
+            {
+                stack.push_back(node.right);
+                stack.push_back(curr + 1);
+            }
+        }
+    }
+
+private:
+    /**
+     * @brief      Tree node. The left child of an inner node directly follows
+     *             it; leaves hold the range [first, first+count) of order.
+     */
+    struct Node
+    {
+        AABB        box;
+        std::size_t right = 0;
+        std::size_t first = 0;
+        std::size_t count = 0;
+    };
+
+    /// Sort the faces along the Morton curve and build the tree
+    void buildTree();
+
+    /// Recursively build the subtree over the sorted range [begin, end)
+    std::size_t build(const std::vector<std::uint32_t> &codes,
+                      std::size_t begin, std::size_t end);
+
+    /// Recompute the face and node boxes from the cached positions
+    void updateBoxes();
+
+    std::size_t                                leafSize;
+    std::vector<SurfaceMesh::SimplexID<1> >    vertexIDs;
+    std::vector<SurfaceMesh::SimplexID<3> >    faceIDs;
+    std::vector<std::array<std::size_t, 3> >   faces;
+    std::vector<Vector>                        positions;
+    std::vector<AABB>                          faceBoxes;
+    std::vector<std::size_t>                   order;
+    std::vector<Node>                          nodes;
+};
+
+/**
+ * @brief      Find intersecting faces within and between indexed surfaces.
+ *
+ * Same as findIntersections() on the meshes, for callers which keep the
+ * BVHs for further queries. Mesh indices refer to positions in bvhs.
+ *
+ * @param[in]  bvhs    Face BVHs of the meshes
+ * @param[in]  select  Set the selected flag of the intersecting faces
+ * @param[in]  marker  If nonzero, assign this marker to the intersecting
+ *                     faces
+ *
+ * @return     The intersecting pairs sorted by mesh and face order
+ */
+std::vector<FaceIntersection> findFaceIntersections(const std::vector<FaceBVH> &bvhs,
+                                                    bool select = false,
+                                                    int  marker = 0);
+} // end namespace gamer
@@ -0,0 +1,215 @@
+/*
+ * ***************************************************************************
+ * This file is part of the GAMer software.
+ * Copyright (C) 2016-2018
+ * by Christopher Lee, John Moody, Rommie Amaro, J. Andrew McCammon,
+ *    and Michael Holst
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * ***************************************************************************
+ */
+
+/**
+ * @file  BufferedWriter.h
+ * @brief Buffered binary and text output for the mesh writers
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/// Namespace for all things gamer
+namespace gamer
+{
+/**
+ * @brief      Minimum width of the next integer written to a BufferedWriter.
+ *
+ * Equivalent of std::setw for BufferedWriter, numbers are right aligned.
+ */
+struct FieldWidth
+{
+    int width;
+};
+
+/**
+ * @brief      Output stream wrapper which formats into a large buffer.
+ *
+ * Values are accumulated in a fixed size buffer and flushed to the
+ * underlying stream in large writes rather than token by token. Binary
+ * values are appended with push() in host byte order, or swapped if
+ * requested. Text is appended with operator<< which formats numbers like
+ * std::ostream does with default flags and the given precision.
+ */
+class BufferedWriter
+{
+public:
+    /**
+     * @brief      Constructor
+     *
+     * @param      out        The stream to write to
+     * @param[in]  swapBytes  Reverse the bytes of values given to push()
+     */
+    explicit BufferedWriter(std::ostream &out, bool swapBytes = false)
+        : out(out), swapBytes(swapBytes)
+    {
+        buffer.reserve(bufferSize);
+    }
+
+    /// Destructor flushes the remaining buffer
+    ~BufferedWriter()
+    {
+        flush();
+    }
+
+    BufferedWriter(const BufferedWriter &) = delete;
+    BufferedWriter &operator=(const BufferedWriter &) = delete;
+
+    /**
+     * @brief      Set the number of significant digits of floating point text
+     *
+     * @param[in]  digits  The precision
+     */
+    void precision(int digits)
+    {
+        _precision = digits;
+    }
+
+    /**
+     * @brief      Append the raw bytes of a value
+     *
+     * @param[in]  value  The value
+     */
+    template <typename T>
+    void push(const T value)
+    {
+        static_assert(std::is_trivially_copyable<T>::value,
+                      "Only trivially copyable values can be pushed");
+        char bytes[sizeof(T)];
+        std::memcpy(bytes, &value, sizeof(T));
+        if (swapBytes)
+            std::reverse(bytes, bytes + sizeof(T));
+        write(bytes, sizeof(T));
+    }
+
+    /**
+     * @brief      Append raw bytes
+     *
+     * @param[in]  data  Pointer to the bytes
+     * @param[in]  n     Number of bytes
+     */
+    void write(const char *data, std::size_t n)
+    {
+        if (buffer.size() + n > bufferSize)
+            flush();
+        if (n > bufferSize)
+            out.write(data, n);
+        else
+            buffer.insert(buffer.end(), data, data + n);
+    }
+
+    /**
+     * @brief      Append a string
+     *
+     * @param[in]  str   The string
+     */
+    void write(const std::string &str)
+    {
+        write(str.data(), str.size());
+    }
+
+    BufferedWriter &operator<<(const std::string &str)
+    {
+        write(str);
+        return *this;
+    }
+
+    BufferedWriter &operator<<(const char *str)
+    {
+        write(str, std::strlen(str));
+        return *this;
+    }
+
+    BufferedWriter &operator<<(char c)
+    {
+        write(&c, 1);
+        return *this;
+    }
+
+    BufferedWriter &operator<<(FieldWidth w)
+    {
+        _width = w.width;
+        return *this;
+    }
+
+    BufferedWriter &operator<<(bool value)
+    {
+        return *this << static_cast<int>(value);
+    }
+
+    template <typename T>
+    typename std::enable_if<std::is_integral<T>::value, BufferedWriter&>::type
+    operator<<(T value)
+    {
+        char text[32];
+        int  n;
+        if (std::is_signed<T>::value)
+            n = std::snprintf(text, sizeof(text), "%*lld", _width, static_cast<long long>(value));
+        else
+            n = std::snprintf(text, sizeof(text), "%*llu", _width, static_cast<unsigned long long>(value));
+        _width = 0;
+        write(text, n);
+        return *this;
+    }
+
+    template <typename T>
+    typename std::enable_if<std::is_floating_point<T>::value, BufferedWriter&>::type
+    operator<<(T value)
+    {
+        char text[64];
+        int  n = std::snprintf(text, sizeof(text), "%*.*g", _width, _precision,
+                               static_cast<double>(value));
+        _width = 0;
+        write(text, n);
+        return *this;
+    }
+
+    /**
+     * @brief      Write the buffered data to the stream
+     */
+    void flush()
+    {
+        if (!buffer.empty())
+        {
+            out.write(buffer.data(), buffer.size());
+            buffer.clear();
+        }
+    }
+
+private:
+    static constexpr std::size_t bufferSize = 1 << 20;
+    std::ostream     &out;
+    bool              swapBytes;
+    int               _precision = 6;
+    int               _width = 0;
+    std::vector<char> buffer;
+};
+} // end namespace gamer
@@ -0,0 +1,108 @@
+/*
+ * ***************************************************************************
+ * This file is part of the GAMer software.
+ * Copyright (C) 2016-2018
+ * by Christopher Lee, John Moody, Rommie Amaro, J. Andrew McCammon,
+ *    and Michael Holst
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * ***************************************************************************
+ */
+
+/**
+ * @file  DenseIndex.h
+ * @brief Dense renumbering of the vertices of a mesh
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+/// Namespace for all things gamer
+namespace gamer
+{
+/**
+ * @brief      Dense renumbering of vertex keys in get_level_id<1>() order.
+ *
+ * Vertex keys are integers which are typically close to contiguous. The
+ * map is stored as a flat array over the key range so that a lookup is a
+ * single indexed load instead of a tree search, and it is built in two
+ * linear passes over the vertices. The index is a snapshot; it must be
+ * rebuilt after vertices are inserted or removed.
+ *
+ * @tparam     Complex  Mesh type
+ */
+template <typename Complex>
+class DenseIndex
+{
+public:
+    using KeyType = typename Complex::KeyType;
+
+    /**
+     * @brief      Build the index of a mesh
+     *
+     * @param[in]  mesh  The mesh
+     * @param[in]  base  Index of the first vertex, 1 for formats which
+     *                   count from one
+     */
+    explicit DenseIndex(const Complex &mesh, std::size_t base = 0)
+    {
+        if (mesh.template size<1>() == 0)
+            return;
+        auto maxKey = std::numeric_limits<KeyType>::lowest();
+        minKey = std::numeric_limits<KeyType>::max();
+        for (const auto vertexID : mesh.template get_level_id<1>())
+        {
+            auto key = vertexID.indices()[0];
+            minKey = std::min(minKey, key);
+            maxKey = std::max(maxKey, key);
+        }
+        index.assign(static_cast<std::size_t>(maxKey - minKey) + 1, 0);
+        std::size_t cnt = base;
+        for (const auto vertexID : mesh.template get_level_id<1>())
+            index[vertexID.indices()[0] - minKey] = cnt++;
+        nVertices = cnt - base;
+    }
+
+    /**
+     * @brief      Dense index of a vertex key
+     *
+     * @param[in]  key   The key of a vertex in the mesh
+     *
+     * @return     The index
+     */
+    std::size_t operator[](KeyType key) const
+    {
+        return index[key - minKey];
+    }
+
+    /**
+     * @brief      Number of vertices indexed
+     */
+    std::size_t size() const
+    {
+        return nVertices;
+    }
+
+private:
+    KeyType                  minKey = 0;
+    std::size_t              nVertices = 0;
+    std::vector<std::size_t> index;
+};
+} // end namespace gamer
@@ -0,0 +1,148 @@
+/*
+ * ***************************************************************************
+ * This file is part of the GAMer software.
+ * Copyright (C) 2016-2018
+ * by Christopher Lee, John Moody, Rommie Amaro, J. Andrew McCammon,
+ *    and Michael Holst
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * ***************************************************************************
+ */
+
+/**
+ * @file  KRingCache.h
+ * @brief Cached k-ring vertex neighbourhoods of a SurfaceMesh
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "gamer/gamer.h"
+#include "gamer/SurfaceMesh.h"
+
+/// Namespace for all things gamer
+namespace gamer
+{
+/**
+ * @brief      Cache of the k-ring neighbourhood of every vertex
+ *
+ * The neighbourhood of a vertex holds the vertex itself followed by every
+ * vertex reachable over at most k edges, the same set casc::kneighbors_up
+ * returns. They are in breadth first order, each ring expanded the way
+ * surfacemesh_detail::vertexGrabber does it, so that the first n entries
+ * are what vertexGrabber collects for n-1 neighbours. Neighbourhoods are stored back to back
+ * in a single array (CSR form) indexed by vertex key so that a lookup is
+ * two loads. The cache is built in parallel from a dense copy of the
+ * vertex adjacency.
+ *
+ * Changes to the connectivity are handled locally. Before a topological
+ * operation confined to the star of a vertex (removing it, flipping one of
+ * its edges), call invalidate() with that vertex: every neighbourhood
+ * which can change is then marked stale and is regathered from the mesh
+ * the next time it is requested. Moving vertices does not invalidate the
+ * cache. Lookups of stale neighbourhoods modify the cache and must not be
+ * made concurrently; call refresh() first to update them all at once.
+ */
+class KRingCache
+{
+public:
+    using SimplexID = SurfaceMesh::SimplexID<1>;
+    using KeyType   = SurfaceMesh::KeyType;
+
+    /**
+     * @brief      Contiguous range of neighbours
+     */
+    class Range
+    {
+    public:
+        Range(const SimplexID *first, const SimplexID *last) : first(first), last(last) {}
+
+        const SimplexID *begin() const { return first; }
+        const SimplexID *end() const { return last; }
+        std::size_t size() const { return last - first; }
+        bool empty() const { return first == last; }
+        const SimplexID &operator[](std::size_t i) const { return first[i]; }
+
+    private:
+        const SimplexID *first;
+        const SimplexID *last;
+    };
+
+    /**
+     * @brief      Build the neighbourhoods of every vertex
+     *
+     * @param[in]  mesh   The surface mesh. It must outlive the cache.
+     * @param[in]  rings  Number of rings k
+     */
+    KRingCache(const SurfaceMesh &mesh, std::size_t rings);
+
+    /**
+     * @brief      Number of rings of each neighbourhood
+     */
+    std::size_t rings() const
+    {
+        return nRings;
+    }
+
+    /**
+     * @brief      Neighbourhood of a vertex
+     *
+     * The vertex itself comes first, followed by its neighbours ordered by
+     * ring. The range stays valid until the cache is next modified.
+     *
+     * @param[in]  vertexID  The vertex
+     *
+     * @return     The neighbourhood
+     */
+    Range operator[](SimplexID vertexID);
+
+    /**
+     * @brief      Mark the neighbourhoods which a change to the star of a
+     *             vertex can affect as stale
+     *
+     * Must be called before the mesh is modified.
+     *
+     * @param[in]  vertexID  The vertex whose star is about to change
+     */
+    void invalidate(SimplexID vertexID);
+
+    /**
+     * @brief      Regather every stale neighbourhood
+     *
+     * The whole cache is rebuilt in parallel if a large fraction of it is
+     * stale.
+     */
+    void refresh();
+
+private:
+    void build();
+    std::size_t slot(KeyType key);
+    void gather(std::size_t s, SimplexID vertexID);
+    void compact();
+
+    const SurfaceMesh       *mesh;
+    std::size_t              nRings;
+    KeyType                  minKey = 0;
+    std::vector<std::size_t> offset;    ///< Start of each neighbourhood
+    std::vector<std::size_t> count;     ///< Length of each neighbourhood
+    std::vector<char>        stale;
+    std::vector<SimplexID>   members;
+    std::size_t              nStale = 0;
+    std::size_t              nLive = 0; ///< Entries of members in use
+};
+} // end namespace gamer
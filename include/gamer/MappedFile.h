@@ -0,0 +1,135 @@
+/*
+ * ***************************************************************************
+ * This file is part of the GAMer software.
+ * Copyright (C) 2016-2018
+ * by Christopher Lee, John Moody, Rommie Amaro, J. Andrew McCammon,
+ *    and Michael Holst
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * ***************************************************************************
+ */
+
+/**
+ * @file  MappedFile.h
+ * @brief Read only memory mapped file access
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+/// Namespace for all things gamer
+namespace gamer
+{
+/**
+ * @brief      Read only view of a file mapped into memory.
+ *
+ * The contents of the file are accessible through data() and size() for the
+ * lifetime of the object. The mapping is not null terminated so parsers must
+ * respect size().
+ */
+class MappedFile
+{
+public:
+    /// Default constructor
+    MappedFile() = default;
+
+    /**
+     * @brief      Construct and map a file
+     *
+     * @param[in]  filename  The filename
+     */
+    explicit MappedFile(const std::string &filename)
+    {
+        open(filename);
+    }
+
+    /// Destructor unmaps the file
+    ~MappedFile()
+    {
+        close();
+    }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    /**
+     * @brief      Map a file into memory
+     *
+     * @param[in]  filename  The filename
+     *
+     * @return     True if the file was successfully mapped
+     */
+    bool open(const std::string &filename);
+
+    /**
+     * @brief      Unmap the file if mapped
+     */
+    void close();
+
+    /**
+     * @brief      Determines if a file is mapped.
+     *
+     * @return     True if open, False otherwise.
+     */
+    bool is_open() const
+    {
+        return _open;
+    }
+
+    /**
+     * @brief      Pointer to the first byte of the file
+     *
+     * @return     Pointer to the mapped data
+     */
+    const char *data() const
+    {
+        return _data;
+    }
+
+    /**
+     * @brief      Size of the file in bytes
+     *
+     * @return     The size
+     */
+    std::size_t size() const
+    {
+        return _size;
+    }
+
+    /// Pointer to the first byte
+    const char *begin() const
+    {
+        return _data;
+    }
+
+    /// Pointer to one past the last byte
+    const char *end() const
+    {
+        return _data + _size;
+    }
+
+private:
+    const char  *_data = nullptr;
+    std::size_t  _size = 0;
+    bool         _open = false;
+#ifdef _WIN32
+    void        *_file    = nullptr;
+    void        *_mapping = nullptr;
+#endif
+};
+} // end namespace gamer
@@ -29,12 +29,17 @@
 
 #pragma once
 
+#include <algorithm>
+#include <functional>
 #include <iostream>
+#include <limits>
 #include <stdexcept>
 #include <string>
+#include <map>
 #include <memory>
 #include <unordered_set>
 #include <utility>
+#include <vector>
 
 #include <casc/casc>
 #include <Eigen/Dense>
@@ -283,6 +288,8 @@ Vector getNormal(const SurfaceMesh& mesh, SurfaceMesh::SimplexID<1> vertexID);
  */
 Vector getNormal(const SurfaceMesh& mesh, SurfaceMesh::SimplexID<3> faceID);
 
+class KRingCache;
+
 /// @cond detail
 /// Namespace for surface mesh detail functions
 namespace surfacemesh_detail
@@ -296,6 +303,20 @@ namespace surfacemesh_detail
  */
 void decimateVertex(SurfaceMesh& mesh, SurfaceMesh::SimplexID<1> vertexID, std::size_t rings = 2);
 
+/**
+ * @brief      Remove a vertex from mesh and triangulate the resulting hole.
+ *
+ * The neighbourhoods affected by the removal are invalidated in the cache.
+ * The vertices around the filled hole are smoothed with an LST over the
+ * given number of rings, taken from the cache if it holds that many.
+ *
+ * @param      mesh      Surface mesh of interest
+ * @param[in]  vertexID  The vertex id
+ * @param      cache     Neighbourhoods of the mesh vertices
+ * @param[in]  rings     Number of neighborhood rings to smooth with
+ */
+void decimateVertex(SurfaceMesh& mesh, SurfaceMesh::SimplexID<1> vertexID, KRingCache& cache, std::size_t rings = 2);
+
 /**
  * @brief      Computes the local structure tensor
  *
@@ -310,6 +331,20 @@ tensor<double, 3, 2> computeLocalStructureTensor(
     const SurfaceMesh::SimplexID<1> vertexID,
     const int rings);
 
+/**
+ * @brief      Computes the local structure tensor
+ *
+ * @param[in]  mesh      Surface mesh of interest
+ * @param[in]  vertexID  Vertex of interest
+ * @param      cache     Neighbourhoods of the mesh vertices
+ *
+ * @return     The local structure tensor.
+ */
+tensor<double, 3, 2> computeLocalStructureTensor(
+    const SurfaceMesh& mesh,
+    const SurfaceMesh::SimplexID<1> vertexID,
+    KRingCache& cache);
+
 
 /**
  * @brief      Computes the local structure tensor from cached normals
@@ -325,6 +360,20 @@ tensor<double, 3, 2> computeLSTFromCache(
     const SurfaceMesh::SimplexID<1> vertexID,
     const int rings);
 
+/**
+ * @brief      Computes the local structure tensor from cached normals
+ *
+ * @param[in]  mesh      Surface mesh of interest
+ * @param[in]  vertexID  Vertex of interest
+ * @param      cache     Neighbourhoods of the mesh vertices
+ *
+ * @return     The local structure tensor.
+ */
+tensor<double, 3, 2> computeLSTFromCache(
+    const SurfaceMesh& mesh,
+    const SurfaceMesh::SimplexID<1> vertexID,
+    KRingCache& cache);
+
 
 /**
  * @brief      Terminal case
@@ -530,10 +579,23 @@ bool computeLocalOrientation(SurfaceMesh& mesh, const std::vector<SurfaceMesh::S
  */
 void weightedVertexSmooth(SurfaceMesh& mesh, SurfaceMesh::SimplexID<1> vertexID, int rings);
 
+/**
+ * @brief      Smooth the vertex according to Section 2.2.2 of GAMer paper.
+ *
+ * @param[out] mesh      SurfaceMesh of interest.
+ * @param[in]  vertexID  SimplexID of the vertex to move.
+ * @param      cache     Neighbourhoods used to compute the LST.
+ */
+void weightedVertexSmooth(SurfaceMesh& mesh, SurfaceMesh::SimplexID<1> vertexID, KRingCache& cache);
+
 Vector weightedVertexSmoothCache(SurfaceMesh& mesh,
                                  SurfaceMesh::SimplexID<1> vertexID,
                                  std::size_t rings);
 
+Vector weightedVertexSmoothCache(SurfaceMesh& mesh,
+                                 SurfaceMesh::SimplexID<1> vertexID,
+                                 KRingCache& cache);
+
 /**
  * @brief      Traditional barycenter smooth.
  *
@@ -820,6 +882,13 @@ void vertexGrabber(const Complex& F,
 /**
  * @brief      Reads in a GeomView OFF file
  *
+ * Vertices are keyed from 0 in file order. Faces keep the winding of the
+ * file if it is consistent; otherwise the orientation is computed as by
+ * casc::compute_orientation().
+ *
+ * Throws std::runtime_error if the file cannot be read or parsed. Earlier
+ * versions printed an error and returned nullptr instead.
+ *
  * @param[in]  filename  Filename of file of interest
  *
  * @return     Returns a unique_ptr to the SurfaceMesh
@@ -838,6 +907,13 @@ void writeOFF(const std::string& filename, const SurfaceMesh& mesh);
 /**
  * @brief      Reads an obj file.
  *
+ * Vertices are keyed from 1 in file order, matching the OBJ indices. Faces
+ * keep the winding of the file if it is consistent; otherwise the
+ * orientation is computed as by casc::compute_orientation().
+ *
+ * Throws std::runtime_error if the file cannot be read or parsed. Earlier
+ * versions printed an error and returned an empty mesh instead.
+ *
  * @param[in]  filename  The filename
  *
  * @return     Unique pointer to SurfaceMesh
@@ -853,6 +929,95 @@ std::unique_ptr<SurfaceMesh> readOBJ(const std::string& filename);
  */
 void writeOBJ(const std::string& filename, const SurfaceMesh& mesh);
 
+/**
+ * @brief      Reads a SurfaceMesh snapshot written by writeSnapshot.
+ *
+ * The file is memory mapped and the mesh is built directly from the stored
+ * arrays, restoring metadata, orientations, markers, and selection.
+ *
+ * @param[in]  filename      The filename
+ * @param      vertexFields  If not null, receives the stored vertex fields
+ *
+ * @return     Unique pointer to SurfaceMesh
+ */
+std::unique_ptr<SurfaceMesh> readSnapshot_SurfaceMesh(const std::string& filename,
+                                                      std::map<std::string, std::vector<REAL> > *vertexFields = nullptr);
+
+/**
+ * @brief      Writes a lossless binary snapshot of the mesh.
+ *
+ * The snapshot stores the global metadata and dense arrays of the vertices,
+ * faces in winding order, markers, and selection flags in 64 byte aligned
+ * sections in host byte order. It is intended for checkpointing and is not
+ * portable between machines of different byte order.
+ *
+ * @param[in]  filename      The filename to write out to
+ * @param[in]  mesh          Surface mesh to output
+ * @param[in]  vertexFields  Additional per vertex values such as curvatures,
+ *                           in get_level_id<1>() order
+ */
+void writeSnapshot(const std::string& filename,
+                   const SurfaceMesh& mesh,
+                   const std::map<std::string, std::vector<REAL> >& vertexFields = {});
+
+/**
+ * @brief      Reads a binary PLY file.
+ *
+ * Faces must be triangles. Vertex and face properties named marker and
+ * selected are restored, as are vertex normals nx, ny, nz.
+ *
+ * @param[in]  filename      The filename
+ * @param      vertexFields  If not null, receives all other scalar vertex
+ *                           properties by name
+ *
+ * @return     Unique pointer to SurfaceMesh
+ */
+std::unique_ptr<SurfaceMesh> readPLY(const std::string& filename,
+                                     std::map<std::string, std::vector<REAL> > *vertexFields = nullptr);
+
+/**
+ * @brief      Writes a mesh to binary little endian PLY format.
+ *
+ * Vertex positions, markers, and selection flags, and face indices,
+ * markers, and selection flags are always written.
+ *
+ * @param[in]  filename      The filename to write out to
+ * @param[in]  mesh          Surface mesh to output
+ * @param[in]  normals       Also write the cached vertex normals
+ * @param[in]  vertexFields  Additional per vertex values such as curvatures,
+ *                           in get_level_id<1>() order
+ */
+void writePLY(const std::string& filename,
+              const SurfaceMesh& mesh,
+              bool normals = false,
+              const std::map<std::string, std::vector<REAL> >& vertexFields = {});
+
+/**
+ * @brief      Reads a binary Gmsh MSH 4.1 file.
+ *
+ * Triangles are read as faces. The first physical tag of the entity each
+ * triangle belongs to becomes the face marker, or -1 if it has none.
+ * Blocks of other element types are skipped.
+ *
+ * @param[in]  filename  The filename
+ *
+ * @return     Unique pointer to SurfaceMesh
+ */
+std::unique_ptr<SurfaceMesh> readMSH_SurfaceMesh(const std::string& filename);
+
+
+/**
+ * @brief      Writes a mesh to binary Gmsh MSH 4.1 format.
+ *
+ * Faces are grouped into one surface entity per marker. Positive markers
+ * are stored as physical tags. Throws std::runtime_error if the mesh has
+ * vertices but no faces.
+ *
+ * @param[in]  filename  The filename to write out to
+ * @param[in]  mesh      Surface mesh to output
+ */
+void writeMSH(const std::string& filename, const SurfaceMesh& mesh);
+
 /**
  * @brief      Pretty print the mesh.
  *
@@ -887,6 +1052,89 @@ void generateHistogram(const SurfaceMesh& mesh);
 std::tuple<double, double, int, int> getMinMaxAngles(const SurfaceMesh& mesh,
                                                      double maxMinAngle, double minMaxAngle);
 
+/**
+ * @brief      Summary of the quality of a surface mesh
+ */
+struct SurfaceQualitySummary
+{
+    std::size_t nFaces          = 0;    ///< Number of faces
+    std::size_t nEdges          = 0;    ///< Number of edges
+    std::size_t nVertices       = 0;    ///< Number of vertices
+    REAL        minAngle        = 180;  ///< Minimum angle in degrees
+    REAL        maxAngle        = 0;    ///< Maximum angle in degrees
+    std::size_t nSmallAngles    = 0;    ///< Number of angles below smallAngle
+    std::size_t nLargeAngles    = 0;    ///< Number of angles above largeAngle
+    REAL        minArea         = std::numeric_limits<REAL>::max();    ///< Smallest face
+    REAL        maxArea         = 0;    ///< Largest face
+    REAL        totalArea       = 0;    ///< Sum of face areas
+    REAL        meanAspectRatio = 0;    ///< Mean normalized aspect ratio
+    REAL        maxAspectRatio  = 0;    ///< Maximum normalized aspect ratio
+    REAL        minEdgeLength   = std::numeric_limits<REAL>::max();    ///< Shortest edge
+    REAL        maxEdgeLength   = 0;    ///< Longest edge
+    REAL        meanEdgeLength  = 0;    ///< Mean edge length
+    std::size_t minValence      = std::numeric_limits<std::size_t>::max(); ///< Lowest valence
+    std::size_t maxValence      = 0;    ///< Highest valence
+};
+
+/**
+ * @brief      Per element quality measures of a surface mesh and their
+ *             distributions
+ *
+ * Per face, edge and vertex arrays follow the iteration order of
+ * get_level_id<3>(), get_level_id<2>() and get_level_id<1>().
+ */
+struct SurfaceQualityStats
+{
+    std::vector<REAL>        area;          ///< Area of each face
+    std::vector<REAL>        minAngle;      ///< Minimum angle of each face in degrees
+    std::vector<REAL>        maxAngle;      ///< Maximum angle of each face in degrees
+    std::vector<REAL>        aspectRatio;   ///< Longest edge/(2*sqrt(3)*inradius)
+    std::vector<REAL>        edgeLength;    ///< Length of each edge
+    std::vector<std::size_t> valence;       ///< Number of edges at each vertex
+
+    /// Counts of all angles in equal bins over [0, 180] degrees
+    std::vector<std::size_t> angleHistogram;
+    /// Number of vertices with each valence
+    std::vector<std::size_t> valenceHistogram;
+
+    SurfaceQualitySummary summary;  ///< Summary over the mesh
+};
+
+/**
+ * @brief      Compute angle, area, aspect ratio, edge length and valence
+ *             measures of a surface mesh in a single parallel pass.
+ *
+ * Degenerate faces have angles of zero and an infinite aspect ratio.
+ *
+ * @param[in]  mesh        The mesh
+ * @param[in]  smallAngle  Angles below this are counted as small
+ * @param[in]  largeAngle  Angles above this are counted as large
+ * @param[in]  nBins       Number of bins of the angle histogram
+ *
+ * @return     The quality statistics
+ */
+SurfaceQualityStats computeQualityStats(const SurfaceMesh& mesh,
+                                        REAL               smallAngle = 15,
+                                        REAL               largeAngle = 165,
+                                        std::size_t        nBins = 18);
+
+/**
+ * @brief      Compute only the face and angle fields of the quality summary.
+ *
+ * A cheaper alternative to computeQualityStats() for monitoring progress,
+ * e.g. between smoothing iterations. No per element arrays or histograms
+ * are allocated and the edge and vertex fields are left at their defaults.
+ *
+ * @param[in]  mesh        The mesh
+ * @param[in]  smallAngle  Angles below this are counted as small
+ * @param[in]  largeAngle  Angles above this are counted as large
+ *
+ * @return     The summary
+ */
+SurfaceQualitySummary computeAngleSummary(const SurfaceMesh& mesh,
+                                          REAL               smallAngle = 15,
+                                          REAL               largeAngle = 165);
+
 /**
  * @brief      Gets the area.
  *
@@ -937,6 +1185,103 @@ double getVolume(const SurfaceMesh& mesh);
  */
 bool hasHole(const SurfaceMesh& mesh);
 
+/**
+ * @brief      A pair of intersecting faces
+ */
+struct FaceIntersection
+{
+    std::size_t               firstMesh;    ///< Index of the mesh of the first face
+    SurfaceMesh::SimplexID<3> firstFace;    ///< The first face
+    std::size_t               secondMesh;   ///< Index of the mesh of the second face
+    SurfaceMesh::SimplexID<3> secondFace;   ///< The second face
+};
+
+/**
+ * @brief      Find intersecting faces within and between surface meshes.
+ *
+ * Faces which share an edge or a vertex only count if they overlap beyond
+ * the shared simplex. Between different meshes, vertices at the same
+ * position are shared and coincident faces are not reported, so surfaces
+ * which share an interface only intersect where they cross. The faces of each mesh are indexed with a FaceBVH and
+ * the candidate pairs are tested in parallel.
+ *
+ * @param      meshes  The meshes
+ * @param[in]  select  Set the selected flag of the intersecting faces
+ * @param[in]  marker  If nonzero, assign this marker to the intersecting
+ *                     faces
+ *
+ * @return     The intersecting pairs sorted by mesh and face order
+ */
+std::vector<FaceIntersection> findIntersections(const std::vector<SurfaceMesh*> &meshes,
+                                                bool select = false,
+                                                int  marker = 0);
+
+/**
+ * @brief      Statistics of the distance from one surface to another
+ */
+struct DistanceStats
+{
+    REAL              max  = 0;     ///< One sided Hausdorff distance
+    REAL              mean = 0;     ///< Area weighted mean distance
+    REAL              rms  = 0;     ///< Area weighted root mean square distance
+    std::vector<REAL> deviations;   ///< Distance of each vertex in get_level_id<1>() order, empty unless requested
+};
+
+/**
+ * @brief      Two sided distance between surfaces
+ */
+struct SurfaceDistance
+{
+    DistanceStats forward;      ///< Distance from the first to the second surface
+    DistanceStats backward;     ///< Distance from the second to the first surface
+
+    /**
+     * @brief      Two sided Hausdorff distance
+     */
+    REAL hausdorff() const
+    {
+        return std::max(forward.max, backward.max);
+    }
+};
+
+/**
+ * @brief      Distance from the points of one surface to another surface.
+ *
+ * The source surface is sampled on a barycentric grid with subdivisions
+ * intervals per edge of every face; with one subdivision only the vertices
+ * are sampled. Each sample is weighted by its share of the face area for the
+ * mean and RMS. Closest points are found with a FaceBVH of the target and
+ * the samples are processed in parallel.
+ *
+ * @param[in]  from          The sampled surface
+ * @param[in]  to            The target surface
+ * @param[in]  subdivisions  Grid intervals per face edge
+ * @param[in]  deviations    Whether to return the distance of each vertex
+ *
+ * @return     The distance statistics
+ */
+DistanceStats oneSidedDistance(const SurfaceMesh &from,
+                               const SurfaceMesh &to,
+                               std::size_t        subdivisions = 1,
+                               bool               deviations = false);
+
+/**
+ * @brief      Distance between two surfaces in both directions.
+ *
+ * See oneSidedDistance() for the sampling.
+ *
+ * @param[in]  a             The first surface
+ * @param[in]  b             The second surface
+ * @param[in]  subdivisions  Grid intervals per face edge
+ * @param[in]  deviations    Whether to return the distance of each vertex
+ *
+ * @return     The distance statistics in both directions
+ */
+SurfaceDistance surfaceDistance(const SurfaceMesh &a,
+                                const SurfaceMesh &b,
+                                std::size_t        subdivisions = 1,
+                                bool               deviations = false);
+
 /**
  * @brief      Gets the number of edges connected to a vertex.
  *
@@ -949,24 +1294,77 @@ inline std::size_t getValence(const SurfaceMesh& mesh, const SurfaceMesh::Simple
     return mesh.get_cover(vertexID).size();
 }
 
+/**
+ * @brief      Per vertex curvature estimates of a surface mesh.
+ *
+ * All arrays are indexed in the order in which get_level_id<1>() visits the
+ * vertices of the mesh. Entries of vertices for which no estimate could be
+ * computed are zero and flagged in valid.
+ */
+struct CurvatureResult
+{
+    std::vector<REAL>          kh;     ///< Mean curvature
+    std::vector<REAL>          kg;     ///< Gaussian curvature
+    std::vector<REAL>          k1;     ///< First principal curvature
+    std::vector<REAL>          k2;     ///< Second principal curvature
+    std::vector<Vector>        d1;     ///< First principal direction, empty unless requested
+    std::vector<Vector>        d2;     ///< Second principal direction, empty unless requested
+    std::vector<unsigned char> valid;  ///< Non-zero where the estimate is defined
+
+    /**
+     * @brief      Allocate zeroed arrays for n vertices
+     *
+     * @param[in]  n           Number of vertices
+     * @param[in]  directions  Whether to allocate principal directions
+     */
+    explicit CurvatureResult(std::size_t n = 0, bool directions = false)
+        : kh(n, 0), kg(n, 0), k1(n, 0), k2(n, 0),
+        d1(directions ? n : 0), d2(directions ? n : 0), valid(n, 0) {}
+
+    /**
+     * @brief      Number of vertices
+     */
+    std::size_t size() const { return kh.size(); }
+};
+
 /**
  * @brief      Compute the curvature using the Meyer, Desbrun, Schröder, Barr
  *             algorithms.
  *
  * @param[in]  mesh    The mesh
+ *
+ * @return     Curvatures in dense vertex order. Vertices without incident
+ *             faces are flagged invalid.
  */
-std::tuple<REAL*, REAL*, REAL*, REAL*, std::map<typename SurfaceMesh::KeyType, typename SurfaceMesh::KeyType> >
-curvatureViaMDSB(const SurfaceMesh& mesh);
+CurvatureResult curvatureViaMDSB(const SurfaceMesh& mesh);
 
 /**
  * @brief      Compute the curvature using the Cazals-Pouget algorithm.
  *
- * @param[in]  dJet    Fit with a d-Jet
- * @param[in]  dPrime  Maximal order differential to compute
- * @param[in]  mesh    The mesh
+ * @param[in]  mesh                 The mesh
+ * @param[in]  dJet                 Fit with a d-Jet
+ * @param[in]  dPrime               Maximal order differential to compute
+ * @param[in]  principalDirections  Also store the principal directions
+ *
+ * @return     Curvatures in dense vertex order. Vertices with too few
+ *             neighbors to fit a jet are flagged invalid.
+ */
+CurvatureResult curvatureViaJets(const SurfaceMesh& mesh,
+                                 std::size_t dJet = 2,
+                                 std::size_t dPrime = 2,
+                                 bool principalDirections = false);
+
+/**
+ * @brief      Average the curvature of each vertex with its valid one ring
+ *             neighbors.
+ *
+ * @param[in]  mesh        The mesh the curvatures were computed on
+ * @param      curvatures  The curvatures to smooth in place
+ * @param[in]  nIter       Number of smoothing iterations
  */
-std::tuple<REAL*, REAL*, REAL*, REAL*, std::map<typename SurfaceMesh::KeyType, typename SurfaceMesh::KeyType> >
-curvatureViaJets(const SurfaceMesh& mesh, std::size_t dJet = 2, std::size_t dPrime = 2);
+void smoothCurvatures(const SurfaceMesh& mesh,
+                      CurvatureResult& curvatures,
+                      std::size_t nIter);
 
 // void osculatingJets(const SurfaceMesh&mesh, std::size_t dJet = 2, std::size_t
 // dPrime = 2);
@@ -1073,9 +1471,42 @@ void coarse_flat(SurfaceMesh& mesh, REAL threshold, REAL weight, std::size_t rin
 /**
  * @brief      Perform smoothing of the mesh normals
  *
- * @param      mesh  The mesh
+ * Each vertex is rotated about the opposite edge of its faces toward the
+ * anisotropically averaged normals of their neighbours, as in
+ * normalSmoothH. All vertices are updated together from the previous
+ * positions, so the pass runs in parallel and the result does not depend
+ * on the vertex order.
+ *
+ * Each vertex moves by the given fraction of its normalSmoothH step. In
+ * the sequential sweep of earlier versions every vertex took the full
+ * step, but from neighbours which had already moved toward the smoothed
+ * normals, so later steps were shorter. Updated together, all corners of
+ * a face rotate toward the same normal at once and the full step
+ * overshoots. The default of one half keeps a pass close to the old
+ * sweep; 1 takes the full step.
+ *
+ * @param      mesh        The mesh
+ * @param[in]  k           Anisotropic smoothing factor
+ * @param[in]  relaxation  Fraction of the step to take, in (0, 1]
+ */
+void normalSmooth(SurfaceMesh& mesh, double k = 1.0, double relaxation = 0.5);
+
+/**
+ * @brief      Implicit fairing by the cotangent Laplacian flow.
+ *
+ * Each step solves the backward Euler system (M - dt L) x' = M x with the
+ * lumped mass matrix M and cotangent Laplacian L by sparse Cholesky
+ * factorization. The factorization is analyzed once and reused for every
+ * step, so one large step smooths as much as many explicit iterations.
+ *
+ * @param      mesh          The mesh
+ * @param[in]  timeStep      Time step relative to the squared mean edge
+ *                           length
+ * @param[in]  steps         Number of steps
+ * @param[in]  selectedOnly  Only move selected vertices and hold the rest
+ *                           fixed
  */
-void normalSmooth(SurfaceMesh& mesh, double k = 1.0);
+void implicitFairing(SurfaceMesh& mesh, REAL timeStep = 1.0, std::size_t steps = 1, bool selectedOnly = false);
 
 /**
  * @brief      Fill holes in the mesh
@@ -1098,6 +1529,119 @@ void flipNormals(SurfaceMesh& mesh);
  */
 std::unique_ptr<SurfaceMesh> refineMesh(const SurfaceMesh& mesh);
 
+/**
+ * @brief      Refine the selected faces of the mesh.
+ *
+ * Selected faces are quadrisected and red-green closure keeps the mesh
+ * conforming: faces with two split edges are quadrisected as well and faces
+ * with one are bisected. Unlike refineMesh, vertex, edge and face data carry
+ * over to the refined elements, so the refined faces stay selected.
+ *
+ * @param[in]  mesh  The mesh
+ *
+ * @return     Pointer to resulting mesh
+ */
+std::unique_ptr<SurfaceMesh> adaptiveRefine(const SurfaceMesh& mesh);
+
+/**
+ * @brief      Refine the mesh until its edges are no longer than a sizing
+ *             field.
+ *
+ * Each level splits the edges longer than the sizing at their midpoint with
+ * the same red-green closure as adaptiveRefine(const SurfaceMesh&). Faces
+ * made by a green bisection also have their longest edge split when they
+ * are refined again, so the angles do not keep shrinking from level to
+ * level.
+ *
+ * @param[in]  mesh       The mesh
+ * @param[in]  sizing     Largest edge length at a point. It is called
+ *                        concurrently and must be thread safe.
+ * @param[in]  maxLevels  Maximum number of refinement levels
+ *
+ * @return     Pointer to resulting mesh
+ */
+std::unique_ptr<SurfaceMesh> adaptiveRefine(const SurfaceMesh&                       mesh,
+                                            const std::function<REAL(const Vector&)>& sizing,
+                                            std::size_t                               maxLevels = 4);
+
+/**
+ * @brief      Refine the mesh until its edges are no longer than a length
+ *             given at each vertex.
+ *
+ * The length at a point is interpolated over the closest face of the input
+ * mesh.
+ *
+ * @param[in]  mesh          The mesh
+ * @param[in]  vertexSizing  Largest edge length at each vertex in
+ *                           get_level_id<1>() order
+ * @param[in]  maxLevels     Maximum number of refinement levels
+ *
+ * @return     Pointer to resulting mesh
+ */
+std::unique_ptr<SurfaceMesh> adaptiveRefine(const SurfaceMesh&       mesh,
+                                            const std::vector<REAL>& vertexSizing,
+                                            std::size_t              maxLevels = 4);
+
+/**
+ * @brief      Remesh a surface toward a uniform edge length.
+ *
+ * Each iteration splits edges longer than 4/3 of the target, collapses edges
+ * shorter than 4/5 of it, flips edges to even out the valences and moves the
+ * vertices tangentially toward the centroid of their neighbours. Boundary
+ * edges and edges between faces with different markers are kept as feature
+ * lines. Vertices slide along these lines and their corners do not move.
+ * Face markers and properties carry
+ * over to the faces they are subdivided into.
+ *
+ * @param[in]  mesh          The mesh
+ * @param[in]  targetLength  The target edge length
+ * @param[in]  iterations    Number of split, collapse, flip and relax passes
+ * @param[in]  project       Project moved vertices back onto the input
+ *                           surface
+ *
+ * @return     Pointer to resulting mesh
+ */
+std::unique_ptr<SurfaceMesh> isotropicRemesh(const SurfaceMesh& mesh,
+                                             REAL               targetLength,
+                                             std::size_t        iterations = 5,
+                                             bool               project = true);
+
+/**
+ * @brief      Remesh a surface toward a spatially varying edge length.
+ *
+ * @param[in]  mesh        The mesh
+ * @param[in]  sizing      Target edge length at a point. It is called
+ *                         concurrently and must be thread safe.
+ * @param[in]  iterations  Number of split, collapse, flip and relax passes
+ * @param[in]  project     Project moved vertices back onto the input surface
+ *
+ * @return     Pointer to resulting mesh
+ */
+std::unique_ptr<SurfaceMesh> isotropicRemesh(const SurfaceMesh&                       mesh,
+                                             const std::function<REAL(const Vector&)>& sizing,
+                                             std::size_t                               iterations = 5,
+                                             bool                                      project = true);
+
+/**
+ * @brief      Remesh a surface toward an edge length given at each vertex.
+ *
+ * The target at a point is interpolated over the closest face of the
+ * input mesh.
+ *
+ * @param[in]  mesh          The mesh
+ * @param[in]  vertexSizing  Target edge length at each vertex in
+ *                           get_level_id<1>() order
+ * @param[in]  iterations    Number of split, collapse, flip and relax passes
+ * @param[in]  project       Project moved vertices back onto the input
+ *                           surface
+ *
+ * @return     Pointer to resulting mesh
+ */
+std::unique_ptr<SurfaceMesh> isotropicRemesh(const SurfaceMesh&       mesh,
+                                             const std::vector<REAL>& vertexSizing,
+                                             std::size_t              iterations = 5,
+                                             bool                     project = true);
+
 /**
  * @brief      Create a triangulated octahedron
  *
@@ -1116,10 +1660,88 @@ std::unique_ptr<SurfaceMesh> sphere(int order);
  */
 std::unique_ptr<SurfaceMesh> cube(int order);
 
+/**
+ * @brief      Construct a SurfaceMesh from dense arrays.
+ *
+ * Vertices are keyed by their position in the vertex array, offset by
+ * firstKey. Face indices always count from zero. The orientation
+ * of each face follows the winding of its vertex indices and is checked for
+ * consistency within each connected component. If the windings are
+ * inconsistent the orientation is recomputed with casc::compute_orientation
+ * and a warning is printed. Throws std::runtime_error if a face index is out
+ * of range or a face repeats a vertex.
+ *
+ * @param[in]  nVertices      Number of vertices
+ * @param[in]  vertices       Vertex positions, nVertices*3 values
+ * @param[in]  vertexMarkers  Vertex markers, nVertices values or nullptr
+ * @param[in]  nFaces         Number of faces
+ * @param[in]  faces          Face vertex indices, nFaces*3 values
+ * @param[in]  faceMarkers    Face markers, nFaces values or nullptr for the
+ *                            default marker -1
+ * @param[in]  firstKey       Key of the first vertex
+ *
+ * @return     Pointer to resulting mesh
+ */
+std::unique_ptr<SurfaceMesh> surfaceMeshFromArrays(std::size_t nVertices,
+                                                   const REAL *vertices,
+                                                   const int *vertexMarkers,
+                                                   std::size_t nFaces,
+                                                   const int *faces,
+                                                   const int *faceMarkers,
+                                                   int firstKey = 0);
+
+/**
+ * @brief      Topology of one set of faces connected through shared edges.
+ */
+struct SurfaceComponent
+{
+    std::size_t nVertices      = 0; /**< @brief Number of vertices */
+    std::size_t nEdges         = 0; /**< @brief Number of edges */
+    std::size_t nFaces         = 0; /**< @brief Number of faces */
+    std::size_t nBoundaryLoops = 0; /**< @brief Number of boundary curves */
+    bool        orientable     = true;  /**< @brief Faces can be oriented consistently */
+    bool        manifold       = true;  /**< @brief No edge has more than two faces */
+
+    /**
+     * @brief      Euler characteristic V - E + F
+     */
+    long eulerCharacteristic() const
+    {
+        return static_cast<long>(nVertices) - static_cast<long>(nEdges)
+               + static_cast<long>(nFaces);
+    }
+};
+
+/**
+ * @brief      Components of a surface mesh.
+ */
+struct SurfaceTopology
+{
+    /// Component of each face in get_level_id<3>() order
+    std::vector<std::size_t>      faceComponent;
+    /// Summary of each component in order of its first face
+    std::vector<SurfaceComponent> components;
+};
+
+/**
+ * @brief      Label the edge connected components of a mesh and summarize
+ *             their topology.
+ *
+ * Uses a union-find over the faces, so the cost is near linear in the
+ * number of faces.
+ *
+ * @param[in]  mesh  The mesh
+ *
+ * @return     The components
+ */
+SurfaceTopology analyzeTopology(const SurfaceMesh& mesh);
+
 /**
  * @brief      Split connected surfaces from a single mesh.
  *
- *             Note that this function creates new meshes from surfaces
+ *             Note that this function creates new meshes from surfaces.
+ *             Each set of faces connected through shared edges becomes
+ *             one mesh, oriented with outward normals.
  *
  * @param      mesh  The mesh
  *
@@ -1129,5 +1751,18 @@ std::vector<std::unique_ptr<SurfaceMesh> > splitSurfaces(SurfaceMesh& mesh);
 
 void cacheNormals(SurfaceMesh& mesh);
 
+/**
+ * @brief      Compute the Betti numbers of the mesh.
+ *
+ * @param      mesh  The mesh
+ *
+ * The first Betti number b1 is derived from the Euler characteristic,
+ * b1 = b0 + b2 - (V - E + F). It counts independent loops: a closed genus g
+ * surface has b1 = 2g, a disk has b1 = 0, and an annulus has b1 = 1.
+ *
+ * @return     Tuple of whether the mesh is manifold, the number of connected
+ *             components b0, the first Betti number b1, and the number of
+ *             voids b2
+ */
 std::tuple<bool, int, int, int> getBettiNumbers(SurfaceMesh& mesh);
 } // end namespace gamer
@@ -30,11 +30,15 @@
 
 #pragma once
 
+#include <array>
+#include <limits>
+#include <map>
 #include <sstream>
 #include <memory>
 #include <string>
 #include <unordered_set>
 #include <utility>
+#include <vector>
 
 #include <gamer/gamer.h>
 
@@ -334,17 +338,55 @@ using TetMesh = casc::simplicial_complex<tetmesh_detail::tetmesh_traits>;
  */
 std::unique_ptr<TetMesh> tetgenioToTetMesh(tetgenio &tetio);
 
+/**
+ * @brief      Construct a TetMesh from dense arrays.
+ *
+ * Vertices are keyed by their position in the vertex array. Cells are
+ * oriented consistently such that the first cell has positive volume.
+ * Throws std::runtime_error if a cell index is out of range or a marked
+ * face is not a face of any cell.
+ *
+ * @param[in]  nVertices      Number of vertices
+ * @param[in]  vertices       Vertex positions, nVertices*3 values
+ * @param[in]  vertexMarkers  Vertex markers, nVertices values or nullptr
+ * @param[in]  nCells         Number of tetrahedra
+ * @param[in]  cells          Tetrahedra vertex indices, nCells*4 values
+ * @param[in]  cellMarkers    Cell markers, nCells values or nullptr
+ * @param[in]  nFaces         Number of marked faces
+ * @param[in]  faces          Marked face vertex indices, nFaces*3 values
+ * @param[in]  faceMarkers    Face markers, nFaces values
+ *
+ * @return     Tetrahedral mesh
+ */
+std::unique_ptr<TetMesh> tetMeshFromArrays(std::size_t nVertices,
+                                           const REAL *vertices,
+                                           const int *vertexMarkers,
+                                           std::size_t nCells,
+                                           const int *cells,
+                                           const int *cellMarkers,
+                                           std::size_t nFaces = 0,
+                                           const int *faces = nullptr,
+                                           const int *faceMarkers = nullptr);
+
 /**
  * @brief      Call TetGen to make a tetrahedral mesh from a stack of surface meshes.
  *
+ * The surfaces are checked with findIntersections() before TetGen runs and
+ * a std::runtime_error listing the intersecting face pairs is thrown if any
+ * are found. Surfaces which share an interface of coincident vertices and
+ * faces are accepted. With strict off the pairs are only printed as a
+ * warning and TetGen is left to deal with them.
+ *
  * @param[in]  surfmeshes     List of surface meshes
  * @param[in]  tetgen_params  TetGen parameters
+ * @param[in]  strict         Throw instead of warning about intersections
  *
  * @return     Tetrahedral mesh
  */
 std::unique_ptr<TetMesh> makeTetMesh(
     const std::vector<SurfaceMesh*> &surfmeshes,
-    std::string                      tetgen_params);
+    std::string                      tetgen_params,
+    bool                             strict = true);
 
 /**
  * @brief      Extracts the boundary surface of a tetrahedral mesh
@@ -363,6 +405,83 @@ std::unique_ptr<SurfaceMesh> extractSurface(const TetMesh &mesh);
  */
 void smoothMesh(TetMesh &mesh);
 
+/**
+ * @brief      Quality guarded optimization of vertex positions.
+ *
+ * Interior vertices are relocated towards the optimal Delaunay
+ * triangulation (ODT) position or the barycenter of their neighbors. A move
+ * is only accepted if it improves the minimum dihedral angle or the minimum
+ * radius ratio of the surrounding cells without worsening the other and
+ * without inverting any cell. Vertices on the boundary, on marked faces, or
+ * between cells of different markers are held fixed. Independent vertices
+ * are grouped by graph coloring and each group is processed in parallel.
+ *
+ * @param      mesh     The mesh
+ * @param[in]  maxIter  Maximum number of sweeps over the vertices
+ *
+ * @return     Number of accepted vertex moves
+ */
+std::size_t optimizeMesh(TetMesh &mesh, std::size_t maxIter = 10);
+
+/**
+ * @brief      Summary of the quality of a set of tetrahedra
+ */
+struct TetQualitySummary
+{
+    std::size_t nCells          = 0;    ///< Number of cells
+    std::size_t nInverted       = 0;    ///< Number of cells with non-positive volume
+    REAL        minDihedral     = 180;  ///< Minimum dihedral angle in degrees
+    REAL        maxDihedral     = 0;    ///< Maximum dihedral angle in degrees
+    REAL        minRadiusRatio  = 1;    ///< Minimum normalized radius ratio
+    REAL        meanRadiusRatio = 0;    ///< Mean normalized radius ratio
+    REAL        maxAspectRatio  = 0;    ///< Maximum normalized aspect ratio
+    REAL        minVolume       = std::numeric_limits<REAL>::max();    ///< Minimum volume
+    REAL        maxVolume       = std::numeric_limits<REAL>::lowest(); ///< Maximum volume
+    REAL        totalVolume     = 0;    ///< Sum of volumes
+    REAL        minEdgeLength   = std::numeric_limits<REAL>::max();    ///< Shortest edge
+    REAL        maxEdgeLength   = 0;    ///< Longest edge
+    REAL        meanEdgeLength  = 0;    ///< Mean length of the edges of each cell
+};
+
+/**
+ * @brief      Per cell quality measures and their distributions
+ *
+ * Per cell arrays follow the iteration order of the cells in the mesh.
+ */
+struct TetQualityStats
+{
+    std::vector<int>  marker;           ///< Cell markers
+    std::vector<REAL> volume;           ///< Signed volume
+    std::vector<REAL> minDihedral;      ///< Minimum dihedral angle in degrees
+    std::vector<REAL> maxDihedral;      ///< Maximum dihedral angle in degrees
+    std::vector<REAL> radiusRatio;      ///< 3*inradius/circumradius
+    std::vector<REAL> aspectRatio;      ///< Longest edge/(2*sqrt(6)*inradius)
+    std::vector<REAL> minEdgeLength;    ///< Shortest edge of each cell
+    std::vector<REAL> maxEdgeLength;    ///< Longest edge of each cell
+
+    /// Counts of all dihedral angles in equal bins over [0, 180] degrees
+    std::vector<std::size_t> dihedralHistogram;
+    /// Counts of radius ratios in equal bins over [0, 1]
+    std::vector<std::size_t> radiusRatioHistogram;
+
+    TetQualitySummary summary;                      ///< Summary over all cells
+    std::map<int, TetQualitySummary> markerSummary; ///< Summary per cell marker
+};
+
+/**
+ * @brief      Compute quality measures of all cells in a single parallel
+ *             pass.
+ *
+ * The volume of a cell is signed by its orientation so inverted cells can
+ * be detected after compute_orientation() has been run.
+ *
+ * @param[in]  mesh   The mesh
+ * @param[in]  nBins  Number of bins of the histograms
+ *
+ * @return     The quality statistics
+ */
+TetQualityStats computeQualityStats(const TetMesh &mesh, std::size_t nBins = 18);
+
 /**
  * @brief      Writes the mesh out in VTK format.
  *
@@ -371,6 +490,24 @@ void smoothMesh(TetMesh &mesh);
  */
 void writeVTK(const std::string &filename, const TetMesh &mesh);
 
+/**
+ * @brief      Writes the mesh out in binary VTK XML unstructured grid format.
+ *
+ * Tetrahedra are written as cells along with any marked faces as triangles.
+ * Cell and face markers are stored in the cell data array "marker" and
+ * vertex markers in the point data array "vertex_marker". All arrays are
+ * stored as raw appended binary data.
+ *
+ * @param[in]  filename      The filename
+ * @param[in]  mesh          The mesh
+ * @param[in]  vertexFields  Additional per vertex fields to write keyed by
+ *                           name. The number of values of each field must
+ *                           be a multiple of the number of vertices.
+ */
+void writeVTU(const std::string                                 &filename,
+              const TetMesh                                     &mesh,
+              const std::map<std::string, std::vector<REAL> >  &vertexFields = {});
+
 /**
  * @brief      Writes the mesh out in OFF format.
  *
@@ -379,6 +516,33 @@ void writeVTK(const std::string &filename, const TetMesh &mesh);
  */
 void writeOFF(const std::string &filename, const TetMesh &mesh);
 
+/**
+ * @brief      Writes the mesh out in binary Gmsh MSH 4.1 format.
+ *
+ * Cells are grouped into one volume entity per cell marker and marked faces
+ * into one surface entity per face marker. Positive markers are stored as
+ * physical tags. Throws std::runtime_error if the mesh has vertices but no
+ * cells or marked faces.
+ *
+ * @param[in]  filename  The filename
+ * @param[in]  mesh      The mesh
+ */
+void writeMSH(const std::string &filename, const TetMesh &mesh);
+
+/**
+ * @brief      Writes a lossless binary snapshot of the mesh.
+ *
+ * See writeSnapshot(const std::string&, const SurfaceMesh&, ...). Vertex
+ * errors, face markers, and higher order edge positions are also stored.
+ *
+ * @param[in]  filename      The filename
+ * @param[in]  mesh          The mesh
+ * @param[in]  vertexFields  Additional per vertex values in
+ *                           get_level_id<1>() order
+ */
+void writeSnapshot(const std::string &filename, const TetMesh &mesh,
+                   const std::map<std::string, std::vector<REAL> > &vertexFields = {});
+
 /**
  * @brief      Writes the mesh out in dolfin XML format.
  *
@@ -407,4 +571,87 @@ void writeTriangle(const std::string &filename, const TetMesh &mesh);
  * @return     Tetrahedral mesh
  */
 std::unique_ptr<TetMesh> readDolfin(const std::string &filename);
+
+/**
+ * @brief      Reads in a mesh in binary Gmsh MSH 4.1 format
+ *
+ * Tetrahedra become cells and triangles mark the faces they coincide with.
+ * The first physical tag of each entity is used as the marker, or -1 if it
+ * has none. Blocks of other element types are skipped.
+ *
+ * @param[in]  filename  The filename
+ *
+ * @return     Tetrahedral mesh
+ */
+std::unique_ptr<TetMesh> readMSH_TetMesh(const std::string &filename);
+
+/**
+ * @brief      Reads a TetMesh snapshot written by writeSnapshot
+ *
+ * @param[in]  filename      The filename
+ * @param      vertexFields  If not null, receives the stored vertex fields
+ *
+ * @return     Tetrahedral mesh
+ */
+std::unique_ptr<TetMesh> readSnapshot_TetMesh(const std::string &filename,
+                                              std::map<std::string, std::vector<REAL> > *vertexFields = nullptr);
+
+/// @cond detail
+/// Namespace for tetmesh detail functions
+namespace tetmesh_detail
+{
+/**
+ * @brief      Signed volume of a tetrahedron
+ *
+ * @param[in]  a     First vertex
+ * @param[in]  b     Second vertex
+ * @param[in]  c     Third vertex
+ * @param[in]  d     Fourth vertex
+ *
+ * @return     Volume which is positive if d lies above the triangle abc
+ */
+REAL signedVolume(const Vector &a, const Vector &b, const Vector &c, const Vector &d);
+
+/**
+ * @brief      Circumcenter of a tetrahedron
+ *
+ * @param[in]  a     First vertex
+ * @param[in]  b     Second vertex
+ * @param[in]  c     Third vertex
+ * @param[in]  d     Fourth vertex
+ *
+ * @return     The circumcenter. The centroid is returned for degenerate
+ *             tetrahedra.
+ */
+Vector circumcenter(const Vector &a, const Vector &b, const Vector &c, const Vector &d);
+
+/**
+ * @brief      Normalized radius ratio of a tetrahedron
+ *
+ * The ratio is three times the inradius over the circumradius, which is one
+ * for the regular tetrahedron and zero for degenerate ones. The sign
+ * follows the sign of the volume.
+ *
+ * @param[in]  a     First vertex
+ * @param[in]  b     Second vertex
+ * @param[in]  c     Third vertex
+ * @param[in]  d     Fourth vertex
+ *
+ * @return     The radius ratio
+ */
+REAL radiusRatio(const Vector &a, const Vector &b, const Vector &c, const Vector &d);
+
+/**
+ * @brief      Interior dihedral angles of a tetrahedron
+ *
+ * @param[in]  a     First vertex
+ * @param[in]  b     Second vertex
+ * @param[in]  c     Third vertex
+ * @param[in]  d     Fourth vertex
+ *
+ * @return     Angles in degrees at edges ab, ac, ad, bc, bd, cd
+ */
+std::array<REAL, 6> dihedralAngles(const Vector &a, const Vector &b, const Vector &c, const Vector &d);
+} // end namespace tetmesh_detail
+/// @endcond
 } // end namespace gamer
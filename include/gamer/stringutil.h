@@ -31,7 +31,8 @@
 
 #include <algorithm>
 #include <cctype>
-#include <functional>
+#include <cstdlib>
+#include <cstring>
 #include <string>
 #include <vector>
 
@@ -78,10 +79,11 @@ inline std::vector<std::string> split(const std::string &cstr, std::vector<char>
 /// Namespace for internal string utility functions
 namespace stringutil_detail
 {
-/// Functor for negated isspace
-std::function<int(int)> isntspace = [](int c) -> int{
-        return !std::isspace(c);
-    };
+/// Negated isspace
+inline int isntspace(int c)
+{
+    return !std::isspace(c);
+}
 }
 /// @endcond
 
@@ -116,5 +118,123 @@ inline void trim(std::string &s)
     ltrim(s);
     rtrim(s);
 }
+/**
+ * @brief      Advance past blanks on the current line
+ *
+ * @param[in]  p     Current position
+ * @param[in]  end   End of the buffer
+ *
+ * @return     Position of the first character which is not a blank
+ */
+inline const char *skipBlank(const char *p, const char *end)
+{
+    while (p != end && (*p == ' ' || *p == '\t' || *p == '\r'))
+        ++p;
+    return p;
+}
+
+/**
+ * @brief      Advance to the start of the next line
+ *
+ * @param[in]  p     Current position
+ * @param[in]  end   End of the buffer
+ *
+ * @return     Position after the next newline or end
+ */
+inline const char *skipLine(const char *p, const char *end)
+{
+    p = static_cast<const char *>(std::memchr(p, '\n', end - p));
+    return (p) ? p + 1 : end;
+}
+
+/**
+ * @brief      Parse an integer from a buffer without allocating
+ *
+ * Leading blanks are skipped. On success p points past the last digit.
+ *
+ * @param      p      Current position
+ * @param[in]  end    End of the buffer
+ * @param      value  The value
+ *
+ * @return     True if an integer was parsed
+ */
+inline bool parseInt(const char *&p, const char *end, long &value)
+{
+    const char *q = skipBlank(p, end);
+    bool negative = false;
+    if (q != end && (*q == '-' || *q == '+'))
+        negative = (*q++ == '-');
+    if (q == end || !std::isdigit(static_cast<unsigned char>(*q)))
+        return false;
+
+    long result = 0;
+    while (q != end && std::isdigit(static_cast<unsigned char>(*q)))
+        result = 10*result + (*q++ - '0');
+    value = (negative) ? -result : result;
+    p = q;
+    return true;
+}
+
+/**
+ * @brief      Parse a floating point number from a buffer without allocating
+ *             on the heap
+ *
+ * Leading blanks are skipped and the number must be followed by white space
+ * or the end of the buffer. On success p points past the number.
+ *
+ * @param      p      Current position
+ * @param[in]  end    End of the buffer
+ * @param      value  The value
+ *
+ * @return     True if a number was parsed
+ */
+inline bool parseReal(const char *&p, const char *end, double &value)
+{
+    const char *q = skipBlank(p, end);
+    const char *start = q;
+    while (q != end && !std::isspace(static_cast<unsigned char>(*q)))
+        ++q;
+
+    // The buffer need not be null terminated so copy the token
+    char buffer[64];
+    std::size_t length = q - start;
+    if (length == 0 || length >= sizeof(buffer))
+        return false;
+    std::memcpy(buffer, start, length);
+    buffer[length] = '\0';
+
+    char *stop;
+    value = std::strtod(buffer, &stop);
+    if (stop != buffer + length)
+        return false;
+    p = q;
+    return true;
+}
+
+/**
+ * @brief      Split a buffer into chunks which begin at the start of a line
+ *
+ * @param[in]  begin      Start of the buffer
+ * @param[in]  end        End of the buffer
+ * @param[in]  chunkSize  Approximate size of each chunk in bytes
+ *
+ * @return     Boundaries of the chunks including begin and end
+ */
+inline std::vector<const char *> lineChunks(const char *begin,
+                                            const char *end,
+                                            std::size_t chunkSize)
+{
+    std::vector<const char *> bounds(1, begin);
+    const char *p = begin;
+    while (static_cast<std::size_t>(end - p) > chunkSize)
+    {
+        p = skipLine(p + chunkSize, end);
+        if (p == end)
+            break;
+        bounds.push_back(p);
+    }
+    bounds.push_back(end);
+    return bounds;
+}
 } // end namespace stringutil
 } // end namespace gamer
@@ -0,0 +1,184 @@
+/*
+ * ***************************************************************************
+ * This file is part of the GAMer software.
+ * Copyright (C) 2016-2018
+ * by Christopher Lee, John Moody, Rommie Amaro, J. Andrew McCammon,
+ *    and Michael Holst
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * ***************************************************************************
+ */
+
+#pragma once
+
+#include <pybind11/pybind11.h>
+
+#include <array>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <streambuf>
+#include <string>
+
+/// Namespace for all things gamer
+namespace gamer
+{
+
+namespace py = pybind11;
+
+/// @cond detail
+namespace pygamer_detail
+{
+/**
+ * @brief      Stream buffer which sends the output of threads with a capture
+ *             target to that target and everything else to the original
+ *             buffer of the stream.
+ */
+class ThreadCaptureBuf : public std::streambuf
+{
+public:
+    /**
+     * @param[in]  stream  0 for std::cout, 1 for std::cerr
+     */
+    explicit ThreadCaptureBuf(std::size_t stream) : stream(stream) {}
+
+    /// Capture targets of the calling thread, indexed like stream
+    static std::array<std::stringstream*, 2> &targets()
+    {
+        static thread_local std::array<std::stringstream*, 2> targets = {{nullptr, nullptr}};
+        return targets;
+    }
+
+    std::streambuf *original = nullptr;
+
+protected:
+    int_type overflow(int_type c) override
+    {
+        if (traits_type::eq_int_type(c, traits_type::eof()))
+            return traits_type::not_eof(c);
+        if (auto target = targets()[stream])
+        {
+            target->put(traits_type::to_char_type(c));
+            return c;
+        }
+        return original->sputc(traits_type::to_char_type(c));
+    }
+
+    std::streamsize xsputn(const char *s, std::streamsize n) override
+    {
+        if (auto target = targets()[stream])
+        {
+            target->write(s, n);
+            return n;
+        }
+        return original->sputn(s, n);
+    }
+
+    int sync() override
+    {
+        return targets()[stream] ? 0 : original->pubsync();
+    }
+
+private:
+    std::size_t stream;
+};
+
+/**
+ * @brief      Call guard which captures std::cout and std::cerr of the
+ *             calling thread and writes them to sys.stdout and sys.stderr
+ *             when the call returns.
+ *
+ * Meant to be listed before py::gil_scoped_release in a py::call_guard so
+ * that it is constructed and destroyed while the GIL is held. Unlike
+ * py::scoped_ostream_redirect nothing touches Python while the call runs,
+ * so several threads can run captured calls at once. Output of other
+ * threads, including OpenMP workers, still goes to the process streams.
+ */
+class CapturedOutput
+{
+public:
+    CapturedOutput()
+    {
+        std::lock_guard<std::mutex> lock(mutex());
+        if (users()++ == 0)
+        {
+            buf(0).original = std::cout.rdbuf(&buf(0));
+            buf(1).original = std::cerr.rdbuf(&buf(1));
+        }
+        ThreadCaptureBuf::targets() = {{&out, &err}};
+    }
+
+    ~CapturedOutput()
+    {
+        ThreadCaptureBuf::targets() = {{nullptr, nullptr}};
+        {
+            std::lock_guard<std::mutex> lock(mutex());
+            if (--users() == 0)
+            {
+                std::cout.rdbuf(buf(0).original);
+                std::cerr.rdbuf(buf(1).original);
+            }
+        }
+        write("stdout", out.str(), std::cout);
+        write("stderr", err.str(), std::cerr);
+    }
+
+    CapturedOutput(const CapturedOutput&) = delete;
+    CapturedOutput &operator=(const CapturedOutput&) = delete;
+
+private:
+    static std::mutex &mutex()
+    {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    static std::size_t &users()
+    {
+        static std::size_t users = 0;
+        return users;
+    }
+
+    static ThreadCaptureBuf &buf(std::size_t stream)
+    {
+        static ThreadCaptureBuf coutBuf(0), cerrBuf(1);
+        return stream == 0 ? coutBuf : cerrBuf;
+    }
+
+    /// Write to a Python stream, falling back to the C++ one
+    static void write(const char *name, const std::string &text, std::ostream &fallback)
+    {
+        if (text.empty())
+            return;
+        try
+        {
+            auto stream = py::module::import("sys").attr(name);
+            stream.attr("write")(text);
+            stream.attr("flush")();
+        }
+        catch (...)
+        {
+            PyErr_Clear();
+            fallback << text << std::flush;
+        }
+    }
+
+    std::stringstream out;
+    std::stringstream err;
+};
+} // end namespace pygamer_detail
+/// @endcond
+} // end namespace gamer
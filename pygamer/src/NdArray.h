@@ -0,0 +1,282 @@
+/*
+ * ***************************************************************************
+ * This file is part of the GAMer software.
+ * Copyright (C) 2016-2018
+ * by Christopher Lee, John Moody, Rommie Amaro, J. Andrew McCammon,
+ *    and Michael Holst
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * ***************************************************************************
+ */
+
+#pragma once
+
+#include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
+
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+/// Namespace for all things gamer
+namespace gamer
+{
+
+namespace py = pybind11;
+
+/// @cond detail
+namespace pygamer_detail
+{
+/**
+ * @brief      Hand ownership of a vector to a NumPy array without copying.
+ *
+ * @param      vec    Vector to move into the array
+ * @param[in]  shape  Shape of the resulting array; flat if empty
+ */
+template <typename T>
+py::array_t<T> vectorToNdarray(std::vector<T> &&vec,
+                               std::vector<std::size_t> shape = {})
+{
+    if (shape.empty())
+        shape.push_back(vec.size());
+
+    std::vector<std::size_t> strides(shape.size(), sizeof(T));
+    for (std::size_t i = shape.size() - 1; i > 0; --i)
+        strides[i-1] = strides[i]*shape[i];
+
+    auto data = new std::vector<T>(std::move(vec));
+    auto free_data = py::capsule(
+                        data,
+                        [](void *data) {
+                            delete reinterpret_cast<std::vector<T>*>(data);
+                     });
+    return py::array_t<T>(shape, strides, data->data(), free_data);
+}
+
+/**
+ * @brief      Gather a per simplex attribute of level k into a NumPy array.
+ *
+ * Simplices are visited in the order of get_level_id<k>() which is the
+ * dense ordering used by to_ndarray.
+ *
+ * @param[in]  mesh   The mesh
+ * @param[in]  get    Functor mapping the simplex data to the value
+ */
+template <std::size_t k, typename T, typename Complex, typename Getter>
+py::array_t<T> levelToNdarray(const Complex &mesh, Getter &&get)
+{
+    const std::size_t n = mesh.template size<k>();
+    T *values = new T[n];
+    std::size_t i = 0;
+    for (const auto simplexID : mesh.template get_level_id<k>())
+        values[i++] = static_cast<T>(get(*simplexID));
+
+    auto free_values = py::capsule(
+                        values,
+                        [](void *values) {
+                            delete[] reinterpret_cast<T*>(values);
+                     });
+    return py::array_t<T>(n, values, free_values);
+}
+
+/**
+ * @brief      Scatter a NumPy array onto a per simplex attribute of level k.
+ *
+ * @param      mesh    The mesh
+ * @param[in]  values  One value per simplex in the order of get_level_id<k>()
+ * @param[in]  set     Functor assigning a value to the simplex data
+ * @param[in]  name    Name of the attribute for error messages
+ */
+template <std::size_t k, typename T, typename Complex, typename Setter>
+void ndarrayToLevel(Complex &mesh,
+                    py::array_t<T, py::array::c_style | py::array::forcecast> values,
+                    Setter &&set,
+                    const char *name)
+{
+    if (static_cast<std::size_t>(values.size()) != mesh.template size<k>())
+    {
+        std::stringstream ss;
+        ss << name << " must have " << mesh.template size<k>() << " entries.";
+        throw std::invalid_argument(ss.str());
+    }
+    const T *data = values.data();
+    for (const auto simplexID : mesh.template get_level_id<k>())
+        set(*simplexID, *data++);
+}
+
+/**
+ * @brief      Define bulk accessors for the vertex and face attributes shared
+ *             by SurfaceMesh and TetMesh.
+ *
+ * @param      cls   The pybind11 class to extend
+ */
+template <typename Complex>
+void defineAttributeArrays(py::class_<Complex> &cls)
+{
+    using VertexData = typename Complex::template NodeData<1>;
+    using FaceData   = typename Complex::template NodeData<3>;
+
+    cls.def("vertex_positions",
+        [](const Complex &mesh){
+            std::vector<double> positions;
+            positions.reserve(3*mesh.template size<1>());
+            for (const auto vertexID : mesh.template get_level_id<1>())
+            {
+                const auto &vertex = *vertexID;
+                positions.push_back(vertex[0]);
+                positions.push_back(vertex[1]);
+                positions.push_back(vertex[2]);
+            }
+            return vectorToNdarray(std::move(positions), {mesh.template size<1>(), 3});
+        },
+        R"delim(
+            Get the positions of all vertices.
+
+            Returns:
+                :py:class:`numpy.ndarray`: (nVertices, 3) array of vertex coordinates in the order of :py:func:`to_ndarray`.
+        )delim"
+    );
+
+    cls.def("set_vertex_positions",
+        [](Complex &mesh, py::array_t<double, py::array::c_style | py::array::forcecast> positions){
+            if (positions.ndim() != 2 || positions.shape(1) != 3
+                || static_cast<std::size_t>(positions.shape(0)) != mesh.template size<1>())
+            {
+                std::stringstream ss;
+                ss << "positions must be an array of shape (" << mesh.template size<1>() << ", 3).";
+                throw std::invalid_argument(ss.str());
+            }
+            const double *data = positions.data();
+            for (const auto vertexID : mesh.template get_level_id<1>())
+            {
+                auto &vertex = *vertexID;
+                vertex[0] = *data++;
+                vertex[1] = *data++;
+                vertex[2] = *data++;
+            }
+        },
+        py::arg("positions"),
+        R"delim(
+            Set the positions of all vertices.
+
+            Args:
+                positions (:py:class:`numpy.ndarray`): (nVertices, 3) array of vertex coordinates in the order of :py:func:`to_ndarray`.
+        )delim"
+    );
+
+    cls.def("vertex_markers",
+        [](const Complex &mesh){
+            return levelToNdarray<1, int>(mesh, [](const VertexData &v){ return v.marker; });
+        },
+        R"delim(
+            Get the markers of all vertices.
+
+            Returns:
+                :py:class:`numpy.ndarray`: Array of vertex markers in the order of :py:func:`to_ndarray`.
+        )delim"
+    );
+
+    cls.def("set_vertex_markers",
+        [](Complex &mesh, py::array_t<int, py::array::c_style | py::array::forcecast> markers){
+            ndarrayToLevel<1>(mesh, markers, [](VertexData &v, int m){ v.marker = m; }, "markers");
+        },
+        py::arg("markers"),
+        R"delim(
+            Set the markers of all vertices.
+
+            Args:
+                markers (:py:class:`numpy.ndarray`): Array of vertex markers in the order of :py:func:`to_ndarray`.
+        )delim"
+    );
+
+    cls.def("vertex_selected",
+        [](const Complex &mesh){
+            return levelToNdarray<1, bool>(mesh, [](const VertexData &v){ return v.selected; });
+        },
+        R"delim(
+            Get the selection flags of all vertices.
+
+            Returns:
+                :py:class:`numpy.ndarray`: Boolean array in the order of :py:func:`to_ndarray`.
+        )delim"
+    );
+
+    cls.def("set_vertex_selected",
+        [](Complex &mesh, py::array_t<bool, py::array::c_style | py::array::forcecast> selected){
+            ndarrayToLevel<1>(mesh, selected, [](VertexData &v, bool s){ v.selected = s; }, "selected");
+        },
+        py::arg("selected"),
+        R"delim(
+            Set the selection flags of all vertices.
+
+            Args:
+                selected (:py:class:`numpy.ndarray`): Boolean array in the order of :py:func:`to_ndarray`.
+        )delim"
+    );
+
+    cls.def("face_markers",
+        [](const Complex &mesh){
+            return levelToNdarray<3, int>(mesh, [](const FaceData &f){ return f.marker; });
+        },
+        R"delim(
+            Get the markers of all faces.
+
+            Returns:
+                :py:class:`numpy.ndarray`: Array of face markers in the order of :py:func:`getFaceIDIterator`.
+        )delim"
+    );
+
+    cls.def("set_face_markers",
+        [](Complex &mesh, py::array_t<int, py::array::c_style | py::array::forcecast> markers){
+            ndarrayToLevel<3>(mesh, markers, [](FaceData &f, int m){ f.marker = m; }, "markers");
+        },
+        py::arg("markers"),
+        R"delim(
+            Set the markers of all faces.
+
+            Args:
+                markers (:py:class:`numpy.ndarray`): Array of face markers in the order of :py:func:`getFaceIDIterator`.
+        )delim"
+    );
+
+    cls.def("face_selected",
+        [](const Complex &mesh){
+            return levelToNdarray<3, bool>(mesh, [](const FaceData &f){ return f.selected; });
+        },
+        R"delim(
+            Get the selection flags of all faces.
+
+            Returns:
+                :py:class:`numpy.ndarray`: Boolean array in the order of :py:func:`getFaceIDIterator`.
+        )delim"
+    );
+
+    cls.def("set_face_selected",
+        [](Complex &mesh, py::array_t<bool, py::array::c_style | py::array::forcecast> selected){
+            ndarrayToLevel<3>(mesh, selected, [](FaceData &f, bool s){ f.selected = s; }, "selected");
+        },
+        py::arg("selected"),
+        R"delim(
+            Set the selection flags of all faces.
+
+            Args:
+                selected (:py:class:`numpy.ndarray`): Boolean array in the order of :py:func:`getFaceIDIterator`.
+        )delim"
+    );
+}
+} // end namespace pygamer_detail
+/// @endcond
+} // end namespace gamer
@@ -0,0 +1,226 @@
+/*
+ * ***************************************************************************
+ * This file is part of the GAMer software.
+ * Copyright (C) 2016-2019
+ * by Christopher Lee, John Moody, Rommie Amaro, J. Andrew McCammon,
+ *    and Michael Holst
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * ***************************************************************************
+ */
+
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
+#include <pybind11/stl.h>
+
+#include "gamer/BVH.h"
+#include "gamer/SurfaceMesh.h"
+
+#include "NdArray.h"
+
+/// Namespace for all things gamer
+namespace gamer
+{
+
+namespace py = pybind11;
+
+void init_SMFaceBVH(py::module& mod){
+    py::class_<FaceBVH> bvh(mod, "FaceBVH",
+        R"delim(
+            Bounding volume hierarchy over the faces of a
+            :py:class:`SurfaceMesh` for ray, closest point and overlap
+            queries.
+
+            Faces are numbered in the order of :py:attr:`SurfaceMesh.faceIDs`
+            at construction. Call :py:func:`refit` after moving vertices and
+            build a new hierarchy after adding or removing faces.
+        )delim"
+    );
+
+    bvh.def(py::init<const SurfaceMesh&, std::size_t>(),
+        py::arg("mesh"), py::arg("leaf_size")=4,
+        py::keep_alive<1, 2>(),
+        py::call_guard<py::gil_scoped_release>(),
+        R"delim(
+            Build the hierarchy.
+
+            Args:
+                mesh (:py:class:`SurfaceMesh`): Mesh of interest.
+                leaf_size (:py:class:`int`): Maximum number of faces per leaf.
+        )delim"
+    );
+
+    bvh.def("refit", &FaceBVH::refit,
+        py::call_guard<py::gil_scoped_release>(),
+        R"delim(
+            Reload the vertex positions and recompute the bounding boxes.
+        )delim"
+    );
+
+    bvh.def("__len__", &FaceBVH::size, "Number of faces");
+
+    bvh.def("face_id", [](const FaceBVH &bvh, std::size_t i){
+            if (i >= bvh.size())
+                throw py::index_error("Face index out of range");
+            return bvh.faceID(i);
+        },
+        py::arg("index"),
+        R"delim(
+            Get the face with an index.
+
+            Args:
+                index (:py:class:`int`): Face index.
+
+            Returns:
+                :py:class:`FaceID`: The face.
+        )delim"
+    );
+
+    bvh.def("bounds", [](const FaceBVH &bvh){
+            auto box = bvh.bounds();
+            return std::make_pair(box.lower, box.upper);
+        },
+        R"delim(
+            Get the bounding box of the mesh.
+
+            Returns:
+                (:py:class:`Vector`, :py:class:`Vector`): Lower and upper corners.
+        )delim"
+    );
+
+    bvh.def("intersect_ray", [](const FaceBVH &bvh, const Vector &origin, const Vector &direction, double t_max) -> py::object {
+            RayHit hit;
+            if (!bvh.intersectRay(origin, direction, hit, t_max))
+                return py::none();
+            return py::make_tuple(hit.face, hit.t, hit.u, hit.v);
+        },
+        py::arg("origin"), py::arg("direction"),
+        py::arg("t_max")=std::numeric_limits<double>::infinity(),
+        R"delim(
+            Find the first face hit by a ray.
+
+            Args:
+                origin (:py:class:`Vector`): Origin of the ray.
+                direction (:py:class:`Vector`): Direction of the ray.
+                t_max (:py:class:`float`): Largest ray parameter of interest.
+
+            Returns:
+                (:py:class:`int`, :py:class:`float`, :py:class:`float`, :py:class:`float`):
+                Face index, ray parameter and barycentric coordinates of the
+                second and third vertex, or None if nothing is hit.
+        )delim"
+    );
+
+    bvh.def("closest_point", [](const FaceBVH &bvh, const Vector &point, double max_distance) -> py::object {
+            auto closest = bvh.closestPoint(point, max_distance);
+            if (closest.face == bvh.size())
+                return py::none();
+            return py::make_tuple(closest.face, closest.point, std::sqrt(closest.squaredDistance));
+        },
+        py::arg("point"),
+        py::arg("max_distance")=std::numeric_limits<double>::infinity(),
+        R"delim(
+            Find the closest point on the surface.
+
+            Args:
+                point (:py:class:`Vector`): Query point.
+                max_distance (:py:class:`float`): Only points closer than this are considered.
+
+            Returns:
+                (:py:class:`int`, :py:class:`Vector`, :py:class:`float`):
+                Face index, closest point and distance, or None if there is
+                no face within max_distance.
+        )delim"
+    );
+
+    bvh.def("closest_points", [](const FaceBVH &bvh, py::array_t<double, py::array::c_style | py::array::forcecast> points){
+            if (points.ndim() != 2 || points.shape(1) != 3)
+                throw std::invalid_argument("points must be an array of shape (n, 3).");
+            const long    n    = points.shape(0);
+            const double *data = points.data();
+
+            std::vector<long>   faces(n);
+            std::vector<double> closest(3*n);
+            std::vector<double> distances(n);
+            {
+                py::gil_scoped_release release;
+                #pragma omp parallel for schedule(static)
+                for (long i = 0; i < n; ++i)
+                {
+                    auto result = bvh.closestPoint(Vector({data[3*i], data[3*i+1], data[3*i+2]}));
+                    faces[i] = result.face == bvh.size() ? -1 : static_cast<long>(result.face);
+                    for (std::size_t k = 0; k < 3; ++k)
+                        closest[3*i+k] = result.point[k];
+                    distances[i] = std::sqrt(result.squaredDistance);
+                }
+            }
+            return py::make_tuple(
+                pygamer_detail::vectorToNdarray(std::move(faces)),
+                pygamer_detail::vectorToNdarray(std::move(closest), {static_cast<std::size_t>(n), 3}),
+                pygamer_detail::vectorToNdarray(std::move(distances)));
+        },
+        py::arg("points"),
+        R"delim(
+            Find the closest points on the surface for many query points in
+            parallel.
+
+            Args:
+                points (:py:class:`numpy.ndarray`): (n, 3) array of query points.
+
+            Returns:
+                (:py:class:`numpy.ndarray`, :py:class:`numpy.ndarray`, :py:class:`numpy.ndarray`):
+                Face indices, (n, 3) closest points and distances.
+        )delim"
+    );
+
+    bvh.def("overlap_box", [](const FaceBVH &bvh, const Vector &lower, const Vector &upper){
+            return bvh.overlapBox(AABB(lower, upper));
+        },
+        py::arg("lower"), py::arg("upper"),
+        R"delim(
+            Find the faces whose bounding box overlaps a box.
+
+            Args:
+                lower (:py:class:`Vector`): Lower corner of the box.
+                upper (:py:class:`Vector`): Upper corner of the box.
+
+            Returns:
+                :py:class:`list`: Face indices.
+        )delim"
+    );
+
+    bvh.def("overlap_triangle", &FaceBVH::overlapTriangle,
+        py::arg("a"), py::arg("b"), py::arg("c"),
+        R"delim(
+            Find the faces which intersect or touch a triangle.
+
+            Args:
+                a (:py:class:`Vector`): First vertex of the triangle.
+                b (:py:class:`Vector`): Second vertex of the triangle.
+                c (:py:class:`Vector`): Third vertex of the triangle.
+
+            Returns:
+                :py:class:`list`: Face indices.
+        )delim"
+    );
+}
+
+} // end namespace gamer
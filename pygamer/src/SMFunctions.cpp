@@ -23,16 +23,38 @@
  */
 
 #include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
 #include <pybind11/stl.h>
 
 #include "gamer/SurfaceMesh.h"
 
+#include "NdArray.h"
+
 /// Namespace for all things gamer
 namespace gamer
 {
 
 namespace py = pybind11;
 
+/// @cond detail
+namespace
+{
+/**
+ * @brief      Convert distance statistics to a dict
+ */
+py::dict distanceStatsToDict(DistanceStats &&stats)
+{
+    py::dict result;
+    result["max"]  = stats.max;
+    result["mean"] = stats.mean;
+    result["rms"]  = stats.rms;
+    if (!stats.deviations.empty())
+        result["deviations"] = pygamer_detail::vectorToNdarray(std::move(stats.deviations));
+    return result;
+}
+} // end anonymous namespace
+/// @endcond
+
 void init_SMFunctions(py::module& mod){
     mod.def("cube", &cube,
         py::arg("order"),
@@ -48,6 +70,64 @@ void init_SMFunctions(py::module& mod){
     );
 
 
+    mod.def("oneSidedDistance",
+        [](const SurfaceMesh &source, const SurfaceMesh &target,
+           std::size_t subdivisions, bool deviations){
+            DistanceStats stats;
+            {
+                py::gil_scoped_release release;
+                stats = oneSidedDistance(source, target, subdivisions, deviations);
+            }
+            return distanceStatsToDict(std::move(stats));
+        },
+        py::arg("source"), py::arg("target"), py::arg("subdivisions")=1,
+        py::arg("deviations")=false,
+        R"delim(
+            Distance from the points of one surface to another surface
+
+            Args:
+                source (:py:class:`SurfaceMesh`): Sampled surface
+                target (:py:class:`SurfaceMesh`): Target surface
+                subdivisions (:py:class:`int`): Sampling grid intervals per face edge, 1 samples the vertices only
+                deviations (:py:class:`bool`): Whether to return the distance of each vertex
+
+            Returns:
+                :py:class:`dict`: Keys 'max', 'mean' and 'rms' and, if requested, 'deviations' as a :py:class:`numpy.ndarray` in vertex order
+        )delim"
+    );
+
+
+    mod.def("surfaceDistance",
+        [](const SurfaceMesh &a, const SurfaceMesh &b,
+           std::size_t subdivisions, bool deviations){
+            SurfaceDistance distance;
+            {
+                py::gil_scoped_release release;
+                distance = surfaceDistance(a, b, subdivisions, deviations);
+            }
+            py::dict result;
+            result["hausdorff"] = distance.hausdorff();
+            result["forward"]   = distanceStatsToDict(std::move(distance.forward));
+            result["backward"]  = distanceStatsToDict(std::move(distance.backward));
+            return result;
+        },
+        py::arg("a"), py::arg("b"), py::arg("subdivisions")=1,
+        py::arg("deviations")=false,
+        R"delim(
+            Two sided Hausdorff and RMS distance between surfaces
+
+            Args:
+                a (:py:class:`SurfaceMesh`): First surface
+                b (:py:class:`SurfaceMesh`): Second surface
+                subdivisions (:py:class:`int`): Sampling grid intervals per face edge, 1 samples the vertices only
+                deviations (:py:class:`bool`): Whether to return the distance of each vertex
+
+            Returns:
+                :py:class:`dict`: 'hausdorff' and the statistics from a to b as 'forward' and from b to a as 'backward', see :py:func:`oneSidedDistance`
+        )delim"
+    );
+
+
     mod.def("sphere", &sphere,
         py::arg("order"),
         R"delim(
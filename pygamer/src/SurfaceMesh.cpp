@@ -25,17 +25,157 @@
 #include <pybind11/pybind11.h>
 #include <pybind11/numpy.h>
 #include <pybind11/stl.h>
-#include <pybind11/iostream.h>
 
+#include "gamer/DenseIndex.h"
 #include "gamer/SurfaceMesh.h"
 
+#include "CapturedOutput.h"
+#include "NdArray.h"
+
+#include <sstream>
+#include <stdexcept>
+
 /// Namespace for all things gamer
 namespace gamer
 {
 
 namespace py = pybind11;
 
+using pygamer_detail::vectorToNdarray;
+
+/// @cond detail
+namespace
+{
+/**
+ * @brief      Convert a quality summary into a dictionary
+ */
+py::dict summaryToDict(const SurfaceQualitySummary &summary)
+{
+    py::dict result;
+    result["n_faces"]           = summary.nFaces;
+    result["n_edges"]           = summary.nEdges;
+    result["n_vertices"]        = summary.nVertices;
+    result["min_angle"]         = summary.minAngle;
+    result["max_angle"]         = summary.maxAngle;
+    result["n_small_angles"]    = summary.nSmallAngles;
+    result["n_large_angles"]    = summary.nLargeAngles;
+    result["min_area"]          = summary.minArea;
+    result["max_area"]          = summary.maxArea;
+    result["total_area"]        = summary.totalArea;
+    result["mean_aspect_ratio"] = summary.meanAspectRatio;
+    result["max_aspect_ratio"]  = summary.maxAspectRatio;
+    result["min_edge_length"]   = summary.minEdgeLength;
+    result["max_edge_length"]   = summary.maxEdgeLength;
+    result["mean_edge_length"]  = summary.meanEdgeLength;
+    result["min_valence"]       = summary.minValence;
+    result["max_valence"]       = summary.maxValence;
+    return result;
+}
+
+/**
+ * @brief      View a per vertex array of a CurvatureResult without copying.
+ *
+ * The array keeps the owning Python object alive.
+ */
+template <typename T>
+py::array_t<T> curvatureView(py::object self, const std::vector<T>& values)
+{
+    return py::array_t<T>(values.size(), values.data(), self);
+}
+
+/**
+ * @brief      View a per vertex direction array of a CurvatureResult as a
+ *             (nVertices, 3) array, or None if it was not computed.
+ */
+py::object directionView(py::object self, const std::vector<Vector>& values)
+{
+    if (values.empty())
+        return py::none();
+    return py::array_t<REAL>(
+                std::array<std::size_t, 2>({values.size(), 3}),
+                {sizeof(Vector), sizeof(REAL)},
+                &values[0][0],
+                self);
+}
+} // end anonymous namespace
+/// @endcond
+
 void init_SurfaceMesh(py::module& mod){
+    // Bindings for CurvatureResult
+    py::class_<CurvatureResult> CurvatureCls(mod, "CurvatureResult",
+        R"delim(
+            Per vertex curvature estimates of a :py:class:`SurfaceMesh`.
+
+            Arrays are views into the result in the order of
+            :py:func:`SurfaceMesh.to_ndarray`. Unpacking yields the tuple
+            (kh, kg, k1, k2).
+        )delim"
+    );
+
+    CurvatureCls.def_property_readonly("kh",
+        [](py::object self){
+            return curvatureView(self, self.cast<const CurvatureResult&>().kh);
+        },
+        "Mean curvature of each vertex."
+    );
+
+    CurvatureCls.def_property_readonly("kg",
+        [](py::object self){
+            return curvatureView(self, self.cast<const CurvatureResult&>().kg);
+        },
+        "Gaussian curvature of each vertex."
+    );
+
+    CurvatureCls.def_property_readonly("k1",
+        [](py::object self){
+            return curvatureView(self, self.cast<const CurvatureResult&>().k1);
+        },
+        "First principal curvature of each vertex."
+    );
+
+    CurvatureCls.def_property_readonly("k2",
+        [](py::object self){
+            return curvatureView(self, self.cast<const CurvatureResult&>().k2);
+        },
+        "Second principal curvature of each vertex."
+    );
+
+    CurvatureCls.def_property_readonly("d1",
+        [](py::object self){
+            return directionView(self, self.cast<const CurvatureResult&>().d1);
+        },
+        "(nVertices, 3) array of first principal directions, or None if not computed."
+    );
+
+    CurvatureCls.def_property_readonly("d2",
+        [](py::object self){
+            return directionView(self, self.cast<const CurvatureResult&>().d2);
+        },
+        "(nVertices, 3) array of second principal directions, or None if not computed."
+    );
+
+    CurvatureCls.def_property_readonly("valid",
+        [](py::object self){
+            const auto &valid = self.cast<const CurvatureResult&>().valid;
+            // Flags are stored as 0 or 1 bytes which numpy reads as bool
+            return py::array_t<bool>(valid.size(),
+                        reinterpret_cast<const bool*>(valid.data()), self);
+        },
+        "Boolean mask of vertices with a defined estimate."
+    );
+
+    CurvatureCls.def("__iter__",
+        [](py::object self){
+            const auto &result = self.cast<const CurvatureResult&>();
+            return py::iter(py::make_tuple(
+                        curvatureView(self, result.kh),
+                        curvatureView(self, result.kg),
+                        curvatureView(self, result.k1),
+                        curvatureView(self, result.k2)));
+        }
+    );
+
+
     // Bindings for SurfaceMesh
     py::class_<SurfaceMesh> SurfMeshCls(mod, "SurfaceMesh",
         R"delim(
@@ -45,6 +185,87 @@ void init_SurfaceMesh(py::module& mod){
     SurfMeshCls.def(py::init<>(), "Default constructor.");
 
 
+    SurfMeshCls.def_static("from_ndarray",
+        [](py::array_t<REAL, py::array::c_style | py::array::forcecast> vertices,
+           py::array_t<int, py::array::c_style | py::array::forcecast> faces,
+           py::object face_markers,
+           py::object vertex_markers,
+           py::object vertex_selected,
+           py::object face_selected){
+            if (vertices.ndim() != 2 || vertices.shape(1) != 3)
+                throw std::invalid_argument("vertices must be an array of shape (nVertices, 3).");
+            if (faces.ndim() != 2 || faces.shape(1) != 3)
+                throw std::invalid_argument("faces must be an array of shape (nFaces, 3).");
+            const std::size_t nVertices = vertices.shape(0);
+            const std::size_t nFaces    = faces.shape(0);
+
+            auto asArray = [](py::object obj, std::size_t n, const char *name){
+                    auto arr = obj.cast<py::array_t<int, py::array::c_style | py::array::forcecast> >();
+                    if (static_cast<std::size_t>(arr.size()) != n)
+                    {
+                        std::stringstream ss;
+                        ss << name << " must have " << n << " entries.";
+                        throw std::invalid_argument(ss.str());
+                    }
+                    return arr;
+                };
+
+            py::array_t<int, py::array::c_style | py::array::forcecast> fmarkers, vmarkers, vsel, fsel;
+            if (!face_markers.is_none())
+                fmarkers = asArray(face_markers, nFaces, "face_markers");
+            if (!vertex_markers.is_none())
+                vmarkers = asArray(vertex_markers, nVertices, "vertex_markers");
+            if (!vertex_selected.is_none())
+                vsel = asArray(vertex_selected, nVertices, "vertex_selected");
+            if (!face_selected.is_none())
+                fsel = asArray(face_selected, nFaces, "face_selected");
+
+            auto mesh = surfaceMeshFromArrays(nVertices, vertices.data(),
+                            vertex_markers.is_none() ? nullptr : vmarkers.data(),
+                            nFaces, faces.data(),
+                            face_markers.is_none() ? nullptr : fmarkers.data());
+
+            if (!vertex_selected.is_none())
+            {
+                const int *sel = vsel.data();
+                for (std::size_t i = 0; i < nVertices; ++i)
+                    (*mesh->get_simplex_up({static_cast<int>(i)})).selected = sel[i];
+            }
+            if (!face_selected.is_none())
+            {
+                const int *sel = fsel.data();
+                const int *f   = faces.data();
+                for (std::size_t i = 0; i < nFaces; ++i)
+                    (*mesh->get_simplex_up({f[3*i], f[3*i+1], f[3*i+2]})).selected = sel[i];
+            }
+            return mesh;
+        },
+        py::arg("vertices"), py::arg("faces"),
+        py::arg("face_markers")=py::none(), py::arg("vertex_markers")=py::none(),
+        py::arg("vertex_selected")=py::none(), py::arg("face_selected")=py::none(),
+        R"delim(
+            Construct a SurfaceMesh from numpy arrays in a single call.
+
+            Vertices are keyed by their row in the vertex array. Face
+            orientations follow the winding of the vertex indices; if the
+            windings are inconsistent they are recomputed with a warning.
+            Faces which repeat a vertex raise an error. Contiguous arrays of matching type are read in place without
+            copying.
+
+            Args:
+                vertices (:py:class:`numpy.ndarray`): (nVertices, 3) array of vertex coordinates.
+                faces (:py:class:`numpy.ndarray`): (nFaces, 3) array of vertex indices of each face.
+                face_markers (:py:class:`numpy.ndarray`, optional): Marker of each face, -1 if omitted.
+                vertex_markers (:py:class:`numpy.ndarray`, optional): Marker of each vertex.
+                vertex_selected (:py:class:`numpy.ndarray`, optional): Selection flag of each vertex.
+                face_selected (:py:class:`numpy.ndarray`, optional): Selection flag of each face.
+
+            Returns:
+                :py:class:`SurfaceMesh`: The new mesh.
+        )delim"
+    );
+
+
     /************************************
      *  INSERT/REMOVE
      ************************************/
@@ -382,7 +603,7 @@ void init_SurfaceMesh(py::module& mod){
 
     SurfMeshCls.def("to_ndarray",
         [](const SurfaceMesh& mesh){
-            std::map<typename SurfaceMesh::KeyType,typename SurfaceMesh::KeyType> sigma;
+            DenseIndex<SurfaceMesh> sigma(mesh);
 
             double *vertices = new double[3*mesh.size<1>()];
             int    *edges = new int[2*mesh.size<2>()];
@@ -390,8 +611,7 @@ void init_SurfaceMesh(py::module& mod){
 
             std::size_t i = 0;
             for(const auto vertexID : mesh.get_level_id<1>()){
-                std::size_t o = 3*i;
-                sigma[mesh.get_name(vertexID)[0]] = i++;
+                std::size_t o = 3*i++;
                 auto vertex = vertexID.data();
                 vertices[o]     = vertex[0];
                 vertices[o+1]   = vertex[1];
@@ -471,6 +691,9 @@ void init_SurfaceMesh(py::module& mod){
     );
 
 
+    pygamer_detail::defineAttributeArrays(SurfMeshCls);
+
+
     SurfMeshCls.def("onBoundary",
         py::overload_cast<const SurfaceMesh::SimplexID<1>>(&SurfaceMesh::onBoundary<1>, py::const_),
         R"delim(
@@ -551,8 +774,8 @@ void init_SurfaceMesh(py::module& mod){
 
     SurfMeshCls.def("splitSurfaces",
         &splitSurfaces,
-        py::call_guard<py::scoped_ostream_redirect,
-                py::scoped_estream_redirect>(),
+        py::call_guard<pygamer_detail::CapturedOutput,
+                py::gil_scoped_release>(),
         R"delim(
             Split disconnected surfaces into separate meshes.
 
@@ -565,124 +788,95 @@ void init_SurfaceMesh(py::module& mod){
     );
 
 
-    SurfMeshCls.def("curvatureViaMDSB",
-        [](const SurfaceMesh& mesh, std::size_t nIter){
-            double* kh;
-            double* kg;
-            double* k1;
-            double* k2;
-            std::map<typename SurfaceMesh::KeyType,typename SurfaceMesh::KeyType> sigma;
-
-            std::tie(kh,kg,k1,k2,sigma) = curvatureViaMDSB(mesh);
-
-            auto free_kh  = py::capsule(
-                                kh,
-                                [](void *kh) {
-                                    delete[] reinterpret_cast<double*>(kh);
-                             });
-            auto free_kg  = py::capsule(
-                                kg,
-                                [](void *kg) {
-                                    delete[] reinterpret_cast<double*>(kg);
-                             });
-            auto free_k1  = py::capsule(
-                                k1,
-                                [](void *k1) {
-                                    delete[] reinterpret_cast<double*>(k1);
-                             });
-            auto free_k2  = py::capsule(
-                                k2,
-                                [](void *k2) {
-                                    delete[] reinterpret_cast<double*>(k2);
-                             });
-
-            if(nIter > 0){
-                double* smoothedkh = new double[mesh.size<1>()];
-                double* smoothedkg = new double[mesh.size<1>()];
-                double* smoothedk1 = new double[mesh.size<1>()];
-                double* smoothedk2 = new double[mesh.size<1>()];
-
-                for(std::size_t round = 0; round < nIter; ++round){
-                    // Smoothing
-                    for(const auto vertexID : mesh.get_level_id<1>()) {
-                        std::size_t i = sigma[vertexID.indices()[0]];
-                        // double value = scale*kh[i];
-
-                        double valuekh = kh[i];
-                        double valuekg = kg[i];
-                        double valuek1 = k1[i];
-                        double valuek2 = k2[i];
-
-                        auto neighbors = vertexID.cover();
-                        for(std::size_t nbor : neighbors) {
-                            valuekh += kh[sigma[nbor]];
-                            valuekg += kg[sigma[nbor]];
-                            valuek1 += k1[sigma[nbor]];
-                            valuek2 += k2[sigma[nbor]];
-                            // value += (1-scale)/static_cast<double>(neighbors.size())*kh[sigma[nbor]];
-                        }
-                        // smoothed[i] = value;
-                        smoothedkh[i] = valuekh/static_cast<double>(neighbors.size()+1);
-                        smoothedkg[i] = valuekg/static_cast<double>(neighbors.size()+1);
-                        smoothedk1[i] = valuek1/static_cast<double>(neighbors.size()+1);
-                        smoothedk2[i] = valuek2/static_cast<double>(neighbors.size()+1);
-                    }
-                    std::copy(smoothedkh, smoothedkh+mesh.size<1>(), kh);
-                    std::copy(smoothedkg, smoothedkg+mesh.size<1>(), kg);
-                    std::copy(smoothedk1, smoothedk1+mesh.size<1>(), k1);
-                    std::copy(smoothedk2, smoothedk2+mesh.size<1>(), k2);
-                }
+    SurfMeshCls.def("isotropicRemesh",
+        [](const SurfaceMesh& mesh, py::object target_length, py::object sizing,
+           std::size_t iterations, bool project){
+            if (target_length.is_none() == sizing.is_none())
+                throw std::invalid_argument("Exactly one of target_length and sizing must be given.");
+            if (!target_length.is_none())
+            {
+                REAL length = target_length.cast<REAL>();
+                py::gil_scoped_release release;
+                return isotropicRemesh(mesh, length, iterations, project);
+            }
+            auto arr = sizing.cast<py::array_t<REAL, py::array::c_style | py::array::forcecast> >();
+            std::vector<REAL> vertexSizing(arr.data(), arr.data() + arr.size());
+            py::gil_scoped_release release;
+            return isotropicRemesh(mesh, vertexSizing, iterations, project);
+        },
+        py::arg("target_length")=py::none(), py::arg("sizing")=py::none(),
+        py::arg("iterations")=5, py::arg("project")=true,
+        R"delim(
+            Remesh the surface toward a target edge length.
+
+            Each iteration splits long edges, collapses short edges, flips
+            edges toward regular valence and relaxes the vertices along the
+            surface. Boundaries and edges between differently marked faces
+            are preserved.
+
+            Args:
+                target_length (:py:class:`float`): Uniform target edge length.
+                sizing (:py:class:`numpy.ndarray`): Target edge length at each vertex, instead of target_length.
+                iterations (:py:class:`int`): Number of remeshing iterations.
+                project (:py:class:`bool`): Project vertices back onto the original surface.
+
+            Returns:
+                :py:class:`SurfaceMesh`: The remeshed surface.
+        )delim"
+    );
+
 
-                // // Smooth Gaussian curvature
-                // // double scale = 0.7;
-                // for(std::size_t round = 0; round < nIter; ++round){
-                //     // Smoothing
-                //     for(const auto vertexID : mesh.get_level_id<1>()) {
-                //         std::size_t i = sigma[vertexID.indices()[0]];
-                //         // double value = scale*kg[i];
-                //         double value = kg[i];
-                //         auto neighbors = vertexID.cover();
-                //         for(std::size_t nbor : neighbors) {
-                //             value += kg[sigma[nbor]];
-                //             // value += (1-scale)/static_cast<double>(neighbors.size())*kg[sigma[nbor]];
-                //         }
-                //         // smoothed[i] = value;
-                //         smoothed[i] = value/static_cast<double>(neighbors.size()+1);
-                //     }
-                //     for(std::size_t i = 0; i < mesh.size<1>(); ++i){
-                //         kg[i] = smoothed[i];
-                //     }
-                // }
-
-                delete[] smoothedkh;
-                delete[] smoothedkg;
-                delete[] smoothedk1;
-                delete[] smoothedk2;
+    SurfMeshCls.def("adaptiveRefine",
+        [](const SurfaceMesh& mesh, py::object max_length, py::object sizing, std::size_t max_levels){
+            if (!max_length.is_none() && !sizing.is_none())
+                throw std::invalid_argument("At most one of max_length and sizing may be given.");
+            if (!max_length.is_none())
+            {
+                REAL length = max_length.cast<REAL>();
+                if (!(length > 0))
+                    throw std::invalid_argument("max_length must be positive.");
+                py::gil_scoped_release release;
+                return adaptiveRefine(mesh, [length](const Vector&){ return length; }, max_levels);
             }
+            if (!sizing.is_none())
+            {
+                auto arr = sizing.cast<py::array_t<REAL, py::array::c_style | py::array::forcecast> >();
+                std::vector<REAL> vertexSizing(arr.data(), arr.data() + arr.size());
+                py::gil_scoped_release release;
+                return adaptiveRefine(mesh, vertexSizing, max_levels);
+            }
+            py::gil_scoped_release release;
+            return adaptiveRefine(mesh);
+        },
+        py::arg("max_length")=py::none(), py::arg("sizing")=py::none(), py::arg("max_levels")=4,
+        R"delim(
+            Locally refine the mesh with red-green closure.
 
-            return  std::make_tuple(
-                        py::array_t<double>(
-                            std::array<std::size_t, 1>({mesh.size<1>()}),
-                            {sizeof(double)},
-                            kh,
-                            free_kh),
-                        py::array_t<double>(
-                            std::array<std::size_t, 1>({mesh.size<1>()}),
-                            {sizeof(double)},
-                            kg,
-                            free_kg),
-                        py::array_t<double>(
-                            std::array<std::size_t, 1>({mesh.size<1>()}),
-                            {sizeof(double)},
-                            k1,
-                            free_k1),
-                        py::array_t<double>(
-                            std::array<std::size_t, 1>({mesh.size<1>()}),
-                            {sizeof(double)},
-                            k2,
-                            free_k2)
-                    );
+            Without arguments the selected faces are quadrisected once.
+            Otherwise edges longer than the sizing are split for up to
+            max_levels levels. Neighbouring faces are bisected or
+            quadrisected to keep the mesh conforming and all vertex, edge
+            and face data is kept.
+
+            Args:
+                max_length (:py:class:`float`): Uniform largest edge length.
+                sizing (:py:class:`numpy.ndarray`): Largest edge length at each vertex.
+                max_levels (:py:class:`int`): Maximum number of refinement levels.
+
+            Returns:
+                :py:class:`SurfaceMesh`: The refined surface.
+        )delim"
+    );
+
+
+    SurfMeshCls.def("curvatureViaMDSB",
+        [](const SurfaceMesh& mesh, std::size_t nIter){
+            auto result = curvatureViaMDSB(mesh);
+            smoothCurvatures(mesh, result, nIter);
+            return result;
         },
+        py::arg("nIter")=0,
+        py::call_guard<py::gil_scoped_release>(),
         R"delim(
             Compute the mean, Gaussian, and principal curvatures of the mesh.
 
@@ -690,136 +884,27 @@ void init_SurfaceMesh(py::module& mod){
                 nIter (:py:class:`int`): Number of smoothing iterations to run
 
             Returns:
-                tuple(:py:class:`numpy.ndarray`, :py:class:`numpy.ndarray`, :py:class:`numpy.ndarray`, :py:class:`numpy.ndarray`): Tuple of arrays containing Mean, Gaussian, First Prinicipal, and Second Principal curvatures.
+                :py:class:`CurvatureResult`: Curvatures in vertex order. Unpacks into a tuple of Mean, Gaussian, First Principal, and Second Principal curvature arrays.
         )delim"
     );
 
     SurfMeshCls.def("curvatureViaJets",
-        [](const SurfaceMesh& mesh, std::size_t nIter){
-            double* kh;
-            double* kg;
-            double* k1;
-            double* k2;
-            std::map<typename SurfaceMesh::KeyType,typename SurfaceMesh::KeyType> sigma;
-
-            std::tie(kh,kg,k1,k2,sigma) = curvatureViaJets(mesh, 2, 2);
-
-            auto free_kh  = py::capsule(
-                                kh,
-                                [](void *kh) {
-                                    delete[] reinterpret_cast<double*>(kh);
-                             });
-            auto free_kg  = py::capsule(
-                                kg,
-                                [](void *kg) {
-                                    delete[] reinterpret_cast<double*>(kg);
-                             });
-            auto free_k1  = py::capsule(
-                                k1,
-                                [](void *k1) {
-                                    delete[] reinterpret_cast<double*>(k1);
-                             });
-            auto free_k2  = py::capsule(
-                                k2,
-                                [](void *k2) {
-                                    delete[] reinterpret_cast<double*>(k2);
-                             });
-
-           if(nIter > 0){
-                double* smoothedkh = new double[mesh.size<1>()];
-                double* smoothedkg = new double[mesh.size<1>()];
-                double* smoothedk1 = new double[mesh.size<1>()];
-                double* smoothedk2 = new double[mesh.size<1>()];
-
-                for(std::size_t round = 0; round < nIter; ++round){
-                    // Smoothing
-                    for(const auto vertexID : mesh.get_level_id<1>()) {
-                        std::size_t i = sigma[vertexID.indices()[0]];
-                        // double value = scale*kh[i];
-
-                        double valuekh = kh[i];
-                        double valuekg = kg[i];
-                        double valuek1 = k1[i];
-                        double valuek2 = k2[i];
-
-                        auto neighbors = vertexID.cover();
-                        for(std::size_t nbor : neighbors) {
-                            valuekh += kh[sigma[nbor]];
-                            valuekg += kg[sigma[nbor]];
-                            valuek1 += k1[sigma[nbor]];
-                            valuek2 += k2[sigma[nbor]];
-                            // value += (1-scale)/static_cast<double>(neighbors.size())*kh[sigma[nbor]];
-                        }
-                        // smoothed[i] = value;
-                        smoothedkh[i] = valuekh/static_cast<double>(neighbors.size()+1);
-                        smoothedkg[i] = valuekg/static_cast<double>(neighbors.size()+1);
-                        smoothedk1[i] = valuek1/static_cast<double>(neighbors.size()+1);
-                        smoothedk2[i] = valuek2/static_cast<double>(neighbors.size()+1);
-                    }
-                    std::copy(smoothedkh, smoothedkh+mesh.size<1>(), kh);
-                    std::copy(smoothedkg, smoothedkg+mesh.size<1>(), kg);
-                    std::copy(smoothedk1, smoothedk1+mesh.size<1>(), k1);
-                    std::copy(smoothedk2, smoothedk2+mesh.size<1>(), k2);
-                }
-
-                // // Smooth Gaussian curvature
-                // // double scale = 0.7;
-                // for(std::size_t round = 0; round < nIter; ++round){
-                //     // Smoothing
-                //     for(const auto vertexID : mesh.get_level_id<1>()) {
-                //         std::size_t i = sigma[vertexID.indices()[0]];
-                //         // double value = scale*kg[i];
-                //         double value = kg[i];
-                //         auto neighbors = vertexID.cover();
-                //         for(std::size_t nbor : neighbors) {
-                //             value += kg[sigma[nbor]];
-                //             // value += (1-scale)/static_cast<double>(neighbors.size())*kg[sigma[nbor]];
-                //         }
-                //         // smoothed[i] = value;
-                //         smoothed[i] = value/static_cast<double>(neighbors.size()+1);
-                //     }
-                //     for(std::size_t i = 0; i < mesh.size<1>(); ++i){
-                //         kg[i] = smoothed[i];
-                //     }
-                // }
-
-                delete[] smoothedkh;
-                delete[] smoothedkg;
-                delete[] smoothedk1;
-                delete[] smoothedk2;
-            }
-
-            return  std::make_tuple(
-                        py::array_t<double>(
-                            std::array<std::size_t, 1>({mesh.size<1>()}),
-                            {sizeof(double)},
-                            kh,
-                            free_kh),
-                        py::array_t<double>(
-                            std::array<std::size_t, 1>({mesh.size<1>()}),
-                            {sizeof(double)},
-                            kg,
-                            free_kg),
-                        py::array_t<double>(
-                            std::array<std::size_t, 1>({mesh.size<1>()}),
-                            {sizeof(double)},
-                            k1,
-                            free_k1),
-                        py::array_t<double>(
-                            std::array<std::size_t, 1>({mesh.size<1>()}),
-                            {sizeof(double)},
-                            k2,
-                            free_k2)
-                    );
+        [](const SurfaceMesh& mesh, std::size_t nIter, bool principalDirections){
+            auto result = curvatureViaJets(mesh, 2, 2, principalDirections);
+            smoothCurvatures(mesh, result, nIter);
+            return result;
         },
+        py::arg("nIter")=0, py::arg("principal_directions")=false,
+        py::call_guard<py::gil_scoped_release>(),
         R"delim(
             Compute the mean, Gaussian, and principal curvatures of the mesh.
 
             Args:
                 nIter (:py:class:`int`): Number of smoothing iterations to run
+                principal_directions (:py:class:`bool`): Also compute the principal directions
 
             Returns:
-                tuple(:py:class:`numpy.ndarray`, :py:class:`numpy.ndarray`, :py:class:`numpy.ndarray`, :py:class:`numpy.ndarray`): Tuple of arrays containing Mean, Gaussian, First Prinicipal, and Second Principal curvatures.
+                :py:class:`CurvatureResult`: Curvatures in vertex order. Unpacks into a tuple of Mean, Gaussian, First Principal, and Second Principal curvature arrays.
         )delim"
     );
 
@@ -955,8 +1040,8 @@ void init_SurfaceMesh(py::module& mod){
      ************************************/
     SurfMeshCls.def("smooth", &smoothMesh,
         py::arg("max_iter")=6, py::arg("preserve_ridges")=false, py::arg("rings")=2, py::arg("verbose")=false,
-        py::call_guard<py::scoped_ostream_redirect,
-                py::scoped_estream_redirect>(),
+        py::call_guard<pygamer_detail::CapturedOutput,
+                py::gil_scoped_release>(),
         R"delim(
             Perform mesh smoothing.
 
@@ -974,6 +1059,7 @@ void init_SurfaceMesh(py::module& mod){
 
     SurfMeshCls.def("coarse", &coarse,
         py::arg("rate"), py::arg("flatRate"), py::arg("denseWeight"), py::arg("rings")=2, py::arg("verbose")=false,
+        py::call_guard<py::gil_scoped_release>(),
         R"delim(
             Coarsen a surface mesh.
 
@@ -995,6 +1081,7 @@ void init_SurfaceMesh(py::module& mod){
             for(int i = 0; i < niter; ++i) coarse_flat(mesh, rate, 0.5, rings, verbose);
         },
         py::arg("rate")=0.016, py::arg("numiter")=1, py::arg("rings")=2, py::arg("verbose")=false,
+        py::call_guard<py::gil_scoped_release>(),
         R"delim(
             Coarsen flat regions of a surface mesh.
 
@@ -1012,6 +1099,7 @@ void init_SurfaceMesh(py::module& mod){
             for(int i = 0; i < niter; ++i) coarse_dense(mesh, rate, 10, rings, verbose);
         },
         py::arg("rate")=1.6, py::arg("numiter")=1, py::arg("rings")=2, py::arg("verbose")=false,
+        py::call_guard<py::gil_scoped_release>(),
         R"delim(
             Coarsen dense regions of a surface mesh.
 
@@ -1025,22 +1113,93 @@ void init_SurfaceMesh(py::module& mod){
 
 
     SurfMeshCls.def("normalSmooth", &normalSmooth,
+        py::arg("anisotropy")=1.0, py::arg("relaxation")=0.5,
+        py::call_guard<py::gil_scoped_release>(),
         R"delim(
             Perform smoothing of mesh face normals.
 
+            All vertices are updated together from the previous positions,
+            so the result does not depend on the vertex order. Earlier
+            versions updated the vertices one after another, each taking a
+            full step. Each vertex now moves by ``relaxation`` times that
+            step; the default of 0.5 keeps a pass close to the old
+            behaviour.
+
             Args:
                 anisotropy (float): Degree of anisotropy.
+                relaxation (float): Fraction of the step to take, in (0, 1].
+
+            Raises:
+                RuntimeError: If relaxation is not in (0, 1].
+        )delim"
+    );
+
+
+    SurfMeshCls.def("implicitFairing", &implicitFairing,
+        py::arg("time_step")=1.0, py::arg("steps")=1, py::arg("selected_only")=false,
+        py::call_guard<py::gil_scoped_release>(),
+        R"delim(
+            Smooth the mesh by implicit cotangent Laplacian fairing.
+
+            Each step solves a sparse backward Euler system, so a single
+            step with a large time step replaces many explicit smoothing
+            iterations.
+
+            Args:
+                time_step (float): Time step relative to the squared mean edge length.
+                steps (int): Number of steps.
+                selected_only (bool): Only move selected vertices.
         )delim"
     );
 
 
     SurfMeshCls.def("fillHoles", &fillHoles,
+        py::call_guard<py::gil_scoped_release>(),
         R"delim(
             Fill holes in the mesh.
         )delim"
     );
 
 
+    SurfMeshCls.def("getQualityStats",
+        [](const SurfaceMesh &mesh, double small_angle, double large_angle, std::size_t nBins){
+            SurfaceQualityStats stats;
+            {
+                py::gil_scoped_release release;
+                stats = computeQualityStats(mesh, small_angle, large_angle, nBins);
+            }
+
+            py::dict result;
+            result["area"]              = vectorToNdarray(std::move(stats.area));
+            result["min_angle"]         = vectorToNdarray(std::move(stats.minAngle));
+            result["max_angle"]         = vectorToNdarray(std::move(stats.maxAngle));
+            result["aspect_ratio"]      = vectorToNdarray(std::move(stats.aspectRatio));
+            result["edge_length"]       = vectorToNdarray(std::move(stats.edgeLength));
+            result["valence"]           = vectorToNdarray(std::move(stats.valence));
+            result["angle_histogram"]   = vectorToNdarray(std::move(stats.angleHistogram));
+            result["valence_histogram"] = vectorToNdarray(std::move(stats.valenceHistogram));
+            result["summary"]           = summaryToDict(stats.summary);
+            return result;
+        },
+        py::arg("small_angle")=15, py::arg("large_angle")=165, py::arg("n_bins")=18,
+        R"delim(
+            Compute quality measures of the mesh in a single parallel pass.
+
+            Args:
+                small_angle (float): Angles below this are counted as small.
+                large_angle (float): Angles above this are counted as large.
+                n_bins (int): Number of bins of the angle histogram.
+
+            Returns:
+                :py:class:`dict`: Per face arrays (area, min_angle,
+                max_angle, aspect_ratio), per edge edge_length and per
+                vertex valence in the order of :py:func:`to_ndarray`, a
+                histogram of all angles over [0, 180], the number of
+                vertices of each valence, and a summary.
+        )delim"
+    );
+
+
     SurfMeshCls.def("getVolume", &getVolume,
         R"delim(
             Get the volume of the surface mesh.
@@ -23,17 +23,55 @@
  */
 
 #include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
 #include <pybind11/stl.h>
 
+#include "gamer/DenseIndex.h"
 #include "gamer/TetMesh.h"
 #include "gamer/SurfaceMesh.h"
 
+#include "NdArray.h"
+
+#include <algorithm>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+
 /// Namespace for all things gamer
 namespace gamer
 {
 
 namespace py = pybind11;
 
+using pygamer_detail::vectorToNdarray;
+
+/// @cond detail
+namespace
+{
+/**
+ * @brief      Convert a quality summary into a dictionary
+ */
+py::dict summaryToDict(const TetQualitySummary &summary)
+{
+    py::dict result;
+    result["n_cells"]           = summary.nCells;
+    result["n_inverted"]        = summary.nInverted;
+    result["min_dihedral"]      = summary.minDihedral;
+    result["max_dihedral"]      = summary.maxDihedral;
+    result["min_radius_ratio"]  = summary.minRadiusRatio;
+    result["mean_radius_ratio"] = summary.meanRadiusRatio;
+    result["max_aspect_ratio"]  = summary.maxAspectRatio;
+    result["min_volume"]        = summary.minVolume;
+    result["max_volume"]        = summary.maxVolume;
+    result["total_volume"]      = summary.totalVolume;
+    result["min_edge_length"]   = summary.minEdgeLength;
+    result["max_edge_length"]   = summary.maxEdgeLength;
+    result["mean_edge_length"]  = summary.meanEdgeLength;
+    return result;
+}
+} // end anonymous namespace
+/// @endcond
+
 void init_TetMesh(py::module& mod){
     // Bindings for TetMesh
     py::class_<TetMesh> TetMeshCls(mod, "TetMesh",
@@ -43,6 +81,80 @@ void init_TetMesh(py::module& mod){
     );
     TetMeshCls.def(py::init<>(), "Default constructor.");
 
+
+    TetMeshCls.def_static("from_ndarray",
+        [](py::array_t<REAL, py::array::c_style | py::array::forcecast> vertices,
+           py::array_t<int, py::array::c_style | py::array::forcecast> cells,
+           py::object cell_markers,
+           py::object faces,
+           py::object face_markers,
+           py::object vertex_markers){
+            if (vertices.ndim() != 2 || vertices.shape(1) != 3)
+                throw std::invalid_argument("vertices must be an array of shape (nVertices, 3).");
+            if (cells.ndim() != 2 || cells.shape(1) != 4)
+                throw std::invalid_argument("cells must be an array of shape (nCells, 4).");
+            const std::size_t nVertices = vertices.shape(0);
+            const std::size_t nCells    = cells.shape(0);
+
+            using IntArray = py::array_t<int, py::array::c_style | py::array::forcecast>;
+            auto asArray = [](py::object obj, std::size_t n, const char *name){
+                    auto arr = obj.cast<IntArray>();
+                    if (static_cast<std::size_t>(arr.size()) != n)
+                    {
+                        std::stringstream ss;
+                        ss << name << " must have " << n << " entries.";
+                        throw std::invalid_argument(ss.str());
+                    }
+                    return arr;
+                };
+
+            IntArray cmarkers, vmarkers, farr, fmarkers;
+            std::size_t nFaces = 0;
+            if (!cell_markers.is_none())
+                cmarkers = asArray(cell_markers, nCells, "cell_markers");
+            if (!vertex_markers.is_none())
+                vmarkers = asArray(vertex_markers, nVertices, "vertex_markers");
+            if (!faces.is_none())
+            {
+                farr = faces.cast<IntArray>();
+                if (farr.ndim() != 2 || farr.shape(1) != 3)
+                    throw std::invalid_argument("faces must be an array of shape (nFaces, 3).");
+                if (face_markers.is_none())
+                    throw std::invalid_argument("face_markers are required when faces are given.");
+                nFaces   = farr.shape(0);
+                fmarkers = asArray(face_markers, nFaces, "face_markers");
+            }
+
+            return tetMeshFromArrays(nVertices, vertices.data(),
+                        vertex_markers.is_none() ? nullptr : vmarkers.data(),
+                        nCells, cells.data(),
+                        cell_markers.is_none() ? nullptr : cmarkers.data(),
+                        nFaces,
+                        faces.is_none() ? nullptr : farr.data(),
+                        faces.is_none() ? nullptr : fmarkers.data());
+        },
+        py::arg("vertices"), py::arg("cells"),
+        py::arg("cell_markers")=py::none(), py::arg("faces")=py::none(),
+        py::arg("face_markers")=py::none(), py::arg("vertex_markers")=py::none(),
+        R"delim(
+            Construct a TetMesh from numpy arrays in a single call.
+
+            Vertices are keyed by their row in the vertex array. Contiguous
+            arrays of matching type are read in place without copying.
+
+            Args:
+                vertices (:py:class:`numpy.ndarray`): (nVertices, 3) array of vertex coordinates.
+                cells (:py:class:`numpy.ndarray`): (nCells, 4) array of vertex indices of each tetrahedron.
+                cell_markers (:py:class:`numpy.ndarray`, optional): Marker of each cell.
+                faces (:py:class:`numpy.ndarray`, optional): (nFaces, 3) array of vertex indices of marked faces.
+                face_markers (:py:class:`numpy.ndarray`, optional): Marker of each face in faces.
+                vertex_markers (:py:class:`numpy.ndarray`, optional): Marker of each vertex.
+
+            Returns:
+                :py:class:`TetMesh`: The new mesh.
+        )delim"
+    );
+
     /************************************
      *  INSERT/REMOVE
      ************************************/
@@ -404,6 +516,148 @@ void init_TetMesh(py::module& mod){
         )delim"
     );
 
+    TetMeshCls.def("to_ndarray",
+        [](const TetMesh &mesh){
+            using CellID  = typename TetMesh::template SimplexID<4>;
+
+            std::vector<double> vertices;
+            std::vector<int>    cells, cellMarkers, faces, faceMarkers;
+            {
+                py::gil_scoped_release release;
+                DenseIndex<TetMesh> sigma(mesh);
+
+                vertices.reserve(3*mesh.size<1>());
+                for (const auto vertexID : mesh.get_level_id<1>())
+                {
+                    auto vertex = vertexID.data();
+                    vertices.push_back(vertex[0]);
+                    vertices.push_back(vertex[1]);
+                    vertices.push_back(vertex[2]);
+                }
+
+                // Vertex keys of a cell in positive order
+                auto orientedCell = [&mesh](CellID cellID){
+                        auto name = mesh.get_name(cellID);
+                        if ((*cellID).orientation == -1)
+                            std::swap(name[0], name[3]);
+                        return name;
+                    };
+
+                cells.reserve(4*mesh.size<4>());
+                cellMarkers.reserve(mesh.size<4>());
+                for (const auto cellID : mesh.get_level_id<4>())
+                {
+                    for (auto key : orientedCell(cellID))
+                        cells.push_back(static_cast<int>(sigma[key]));
+                    cellMarkers.push_back((*cellID).marker);
+                }
+
+                // Outward facing face of a positive cell (w0, w1, w2, w3)
+                // opposite to each of its vertices
+                static constexpr std::size_t opposite[4][3] = {
+                    {1, 2, 3}, {0, 3, 2}, {0, 1, 3}, {0, 2, 1}};
+
+                for (const auto faceID : mesh.get_level_id<3>())
+                {
+                    auto cover = mesh.up(faceID);
+                    if (cover.size() != 1 && (*faceID).marker == 0)
+                        continue;
+
+                    auto name = mesh.get_name(faceID);
+                    auto cell = orientedCell(*cover.begin());
+                    std::size_t i = 0;
+                    while (std::find(name.begin(), name.end(), cell[i]) != name.end())
+                        ++i;
+                    for (auto j : opposite[i])
+                        faces.push_back(static_cast<int>(sigma[cell[j]]));
+                    faceMarkers.push_back((*faceID).marker);
+                }
+            }
+
+            const std::size_t nVertices = vertices.size()/3;
+            const std::size_t nCells    = cellMarkers.size();
+            const std::size_t nFaces    = faceMarkers.size();
+            return py::make_tuple(
+                        vectorToNdarray(std::move(vertices), {nVertices, 3}),
+                        vectorToNdarray(std::move(cells), {nCells, 4}),
+                        vectorToNdarray(std::move(cellMarkers)),
+                        vectorToNdarray(std::move(faces), {nFaces, 3}),
+                        vectorToNdarray(std::move(faceMarkers)));
+        },
+        R"delim(
+            Converts the TetMesh into sets of numpy arrays.
+
+            Cells are positively oriented. Faces include every boundary
+            face, oriented outward, and every interior face with a non-zero
+            marker, oriented outward with respect to one of its cells.
+
+            Returns:
+                tuple(:py:class:`numpy.ndarray`, :py:class:`numpy.ndarray`, :py:class:`numpy.ndarray`, :py:class:`numpy.ndarray`, :py:class:`numpy.ndarray`): Tuple of (nVertices, 3) array of vertex coordinates, (nCells, 4) array of indices of vertices making up cells, (nCells,) array of cell markers, (nFaces, 3) array of indices of vertices making up faces, and (nFaces,) array of face markers.
+        )delim"
+    );
+
+
+    pygamer_detail::defineAttributeArrays(TetMeshCls);
+
+
+    TetMeshCls.def("cell_markers",
+        [](const TetMesh &mesh){
+            return pygamer_detail::levelToNdarray<4, int>(mesh,
+                    [](const TMCell &c){ return c.marker; });
+        },
+        R"delim(
+            Get the markers of all cells.
+
+            Returns:
+                :py:class:`numpy.ndarray`: Array of cell markers in the order of :py:func:`getCellIDIterator`.
+        )delim"
+    );
+
+
+    TetMeshCls.def("set_cell_markers",
+        [](TetMesh &mesh, py::array_t<int, py::array::c_style | py::array::forcecast> markers){
+            pygamer_detail::ndarrayToLevel<4>(mesh, markers,
+                    [](TMCell &c, int m){ c.marker = m; }, "markers");
+        },
+        py::arg("markers"),
+        R"delim(
+            Set the markers of all cells.
+
+            Args:
+                markers (:py:class:`numpy.ndarray`): Array of cell markers in the order of :py:func:`getCellIDIterator`.
+        )delim"
+    );
+
+
+    TetMeshCls.def("cell_selected",
+        [](const TetMesh &mesh){
+            return pygamer_detail::levelToNdarray<4, bool>(mesh,
+                    [](const TMCell &c){ return c.selected; });
+        },
+        R"delim(
+            Get the selection flags of all cells.
+
+            Returns:
+                :py:class:`numpy.ndarray`: Boolean array in the order of :py:func:`getCellIDIterator`.
+        )delim"
+    );
+
+
+    TetMeshCls.def("set_cell_selected",
+        [](TetMesh &mesh, py::array_t<bool, py::array::c_style | py::array::forcecast> selected){
+            pygamer_detail::ndarrayToLevel<4>(mesh, selected,
+                    [](TMCell &c, bool s){ c.selected = s; }, "selected");
+        },
+        py::arg("selected"),
+        R"delim(
+            Set the selection flags of all cells.
+
+            Args:
+                selected (:py:class:`numpy.ndarray`): Boolean array in the order of :py:func:`getCellIDIterator`.
+        )delim"
+    );
+
+
     TetMeshCls.def("onBoundary",
         py::overload_cast<const TetMesh::SimplexID<1>>(&TetMesh::onBoundary<1>, py::const_),
         R"delim(
@@ -511,6 +765,7 @@ void init_TetMesh(py::module& mod){
 
     TetMeshCls.def("extractSurface",
         &extractSurface,
+        py::call_guard<py::gil_scoped_release>(),
         R"delim(
             Extract the surface of the TetMesh.
 
@@ -522,6 +777,70 @@ void init_TetMesh(py::module& mod){
         )delim"
     );
 
+    TetMeshCls.def("optimize",
+        &optimizeMesh,
+        py::arg("max_iter")=10,
+        py::call_guard<py::gil_scoped_release>(),
+        R"delim(
+            Quality guarded optimization of interior vertex positions.
+
+            Vertices are moved towards their optimal Delaunay triangulation
+            position or the barycenter of their neighbors. Moves are only
+            accepted if the minimum dihedral angle or radius ratio of the
+            surrounding cells improves and no cell is inverted. Boundary
+            vertices and vertices on marked faces are not moved.
+
+            Args:
+                max_iter (int): Maximum number of sweeps over the vertices.
+
+            Returns:
+                :py:class:`int`: Number of accepted vertex moves.
+        )delim"
+    );
+
+    TetMeshCls.def("getQualityStats",
+        [](const TetMesh &mesh, std::size_t nBins){
+            TetQualityStats stats;
+            {
+                py::gil_scoped_release release;
+                stats = computeQualityStats(mesh, nBins);
+            }
+
+            py::dict markers;
+            for (const auto &item : stats.markerSummary)
+                markers[py::int_(item.first)] = summaryToDict(item.second);
+
+            py::dict result;
+            result["marker"]          = vectorToNdarray(std::move(stats.marker));
+            result["volume"]          = vectorToNdarray(std::move(stats.volume));
+            result["min_dihedral"]    = vectorToNdarray(std::move(stats.minDihedral));
+            result["max_dihedral"]    = vectorToNdarray(std::move(stats.maxDihedral));
+            result["radius_ratio"]    = vectorToNdarray(std::move(stats.radiusRatio));
+            result["aspect_ratio"]    = vectorToNdarray(std::move(stats.aspectRatio));
+            result["min_edge_length"] = vectorToNdarray(std::move(stats.minEdgeLength));
+            result["max_edge_length"] = vectorToNdarray(std::move(stats.maxEdgeLength));
+            result["dihedral_histogram"]     = vectorToNdarray(std::move(stats.dihedralHistogram));
+            result["radius_ratio_histogram"] = vectorToNdarray(std::move(stats.radiusRatioHistogram));
+            result["summary"]         = summaryToDict(stats.summary);
+            result["marker_summary"]  = markers;
+            return result;
+        },
+        py::arg("n_bins")=18,
+        R"delim(
+            Compute quality measures of all cells in a single parallel pass.
+
+            Args:
+                n_bins (int): Number of bins of the histograms.
+
+            Returns:
+                :py:class:`dict`: Per cell arrays (marker, volume,
+                min_dihedral, max_dihedral, radius_ratio, aspect_ratio,
+                min_edge_length, max_edge_length), histograms of the
+                dihedral angles over [0, 180] and radius ratios over [0, 1],
+                a summary over all cells, and a summary per cell marker.
+        )delim"
+    );
+
     /************************************
      *  ITERATORS
      ************************************/
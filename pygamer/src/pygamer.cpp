@@ -22,15 +22,19 @@
  * ***************************************************************************
  */
 
+#include <tuple>
+#include <vector>
+
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
-#include <pybind11/iostream.h>
 
 #include "gamer/SurfaceMesh.h"
 #include "gamer/TetMesh.h"
 #include "gamer/PDBReader.h"
 #include "gamer/version.h"
 
+#include "CapturedOutput.h"
+
 /// Namespace for all things gamer
 namespace gamer
 {
@@ -46,6 +50,7 @@ void init_SMFace(py::module &);
 void init_SMSimplexID(py::module &);
 void init_SMFunctions(py::module &);
 void init_SurfaceMesh(py::module &);
+void init_SMFaceBVH(py::module &);
 
 void init_TMGlobal(py::module &);
 void init_TMVertex(py::module &);
@@ -57,7 +62,17 @@ void init_TetMesh(py::module &);
 
 // Initialize the main `pygamer` module
 PYBIND11_MODULE(pygamer, pygamer) {
-    pygamer.doc() = "Python wrapper around the GAMer C++ library.";
+    pygamer.doc() = R"delim(
+        Python wrapper around the GAMer C++ library.
+
+        Long running operations such as smoothing, coarsening, mesh
+        generation, curvature estimation, and the file readers and writers
+        release the GIL while they run. It is safe to call them concurrently
+        from several Python threads as long as each thread works on a
+        distinct mesh object. Operating on the same mesh from several
+        threads at once is not safe, nor is modifying a mesh while another
+        thread reads or writes it.
+    )delim";
 
     init_Vector(pygamer);           // Vector class
 
@@ -75,6 +90,7 @@ PYBIND11_MODULE(pygamer, pygamer) {
     init_SMSimplexID(SurfMeshMod);  // SurfaceMesh::SimplexID class
     init_SMFunctions(SurfMeshMod);  // Functions pyg.sm.*
     init_SurfaceMesh(SurfMeshMod);  // SurfaceMesh class
+    init_SMFaceBVH(SurfMeshMod);    // FaceBVH class
 
 
     /************************************
@@ -96,6 +112,7 @@ PYBIND11_MODULE(pygamer, pygamer) {
      ************************************/
     pygamer.def("readOFF", &readOFF,
         py::arg("filename"),
+        py::call_guard<py::gil_scoped_release>(),
         R"delim(
             Read OFF file to mesh
 
@@ -110,6 +127,7 @@ PYBIND11_MODULE(pygamer, pygamer) {
 
     pygamer.def("readPDB_molsurf", &readPDB_molsurf,
         py::arg("filename"),
+        py::call_guard<py::gil_scoped_release>(),
         R"delim(
             Read a PDB file into a mesh
 
@@ -125,6 +143,7 @@ PYBIND11_MODULE(pygamer, pygamer) {
         py::arg("filename"),
         py::arg("blobbyness") = -0.2,
         py::arg("isovalue") = 2.5,
+        py::call_guard<py::gil_scoped_release>(),
         R"delim(
             Read a PDB file into a mesh
 
@@ -141,6 +160,7 @@ PYBIND11_MODULE(pygamer, pygamer) {
 
     pygamer.def("readPQR_molsurf", &readPQR_molsurf,
         py::arg("filename"),
+        py::call_guard<py::gil_scoped_release>(),
         R"delim(
             Read a PQR file into a mesh
 
@@ -156,6 +176,7 @@ PYBIND11_MODULE(pygamer, pygamer) {
         py::arg("filename"),
         py::arg("blobbyness") = -0.2,
         py::arg("isovalue") = 2.5,
+        py::call_guard<py::gil_scoped_release>(),
         R"delim(
             Read a PQR file into a mesh
 
@@ -172,6 +193,7 @@ PYBIND11_MODULE(pygamer, pygamer) {
 
     pygamer.def("writeOFF", py::overload_cast<const std::string&, const SurfaceMesh&>(&writeOFF),
         py::arg("filename"), py::arg("mesh"),
+        py::call_guard<py::gil_scoped_release>(),
         R"delim(
             Write mesh to file in OFF format
 
@@ -184,6 +206,7 @@ PYBIND11_MODULE(pygamer, pygamer) {
 
     pygamer.def("writeOFF", py::overload_cast<const std::string&, const TetMesh&>(&writeOFF),
         py::arg("filename"), py::arg("mesh"),
+        py::call_guard<py::gil_scoped_release>(),
         R"delim(
             Write mesh to file in OFF format
 
@@ -196,6 +219,7 @@ PYBIND11_MODULE(pygamer, pygamer) {
 
     pygamer.def("readOBJ", &readOBJ,
         py::arg("filename"),
+        py::call_guard<py::gil_scoped_release>(),
         R"delim(
             Read OBJ file to mesh
 
@@ -209,6 +233,7 @@ PYBIND11_MODULE(pygamer, pygamer) {
 
     pygamer.def("writeOBJ", &writeOBJ,
         py::arg("filename"), py::arg("mesh"),
+        py::call_guard<py::gil_scoped_release>(),
         R"delim(
             Write mesh to file in OBJ format
 
@@ -221,6 +246,7 @@ PYBIND11_MODULE(pygamer, pygamer) {
 
     pygamer.def("writeVTK", &writeVTK,
         py::arg("filename"), py::arg("mesh"),
+        py::call_guard<py::gil_scoped_release>(),
         R"delim(
             Write mesh to file in VTK format
 
@@ -231,8 +257,25 @@ PYBIND11_MODULE(pygamer, pygamer) {
     );
 
 
+    pygamer.def("writeVTU", &writeVTU,
+        py::arg("filename"), py::arg("mesh"),
+        py::arg("vertexFields") = std::map<std::string, std::vector<REAL> >(),
+        py::call_guard<py::gil_scoped_release>(),
+        R"delim(
+            Write mesh to file in binary VTK XML unstructured grid format
+
+            Args:
+                filename (:py:class:`str`): Filename to write to
+                mesh (:py:class:`tetmesh.TetMesh`): Mesh of interest
+                vertexFields (:py:class:`dict`): Optional mapping of field
+                    names to flat lists of per vertex values
+        )delim"
+    );
+
+
     pygamer.def("writeDolfin", &writeDolfin,
         py::arg("filename"), py::arg("mesh"),
+        py::call_guard<py::gil_scoped_release>(),
         R"delim(
             Write mesh to file in Dolfin XML format
 
@@ -245,6 +288,7 @@ PYBIND11_MODULE(pygamer, pygamer) {
 
     pygamer.def("writeTriangle", &writeTriangle,
         py::arg("filename"), py::arg("mesh"),
+        py::call_guard<py::gil_scoped_release>(),
         R"delim(
             Write mesh to file in Triangle format
 
@@ -256,6 +300,7 @@ PYBIND11_MODULE(pygamer, pygamer) {
 
     pygamer.def("printQualityInfo", &printQualityInfo,
         py::arg("filename"), py::arg("mesh"),
+        py::call_guard<py::gil_scoped_release>(),
         R"delim(
             Print mesh quality info to file
 
@@ -268,6 +313,7 @@ PYBIND11_MODULE(pygamer, pygamer) {
 
     pygamer.def("readDolfin", &readDolfin,
         py::arg("filename"),
+        py::call_guard<py::gil_scoped_release>(),
         R"delim(
             Read Dolfin format mesh into mesh
 
@@ -279,14 +325,237 @@ PYBIND11_MODULE(pygamer, pygamer) {
         )delim"
     );
 
+    pygamer.def("readMSH_TetMesh", &readMSH_TetMesh,
+        py::arg("filename"),
+        py::call_guard<py::gil_scoped_release>(),
+        R"delim(
+            Read binary Gmsh MSH 4.1 file into a tetrahedral mesh
+
+            Args:
+                filename (:py:class:`str`): Filename to read from
+
+            Returns:
+                :py:class:`tetmesh.TetMesh`: Tetrahedral mesh
+        )delim"
+    );
+
+
+    pygamer.def("readMSH_SurfaceMesh", &readMSH_SurfaceMesh,
+        py::arg("filename"),
+        py::call_guard<py::gil_scoped_release>(),
+        R"delim(
+            Read binary Gmsh MSH 4.1 file into a surface mesh
+
+            Args:
+                filename (:py:class:`str`): Filename to read from
+
+            Returns:
+                :py:class:`surfacemesh.SurfaceMesh`: Surface mesh
+        )delim"
+    );
+
+
+    pygamer.def("writeMSH", py::overload_cast<const std::string&, const SurfaceMesh&>(&writeMSH),
+        py::arg("filename"), py::arg("mesh"),
+        py::call_guard<py::gil_scoped_release>(),
+        R"delim(
+            Write mesh to file in binary Gmsh MSH 4.1 format
+
+            Args:
+                filename (:py:class:`str`): Filename to write to.
+                mesh (:py:class:`surfacemesh.SurfaceMesh`): Mesh of interest.
+        )delim"
+    );
+
+
+    pygamer.def("writeMSH", py::overload_cast<const std::string&, const TetMesh&>(&writeMSH),
+        py::arg("filename"), py::arg("mesh"),
+        py::call_guard<py::gil_scoped_release>(),
+        R"delim(
+            Write mesh to file in binary Gmsh MSH 4.1 format
+
+            Args:
+                filename (:py:class:`str`): Filename to write to.
+                mesh (:py:class:`tetmesh.TetMesh`): Mesh of interest.
+        )delim"
+    );
+
+    pygamer.def("readPLY",
+        [](const std::string& filename){
+            std::map<std::string, std::vector<REAL> > fields;
+            std::unique_ptr<SurfaceMesh> mesh;
+            {
+                py::gil_scoped_release release;
+                mesh = readPLY(filename, &fields);
+            }
+            return std::make_tuple(std::move(mesh), fields);
+        },
+        py::arg("filename"),
+        R"delim(
+            Read binary PLY file into a surface mesh
+
+            Args:
+                filename (:py:class:`str`): Filename to read from
+
+            Returns:
+                (:py:class:`surfacemesh.SurfaceMesh`, :py:class:`dict`):
+                Surface mesh and any additional scalar vertex properties by
+                name.
+        )delim"
+    );
+
+
+    pygamer.def("writePLY", &writePLY,
+        py::arg("filename"), py::arg("mesh"), py::arg("normals") = false,
+        py::arg("vertex_fields") = std::map<std::string, std::vector<REAL> >(),
+        py::call_guard<py::gil_scoped_release>(),
+        R"delim(
+            Write mesh to file in binary little endian PLY format
+
+            Vertex and face markers and selection flags are stored as the
+            properties marker and selected.
+
+            Args:
+                filename (:py:class:`str`): Filename to write to.
+                mesh (:py:class:`surfacemesh.SurfaceMesh`): Mesh of interest.
+                normals (:py:class:`bool`): Also write the cached vertex
+                    normals as nx, ny, nz.
+                vertex_fields (:py:class:`dict`): Additional per vertex
+                    values, such as curvatures, keyed by property name.
+        )delim"
+    );
+
+    pygamer.def("readSnapshot_SurfaceMesh",
+        [](const std::string& filename){
+            std::map<std::string, std::vector<REAL> > fields;
+            std::unique_ptr<SurfaceMesh> mesh;
+            {
+                py::gil_scoped_release release;
+                mesh = readSnapshot_SurfaceMesh(filename, &fields);
+            }
+            return std::make_tuple(std::move(mesh), fields);
+        },
+        py::arg("filename"),
+        R"delim(
+            Read a binary snapshot into a surface mesh
+
+            Args:
+                filename (:py:class:`str`): Filename to read from
+
+            Returns:
+                (:py:class:`surfacemesh.SurfaceMesh`, :py:class:`dict`):
+                Surface mesh and the stored vertex fields by name.
+        )delim"
+    );
+
+
+    pygamer.def("readSnapshot_TetMesh",
+        [](const std::string& filename){
+            std::map<std::string, std::vector<REAL> > fields;
+            std::unique_ptr<TetMesh> mesh;
+            {
+                py::gil_scoped_release release;
+                mesh = readSnapshot_TetMesh(filename, &fields);
+            }
+            return std::make_tuple(std::move(mesh), fields);
+        },
+        py::arg("filename"),
+        R"delim(
+            Read a binary snapshot into a tetrahedral mesh
+
+            Args:
+                filename (:py:class:`str`): Filename to read from
+
+            Returns:
+                (:py:class:`tetmesh.TetMesh`, :py:class:`dict`):
+                Tetrahedral mesh and the stored vertex fields by name.
+        )delim"
+    );
+
+
+    pygamer.def("writeSnapshot",
+        py::overload_cast<const std::string&, const SurfaceMesh&,
+                          const std::map<std::string, std::vector<REAL> >&>(&writeSnapshot),
+        py::arg("filename"), py::arg("mesh"),
+        py::arg("vertex_fields") = std::map<std::string, std::vector<REAL> >(),
+        py::call_guard<py::gil_scoped_release>(),
+        R"delim(
+            Write a lossless binary snapshot of the mesh
+
+            The snapshot keeps metadata, orientations, markers, and selection
+            and is meant for checkpointing on the same machine.
+
+            Args:
+                filename (:py:class:`str`): Filename to write to.
+                mesh (:py:class:`surfacemesh.SurfaceMesh`): Mesh of interest.
+                vertex_fields (:py:class:`dict`): Additional per vertex
+                    values, such as curvatures, keyed by name.
+        )delim"
+    );
+
+
+    pygamer.def("writeSnapshot",
+        py::overload_cast<const std::string&, const TetMesh&,
+                          const std::map<std::string, std::vector<REAL> >&>(&writeSnapshot),
+        py::arg("filename"), py::arg("mesh"),
+        py::arg("vertex_fields") = std::map<std::string, std::vector<REAL> >(),
+        py::call_guard<py::gil_scoped_release>(),
+        R"delim(
+            Write a lossless binary snapshot of the mesh
+
+            Args:
+                filename (:py:class:`str`): Filename to write to.
+                mesh (:py:class:`tetmesh.TetMesh`): Mesh of interest.
+                vertex_fields (:py:class:`dict`): Additional per vertex
+                    values keyed by name.
+        )delim"
+    );
+
+    pygamer.def("findIntersections",
+        [](const std::vector<SurfaceMesh*> &meshes, bool select, int marker){
+            std::vector<std::tuple<std::size_t, SurfaceMesh::SimplexID<3>,
+                                   std::size_t, SurfaceMesh::SimplexID<3> > > result;
+            for (const auto &intersection : findIntersections(meshes, select, marker))
+            {
+                result.emplace_back(intersection.firstMesh, intersection.firstFace,
+                                    intersection.secondMesh, intersection.secondFace);
+            }
+            return result;
+        },
+        py::arg("meshes"), py::arg("select")=false, py::arg("marker")=0,
+        py::call_guard<py::gil_scoped_release>(),
+        R"delim(
+            Find intersecting faces within and between surface meshes.
+
+            Faces of the same mesh which only share an edge or a vertex do
+            not count. Run this before :py:func:`makeTetMesh` to locate the
+            faces which would make tetgen fail.
+
+            Args:
+                meshes (:py:class:`list`(:py:class:`surfacemesh.SurfaceMesh`)): List of meshes
+                select (:py:class:`bool`): Select the intersecting faces
+                marker (:py:class:`int`): If nonzero, assign this marker to the intersecting faces
+
+            Returns:
+                :py:class:`list`: Tuples (mesh index, :py:class:`surfacemesh.FaceID`, mesh index, :py:class:`surfacemesh.FaceID`) of intersecting faces
+        )delim"
+    );
+
     pygamer.def("makeTetMesh", &makeTetMesh,
-        py::call_guard<py::scoped_ostream_redirect,
-                py::scoped_estream_redirect>(),
+        py::arg("meshes"), py::arg("tetgen_params"), py::arg("strict") = true,
+        py::call_guard<pygamer_detail::CapturedOutput,
+                py::gil_scoped_release>(),
         R"delim(
             Call tetgen to make a TetMesh
 
+            Intersecting faces found by :py:func:`findIntersections` raise
+            an error naming the face pairs. Surfaces may share an interface
+            of coincident vertices and faces.
+
             Args:
                 meshes (:py:class:`list`(:py:class:`surfacemesh.SurfaceMesh`): List of meshes with filled metadata
+                tetgen_params (:py:class:`str`): Parameters for tetgen
+                strict (:py:class:`bool`): If False, only warn about intersecting faces
 
             Returns:
                 :py:class:`tetmesh.TetMesh`: Resulting tetrahedral mesh
@@ -0,0 +1,586 @@
+/*
+ * ***************************************************************************
+ * This file is part of the GAMer software.
+ * Copyright (C) 2016-2018
+ * by Christopher Lee, John Moody, Rommie Amaro, J. Andrew McCammon,
+ *    and Michael Holst
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * ***************************************************************************
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <utility>
+
+#include "gamer/BVH.h"
+#include "gamer/DenseIndex.h"
+
+/// Namespace for all things gamer
+namespace gamer
+{
+namespace
+{
+/**
+ * @brief      Spread the low 10 bits of x so that they occupy every third bit
+ */
+std::uint32_t expandBits(std::uint32_t x)
+{
+    x = (x * 0x00010001u) & 0xFF0000FFu;
+    x = (x * 0x00000101u) & 0x0F00F00Fu;
+    x = (x * 0x00000011u) & 0xC30C30C3u;
+    x = (x * 0x00000005u) & 0x49249249u;
+    return x;
+}
+
+/**
+ * @brief      30 bit Morton code of a point in the unit cube
+ */
+std::uint32_t morton3D(REAL x, REAL y, REAL z)
+{
+    auto quantize = [](REAL v){
+        return static_cast<std::uint32_t>(std::min(std::max(v*1024, REAL(0)), REAL(1023)));
+    };
+    return (expandBits(quantize(x)) << 2) | (expandBits(quantize(y)) << 1) | expandBits(quantize(z));
+}
+
+/**
+ * @brief      Whether the projections of two triangles onto an axis are
+ *             disjoint
+ */
+bool separatedAlong(const Vector &axis, const Vector *A, const Vector *B)
+{
+    REAL aMin = dot(axis, A[0]), aMax = aMin;
+    REAL bMin = dot(axis, B[0]), bMax = bMin;
+    for (std::size_t i = 1; i < 3; ++i)
+    {
+        REAL a = dot(axis, A[i]);
+        REAL b = dot(axis, B[i]);
+        aMin = std::min(aMin, a);
+        aMax = std::max(aMax, a);
+        bMin = std::min(bMin, b);
+        bMax = std::max(bMax, b);
+    }
+    return aMax < bMin || bMax < aMin;
+}
+} // end anonymous namespace
+
+
+bool rayTriangleIntersect(const Vector &origin, const Vector &dir,
+                          const Vector &a, const Vector &b, const Vector &c,
+                          REAL &t, REAL &u, REAL &v)
+{
+    Vector e1   = b - a;
+    Vector e2   = c - a;
+    Vector pvec = cross(dir, e2);
+    REAL   det  = dot(e1, pvec);
+    // Ray parallel to the plane of the triangle
+    if (det == 0)
+        return false;
+    REAL   inv  = 1/det;
+
+    Vector tvec = origin - a;
+    u = dot(tvec, pvec)*inv;
+    if (u < 0 || u > 1)
+        return false;
+
+    Vector qvec = cross(tvec, e1);
+    v = dot(dir, qvec)*inv;
+    if (v < 0 || u + v > 1)
+        return false;
+
+    t = dot(e2, qvec)*inv;
+    return t >= 0;
+}
+
+
+Vector closestPointOnTriangle(const Vector &p,
+                              const Vector &a, const Vector &b, const Vector &c)
+{
+    // Voronoi region classification, Ericson, Real-Time Collision Detection 5.1.5
+    Vector ab = b - a;
+    Vector ac = c - a;
+    Vector ap = p - a;
+    REAL   d1 = dot(ab, ap);
+    REAL   d2 = dot(ac, ap);
+    if (d1 <= 0 && d2 <= 0)
+        return a;
+
+    Vector bp = p - b;
+    REAL   d3 = dot(ab, bp);
+    REAL   d4 = dot(ac, bp);
+    if (d3 >= 0 && d4 <= d3)
+        return b;
+
+    REAL vc = d1*d4 - d3*d2;
+    if (vc <= 0 && d1 >= 0 && d3 <= 0)
+        return a + (d1/(d1 - d3))*ab;
+
+    Vector cp = p - c;
+    REAL   d5 = dot(ab, cp);
+    REAL   d6 = dot(ac, cp);
+    if (d6 >= 0 && d5 <= d6)
+        return c;
+
+    REAL vb = d5*d2 - d1*d6;
+    if (vb <= 0 && d2 >= 0 && d6 <= 0)
+        return a + (d2/(d2 - d6))*ac;
+
+    REAL va = d3*d6 - d5*d4;
+    if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0)
+        return b + ((d4 - d3)/((d4 - d3) + (d5 - d6)))*(c - b);
+
+    REAL denom = va + vb + vc;
+    // Degenerate triangle
+    if (denom <= 0)
+        return a;
+    return a + (vb/denom)*ab + (vc/denom)*ac;
+}
+
+
+bool trianglesIntersect(const Vector &a0, const Vector &a1, const Vector &a2,
+                        const Vector &b0, const Vector &b1, const Vector &b2)
+{
+    const Vector A[3] = {a0, a1, a2};
+    const Vector B[3] = {b0, b1, b2};
+    const Vector edgesA[3] = {a1 - a0, a2 - a1, a0 - a2};
+    const Vector edgesB[3] = {b1 - b0, b2 - b1, b0 - b2};
+    const Vector normalA = cross(edgesA[0], edgesA[1]);
+    const Vector normalB = cross(edgesB[0], edgesB[1]);
+
+    if (separatedAlong(normalA, A, B) || separatedAlong(normalB, A, B))
+        return false;
+
+    // A degenerate axis projects everything to zero and never separates, so
+    // no special casing of parallel edges is needed.
+    for (std::size_t i = 0; i < 3; ++i)
+    {
+        for (std::size_t j = 0; j < 3; ++j)
+        {
+            if (separatedAlong(cross(edgesA[i], edgesB[j]), A, B))
+                return false;
+        }
+    }
+
+    // Coplanar triangles are separated by an in-plane edge normal. Both
+    // normals are used with every edge so that a degenerate triangle, such as
+    // a segment passed as (p, q, q), borrows the plane of the other one.
+    for (std::size_t i = 0; i < 3; ++i)
+    {
+        if (separatedAlong(cross(normalA, edgesA[i]), A, B)
+            || separatedAlong(cross(normalB, edgesB[i]), A, B)
+            || separatedAlong(cross(normalB, edgesA[i]), A, B)
+            || separatedAlong(cross(normalA, edgesB[i]), A, B))
+            return false;
+    }
+    return true;
+}
+
+
+FaceBVH::FaceBVH(const SurfaceMesh &mesh, std::size_t leafSize)
+    : leafSize(std::max<std::size_t>(leafSize, 1))
+{
+    DenseIndex<SurfaceMesh> index(mesh);
+    vertexIDs.reserve(mesh.size<1>());
+    for (const auto vertexID : mesh.get_level_id<1>())
+        vertexIDs.push_back(vertexID);
+
+    faceIDs.reserve(mesh.size<3>());
+    faces.reserve(mesh.size<3>());
+    for (const auto faceID : mesh.get_level_id<3>())
+    {
+        auto name = mesh.get_name(faceID);
+        std::array<std::size_t, 3> face = {{index[name[0]], index[name[1]], index[name[2]]}};
+        if ((*faceID).orientation == -1)
+            std::swap(face[0], face[2]);
+        faceIDs.push_back(faceID);
+        faces.push_back(face);
+    }
+
+    positions.resize(vertexIDs.size());
+    faceBoxes.resize(faces.size());
+    order.resize(faces.size());
+    refit();
+    buildTree();
+}
+
+
+void FaceBVH::buildTree()
+{
+    const long nFaces = faces.size();
+    nodes.clear();
+    if (nFaces == 0)
+        return;
+
+    // Morton codes of the face box centers relative to the box of centers
+    std::vector<Vector> centers(nFaces);
+    AABB                centerBox;
+    for (long i = 0; i < nFaces; ++i)
+    {
+        centers[i] = (faceBoxes[i].lower + faceBoxes[i].upper)/2;
+        centerBox.expand(centers[i]);
+    }
+    Vector scale;
+    for (std::size_t k = 0; k < 3; ++k)
+    {
+        REAL extent = centerBox.upper[k] - centerBox.lower[k];
+        scale[k] = extent > 0 ? 1/extent : 0;
+    }
+
+    std::vector<std::uint32_t> codes(nFaces);
+    #pragma omp parallel for schedule(static)
+    for (long i = 0; i < nFaces; ++i)
+    {
+        const Vector &c = centers[i];
+        codes[i] = morton3D((c[0] - centerBox.lower[0])*scale[0],
+                            (c[1] - centerBox.lower[1])*scale[1],
+                            (c[2] - centerBox.lower[2])*scale[2]);
+    }
+
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&codes](std::size_t a, std::size_t b){
+        return codes[a] < codes[b] || (codes[a] == codes[b] && a < b);
+    });
+    std::vector<std::uint32_t> sortedCodes(nFaces);
+    for (long i = 0; i < nFaces; ++i)
+        sortedCodes[i] = codes[order[i]];
+
+    nodes.reserve(2*(nFaces/leafSize) + 1);
+    build(sortedCodes, 0, nFaces);
+    updateBoxes();
+}
+
+
+std::size_t FaceBVH::build(const std::vector<std::uint32_t> &codes,
+                           std::size_t begin, std::size_t end)
+{
+    std::size_t curr = nodes.size();
+    nodes.emplace_back();
+    if (end - begin <= leafSize)
+    {
+        nodes[curr].first = begin;
+        nodes[curr].count = end - begin;
+        return curr;
+    }
+
+    std::size_t split;
+    std::uint32_t diff = codes[begin] ^ codes[end-1];
+    if (diff == 0)
+    {
+        // Identical codes, fall back to a median split
+        split = (begin + end)/2;
+    }
+    else
+    {
+        // The codes in the range share all bits above the highest differing
+        // one, so the range splits where that bit becomes set.
+        unsigned bit = 0;
+        while (diff >>= 1)
+            ++bit;
+        split = std::partition_point(codes.begin() + begin, codes.begin() + end,
+                                     [bit](std::uint32_t code){
+                    return ((code >> bit) & 1u) == 0;
+                }) - codes.begin();
+    }
+
+    build(codes, begin, split);
+    std::size_t right = build(codes, split, end);
+    nodes[curr].right = right;
+    return curr;
+}
+
+
+void FaceBVH::refit()
+{
+    const long nVertices = vertexIDs.size();
+    #pragma omp parallel for schedule(static)
+    for (long i = 0; i < nVertices; ++i)
+        positions[i] = (*vertexIDs[i]).position;
+    updateBoxes();
+}
+
+
+void FaceBVH::updateBoxes()
+{
+    const long nFaces = faces.size();
+    #pragma omp parallel for schedule(static)
+    for (long i = 0; i < nFaces; ++i)
+    {
+        AABB box;
+        for (std::size_t k = 0; k < 3; ++k)
+            box.expand(positions[faces[i][k]]);
+        faceBoxes[i] = box;
+    }
+
+    const long nNodes = nodes.size();
+    #pragma omp parallel for schedule(static)
+    for (long i = 0; i < nNodes; ++i)
+    {
+        Node &node = nodes[i];
+        if (node.count == 0)
+            continue;
+        AABB box;
+        for (std::size_t j = node.first; j < node.first + node.count; ++j)
+            box.expand(faceBoxes[order[j]]);
+        node.box = box;
+    }
+
+    // Children always follow their parent
+    for (long i = nNodes - 1; i >= 0; --i)
+    {
+        Node &node = nodes[i];
+        if (node.count > 0)
+            continue;
+        node.box = nodes[i+1].box;
+        node.box.expand(nodes[node.right].box);
+    }
+}
+
+
+bool FaceBVH::intersectRay(const Vector &origin, const Vector &dir, RayHit &hit, REAL tMax) const
+{
+    if (nodes.empty())
+        return false;
+    Vector invDir;
+    for (std::size_t k = 0; k < 3; ++k)
+        invDir[k] = 1/dir[k];
+
+    bool  found = false;
+    REAL  tEnter;
+    std::vector<std::pair<std::size_t, REAL> > stack;
+    if (nodes[0].box.intersectRay(origin, invDir, tMax, tEnter))
+        stack.emplace_back(0, tEnter);
+
+    while (!stack.empty())
+    {
+        std::size_t curr = stack.back().first;
+        REAL        tNode = stack.back().second;
+        stack.pop_back();
+        if (tNode > tMax)
+            continue;
+
+        const Node &node = nodes[curr];
+        if (node.count > 0)
+        {
+            for (std::size_t j = node.first; j < node.first + node.count; ++j)
+            {
+                auto tri = triangle(order[j]);
+                REAL t, u, v;
+                if (rayTriangleIntersect(origin, dir, tri[0], tri[1], tri[2], t, u, v)
+                    && t <= tMax)
+                {
+                    tMax  = t;
+                    hit   = RayHit{order[j], t, u, v};
+                    found = true;
+                }
+            }
+        }
+        else
+        {
+            REAL tLeft, tRight;
+            bool hitLeft  = nodes[curr+1].box.intersectRay(origin, invDir, tMax, tLeft);
+            bool hitRight = nodes[node.right].box.intersectRay(origin, invDir, tMax, tRight);
+            // Push the farther child first so the nearer one is visited first
+            if (hitLeft && hitRight && tLeft <= tRight)
+            {
+                stack.emplace_back(node.right, tRight);
+                stack.emplace_back(curr+1, tLeft);
+            }
+            else
+            {
+                if (hitLeft)
+                    stack.emplace_back(curr+1, tLeft);
+                if (hitRight)
+                    stack.emplace_back(node.right, tRight);
+            }
+        }
+    }
+    return found;
+}
+
+
+std::vector<RayHit> FaceBVH::intersectRayAll(const Vector &origin, const Vector &dir, REAL tMax) const
+{
+    std::vector<RayHit> hits;
+    if (nodes.empty())
+        return hits;
+    Vector invDir;
+    for (std::size_t k = 0; k < 3; ++k)
+        invDir[k] = 1/dir[k];
+
+    REAL tEnter;
+    std::vector<std::size_t> stack{0};
+    while (!stack.empty())
+    {
+        std::size_t curr = stack.back();
+        stack.pop_back();
+        const Node &node = nodes[curr];
+        if (!node.box.intersectRay(origin, invDir, tMax, tEnter))
+            continue;
+        if (node.count > 0)
+        {
+            for (std::size_t j = node.first; j < node.first + node.count; ++j)
+            {
+                auto tri = triangle(order[j]);
+                REAL t, u, v;
+                if (rayTriangleIntersect(origin, dir, tri[0], tri[1], tri[2], t, u, v)
+                    && t <= tMax)
+                    hits.push_back(RayHit{order[j], t, u, v});
+            }
+        }
+        else
+        {
+            stack.push_back(node.right);
+            stack.push_back(curr+1);
+        }
+    }
+    return hits;
+}
+
+
+bool FaceBVH::contains(const Vector &p) const
+{
+    // Unit directions in general position with respect to axis aligned and
+    // symmetric geometry
+    static const REAL directions[][3] = {
+        { 0.6311, 0.5411, 0.5557},
+        {-0.4728, 0.7361,-0.4845},
+        { 0.3029,-0.6627, 0.6850},
+        {-0.7254,-0.3810, 0.5732},
+        { 0.5207,-0.2893,-0.8032},
+        {-0.1846, 0.2871, 0.9399},
+        { 0.8967, 0.4208,-0.1374}
+    };
+    if (nodes.empty())
+        return false;
+    const Vector diagonal = nodes[0].box.upper - nodes[0].box.lower;
+    const REAL   baryTol  = 1e-9;
+    const REAL   cosTol   = 1e-6;
+    const REAL   distTol  = 1e-9*std::sqrt(dot(diagonal, diagonal));
+
+    std::size_t votes = 0, inside = 0;
+    for (const auto &d : directions)
+    {
+        Vector dir({d[0], d[1], d[2]});
+        bool   ambiguous = false;
+        auto   hits = intersectRayAll(p, dir);
+        for (const auto &hit : hits)
+        {
+            auto   tri    = triangle(hit.face);
+            Vector normal = cross(tri[1] - tri[0], tri[2] - tri[0]);
+            REAL   length = std::sqrt(dot(normal, normal));
+            if (hit.u < baryTol || hit.v < baryTol || hit.u + hit.v > 1 - baryTol
+                || std::abs(dot(normal, dir)) <= cosTol*length
+                || hit.t <= distTol)
+            {
+                ambiguous = true;
+                break;
+            }
+        }
+        if (ambiguous)
+            continue;
+
+        inside += hits.size() % 2;
+        if (++votes == 3)
+            break;
+    }
+    return 2*inside > votes;
+}
+
+
+ClosestPoint FaceBVH::closestPoint(const Vector &p, REAL maxDistance) const
+{
+    ClosestPoint result{size(), Vector(), std::numeric_limits<REAL>::infinity()};
+    if (nodes.empty())
+        return result;
+
+    REAL best = maxDistance*maxDistance;
+    std::vector<std::pair<std::size_t, REAL> > stack;
+    stack.emplace_back(0, nodes[0].box.squaredDistance(p));
+    while (!stack.empty())
+    {
+        std::size_t curr = stack.back().first;
+        REAL        dNode = stack.back().second;
+        stack.pop_back();
+        if (dNode >= best)
+            continue;
+
+        const Node &node = nodes[curr];
+        if (node.count > 0)
+        {
+            for (std::size_t j = node.first; j < node.first + node.count; ++j)
+            {
+                if (faceBoxes[order[j]].squaredDistance(p) >= best)
+                    continue;
+                auto   tri = triangle(order[j]);
+                Vector q   = closestPointOnTriangle(p, tri[0], tri[1], tri[2]);
+                Vector d   = q - p;
+                REAL   d2  = dot(d, d);
+                if (d2 < best)
+                {
+                    best   = d2;
+                    result = ClosestPoint{order[j], q, d2};
+                }
+            }
+        }
+        else
+        {
+            REAL dLeft  = nodes[curr+1].box.squaredDistance(p);
+            REAL dRight = nodes[node.right].box.squaredDistance(p);
+            // Push the farther child first so the nearer one is visited first
+            if (dLeft <= dRight)
+            {
+                stack.emplace_back(node.right, dRight);
+                stack.emplace_back(curr+1, dLeft);
+            }
+            else
+            {
+                stack.emplace_back(curr+1, dLeft);
+                stack.emplace_back(node.right, dRight);
+            }
+        }
+    }
+    return result;
+}
+
+
+std::vector<std::size_t> FaceBVH::overlapBox(const AABB &box) const
+{
+    std::vector<std::size_t> result;
+    forEachOverlap(box, [&result](std::size_t i){
+        result.push_back(i);
+    });
+    return result;
+}
+
+
+std::vector<std::size_t> FaceBVH::overlapTriangle(const Vector &a, const Vector &b, const Vector &c) const
+{
+    AABB box;
+    box.expand(a);
+    box.expand(b);
+    box.expand(c);
+
+    std::vector<std::size_t> result;
+    forEachOverlap(box, [&](std::size_t i){
+        auto tri = triangle(i);
+        if (trianglesIntersect(a, b, c, tri[0], tri[1], tri[2]))
+            result.push_back(i);
+    });
+    return result;
+}
+} // end namespace gamer
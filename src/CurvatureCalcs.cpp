@@ -30,40 +30,34 @@
 #include <iomanip>
 #include <map>
 #include <ostream>
+#include <sstream>
 #include <stdexcept>
 #include <strstream>
 #include <vector>
 
+#include "gamer/DenseIndex.h"
 #include "gamer/EigenDiagonalization.h"
+#include "gamer/KRingCache.h"
 #include "gamer/OsculatingJets.h"
 #include "gamer/SurfaceMesh.h"
 
 /// Namespace for all things gamer
 namespace gamer
 {
-std::tuple<REAL*, REAL*, REAL*, REAL*, std::map<typename SurfaceMesh::KeyType, typename SurfaceMesh::KeyType>>
-curvatureViaMDSB(const SurfaceMesh& mesh){
-    std::map<typename SurfaceMesh::KeyType, typename SurfaceMesh::KeyType> sigma;
-
-    REAL *Amix = new REAL[mesh.size<1>()];
-    REAL *kg = new REAL[mesh.size<1>()];
-    REAL *kh = new REAL[mesh.size<1>()];
-    REAL *k1 = new REAL[mesh.size<1>()];
-    REAL *k2 = new REAL[mesh.size<1>()];
-    Vector *Kh = new Vector[mesh.size<1>()];
-    Vector *normals = new Vector[mesh.size<1>()];
-
-    // Map VertexIDs to indices
-    std::size_t i = 0;
-    for (const auto vertexID : mesh.get_level_id<1>()) {
-        Amix[i] = 0;
-        kg[i] = 0;
-        kh[i] = 0;
-        k1[i] = 0;
-        k2[i] = 0;
-        normals[i] = getNormal(mesh, vertexID);
-        sigma[vertexID.indices()[0]] = i++;
-    }
+CurvatureResult curvatureViaMDSB(const SurfaceMesh& mesh){
+    const std::size_t nVertices = mesh.size<1>();
+    DenseIndex<SurfaceMesh> sigma(mesh);
+    CurvatureResult result(nVertices);
+
+    std::vector<REAL> Amix(nVertices, 0);
+    std::vector<Vector> Kh(nVertices);
+    std::vector<Vector> normals;
+    normals.reserve(nVertices);
+    for (const auto vertexID : mesh.get_level_id<1>())
+        normals.push_back(getNormal(mesh, vertexID));
+
+    std::vector<REAL> &kg = result.kg;
+    std::vector<REAL> &kh = result.kh;
 
     for (const auto faceID : mesh.get_level_id<3>()) {
         auto indices = faceID.indices(); // Face vertex indices
@@ -141,7 +135,13 @@ curvatureViaMDSB(const SurfaceMesh& mesh){
         }
     }
 
-    for (std::size_t i = 0; i < mesh.size<1>(); ++i) {
+    for (std::size_t i = 0; i < nVertices; ++i) {
+        // Vertices without any incident face have no mixed area
+        if (Amix[i] <= 0) {
+            kg[i] = 0;
+            continue;
+        }
+
         Kh[i] = Kh[i]/(2.0*Amix[i]);
         kh[i] = std::copysign(length(Kh[i])/2.0, -dot(Kh[i], normals[i]));
         kg[i] = (2.0*M_PI - kg[i])/Amix[i];
@@ -149,38 +149,47 @@ curvatureViaMDSB(const SurfaceMesh& mesh){
         REAL kh2 = kh[i]*kh[i];
         REAL tmp = kh2 < kg[i] ? 0 : std::sqrt(kh2-kg[i]);
 
-        k1[i] = kh[i] + tmp;
-        k2[i] = kh[i] - tmp;
+        result.k1[i] = kh[i] + tmp;
+        result.k2[i] = kh[i] - tmp;
+        result.valid[i] = 1;
     }
-
-    delete[] Amix;
-    delete[] Kh;
-    delete[] normals;
-    return std::make_tuple(kh, kg, k1, k2, sigma);
+    return result;
 }
 
 
-std::tuple<REAL*, REAL*, REAL*, REAL*, std::map<typename SurfaceMesh::KeyType, typename SurfaceMesh::KeyType>>
-curvatureViaJets(const SurfaceMesh& mesh, std::size_t dJet, std::size_t dPrime){
-    std::map<typename SurfaceMesh::KeyType, typename SurfaceMesh::KeyType> sigma;
+CurvatureResult curvatureViaJets(const SurfaceMesh& mesh,
+                                 std::size_t dJet,
+                                 std::size_t dPrime,
+                                 bool principalDirections){
+    CurvatureResult result(mesh.size<1>(), principalDirections);
 
-    REAL *kg = new REAL[mesh.size<1>()];
-    REAL *kh = new REAL[mesh.size<1>()];
-    REAL *k1 = new REAL[mesh.size<1>()];
-    REAL *k2 = new REAL[mesh.size<1>()];
+    std::size_t min_nb_points = (dJet + 1) * (dJet + 2) / 2;
 
-    int min_nb_points = (dJet + 1) * (dJet + 2) / 2;
+    // Enough rings to hold min_nb_points around a regular vertex of valence
+    // six. Vertices with a smaller neighbourhood fall back to vertexGrabber.
+    std::size_t rings = 1;
+    while (1 + 3*rings*(rings + 1) < min_nb_points)
+        ++rings;
+    KRingCache cache(mesh, rings);
 
-    // Map VertexIDs to indices
     std::size_t i = 0;
     for (const auto vertexID : mesh.get_level_id<1>()) {
         std::vector<SurfaceMesh::SimplexID<1>> nbors;
-        nbors.push_back(vertexID);
-        surfacemesh_detail::vertexGrabber(mesh, min_nb_points-1, nbors, vertexID);
+        auto ring = cache[vertexID];
+        if (ring.size() >= min_nb_points) {
+            // Rings are ordered like vertexGrabber so a prefix is what it
+            // would collect.
+            nbors.assign(ring.begin(), ring.begin() + min_nb_points);
+        }
+        else {
+            nbors.push_back(vertexID);
+            surfacemesh_detail::vertexGrabber(mesh, min_nb_points-1, nbors, vertexID);
+        }
 
         if (nbors.size() < min_nb_points) {
             std::cerr << "Not enough pts (have: " << nbors.size() << ", need: "      << min_nb_points << ") for fitting this vertex: "
                       << vertexID << std::endl;
+            ++i;
             continue;
         }
 
@@ -191,13 +200,64 @@ curvatureViaJets(const SurfaceMesh& mesh, std::size_t dJet, std::size_t dPrime){
         REAL tk1 = mongeForm.principal_curvatures(0);
         REAL tk2 = mongeForm.principal_curvatures(1);
 
-        k1[i] = tk1;
-        k2[i] = tk2;
+        result.k1[i] = tk1;
+        result.k2[i] = tk2;
+
+        result.kg[i] = tk1*tk2;
+        result.kh[i] = (tk1+tk2)/2.;
+        if (principalDirections) {
+            result.d1[i] = mongeForm.maximal_principal_direction();
+            result.d2[i] = mongeForm.minimal_principal_direction();
+        }
+        result.valid[i++] = 1;
+    }
+    return result;
+}
+
 
-        kg[i] = tk1*tk2;
-        kh[i] = (tk1+tk2)/2.;
-        sigma[vertexID.indices()[0]] = i++;
+void smoothCurvatures(const SurfaceMesh& mesh,
+                      CurvatureResult& curvatures,
+                      std::size_t nIter){
+    const std::size_t nVertices = mesh.size<1>();
+    if (curvatures.size() != nVertices) {
+        std::stringstream ss;
+        ss << "smoothCurvatures: Curvatures of " << curvatures.size()
+           << " vertices do not match mesh with " << nVertices << " vertices.";
+        throw std::runtime_error(ss.str());
     }
-    return std::make_tuple(kh, kg, k1, k2, sigma);
+    if (nIter == 0) return;
+
+    // Gather the valid one ring of each valid vertex once
+    DenseIndex<SurfaceMesh> sigma(mesh);
+    std::vector<std::size_t> offsets(1, 0);
+    std::vector<std::size_t> nbors;
+    offsets.reserve(nVertices+1);
+    for (const auto vertexID : mesh.get_level_id<1>()) {
+        std::size_t i = offsets.size() - 1;
+        if (curvatures.valid[i]) {
+            for (auto key : vertexID.cover()) {
+                std::size_t j = sigma[key];
+                if (curvatures.valid[j])
+                    nbors.push_back(j);
+            }
+        }
+        offsets.push_back(nbors.size());
+    }
+
+    std::array<std::vector<REAL>*, 4> values = {
+        &curvatures.kh, &curvatures.kg, &curvatures.k1, &curvatures.k2};
+    std::vector<REAL> smoothed(nVertices);
+    for (std::vector<REAL> *value : values) {
+        std::vector<REAL> &k = *value;
+        for (std::size_t round = 0; round < nIter; ++round) {
+            for (std::size_t i = 0; i < nVertices; ++i) {
+                REAL sum = k[i];
+                for (std::size_t n = offsets[i]; n < offsets[i+1]; ++n)
+                    sum += k[nbors[n]];
+                smoothed[i] = sum/static_cast<REAL>(offsets[i+1] - offsets[i] + 1);
+            }
+            k.swap(smoothed);
+        }
+    }
+}
 }
-}
\ No newline at end of file
@@ -0,0 +1,218 @@
+/*
+ * ***************************************************************************
+ * This file is part of the GAMer software.
+ * Copyright (C) 2016-2018
+ * by Christopher Lee, John Moody, Rommie Amaro, J. Andrew McCammon,
+ *    and Michael Holst
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * ***************************************************************************
+ */
+
+#include <array>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+#include <Eigen/Sparse>
+#include <Eigen/SparseCholesky>
+
+#include "gamer/DenseIndex.h"
+#include "gamer/SurfaceMesh.h"
+
+/// Namespace for all things gamer
+namespace gamer
+{
+/// @cond detail
+namespace
+{
+using Positions = Eigen::Matrix<REAL, Eigen::Dynamic, 3>;
+
+/**
+ * @brief      Backward Euler steps of the cotangent Laplacian flow.
+ *
+ * @param      positions  Vertex positions, updated in place
+ * @param[in]  faces      Vertex indices of each face
+ * @param[in]  row        Row of each vertex in the system or -1 if it is
+ *                        fixed
+ * @param[in]  nFree      Number of vertices which move
+ * @param[in]  dt         The time step
+ * @param[in]  steps      Number of steps
+ */
+void cotangentFlow(Positions                                      &positions,
+                   const std::vector<std::array<std::size_t, 3> > &faces,
+                   const std::vector<long>                        &row,
+                   long                                            nFree,
+                   REAL                                            dt,
+                   std::size_t                                     steps)
+{
+    using SparseMatrix = Eigen::SparseMatrix<REAL>;
+    using Triplet      = Eigen::Triplet<REAL>;
+
+    const long nVertices = positions.rows();
+    const long nFaces    = faces.size();
+
+    // Free vertices without faces keep their position
+    std::vector<char> isolated(nVertices, 1);
+    for (const auto &face : faces)
+    {
+        for (auto v : face)
+            isolated[v] = 0;
+    }
+
+    Eigen::SimplicialLDLT<SparseMatrix> solver;
+    std::vector<std::array<REAL, 3> >   cotangents(nFaces);
+    std::vector<REAL>                   areas(nFaces);
+
+    for (std::size_t step = 0; step < steps; ++step)
+    {
+        // Cotangent of the angle at each corner and area of each face
+        #pragma omp parallel for schedule(static)
+        for (long f = 0; f < nFaces; ++f)
+        {
+            const auto &face = faces[f];
+            Eigen::Matrix<REAL, 1, 3> u = positions.row(face[1]) - positions.row(face[0]);
+            Eigen::Matrix<REAL, 1, 3> w = positions.row(face[2]) - positions.row(face[0]);
+            REAL twiceArea = u.cross(w).norm();
+            areas[f] = twiceArea/2;
+            for (std::size_t k = 0; k < 3; ++k)
+            {
+                u = positions.row(face[(k+1)%3]) - positions.row(face[k]);
+                w = positions.row(face[(k+2)%3]) - positions.row(face[k]);
+                cotangents[f][k] = (twiceArea > 0) ? u.dot(w)/twiceArea : 0;
+            }
+        }
+
+        // Solve (M - dt L) x' = M x with the lumped mass matrix M and the
+        // cotangent Laplacian L. Fixed vertices move to the right hand side.
+        // Every face contributes the same entries each step so the sparsity
+        // pattern does not change.
+        std::vector<Triplet> triplets;
+        triplets.reserve(9*nFaces + nFree);
+        Positions rhs = Positions::Zero(nFree, 3);
+        for (long v = 0; v < nVertices; ++v)
+        {
+            if (row[v] >= 0 && isolated[v])
+            {
+                triplets.emplace_back(row[v], row[v], 1);
+                rhs.row(row[v]) = positions.row(v);
+            }
+        }
+        for (long f = 0; f < nFaces; ++f)
+        {
+            const auto &face = faces[f];
+            for (std::size_t k = 0; k < 3; ++k)
+            {
+                const long r = row[face[k]];
+                if (r < 0)
+                    continue;
+                const REAL mass = areas[f]/3;
+                triplets.emplace_back(r, r, mass);
+                rhs.row(r) += mass*positions.row(face[k]);
+            }
+            for (std::size_t k = 0; k < 3; ++k)
+            {
+                // Edge opposite corner k
+                const std::size_t i = face[(k+1)%3], j = face[(k+2)%3];
+                const long ri = row[i], rj = row[j];
+                const REAL weight = dt*cotangents[f][k]/2;
+                if (ri >= 0)
+                    triplets.emplace_back(ri, ri, weight);
+                if (rj >= 0)
+                    triplets.emplace_back(rj, rj, weight);
+                if (ri >= 0 && rj >= 0)
+                {
+                    triplets.emplace_back(ri, rj, -weight);
+                    triplets.emplace_back(rj, ri, -weight);
+                }
+                else if (ri >= 0)
+                {
+                    rhs.row(ri) += weight*positions.row(j);
+                }
+                else if (rj >= 0)
+                {
+                    rhs.row(rj) += weight*positions.row(i);
+                }
+            }
+        }
+        SparseMatrix A(nFree, nFree);
+        A.setFromTriplets(triplets.begin(), triplets.end());
+
+        if (step == 0)
+            solver.analyzePattern(A);
+        solver.factorize(A);
+        if (solver.info() != Eigen::Success)
+            throw std::runtime_error("implicitFairing: Failed to factorize the fairing system.");
+        Positions solution = solver.solve(rhs);
+
+        #pragma omp parallel for schedule(static)
+        for (long v = 0; v < nVertices; ++v)
+        {
+            if (row[v] >= 0)
+                positions.row(v) = solution.row(row[v]);
+        }
+    }
+}
+} // end anonymous namespace
+/// @endcond
+
+void implicitFairing(SurfaceMesh& mesh, REAL timeStep, std::size_t steps, bool selectedOnly)
+{
+    if (!(timeStep > 0))
+        throw std::runtime_error("implicitFairing: The time step must be positive.");
+
+    const std::size_t       nVertices = mesh.size<1>();
+    DenseIndex<SurfaceMesh> index(mesh);
+
+    std::vector<SurfaceMesh::SimplexID<1> > vertexIDs;
+    std::vector<long>                       row(nVertices, -1);
+    Positions                               positions(nVertices, 3);
+    long nFree = 0;
+    for (const auto vertexID : mesh.get_level_id<1>())
+    {
+        const auto &vertex = *vertexID;
+        if (!selectedOnly || vertex.selected)
+            row[vertexIDs.size()] = nFree++;
+        positions.row(vertexIDs.size()) << vertex[0], vertex[1], vertex[2];
+        vertexIDs.push_back(vertexID);
+    }
+    if (nFree == 0)
+        return;
+
+    std::vector<std::array<std::size_t, 3> > faces;
+    faces.reserve(mesh.size<3>());
+    REAL meanLength = 0;
+    for (const auto faceID : mesh.get_level_id<3>())
+    {
+        auto name = mesh.get_name(faceID);
+        faces.push_back({{index[name[0]], index[name[1]], index[name[2]]}});
+        for (std::size_t k = 0; k < 3; ++k)
+            meanLength += (positions.row(faces.back()[k]) - positions.row(faces.back()[(k+1)%3])).norm();
+    }
+    if (!faces.empty())
+        meanLength /= 3*faces.size();
+
+    // Scale the time step by the squared mean edge length so that the
+    // amount of smoothing does not depend on the size of the mesh
+    cotangentFlow(positions, faces, row, nFree, timeStep*meanLength*meanLength, steps);
+
+    for (std::size_t v = 0; v < nVertices; ++v)
+    {
+        if (row[v] >= 0)
+            (*vertexIDs[v]).position = Vector({positions(v, 0), positions(v, 1), positions(v, 2)});
+    }
+}
+} // end namespace gamer
@@ -0,0 +1,323 @@
+/*
+ * ***************************************************************************
+ * This file is part of the GAMer software.
+ * Copyright (C) 2016-2018
+ * by Christopher Lee, John Moody, Rommie Amaro, J. Andrew McCammon,
+ *    and Michael Holst
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * ***************************************************************************
+ */
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <set>
+
+#include "gamer/DenseIndex.h"
+#include "gamer/KRingCache.h"
+
+/// Namespace for all things gamer
+namespace gamer
+{
+KRingCache::KRingCache(const SurfaceMesh &mesh, std::size_t rings)
+    : mesh(&mesh), nRings(rings)
+{
+    build();
+}
+
+void KRingCache::build()
+{
+    offset.clear();
+    count.clear();
+    stale.clear();
+    members.clear();
+    nStale = 0;
+    nLive  = 0;
+
+    const std::size_t nVertices = mesh->size<1>();
+    if (nVertices == 0)
+        return;
+
+    DenseIndex<SurfaceMesh> index(*mesh);
+    std::vector<SimplexID> vertices;
+    vertices.reserve(nVertices);
+    auto maxKey = std::numeric_limits<KeyType>::lowest();
+    minKey = std::numeric_limits<KeyType>::max();
+    for (const auto vertexID : mesh->get_level_id<1>())
+    {
+        auto key = vertexID.indices()[0];
+        minKey = std::min(minKey, key);
+        maxKey = std::max(maxKey, key);
+        vertices.push_back(vertexID);
+    }
+
+    // Dense one ring adjacency
+    std::vector<std::size_t> adjStart(nVertices + 1, 0);
+    std::vector<std::array<std::size_t, 2> > edges;
+    edges.reserve(mesh->size<2>());
+    for (const auto edgeID : mesh->get_level_id<2>())
+    {
+        auto name = mesh->get_name(edgeID);
+        std::array<std::size_t, 2> edge = {{index[name[0]], index[name[1]]}};
+        ++adjStart[edge[0] + 1];
+        ++adjStart[edge[1] + 1];
+        edges.push_back(edge);
+    }
+    for (std::size_t i = 0; i < nVertices; ++i)
+        adjStart[i + 1] += adjStart[i];
+    std::vector<std::size_t> adjacent(adjStart.back());
+    {
+        std::vector<std::size_t> fill(adjStart.begin(), adjStart.end() - 1);
+        for (const auto &edge : edges)
+        {
+            adjacent[fill[edge[0]]++] = edge[1];
+            adjacent[fill[edge[1]]++] = edge[0];
+        }
+    }
+    // Neighbours in key order, as get_cover lists them
+    for (std::size_t i = 0; i < nVertices; ++i)
+    {
+        std::sort(adjacent.begin() + adjStart[i], adjacent.begin() + adjStart[i + 1],
+                  [&](std::size_t a, std::size_t b){
+            return vertices[a].indices()[0] < vertices[b].indices()[0];
+        });
+    }
+
+    // Breadth first search from a vertex over the dense adjacency. The
+    // vertex itself is stamped into mark so that the array never needs to
+    // be cleared between searches. Each ring is expanded in SimplexID order
+    // like vertexGrabber so that prefixes of the result match it.
+    auto search = [&](std::size_t center, std::vector<std::size_t> &mark,
+                      std::vector<std::size_t> &queue, std::vector<std::size_t> &order){
+        queue.clear();
+        queue.push_back(center);
+        mark[center] = center;
+        std::size_t begin = 0;
+        for (std::size_t ring = 0; ring < nRings; ++ring)
+        {
+            const std::size_t end = queue.size();
+            order.assign(queue.begin() + begin, queue.begin() + end);
+            std::sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b){
+                return vertices[a] < vertices[b];
+            });
+            for (const std::size_t u : order)
+            {
+                for (std::size_t j = adjStart[u]; j < adjStart[u + 1]; ++j)
+                {
+                    const std::size_t nbor = adjacent[j];
+                    if (mark[nbor] != center)
+                    {
+                        mark[nbor] = center;
+                        queue.push_back(nbor);
+                    }
+                }
+            }
+            if (end == queue.size())
+                break;
+            begin = end;
+        }
+    };
+
+    // Two passes: size every neighbourhood, then fill them in place
+    const long n = nVertices;
+    std::vector<std::size_t> start(nVertices + 1, 0);
+    #pragma omp parallel
+    {
+        std::vector<std::size_t> mark(nVertices, nVertices);
+        std::vector<std::size_t> queue, order;
+
+        #pragma omp for schedule(static)
+        for (long v = 0; v < n; ++v)
+        {
+            search(v, mark, queue, order);
+            start[v + 1] = queue.size();
+        }
+    }
+    for (std::size_t i = 0; i < nVertices; ++i)
+        start[i + 1] += start[i];
+
+    members.resize(start.back());
+    #pragma omp parallel
+    {
+        std::vector<std::size_t> mark(nVertices, nVertices);
+        std::vector<std::size_t> queue, order;
+
+        #pragma omp for schedule(static)
+        for (long v = 0; v < n; ++v)
+        {
+            search(v, mark, queue, order);
+            for (std::size_t i = 0; i < queue.size(); ++i)
+                members[start[v] + i] = vertices[queue[i]];
+        }
+    }
+    nLive = members.size();
+
+    const std::size_t nSlots = static_cast<std::size_t>(maxKey - minKey) + 1;
+    offset.assign(nSlots, 0);
+    count.assign(nSlots, 0);
+    stale.assign(nSlots, 0);
+    for (std::size_t v = 0; v < nVertices; ++v)
+    {
+        const std::size_t s = vertices[v].indices()[0] - minKey;
+        offset[s] = start[v];
+        count[s]  = start[v + 1] - start[v];
+    }
+}
+
+std::size_t KRingCache::slot(KeyType key)
+{
+    // Vertices inserted after the build may have keys outside the range.
+    // Their neighbourhoods start out stale.
+    if (offset.empty())
+    {
+        minKey = key;
+    }
+    else if (key < minKey)
+    {
+        const std::size_t shift = minKey - key;
+        offset.insert(offset.begin(), shift, 0);
+        count.insert(count.begin(), shift, 0);
+        stale.insert(stale.begin(), shift, 1);
+        nStale += shift;
+        minKey = key;
+    }
+    const std::size_t s = key - minKey;
+    if (s >= offset.size())
+    {
+        nStale += s + 1 - offset.size();
+        offset.resize(s + 1, 0);
+        count.resize(s + 1, 0);
+        stale.resize(s + 1, 1);
+    }
+    return s;
+}
+
+void KRingCache::gather(std::size_t s, SimplexID vertexID)
+{
+    std::vector<SimplexID> ring;
+    std::set<SimplexID>    visited;
+    ring.push_back(vertexID);
+    visited.insert(vertexID);
+    std::size_t begin = 0;
+    for (std::size_t r = 0; r < nRings && begin < ring.size(); ++r)
+    {
+        // Same visiting order as vertexGrabber
+        const std::set<SimplexID> order(ring.begin() + begin, ring.end());
+        begin = ring.size();
+        for (auto u : order)
+        {
+            for (auto a : mesh->get_cover(u))
+            {
+                auto nbor = mesh->get_simplex_up({a});
+                if (visited.insert(nbor).second)
+                    ring.push_back(nbor);
+            }
+        }
+    }
+
+    nLive -= count[s];
+    if (ring.size() > count[s])
+    {
+        // Reclaim the space of replaced neighbourhoods once it dominates
+        if (members.size() - nLive > nLive + ring.size())
+            compact();
+        offset[s] = members.size();
+        members.insert(members.end(), ring.begin(), ring.end());
+    }
+    else
+    {
+        std::copy(ring.begin(), ring.end(), members.begin() + offset[s]);
+    }
+    count[s] = ring.size();
+    nLive   += ring.size();
+    if (stale[s])
+    {
+        stale[s] = 0;
+        --nStale;
+    }
+}
+
+void KRingCache::compact()
+{
+    std::vector<SimplexID> packed;
+    packed.reserve(nLive);
+    for (std::size_t s = 0; s < offset.size(); ++s)
+    {
+        // Stale neighbourhoods are regathered before use anyway
+        if (stale[s])
+            count[s] = 0;
+        const std::size_t first = packed.size();
+        packed.insert(packed.end(), members.begin() + offset[s],
+                      members.begin() + offset[s] + count[s]);
+        offset[s] = first;
+    }
+    members.swap(packed);
+    nLive = members.size();
+}
+
+KRingCache::Range KRingCache::operator[](SimplexID vertexID)
+{
+    const std::size_t s = slot(vertexID.indices()[0]);
+    if (stale[s])
+        gather(s, vertexID);
+    const SimplexID *first = members.data() + offset[s];
+    return Range(first, first + count[s]);
+}
+
+void KRingCache::invalidate(SimplexID vertexID)
+{
+    for (const auto nbor : (*this)[vertexID])
+    {
+        const std::size_t s = slot(nbor.indices()[0]);
+        if (!stale[s])
+        {
+            stale[s] = 1;
+            ++nStale;
+        }
+    }
+}
+
+void KRingCache::refresh()
+{
+    if (nStale == 0)
+        return;
+    if (4*nStale > mesh->size<1>())
+    {
+        build();
+        return;
+    }
+    for (std::size_t s = 0; s < offset.size(); ++s)
+    {
+        if (!stale[s])
+            continue;
+        KeyType key = minKey + static_cast<KeyType>(s);
+        auto vertexID = mesh->get_simplex_up({key});
+        if (vertexID != nullptr)
+        {
+            gather(s, vertexID);
+        }
+        else
+        {
+            // The vertex has been removed
+            nLive   -= count[s];
+            count[s] = 0;
+            stale[s] = 0;
+            --nStale;
+        }
+    }
+}
+} // end namespace gamer
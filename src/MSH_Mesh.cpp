@@ -0,0 +1,830 @@
+/*
+ * ***************************************************************************
+ * This file is part of the GAMer software.
+ * Copyright (C) 2016-2018
+ * by Christopher Lee, John Moody, Rommie Amaro, J. Andrew McCammon,
+ *    and Michael Holst
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * ***************************************************************************
+ */
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <casc/casc>
+
+#include "gamer/BufferedWriter.h"
+#include "gamer/DenseIndex.h"
+#include "gamer/MappedFile.h"
+#include "gamer/SurfaceMesh.h"
+#include "gamer/TetMesh.h"
+
+/// Namespace for all things gamer
+namespace gamer
+{
+/// @cond detail
+namespace
+{
+/// Gmsh stores all size_t values as 8 bytes in binary files
+using msh_size_t = std::uint64_t;
+
+/// Gmsh element type identifiers
+constexpr int MSH_TRIANGLE    = 2;
+constexpr int MSH_TETRAHEDRON = 4;
+
+/**
+ * @brief      Number of nodes of a Gmsh element type
+ *
+ * @param[in]  type  The element type
+ *
+ * @return     Number of nodes, or zero if the type is not in the table
+ */
+std::size_t mshNodesPerElement(int type)
+{
+    static const std::array<int, 32> nodes = {
+        0, 2, 3, 4, 4, 8, 6, 5, 3, 6, 9, 10, 27, 18, 14, 1,
+        8, 20, 15, 13, 9, 10, 12, 15, 15, 21, 4, 5, 6, 20, 35, 56
+    };
+    if (type <= 0 || type >= static_cast<int>(nodes.size()))
+        return 0;
+    return nodes[type];
+}
+
+/**
+ * @brief      Simplices sharing a marker which are written as one entity.
+ *
+ * @tparam     Mesh  Mesh type
+ * @tparam     k     Level of the simplices
+ */
+template <typename Mesh, std::size_t k>
+struct MSHEntity
+{
+    int marker;
+    std::array<double, 6> bbox;
+    std::vector<typename Mesh::template SimplexID<k> > ids;
+};
+
+/**
+ * @brief      Group the simplices of a level by marker.
+ *
+ * @param[in]  mesh          The mesh
+ * @param[in]  skipUnmarked  Skip simplices with a marker of zero
+ *
+ * @return     Entities in order of increasing marker
+ */
+template <std::size_t k, typename Mesh>
+std::vector<MSHEntity<Mesh, k> > groupByMarker(const Mesh &mesh, bool skipUnmarked)
+{
+    std::map<int, MSHEntity<Mesh, k> > groups;
+    for (const auto id : mesh.template get_level_id<k>())
+    {
+        int marker = (*id).marker;
+        if (skipUnmarked && marker == 0)
+            continue;
+        auto it = groups.find(marker);
+        if (it == groups.end())
+        {
+            const double inf = std::numeric_limits<double>::infinity();
+            MSHEntity<Mesh, k> entity;
+            entity.marker = marker;
+            entity.bbox   = {inf, inf, inf, -inf, -inf, -inf};
+            it = groups.emplace(marker, std::move(entity)).first;
+        }
+        auto &entity = it->second;
+        entity.ids.push_back(id);
+        for (auto key : id.indices())
+        {
+            const auto &vertex = *mesh.get_simplex_up({key});
+            for (std::size_t j = 0; j < 3; ++j)
+            {
+                entity.bbox[j]   = std::min<double>(entity.bbox[j], vertex[j]);
+                entity.bbox[j+3] = std::max<double>(entity.bbox[j+3], vertex[j]);
+            }
+        }
+    }
+    std::vector<MSHEntity<Mesh, k> > result;
+    result.reserve(groups.size());
+    for (auto &group : groups)
+        result.push_back(std::move(group.second));
+    return result;
+}
+
+/**
+ * @brief      Write an entity record of the binary Entities section.
+ *
+ * Only positive markers are valid physical tags.
+ */
+template <typename Entity>
+void writeMSHEntity(BufferedWriter &out, int tag, const Entity &entity)
+{
+    out.push(static_cast<int>(tag));
+    for (auto v : entity.bbox)
+        out.push(v);
+    if (entity.marker > 0)
+    {
+        out.push(static_cast<msh_size_t>(1));
+        out.push(static_cast<int>(entity.marker));
+    }
+    else
+    {
+        out.push(static_cast<msh_size_t>(0));
+    }
+    out.push(static_cast<msh_size_t>(0));   // No bounding entities
+}
+
+/**
+ * @brief      Check that the nodes of a mesh can be placed on an entity.
+ *
+ * The nodes are written as a block of the first surface or volume entity,
+ * so a mesh with vertices but no such entity cannot be written.
+ *
+ * @param[in]  mesh      The mesh
+ * @param[in]  surfaces  Surface entities
+ * @param[in]  volumes   Volume entities
+ */
+template <typename Mesh, typename Surfaces, typename Volumes>
+void checkMSHNodeEntity(const Mesh     &mesh,
+                        const Surfaces &surfaces,
+                        const Volumes  &volumes)
+{
+    if (mesh.template size<1>() > 0 && surfaces.empty() && volumes.empty())
+    {
+        throw std::runtime_error("writeMSH: The mesh has vertices but no cells "
+                                 "or marked faces which could own them.");
+    }
+}
+
+/**
+ * @brief      Write the format header and the nodes of a mesh.
+ *
+ * @param      out           The output
+ * @param[in]  mesh          The mesh
+ * @param[in]  surfaces      Surface entities
+ * @param[in]  volumes       Volume entities
+ */
+template <typename Mesh, typename Surfaces, typename Volumes>
+void writeMSHHeaderAndNodes(BufferedWriter &out,
+                            const Mesh     &mesh,
+                            const Surfaces &surfaces,
+                            const Volumes  &volumes)
+{
+    out.write("$MeshFormat\n4.1 1 8\n");
+    out.push(static_cast<int>(1));
+    out.write("\n$EndMeshFormat\n");
+
+    out.write("$Entities\n");
+    out.push(static_cast<msh_size_t>(0));
+    out.push(static_cast<msh_size_t>(0));
+    out.push(static_cast<msh_size_t>(surfaces.size()));
+    out.push(static_cast<msh_size_t>(volumes.size()));
+    for (std::size_t i = 0; i < surfaces.size(); ++i)
+        writeMSHEntity(out, i+1, surfaces[i]);
+    for (std::size_t i = 0; i < volumes.size(); ++i)
+        writeMSHEntity(out, i+1, volumes[i]);
+    out.write("\n$EndEntities\n");
+
+    // All nodes are placed in a single block on the first entity of the
+    // highest dimension. checkMSHNodeEntity() ensures there is one.
+    const msh_size_t nNodes = mesh.template size<1>();
+    out.write("$Nodes\n");
+    out.push(static_cast<msh_size_t>(nNodes > 0 ? 1 : 0));
+    out.push(nNodes);
+    out.push(static_cast<msh_size_t>(nNodes > 0 ? 1 : 0));
+    out.push(nNodes);
+    if (nNodes > 0)
+    {
+        out.push(static_cast<int>(volumes.empty() ? 2 : 3));
+        out.push(static_cast<int>(1));
+        out.push(static_cast<int>(0));      // Not parametric
+        out.push(nNodes);
+        for (msh_size_t i = 1; i <= nNodes; ++i)
+            out.push(i);
+        for (const auto &vertex : mesh.template get_level<1>())
+        {
+            out.push(static_cast<double>(vertex[0]));
+            out.push(static_cast<double>(vertex[1]));
+            out.push(static_cast<double>(vertex[2]));
+        }
+    }
+    out.write("\n$EndNodes\n");
+}
+
+/**
+ * @brief      Write one element block per entity.
+ *
+ * @param      out       The output
+ * @param[in]  dim       Dimension of the entities
+ * @param[in]  type      Gmsh element type
+ * @param[in]  entities  The entities
+ * @param[in]  nodeTags  Node tags of the vertices
+ * @param      tag       Next element tag
+ * @param[in]  order     Function returning the ordered keys of a simplex
+ */
+template <typename Entities, typename NodeTags, typename Order>
+void writeMSHElementBlocks(BufferedWriter &out,
+                           int             dim,
+                           int             type,
+                           const Entities &entities,
+                           const NodeTags &nodeTags,
+                           msh_size_t     &tag,
+                           Order         &&order)
+{
+    for (std::size_t i = 0; i < entities.size(); ++i)
+    {
+        const auto &entity = entities[i];
+        out.push(static_cast<int>(dim));
+        out.push(static_cast<int>(i+1));
+        out.push(static_cast<int>(type));
+        out.push(static_cast<msh_size_t>(entity.ids.size()));
+        for (const auto id : entity.ids)
+        {
+            out.push(tag++);
+            for (auto key : order(id))
+                out.push(static_cast<msh_size_t>(nodeTags[key]));
+        }
+    }
+}
+
+/**
+ * @brief      Forward cursor over a memory mapped MSH file.
+ */
+class MSHCursor
+{
+public:
+    MSHCursor(const char *begin, const char *end) : pos(begin), last(end) {}
+
+    bool atEnd()
+    {
+        skipWhitespace();
+        return pos >= last;
+    }
+
+    template <typename T>
+    T read()
+    {
+        need(sizeof(T));
+        T value;
+        std::memcpy(&value, pos, sizeof(T));
+        pos += sizeof(T);
+        return value;
+    }
+
+    void skip(std::size_t n)
+    {
+        need(n);
+        pos += n;
+    }
+
+    const char *current() const
+    {
+        return pos;
+    }
+
+    const char *end() const
+    {
+        return last;
+    }
+
+    std::string line()
+    {
+        skipWhitespace();
+        const char *begin = pos;
+        const char *nl    = static_cast<const char*>(std::memchr(pos, '\n', last - pos));
+        pos = (nl) ? nl + 1 : last;
+        const char *end = (nl) ? nl : last;
+        if (end > begin && end[-1] == '\r')
+            --end;
+        return std::string(begin, end);
+    }
+
+    void expect(const std::string &token)
+    {
+        std::string found = line();
+        if (found != token)
+            throw std::runtime_error("Expected '" + token + "' but found '" + found + "'.");
+    }
+
+    void skipSection(const std::string &name)
+    {
+        const std::string token = "$End" + name;
+        while (pos < last)
+        {
+            const char *hit = static_cast<const char*>(std::memchr(pos, '$', last - pos));
+            if (hit == nullptr)
+                break;
+            pos = hit;
+            if (static_cast<std::size_t>(last - pos) >= token.size()
+                && std::strncmp(pos, token.c_str(), token.size()) == 0)
+            {
+                line();
+                return;
+            }
+            ++pos;
+        }
+        throw std::runtime_error("Missing '" + token + "'.");
+    }
+
+private:
+    void need(std::size_t n)
+    {
+        if (static_cast<std::size_t>(last - pos) < n)
+            throw std::runtime_error("Unexpected end of file.");
+    }
+
+    void skipWhitespace()
+    {
+        while (pos < last && (*pos == ' ' || *pos == '\n' || *pos == '\r' || *pos == '\t'))
+            ++pos;
+    }
+
+    const char *pos;
+    const char *last;
+};
+
+/**
+ * @brief      Infer the number of nodes per element of a block of an element
+ *             type which is not in the table.
+ *
+ * Binary element blocks do not store their length. The node count is the
+ * smallest one for which every element tag lies in the range given by the
+ * section header and the block is followed by a plausible block header, or
+ * by the end of the section if it is the last block.
+ *
+ * @param[in]  cursor     Cursor at the first element of the block
+ * @param[in]  n          Number of elements of the block
+ * @param[in]  nElements  Number of elements of the section
+ * @param[in]  minTag     Smallest element tag of the section
+ * @param[in]  maxTag     Largest element tag of the section
+ * @param[in]  lastBlock  Whether this is the last block of the section
+ *
+ * @return     Number of nodes per element
+ */
+std::size_t inferNodesPerElement(const MSHCursor &cursor, msh_size_t n,
+                                 msh_size_t nElements,
+                                 msh_size_t minTag, msh_size_t maxTag,
+                                 bool lastBlock)
+{
+    const char *begin = cursor.current();
+    const std::size_t available = cursor.end() - begin;
+    const std::string endToken = "$EndElements";
+    for (std::size_t nn = 1; (nn + 1)*sizeof(msh_size_t)*n <= available; ++nn)
+    {
+        const std::size_t stride = (nn + 1)*sizeof(msh_size_t);
+        bool valid = true;
+        for (msh_size_t i = 0; i < n && valid; ++i)
+        {
+            msh_size_t tag;
+            std::memcpy(&tag, begin + i*stride, sizeof(tag));
+            valid = tag >= minTag && tag <= maxTag;
+        }
+        if (!valid)
+            continue;
+
+        const char *next = begin + n*stride;
+        if (lastBlock)
+        {
+            while (next < cursor.end() && std::isspace(static_cast<unsigned char>(*next)))
+                ++next;
+            if (static_cast<std::size_t>(cursor.end() - next) >= endToken.size()
+                && std::strncmp(next, endToken.c_str(), endToken.size()) == 0)
+                return nn;
+        }
+        else if (static_cast<std::size_t>(cursor.end() - next) >= 3*sizeof(int) + sizeof(msh_size_t))
+        {
+            int dim, entityTag, type;
+            msh_size_t count;
+            std::memcpy(&dim, next, sizeof(int));
+            std::memcpy(&entityTag, next + sizeof(int), sizeof(int));
+            std::memcpy(&type, next + 2*sizeof(int), sizeof(int));
+            std::memcpy(&count, next + 3*sizeof(int), sizeof(count));
+            if (dim >= 0 && dim <= 3 && entityTag > 0 && type > 0 && count <= nElements - n)
+                return nn;
+        }
+    }
+    throw std::runtime_error("Cannot determine the size of an element block.");
+}
+
+/**
+ * @brief      Contents of a MSH file reduced to dense arrays.
+ */
+struct MSHData
+{
+    std::vector<REAL> nodes;        ///< Node positions
+    std::vector<int>  triangles;    ///< Triangle node indices
+    std::vector<int>  triMarkers;   ///< Triangle physical tags
+    std::vector<int>  tetrahedra;   ///< Tetrahedron node indices
+    std::vector<int>  tetMarkers;   ///< Tetrahedron physical tags
+};
+
+/**
+ * @brief      Read the entity records of one dimension.
+ *
+ * @param      cursor     The cursor
+ * @param[in]  count      Number of entities
+ * @param[in]  dim        Dimension of the entities
+ * @param      physicals  Map from entity tag to first physical tag
+ */
+void readMSHEntities(MSHCursor &cursor, msh_size_t count, int dim,
+                     std::map<int, int> &physicals)
+{
+    for (msh_size_t i = 0; i < count; ++i)
+    {
+        int tag = cursor.read<int>();
+        cursor.skip(((dim == 0) ? 3 : 6)*sizeof(double));
+        msh_size_t nPhysical = cursor.read<msh_size_t>();
+        int physical = -1;
+        for (msh_size_t j = 0; j < nPhysical; ++j)
+        {
+            int p = cursor.read<int>();
+            if (j == 0)
+                physical = p;
+        }
+        physicals[tag] = physical;
+        if (dim > 0)
+        {
+            msh_size_t nBounding = cursor.read<msh_size_t>();
+            cursor.skip(nBounding*sizeof(int));
+        }
+    }
+}
+
+/**
+ * @brief      Parse a binary MSH 4.1 file
+ *
+ * @param[in]  filename  The filename
+ * @param[in]  volume    Keep only the nodes used by tetrahedra
+ *
+ * @return     The parsed data
+ */
+MSHData readMSHData(const std::string &filename, bool volume)
+{
+    MappedFile file;
+    if (!file.open(filename))
+    {
+        std::stringstream ss;
+        ss << "File '" << filename << "' could not be read.";
+        throw std::runtime_error(ss.str());
+    }
+
+    MSHData data;
+    try
+    {
+        MSHCursor cursor(file.begin(), file.end());
+        std::array<std::map<int, int>, 4> physicals;
+        // Node tags are mapped to positions in data.nodes
+        msh_size_t minTag = 0;
+        std::vector<msh_size_t> tagIndex;
+        std::vector<msh_size_t> triTags, tetTags;
+        bool foundFormat = false;
+
+        while (!cursor.atEnd())
+        {
+            std::string section = cursor.line();
+            if (section == "$MeshFormat")
+            {
+                std::stringstream header(cursor.line());
+                double version;
+                int fileType, dataSize;
+                header >> version >> fileType >> dataSize;
+                if (version < 4.1 || version >= 5)
+                    throw std::runtime_error("Only MSH version 4.1 is supported.");
+                if (fileType != 1)
+                    throw std::runtime_error("Only binary MSH files are supported.");
+                if (dataSize != sizeof(msh_size_t))
+                    throw std::runtime_error("Unsupported data size.");
+                if (cursor.read<int>() != 1)
+                    throw std::runtime_error("File endianness does not match this machine.");
+                cursor.expect("$EndMeshFormat");
+                foundFormat = true;
+            }
+            else if (!foundFormat)
+            {
+                throw std::runtime_error("Missing $MeshFormat section.");
+            }
+            else if (section == "$Entities")
+            {
+                std::array<msh_size_t, 4> counts;
+                for (auto &count : counts)
+                    count = cursor.read<msh_size_t>();
+                for (int dim = 0; dim < 4; ++dim)
+                    readMSHEntities(cursor, counts[dim], dim, physicals[dim]);
+                cursor.expect("$EndEntities");
+            }
+            else if (section == "$Nodes")
+            {
+                msh_size_t nBlocks = cursor.read<msh_size_t>();
+                msh_size_t nNodes  = cursor.read<msh_size_t>();
+                minTag = cursor.read<msh_size_t>();
+                msh_size_t maxTag = cursor.read<msh_size_t>();
+                if (nNodes > 0 && maxTag < minTag)
+                    throw std::runtime_error("Invalid node tag range.");
+                data.nodes.reserve(3*nNodes);
+                tagIndex.assign(nNodes > 0 ? maxTag - minTag + 1 : 0,
+                                std::numeric_limits<msh_size_t>::max());
+                for (msh_size_t b = 0; b < nBlocks; ++b)
+                {
+                    int dim        = cursor.read<int>();
+                    cursor.read<int>(); // entity tag
+                    int parametric = cursor.read<int>();
+                    msh_size_t n   = cursor.read<msh_size_t>();
+                    msh_size_t first = data.nodes.size()/3;
+                    for (msh_size_t i = 0; i < n; ++i)
+                    {
+                        msh_size_t tag = cursor.read<msh_size_t>();
+                        if (tag < minTag || tag - minTag >= tagIndex.size())
+                            throw std::runtime_error("Node tag out of range.");
+                        tagIndex[tag - minTag] = first + i;
+                    }
+                    const int extra = parametric ? dim : 0;
+                    for (msh_size_t i = 0; i < n; ++i)
+                    {
+                        data.nodes.push_back(cursor.read<double>());
+                        data.nodes.push_back(cursor.read<double>());
+                        data.nodes.push_back(cursor.read<double>());
+                        cursor.skip(extra*sizeof(double));
+                    }
+                }
+                cursor.expect("$EndNodes");
+            }
+            else if (section == "$Elements")
+            {
+                msh_size_t nBlocks = cursor.read<msh_size_t>();
+                msh_size_t nElements     = cursor.read<msh_size_t>();
+                msh_size_t minElementTag = cursor.read<msh_size_t>();
+                msh_size_t maxElementTag = cursor.read<msh_size_t>();
+                for (msh_size_t b = 0; b < nBlocks; ++b)
+                {
+                    int dim       = cursor.read<int>();
+                    int entityTag = cursor.read<int>();
+                    int type      = cursor.read<int>();
+                    msh_size_t n  = cursor.read<msh_size_t>();
+                    std::size_t nn = mshNodesPerElement(type);
+
+                    // Skip element types GAMER does not use, including ones
+                    // missing from the table
+                    if (nn == 0 && n > 0)
+                        nn = inferNodesPerElement(cursor, n, nElements, minElementTag,
+                                                  maxElementTag, b + 1 == nBlocks);
+                    if (type != MSH_TRIANGLE && type != MSH_TETRAHEDRON)
+                    {
+                        cursor.skip(n*(nn+1)*sizeof(msh_size_t));
+                        continue;
+                    }
+                    int marker = -1;
+                    if (dim >= 0 && dim < 4)
+                    {
+                        auto it = physicals[dim].find(entityTag);
+                        if (it != physicals[dim].end())
+                            marker = it->second;
+                    }
+                    auto &tags    = (type == MSH_TRIANGLE) ? triTags : tetTags;
+                    auto &markers = (type == MSH_TRIANGLE) ? data.triMarkers : data.tetMarkers;
+                    tags.reserve(tags.size() + n*nn);
+                    markers.reserve(markers.size() + n);
+                    for (msh_size_t i = 0; i < n; ++i)
+                    {
+                        cursor.read<msh_size_t>();  // element tag
+                        for (std::size_t j = 0; j < nn; ++j)
+                            tags.push_back(cursor.read<msh_size_t>());
+                        markers.push_back(marker);
+                    }
+                }
+                cursor.expect("$EndElements");
+            }
+            else if (!section.empty() && section[0] == '$')
+            {
+                cursor.skipSection(section.substr(1));
+            }
+            else
+            {
+                throw std::runtime_error("Unexpected content '" + section + "'.");
+            }
+        }
+
+        // Keep only nodes referenced by the elements of the mesh type and
+        // renumber them densely in ascending node tag order.
+        const std::size_t nNodes = data.nodes.size()/3;
+        std::vector<int> dense(nNodes, -1);
+        auto lookup = [&](msh_size_t tag) -> msh_size_t {
+                          if (tag < minTag || tag - minTag >= tagIndex.size()
+                              || tagIndex[tag - minTag] >= nNodes)
+                          {
+                              std::stringstream ss;
+                              ss << "Element references unknown node " << tag << ".";
+                              throw std::runtime_error(ss.str());
+                          }
+                          return tagIndex[tag - minTag];
+                      };
+        std::vector<char> used(nNodes, 0);
+        for (auto tag : (volume ? tetTags : triTags))
+            used[lookup(tag)] = 1;
+        int cnt = 0;
+        for (auto idx : tagIndex)
+        {
+            if (idx < nNodes && used[idx])
+                dense[idx] = cnt++;
+        }
+
+        std::vector<REAL> nodes(3*cnt);
+        for (std::size_t i = 0; i < nNodes; ++i)
+        {
+            if (dense[i] >= 0)
+                std::copy_n(&data.nodes[3*i], 3, &nodes[3*dense[i]]);
+        }
+        data.nodes.swap(nodes);
+
+        if (volume)
+        {
+            data.tetrahedra.reserve(tetTags.size());
+            for (auto tag : tetTags)
+                data.tetrahedra.push_back(dense[lookup(tag)]);
+        }
+        else
+        {
+            data.tetMarkers.clear();
+        }
+
+        // Drop triangles which are not part of the retained nodes
+        std::vector<int> triMarkers;
+        data.triangles.reserve(triTags.size());
+        for (std::size_t i = 0; i < data.triMarkers.size(); ++i)
+        {
+            std::array<int, 3> tri;
+            for (std::size_t j = 0; j < 3; ++j)
+                tri[j] = dense[lookup(triTags[3*i+j])];
+            if (tri[0] < 0 || tri[1] < 0 || tri[2] < 0)
+                continue;
+            data.triangles.insert(data.triangles.end(), tri.begin(), tri.end());
+            triMarkers.push_back(data.triMarkers[i]);
+        }
+        data.triMarkers.swap(triMarkers);
+    }
+    catch (const std::runtime_error &e)
+    {
+        std::stringstream ss;
+        ss << "readMSH: In file '" << filename << "': " << e.what();
+        throw std::runtime_error(ss.str());
+    }
+    return data;
+}
+} // end anonymous namespace
+/// @endcond
+
+void writeMSH(const std::string &filename, const TetMesh &mesh)
+{
+    if ((*mesh.get_simplex_up()).higher_order == true)
+    {
+        throw std::runtime_error("MSH output does not support higher order meshes.");
+    }
+
+    auto volumes  = groupByMarker<4>(mesh, false);
+    auto surfaces = groupByMarker<3>(mesh, true);
+    checkMSHNodeEntity(mesh, surfaces, volumes);
+
+    std::ofstream fout(filename, std::ios::out | std::ios::binary);
+    if (!fout.is_open())
+    {
+        std::stringstream ss;
+        ss << "File '" << filename
+           << "' could not be written to.";
+        throw std::runtime_error(ss.str());
+    }
+
+    DenseIndex<TetMesh> nodeTags(mesh, 1);
+
+    BufferedWriter out(fout);
+    writeMSHHeaderAndNodes(out, mesh, surfaces, volumes);
+
+    const msh_size_t nElements = mesh.size<4>() + [&surfaces]{
+                                     msh_size_t n = 0;
+                                     for (const auto &s : surfaces)
+                                         n += s.ids.size();
+                                     return n;
+                                 }();
+    out.write("$Elements\n");
+    out.push(static_cast<msh_size_t>(volumes.size() + surfaces.size()));
+    out.push(nElements);
+    out.push(static_cast<msh_size_t>(nElements > 0 ? 1 : 0));
+    out.push(nElements);
+
+    msh_size_t tag = 1;
+    bool orientationError = false;
+    writeMSHElementBlocks(out, 3, MSH_TETRAHEDRON, volumes, nodeTags, tag,
+                          [&orientationError](TetMesh::SimplexID<4> cellID){
+                              auto w = cellID.indices();
+                              auto orientation = (*cellID).orientation;
+                              if (orientation == -1)
+                                  std::swap(w[0], w[3]);
+                              else if (orientation != 1)
+                                  orientationError = true;
+                              return w;
+                          });
+    writeMSHElementBlocks(out, 2, MSH_TRIANGLE, surfaces, nodeTags, tag,
+                          [](TetMesh::SimplexID<3> faceID){
+                              return faceID.indices();
+                          });
+    out.write("\n$EndElements\n");
+    out.flush();
+
+    if (orientationError)
+    {
+        std::cerr << "WARNING(writeMSH): The orientation of one or more cells "
+                  << "is not defined. Did you run compute_orientation()?"
+                  << std::endl;
+    }
+}
+
+void writeMSH(const std::string &filename, const SurfaceMesh &mesh)
+{
+    auto surfaces = groupByMarker<3>(mesh, false);
+    decltype(surfaces) volumes;     // Surface meshes have no volumes
+    checkMSHNodeEntity(mesh, surfaces, volumes);
+
+    std::ofstream fout(filename, std::ios::out | std::ios::binary);
+    if (!fout.is_open())
+    {
+        std::stringstream ss;
+        ss << "File '" << filename
+           << "' could not be written to.";
+        throw std::runtime_error(ss.str());
+    }
+
+    DenseIndex<SurfaceMesh> nodeTags(mesh, 1);
+
+    BufferedWriter out(fout);
+    writeMSHHeaderAndNodes(out, mesh, surfaces, volumes);
+
+    const msh_size_t nElements = mesh.size<3>();
+    out.write("$Elements\n");
+    out.push(static_cast<msh_size_t>(surfaces.size()));
+    out.push(nElements);
+    out.push(static_cast<msh_size_t>(nElements > 0 ? 1 : 0));
+    out.push(nElements);
+
+    msh_size_t tag = 1;
+    bool orientationError = false;
+    writeMSHElementBlocks(out, 2, MSH_TRIANGLE, surfaces, nodeTags, tag,
+                          [&orientationError](SurfaceMesh::SimplexID<3> faceID){
+                              auto w = faceID.indices();
+                              auto orientation = (*faceID).orientation;
+                              if (orientation == -1)
+                                  std::swap(w[0], w[2]);
+                              else if (orientation != 1)
+                                  orientationError = true;
+                              return w;
+                          });
+    out.write("\n$EndElements\n");
+    out.flush();
+
+    if (orientationError)
+    {
+        std::cerr << "WARNING(writeMSH): The orientation of one or more faces "
+                  << "is not defined. Did you run compute_orientation()?"
+                  << std::endl;
+    }
+}
+
+std::unique_ptr<TetMesh> readMSH_TetMesh(const std::string &filename)
+{
+    MSHData data = readMSHData(filename, true);
+    return tetMeshFromArrays(data.nodes.size()/3, data.nodes.data(), nullptr,
+                             data.tetMarkers.size(), data.tetrahedra.data(),
+                             data.tetMarkers.data(),
+                             data.triMarkers.size(), data.triangles.data(),
+                             data.triMarkers.data());
+}
+
+std::unique_ptr<SurfaceMesh> readMSH_SurfaceMesh(const std::string &filename)
+{
+    MSHData data = readMSHData(filename, false);
+    return surfaceMeshFromArrays(data.nodes.size()/3, data.nodes.data(), nullptr,
+                                 data.triMarkers.size(), data.triangles.data(),
+                                 data.triMarkers.data());
+}
+} // end namespace gamer
@@ -0,0 +1,141 @@
+/*
+ * ***************************************************************************
+ * This file is part of the GAMer software.
+ * Copyright (C) 2016-2018
+ * by Christopher Lee, John Moody, Rommie Amaro, J. Andrew McCammon,
+ *    and Michael Holst
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * ***************************************************************************
+ */
+
+#include "gamer/MappedFile.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/// Namespace for all things gamer
+namespace gamer
+{
+#ifdef _WIN32
+bool MappedFile::open(const std::string &filename)
+{
+    close();
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                              nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER fsize;
+    if (!GetFileSizeEx(file, &fsize))
+    {
+        CloseHandle(file);
+        return false;
+    }
+    _file = file;
+    _size = static_cast<std::size_t>(fsize.QuadPart);
+    _open = true;
+
+    // Zero length files cannot be mapped
+    if (_size == 0)
+        return true;
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr)
+    {
+        close();
+        return false;
+    }
+    _mapping = mapping;
+
+    _data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (_data == nullptr)
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (_data)
+        UnmapViewOfFile(_data);
+    if (_mapping)
+        CloseHandle(static_cast<HANDLE>(_mapping));
+    if (_file)
+        CloseHandle(static_cast<HANDLE>(_file));
+    _data    = nullptr;
+    _mapping = nullptr;
+    _file    = nullptr;
+    _size    = 0;
+    _open    = false;
+}
+#else
+bool MappedFile::open(const std::string &filename)
+{
+    close();
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat sb;
+    if (fstat(fd, &sb) != 0)
+    {
+        ::close(fd);
+        return false;
+    }
+    _size = static_cast<std::size_t>(sb.st_size);
+
+    // Zero length files cannot be mapped
+    if (_size > 0)
+    {
+        void *ptr = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (ptr == MAP_FAILED)
+        {
+            ::close(fd);
+            _size = 0;
+            return false;
+        }
+        // Files are parsed front to back
+        madvise(ptr, _size, MADV_SEQUENTIAL);
+        _data = static_cast<const char*>(ptr);
+    }
+    // The mapping remains valid after the descriptor is closed
+    ::close(fd);
+    _open = true;
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (_data)
+        munmap(const_cast<char*>(_data), _size);
+    _data = nullptr;
+    _size = 0;
+    _open = false;
+}
+#endif
+} // end namespace gamer
@@ -24,101 +24,206 @@
 
 
 
+#include <algorithm>
+#include <cctype>
 #include <cmath>
+#include <cstring>
 #include <fstream>
 #include <memory>
 #include <ostream>
+#include <sstream>
+#include <stdexcept>
 #include <string>
 #include <iostream>
 #include <vector>
 
+#include "gamer/BufferedWriter.h"
+#include "gamer/DenseIndex.h"
+#include "gamer/MappedFile.h"
 #include "gamer/stringutil.h"
 #include "gamer/SurfaceMesh.h"
 
 /// Namespace for all things gamer
 namespace gamer
 {
-//https://en.wikipedia.org/wiki/Wavefront_.obj_file
-//http://paulbourke.net/dataformats/obj/
-std::unique_ptr<SurfaceMesh> readOBJ(const std::string &filename)
+/// @cond detail
+namespace
 {
-    // Instantiate mesh!
-    std::unique_ptr<SurfaceMesh> mesh(new SurfaceMesh);
-
-    std::ifstream                fin(filename);
-    if (!fin.is_open())
-    {
-        std::cerr << "Read Error: File '" << filename << "' could not be read." << std::endl;
-        return mesh;
-    }
+/// Approximate number of bytes parsed per task
+constexpr std::size_t OBJChunkSize = 1 << 22;
 
-    int                      i = 0; // index of vertices
-    std::string              line;
-    std::vector<std::string> arr;
+/**
+ * @brief      Vertices and faces parsed from a contiguous range of lines
+ */
+struct OBJChunk
+{
+    std::vector<REAL>        vertices;
+    /// Zero based vertex indices, relative ones still lack the chunk offset
+    std::vector<long>        faces;
+    /// Positions in faces which hold indices relative to this chunk
+    std::vector<std::size_t> relative;
+    std::string              error;
+};
 
-    // while the file isn't empty
-    while (fin.peek() != -1)
+/**
+ * @brief      Parse the vertex and face lines of a chunk
+ *
+ * @param[in]  p      Start of the chunk
+ * @param[in]  end    End of the chunk
+ * @param      chunk  The chunk
+ */
+void parseOBJChunk(const char *p, const char *end, OBJChunk &chunk)
+{
+    while (p != end)
     {
-        getline(fin, line);
-        stringutil::trim(line);
+        const char *line = stringutil::skipBlank(p, end);
+        const char *eol  = static_cast<const char *>(std::memchr(line, '\n', end - line));
+        p   = (eol) ? eol + 1 : end;
+        eol = (eol) ? eol : end;
 
-        if (line.empty())
-            continue;       // skip empty lines
-        if (line[0] == '#')
-            continue;       // skip comments
+        // Everything but geometric vertices and faces is ignored. This also
+        // skips normals "vn", textures "vt", and comments.
+        if (eol - line < 2 || !(line[1] == ' ' || line[1] == '\t'))
+            continue;
 
-        if (line[0] == 'v') // Vertex
+        if (line[0] == 'v')
         {
-            // if not space see what kind of data it is
-            if (!std::isspace(line[1]))
+            // List of geometric vertices, with (x,y,z[,w]) coordinates, w
+            // is optional and defaults to 1.0. Ignore possible w for now...
+            const char *q = line + 1;
+            for (int i = 0; i < 3; ++i)
             {
-                // ignore normals "vn" and textures "vt"
-                // also ignore potentially diabolical filenames
-                continue;
+                double value;
+                if (!stringutil::parseReal(q, eol, value))
+                {
+                    chunk.error = "Parse Error: Couldn't interpret vertex: '"
+                                  + std::string(line, eol) + "'.";
+                    return;
+                }
+                chunk.vertices.push_back(value);
             }
-            else
+        }
+        else if (line[0] == 'f')
+        {
+            // Faces can be a pain also arbitrary dimension
+            // f v1 v2 v3 ....
+            // f v1/vt1 v2/vt2 v3/vt3 ...
+            // f v1/vt1/vn1 v2/vt2/vn2 v3/vt3/vn3 ...
+            // f v1//vn1 v2//vn2 v3//vn3 ...
+            const char *q = line + 1;
+            std::size_t n = 0;
+            while (true)
+            {
+                q = stringutil::skipBlank(q, eol);
+                if (q == eol || *q == '#')
+                    break;
+
+                long index;
+                if (!stringutil::parseInt(q, eol, index) || index == 0)
+                {
+                    chunk.error = "Parse Error: Couldn't interpret face: '"
+                                  + std::string(line, eol) + "'.";
+                    return;
+                }
+                // again we're going to ignore textures and normals
+                while (q != eol && !std::isspace(static_cast<unsigned char>(*q)))
+                    ++q;
+
+                if (++n > 3)
+                    break;
+                if (index > 0)
+                    chunk.faces.push_back(index - 1);
+                else
+                {
+                    // Negative indices count back from the latest vertex
+                    chunk.relative.push_back(chunk.faces.size());
+                    chunk.faces.push_back(static_cast<long>(chunk.vertices.size()/3) + index);
+                }
+            }
+            if (n != 3)
             {
-                // List of geometric vertices, with (x,y,z[,w]) coordinates, w
-                // is optional and defaults to 1.0.
-                arr = stringutil::split(line, {' '});
-                SMVertex v = SMVertex(
-                    std::stod(arr[1]),
-                    std::stod(arr[2]),
-                    std::stod(arr[3])
-                    );
-                // ignore possible w for now...
-                mesh->insert<1>({++i}, v);
+                chunk.error = "Unsupported: Found face that is not a triangle!";
+                return;
             }
         }
+    }
+}
+} // end anonymous namespace
+/// @endcond
 
-        // Faces can be a pain also arbitrary dimension
-        // f v1 v2 v3 ....
-        // f v1/vt1 v2/vt2 v3/vt3 ...
-        // f v1/vt1/vn1 v2/vt2/vn2 v3/vt3/vn3 ...
-        // f v1//vn1 v2//vn2 v3//vn3 ...
-        if (line[0] == 'f')
+//https://en.wikipedia.org/wiki/Wavefront_.obj_file
+//http://paulbourke.net/dataformats/obj/
+std::unique_ptr<SurfaceMesh> readOBJ(const std::string &filename)
+{
+    MappedFile file(filename);
+    if (!file.is_open())
+    {
+        std::stringstream ss;
+        ss << "File '" << filename << "' could not be read.";
+        throw std::runtime_error(ss.str());
+    }
+
+    try
+    {
+        // Lines are independent so chunks of the file are parsed concurrently
+        auto bounds = stringutil::lineChunks(file.begin(), file.end(), OBJChunkSize);
+        const long nChunks = static_cast<long>(bounds.size()) - 1;
+        std::vector<OBJChunk> chunks(nChunks);
+
+        #pragma omp parallel for schedule(dynamic)
+        for (long i = 0; i < nChunks; ++i)
+            parseOBJChunk(bounds[i], bounds[i+1], chunks[i]);
+
+        std::vector<std::size_t> vertexOffset(nChunks + 1, 0);
+        std::vector<std::size_t> faceOffset(nChunks + 1, 0);
+        for (long i = 0; i < nChunks; ++i)
         {
-            arr = stringutil::split(line, {' '});
-            if (arr.size() != 4)
-            {
-                std::cerr << "Unsupported: Found face that is not a triangle!" << std::endl;
-                mesh.reset();
-                return mesh;
-            }
-            // again we're going to ignore textures and normals
-            for (auto it = arr.begin(); it != arr.end(); ++it)
+            if (!chunks[i].error.empty())
+                throw std::runtime_error(chunks[i].error);
+            vertexOffset[i+1] = vertexOffset[i] + chunks[i].vertices.size()/3;
+            faceOffset[i+1]   = faceOffset[i] + chunks[i].faces.size();
+        }
+        const std::size_t nVertices = vertexOffset[nChunks];
+
+        std::vector<REAL> vertices(3*nVertices);
+        std::vector<int>  faces(faceOffset[nChunks]);
+        bool outOfRange = false;
+
+        #pragma omp parallel for schedule(dynamic) reduction(||:outOfRange)
+        for (long i = 0; i < nChunks; ++i)
+        {
+            OBJChunk &chunk = chunks[i];
+            for (std::size_t pos : chunk.relative)
+                chunk.faces[pos] += vertexOffset[i];
+
+            std::copy(chunk.vertices.begin(), chunk.vertices.end(),
+                      vertices.begin() + 3*vertexOffset[i]);
+            for (std::size_t j = 0; j < chunk.faces.size(); ++j)
             {
-                *it = stringutil::split(*it, {'/'})[0];
+                long index = chunk.faces[j];
+                if (index < 0 || static_cast<std::size_t>(index) >= nVertices)
+                    outOfRange = true;
+                faces[faceOffset[i] + j] = static_cast<int>(index);
             }
-            mesh->insert<3>({
-                    std::stoi(arr[1]),
-                    std::stoi(arr[2]),
-                    std::stoi(arr[3])});
+            std::vector<REAL>().swap(chunk.vertices);
+            std::vector<long>().swap(chunk.faces);
         }
 
-        // everything else is ignored for now also
+        if (outOfRange)
+            throw std::runtime_error("Parse Error: A face references a vertex which does not exist.");
+
+        // Vertices are keyed by their one based OBJ index
+        return surfaceMeshFromArrays(nVertices, vertices.data(), nullptr,
+                                     faces.size()/3, faces.data(),
+                                     std::vector<int>(faces.size()/3, -1).data(),
+                                     1);
+    }
+    catch (const std::runtime_error &e)
+    {
+        std::stringstream ss;
+        ss << "readOBJ: In file '" << filename << "': " << e.what();
+        throw std::runtime_error(ss.str());
     }
-    return mesh;
 }
 
 void writeOBJ(const std::string &filename, const SurfaceMesh &mesh)
@@ -131,22 +236,18 @@ void writeOBJ(const std::string &filename, const SurfaceMesh &mesh)
         exit(1);
     }
 
-    std::map<typename SurfaceMesh::KeyType, typename SurfaceMesh::KeyType> sigma;
-    typename SurfaceMesh::KeyType cnt = 1;
-    for (const auto &x : mesh.get_level_id<1>())
-    {
-        sigma[mesh.get_name(x)[0]] = cnt++;
-    }
+    DenseIndex<SurfaceMesh> sigma(mesh, 1);
+    BufferedWriter out(fout);
 
-    fout.precision(10);
+    out.precision(10);
     // Get the vertex data directly
     for (const auto &vertex : mesh.get_level<1>())
     {
-        fout << "v "
-             << vertex[0] << " "
-             << vertex[1] << " "
-             << vertex[2] << " "
-             << "\n";
+        out << "v "
+            << vertex[0] << " "
+            << vertex[1] << " "
+            << vertex[2] << " "
+            << "\n";
     }
 
     // Get the face nodes
@@ -157,19 +258,20 @@ void writeOBJ(const std::string &filename, const SurfaceMesh &mesh)
         auto orientation = (*faceNodeID).orientation;
         if (orientation == 1)
         {
-            fout << "f " << sigma[w[2]] << " " << sigma[w[1]] << " " << sigma[w[0]] << "\n";
+            out << "f " << sigma[w[0]] << " " << sigma[w[1]] << " " << sigma[w[2]] << "\n";
         }
         else if (orientation == -1)
         {
-            fout << "f " << sigma[w[0]] << " " << sigma[w[1]] << " " << sigma[w[2]] << "\n";
+            out << "f " << sigma[w[2]] << " " << sigma[w[1]] << " " << sigma[w[0]] << "\n";
 
         }
         else
         {
             std::cerr << "Warning: Orientation undefined..." << std::endl;
-            fout << "f " << sigma[w[0]] << " " << sigma[w[1]] << " " << sigma[w[2]] << "\n";
+            out << "f " << sigma[w[0]] << " " << sigma[w[1]] << " " << sigma[w[2]] << "\n";
         }
     }
+    out.flush();
     fout.close();
 
 }
@@ -23,13 +23,21 @@
  */
 
 
+#include "gamer/BufferedWriter.h"
+#include "gamer/DenseIndex.h"
+#include "gamer/MappedFile.h"
+#include "gamer/stringutil.h"
 #include "gamer/SurfaceMesh.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
 #include <string>
 #include <iostream>
 #include <fstream>
 #include <memory>
 #include <ostream>
-#include <regex>
+#include <sstream>
+#include <stdexcept>
 #include <cmath>
 #include <vector>
 
@@ -55,200 +63,266 @@ int get_marker(float r, float g, float b)
     return static_cast<int>(round(r * 10) * 121 + round(g * 10) * 11 + round(b * 10));
 }
 
-//http://www.geomview.org/docs/html/OFF.html
-std::unique_ptr<SurfaceMesh> readOFF(const std::string &filename)
+/// @cond detail
+namespace
 {
-    // Instantiate mesh!
-    //auto mesh = new SurfaceMesh();
-    std::unique_ptr<SurfaceMesh> mesh(new SurfaceMesh);
+/// Approximate number of bytes parsed per task
+constexpr std::size_t OFFChunkSize = 1 << 22;
 
-    std::ifstream                fin(filename);
-    if (!fin.is_open())
-    {
-        std::cerr << "Read Error: File '" << filename << "' could not be read." << std::endl;
-        mesh.reset();
-        return mesh;
-    }
+/**
+ * @brief      Numeric rows parsed from a contiguous range of lines
+ */
+struct OFFRows
+{
+    std::vector<double>      values;
+    /// End of each row in values
+    std::vector<std::size_t> ends;
+    std::string              error;
+};
 
-    std::string line;
-    // Parse the first line:
-    // [ST][C][N][4][n]OFF  # Header keyword
-    // we only read OFF's in 3 space... simplicial_complex only does triangles
-    getline(fin, line);
-    // Assume the first line must end with 'OFF\n'
-    if (!(line.find("OFF", line.size()-4) == std::string::npos))
+/**
+ * @brief      Parse every non empty line of a chunk into a row of numbers
+ *
+ * Comments starting with '#' run to the end of the line.
+ *
+ * @param[in]  p     Start of the chunk
+ * @param[in]  end   End of the chunk
+ * @param      rows  The rows
+ */
+void parseOFFChunk(const char *p, const char *end, OFFRows &rows)
+{
+    while (p != end)
     {
-        std::cerr << "File Format Error: File '" << filename << "' does not look like a valid OFF file." << std::endl;
-        std::cerr << "Expected 'OFF' at end of line, found: '" << line << "'." << std::endl;
-        mesh.reset();
-        return mesh;
-    }
+        const char *line = p;
+        const char *eol  = static_cast<const char *>(std::memchr(line, '\n', end - line));
+        p   = (eol) ? eol + 1 : end;
+        eol = (eol) ? eol : end;
 
-    // Have the support for reading in various things. Currently we are ignoring
-    // them though...
-    bool textureCoords = false;
-    if (!(line.find("ST") == std::string::npos))
-    {
-        std::cout << "Found vertex texture coordinates flag." << std::endl;
-        textureCoords = true;
-    }
-    bool vertexColors = false;
-    if (!(line.find("C") == std::string::npos))
-    {
-        std::cout << "Found vertex colors flag." << std::endl;
-        vertexColors = true;
-    }
-    bool vertexNormals = false;
-    if (!(line.find("N") == std::string::npos))
-    {
-        std::cout << "Found vertex normals flag." << std::endl;
-        vertexNormals = true;
-    }
-    int dimension = 3;
-    if (!(line.find("4") == std::string::npos))
-    {
-        std::cout << "Found dimension flag." << std::endl;
-        dimension = 4;
-    }
+        const char *comment = static_cast<const char *>(std::memchr(line, '#', eol - line));
+        if (comment)
+            eol = comment;
 
-    if (!(line.find("n") == std::string::npos))
-    {
-        getline(fin, line);  // Assume no comments here yet...
-        int tempDim = std::stoi(line);
-        if (dimension == 4)
-            dimension = tempDim + 1;
-        else
-            dimension = tempDim;
-    }
+        const char *q = line;
+        bool empty = true;
+        while (true)
+        {
+            q = stringutil::skipBlank(q, eol);
+            if (q == eol)
+                break;
 
-    // Lambda function to split the string
-    auto split = [](const std::string &cstr, std::vector<char> delim = {' ', '\t'}) -> std::vector<std::string> {
-            std::string str = cstr;
-            for (auto i = 1; i < delim.size(); i++)
+            // Most values are indices so try the cheaper integer parse first
+            const char *r = q;
+            long   integer;
+            double value;
+            if (stringutil::parseInt(r, eol, integer)
+                && (r == eol || std::isspace(static_cast<unsigned char>(*r))))
             {
-                std::replace(str.begin(), str.end(), delim[i], delim[0]);
+                value = static_cast<double>(integer);
+                q = r;
             }
-            std::vector<std::string> result;
-            auto                     begin = str.begin();
-            do
+            else if (!stringutil::parseReal(q, eol, value))
             {
-                auto end = begin;
-                while (*end != delim[0] && end != str.end())
-                    end++;
-                if (end != begin)
-                    result.push_back(std::string(begin, end));
-                begin = end;
+                rows.error = "Parse Error: Couldn't interpret line: '"
+                             + std::string(line, eol) + "'.";
+                return;
             }
-            while (begin++ != str.end());
-            return result;
-        };
+            rows.values.push_back(value);
+            empty = false;
+        }
+        if (!empty)
+            rows.ends.push_back(rows.values.size());
+    }
+}
+} // end anonymous namespace
+/// @endcond
+
+//http://www.geomview.org/docs/html/OFF.html
+std::unique_ptr<SurfaceMesh> readOFF(const std::string &filename)
+{
+    MappedFile file(filename);
+    if (!file.is_open())
+    {
+        std::stringstream ss;
+        ss << "File '" << filename << "' could not be read.";
+        throw std::runtime_error(ss.str());
+    }
 
-    std::vector<std::string> arr;
-    // Allow some comments denoted by #...
-    while (getline(fin, line))
+    try
     {
-        if (line.find("#") == 0)
+        const char *p   = file.begin();
+        const char *end = file.end();
+
+        // Grab the next line without the trailing newline
+        auto nextLine = [&p, end]() -> std::string {
+                const char *line = p;
+                p = stringutil::skipLine(p, end);
+                std::string result(line, p);
+                stringutil::trim(result);
+                return result;
+            };
+
+        // Parse the first line:
+        // [ST][C][N][4][n]OFF  # Header keyword
+        // we only read OFF's in 3 space... simplicial_complex only does triangles
+        std::string line = nextLine();
+        // Assume the first line must end with 'OFF\n'
+        if (line.size() < 3 || line.compare(line.size()-3, 3, "OFF") != 0)
         {
-            continue;
+            throw std::runtime_error("File Format Error: Expected 'OFF' at end of line, found: '"
+                                     + line + "'.");
         }
-        arr = split(line, {'#'});
-        if (arr[0].length() != 0) // Assume that comments are over
-            break;
-    }
 
-    // Parse the second line:
-    // NVertices  NFaces  NEdges
-    arr = split(arr[0]);
-    int numVertices = std::stoi(arr[0]);
-    //std::cout << "#Vertices: " << numVertices << std::endl;
-
-    int numFaces = std::stoi(arr[1]);
-    //std::cout << "#Faces: " << numFaces << std::endl;
-
-    // numEdges is ignored
-    //int numEdges = std::stoi(arr[2]);
-    //std::cout << "#Edges: " << numEdges << std::endl;
-
-    // NOTE:: Assume there are no more comments...
-
-    // Parse the vertices
-    /*
-       x[0]  y[0]  z[0]
-     # Vertices, possibly with normals,
-     # colors, and/or texture coordinates, in that order,
-     # if the prefixes N, C, ST
-     # are present.
-     # If 4OFF, each vertex has 4 components,
-     # including a final homogeneous component.
-     # If nOFF, each vertex has Ndim components.
-     # If 4nOFF, each vertex has Ndim+1 components.
-     */
-    for (int i = 0; i < numVertices; i++)
-    {
-        getline(fin, line);
-        //std::cout << line << std::endl;
-        arr = split(line);
-        if (arr.size() < dimension)
+        // Have the support for reading in various things. Currently we are ignoring
+        // them though...
+        if (!(line.find("ST") == std::string::npos))
+            std::cout << "Found vertex texture coordinates flag." << std::endl;
+        if (!(line.find("C") == std::string::npos))
+            std::cout << "Found vertex colors flag." << std::endl;
+        if (!(line.find("N") == std::string::npos))
+            std::cout << "Found vertex normals flag." << std::endl;
+        int dimension = 3;
+        if (!(line.find("4") == std::string::npos))
         {
-            std::cerr << "Parse Error: Vertex line has fewer dimensions than expected (" << dimension << ")" << std::endl;
-            mesh.reset();
-            return mesh;
+            std::cout << "Found dimension flag." << std::endl;
+            dimension = 4;
         }
-        double x = std::stod(arr[0]);
-        double y = std::stod(arr[1]);
-        double z = std::stod(arr[2]);
-        mesh->insert<1>({i}, SMVertex(x, y, z));
-    }
 
-    // Parse Faces
-    /*
-     # Faces
-     # Nv = # vertices on this face
-     # v[0] ... v[Nv-1]: vertex indices
-     #       in range 0..NVertices-1
-
-        TODO: This should parse the number of vertices in each face (10)
-        TODO: (10) Get orientation from the OFF file
-     */
-    for (int i = 0; i < numFaces; i++)
-    {
-        getline(fin, line);
-        arr = split(line);
-        if (std::stoi(arr[0]) != 3 && arr.size() < dimension+1)
+        if (!(line.find("n") == std::string::npos))
         {
-            std::cerr << "Unsupported: Found face that is not a triangle!" << std::endl;
-            mesh.reset();
-            return mesh;
+            line = nextLine();  // Assume no comments here yet...
+            int tempDim = std::stoi(line);
+            if (dimension == 4)
+                dimension = tempDim + 1;
+            else
+                dimension = tempDim;
         }
-        else if (arr.size() == dimension+1)
+
+        // Allow some comments denoted by #...
+        do
         {
-            auto v0 = std::stoi(arr[1]);
-            auto v1 = std::stoi(arr[2]);
-            auto v2 = std::stoi(arr[3]);
-            mesh->insert<3>({v0, v1, v2});
+            line = nextLine();
+            line = line.substr(0, line.find('#'));
         }
-        else if (arr.size() == dimension+5)
+        while (line.empty() && p != end);
+
+        // Parse the second line:
+        // NVertices  NFaces  NEdges
+        // numEdges is ignored
+        long numVertices, numFaces;
+        const char *counts = line.c_str();
+        const char *countsEnd = counts + line.size();
+        if (!stringutil::parseInt(counts, countsEnd, numVertices)
+            || !stringutil::parseInt(counts, countsEnd, numFaces)
+            || numVertices < 0 || numFaces < 0)
         {
-            auto v0 = std::stoi(arr[1]);
-            auto v1 = std::stoi(arr[2]);
-            auto v2 = std::stoi(arr[3]);
-            // parse for marker/color data
-            auto r = std::stod(arr[4]);
-            auto g = std::stod(arr[5]);
-            auto b = std::stod(arr[6]);
-            //auto k = std::stod(arr[7]);
-            mesh->insert<3>({v0, v1, v2}, SMFace(get_marker(r, g, b), false));
+            throw std::runtime_error("File Format Error: Couldn't interpret counts: '" + line + "'.");
         }
-        else
+
+        // Parse the remaining rows concurrently
+        auto bounds = stringutil::lineChunks(p, end, OFFChunkSize);
+        const long nChunks = static_cast<long>(bounds.size()) - 1;
+        std::vector<OFFRows> chunks(nChunks);
+
+        #pragma omp parallel for schedule(dynamic)
+        for (long i = 0; i < nChunks; ++i)
+            parseOFFChunk(bounds[i], bounds[i+1], chunks[i]);
+
+        std::vector<REAL> vertices;
+        std::vector<int>  faces, markers;
+        vertices.reserve(3*numVertices);
+        faces.reserve(3*numFaces);
+        markers.reserve(numFaces);
+
+        for (const auto &rows : chunks)
         {
-            std::cerr << "Parse Error: Couldn't interpret face: '" << line << "'." << std::endl;
-            mesh.reset();
-            return mesh;
+            if (!rows.error.empty())
+            {
+                throw std::runtime_error(rows.error);
+            }
+
+            std::size_t begin = 0;
+            for (std::size_t rowEnd : rows.ends)
+            {
+                const double *row = &rows.values[begin];
+                std::size_t   n   = rowEnd - begin;
+                begin = rowEnd;
+
+                /*
+                   x[0]  y[0]  z[0]
+                 # Vertices, possibly with normals,
+                 # colors, and/or texture coordinates, in that order,
+                 # if the prefixes N, C, ST
+                 # are present.
+                 # If 4OFF, each vertex has 4 components,
+                 # including a final homogeneous component.
+                 # If nOFF, each vertex has Ndim components.
+                 # If 4nOFF, each vertex has Ndim+1 components.
+                 */
+                if (vertices.size() < 3*static_cast<std::size_t>(numVertices))
+                {
+                    if (n < static_cast<std::size_t>(std::max(dimension, 3)))
+                    {
+                        std::stringstream ss;
+                        ss << "Parse Error: Vertex line has fewer dimensions than expected (" << dimension << ")";
+                        throw std::runtime_error(ss.str());
+                    }
+                    vertices.insert(vertices.end(), row, row + 3);
+                }
+                /*
+                 # Faces
+                 # Nv = # vertices on this face
+                 # v[0] ... v[Nv-1]: vertex indices
+                 #       in range 0..NVertices-1
+                 # optionally followed by a color
+                 */
+                else if (markers.size() < static_cast<std::size_t>(numFaces))
+                {
+                    if (row[0] != 3)
+                    {
+                        throw std::runtime_error("Unsupported: Found face that is not a triangle!");
+                    }
+                    if (n != 4 && n != 7 && n != 8)
+                    {
+                        std::stringstream ss;
+                        ss << "Parse Error: Couldn't interpret face " << markers.size() << ".";
+                        throw std::runtime_error(ss.str());
+                    }
+                    for (std::size_t j = 1; j < 4; ++j)
+                    {
+                        if (row[j] < 0 || row[j] >= numVertices)
+                        {
+                            std::stringstream ss;
+                            ss << "Parse Error: Face " << markers.size()
+                               << " references a vertex which does not exist.";
+                            throw std::runtime_error(ss.str());
+                        }
+                        faces.push_back(static_cast<int>(row[j]));
+                    }
+                    // parse for marker/color data
+                    markers.push_back((n == 4) ? -1 : get_marker(row[4], row[5], row[6]));
+                }
+            }
         }
+
+        if (markers.size() != static_cast<std::size_t>(numFaces))
+        {
+            std::stringstream ss;
+            ss << "Parse Error: File ended after " << vertices.size()/3
+               << " vertices and " << markers.size() << " faces.";
+            throw std::runtime_error(ss.str());
+        }
+
+        // Keeps the windings of the file, falling back to
+        // compute_orientation() if they are inconsistent
+        return surfaceMeshFromArrays(numVertices, vertices.data(), nullptr,
+                                     numFaces, faces.data(), markers.data());
+    }
+    catch (const std::runtime_error &e)
+    {
+        std::stringstream ss;
+        ss << "readOFF: In file '" << filename << "': " << e.what();
+        throw std::runtime_error(ss.str());
     }
-    fin.close();
-    compute_orientation(*mesh);
-    return mesh;
 }
 
 void writeOFF(const std::string &filename, const SurfaceMesh &mesh)
@@ -261,29 +335,26 @@ void writeOFF(const std::string &filename, const SurfaceMesh &mesh)
         exit(1);
     }
 
-    fout << "OFF" << std::endl;
+    BufferedWriter out(fout);
+    out << "OFF\n";
 
     std::size_t numVertices = mesh.size<1>();
     std::size_t numFaces = mesh.size<3>();
     std::size_t numEdges = mesh.size<2>();
-    fout << numVertices << " "
-         << numFaces << " "
-         << numEdges << "\n";
+    out << numVertices << " "
+        << numFaces << " "
+        << numEdges << "\n";
 
-    std::map<typename SurfaceMesh::KeyType, typename SurfaceMesh::KeyType> sigma;
-    typename SurfaceMesh::KeyType cnt = 0;
+    DenseIndex<SurfaceMesh> sigma(mesh);
 
-    fout.precision(10);
+    out.precision(10);
     // Get the vertex data directly
-    for (const auto vertexID : mesh.get_level_id<1>())
+    for (const auto &vertex : mesh.get_level<1>())
     {
-        sigma[mesh.get_name(vertexID)[0]] = cnt++;
-        auto vertex = *vertexID;
-
-        fout << vertex[0] << " "
-             << vertex[1] << " "
-             << vertex[2] << " "
-             << "\n";
+        out << vertex[0] << " "
+            << vertex[1] << " "
+            << vertex[2] << " "
+            << "\n";
     }
 
     bool orientationError = false;
@@ -296,19 +367,20 @@ void writeOFF(const std::string &filename, const SurfaceMesh &mesh)
         auto orientation = (*faceNodeID).orientation;
         if (orientation == 1)
         {
-            fout << "3 " << sigma[w[0]] << " " << sigma[w[1]] << " " << sigma[w[2]] << "\n";
+            out << "3 " << sigma[w[0]] << " " << sigma[w[1]] << " " << sigma[w[2]] << "\n";
         }
         else if (orientation == -1)
         {
-            fout << "3 " << sigma[w[2]] << " " << sigma[w[1]] << " " << sigma[w[0]] << "\n";
+            out << "3 " << sigma[w[2]] << " " << sigma[w[1]] << " " << sigma[w[0]] << "\n";
 
         }
         else
         {
             orientationError = true;
-            fout << "3 " << sigma[w[0]] << " " << sigma[w[1]] << " " << sigma[w[2]] << "\n";
+            out << "3 " << sigma[w[0]] << " " << sigma[w[1]] << " " << sigma[w[2]] << "\n";
         }
     }
+    out.flush();
     if (orientationError)
     {
         std::cerr << "WARNING(writeOFF): The orientation of one or more faces "
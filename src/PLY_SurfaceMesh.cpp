@@ -0,0 +1,484 @@
+/*
+ * ***************************************************************************
+ * This file is part of the GAMer software.
+ * Copyright (C) 2016-2018
+ * by Christopher Lee, John Moody, Rommie Amaro, J. Andrew McCammon,
+ *    and Michael Holst
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * ***************************************************************************
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <casc/casc>
+
+#include "gamer/BufferedWriter.h"
+#include "gamer/DenseIndex.h"
+#include "gamer/MappedFile.h"
+#include "gamer/SurfaceMesh.h"
+
+/// Namespace for all things gamer
+namespace gamer
+{
+/// @cond detail
+namespace
+{
+/**
+ * @brief      Determines if this machine stores numbers big endian.
+ */
+bool hostIsBigEndian()
+{
+    const std::uint16_t probe = 1;
+    unsigned char first;
+    std::memcpy(&first, &probe, 1);
+    return first == 0;
+}
+
+/// Scalar types of PLY properties
+enum class PLYType
+{
+    INT8, UINT8, INT16, UINT16, INT32, UINT32, FLOAT32, FLOAT64
+};
+
+/**
+ * @brief      Look up a PLY type by name
+ */
+PLYType plyType(const std::string &name)
+{
+    static const std::map<std::string, PLYType> types = {
+        {"char",   PLYType::INT8},    {"int8",    PLYType::INT8},
+        {"uchar",  PLYType::UINT8},   {"uint8",   PLYType::UINT8},
+        {"short",  PLYType::INT16},   {"int16",   PLYType::INT16},
+        {"ushort", PLYType::UINT16},  {"uint16",  PLYType::UINT16},
+        {"int",    PLYType::INT32},   {"int32",   PLYType::INT32},
+        {"uint",   PLYType::UINT32},  {"uint32",  PLYType::UINT32},
+        {"float",  PLYType::FLOAT32}, {"float32", PLYType::FLOAT32},
+        {"double", PLYType::FLOAT64}, {"float64", PLYType::FLOAT64}};
+    auto it = types.find(name);
+    if (it == types.end())
+        throw std::runtime_error("Unknown property type '" + name + "'.");
+    return it->second;
+}
+
+/**
+ * @brief      A property of a PLY element
+ */
+struct PLYProperty
+{
+    std::string name;
+    PLYType     type;
+    bool        isList = false;
+    PLYType     countType = PLYType::UINT8;
+};
+
+/**
+ * @brief      An element declared in the PLY header
+ */
+struct PLYElement
+{
+    std::string              name;
+    std::size_t              count = 0;
+    std::vector<PLYProperty> properties;
+};
+
+/**
+ * @brief      Sequential reader of binary PLY values.
+ */
+class PLYCursor
+{
+public:
+    PLYCursor(const char *begin, const char *end, bool swap)
+        : pos(begin), last(end), swap(swap) {}
+
+    double read(PLYType type)
+    {
+        switch (type)
+        {
+        case PLYType::INT8:    return get<std::int8_t>();
+        case PLYType::UINT8:   return get<std::uint8_t>();
+        case PLYType::INT16:   return get<std::int16_t>();
+        case PLYType::UINT16:  return get<std::uint16_t>();
+        case PLYType::INT32:   return get<std::int32_t>();
+        case PLYType::UINT32:  return get<std::uint32_t>();
+        case PLYType::FLOAT32: return get<float>();
+        default:               return get<double>();
+        }
+    }
+
+private:
+    template <typename T>
+    T get()
+    {
+        if (static_cast<std::size_t>(last - pos) < sizeof(T))
+            throw std::runtime_error("Unexpected end of file.");
+        char bytes[sizeof(T)];
+        std::memcpy(bytes, pos, sizeof(T));
+        if (swap)
+            std::reverse(bytes, bytes + sizeof(T));
+        pos += sizeof(T);
+        T value;
+        std::memcpy(&value, bytes, sizeof(T));
+        return value;
+    }
+
+    const char *pos;
+    const char *last;
+    bool        swap;
+};
+} // end anonymous namespace
+/// @endcond
+
+void writePLY(const std::string &filename,
+              const SurfaceMesh &mesh,
+              bool normals,
+              const std::map<std::string, std::vector<REAL> > &vertexFields)
+{
+    const std::size_t nVertices = mesh.size<1>();
+    for (const auto &field : vertexFields)
+    {
+        if (field.second.size() != nVertices)
+        {
+            std::stringstream ss;
+            ss << "writePLY: Field '" << field.first << "' has "
+               << field.second.size() << " values but the mesh has "
+               << nVertices << " vertices.";
+            throw std::runtime_error(ss.str());
+        }
+    }
+
+    std::ofstream fout(filename, std::ios::out | std::ios::binary);
+    if (!fout.is_open())
+    {
+        std::stringstream ss;
+        ss << "File '" << filename
+           << "' could not be written to.";
+        throw std::runtime_error(ss.str());
+    }
+
+    std::stringstream header;
+    header << "ply\n"
+           << "format binary_little_endian 1.0\n"
+           << "comment Generated by GAMer\n"
+           << "element vertex " << nVertices << "\n"
+           << "property double x\n"
+           << "property double y\n"
+           << "property double z\n"
+           << "property int marker\n"
+           << "property uchar selected\n";
+    if (normals)
+    {
+        header << "property double nx\n"
+               << "property double ny\n"
+               << "property double nz\n";
+    }
+    for (const auto &field : vertexFields)
+        header << "property double " << field.first << "\n";
+    header << "element face " << mesh.size<3>() << "\n"
+           << "property list uchar int vertex_indices\n"
+           << "property int marker\n"
+           << "property uchar selected\n"
+           << "end_header\n";
+
+    BufferedWriter out(fout, hostIsBigEndian());
+    out.write(header.str());
+
+    DenseIndex<SurfaceMesh> sigma(mesh);
+    std::size_t idx = 0;
+    for (const auto &vertex : mesh.get_level<1>())
+    {
+        out.push(static_cast<double>(vertex[0]));
+        out.push(static_cast<double>(vertex[1]));
+        out.push(static_cast<double>(vertex[2]));
+        out.push(static_cast<std::int32_t>(vertex.marker));
+        out.push(static_cast<std::uint8_t>(vertex.selected));
+        if (normals)
+        {
+            out.push(static_cast<double>(vertex.normal[0]));
+            out.push(static_cast<double>(vertex.normal[1]));
+            out.push(static_cast<double>(vertex.normal[2]));
+        }
+        for (const auto &field : vertexFields)
+            out.push(static_cast<double>(field.second[idx]));
+        ++idx;
+    }
+
+    bool orientationError = false;
+    for (const auto faceID : mesh.get_level_id<3>())
+    {
+        auto w = mesh.get_name(faceID);
+        const auto &face = *faceID;
+        if (face.orientation == -1)
+            std::swap(w[0], w[2]);
+        else if (face.orientation != 1)
+            orientationError = true;
+
+        out.push(static_cast<std::uint8_t>(3));
+        for (auto key : w)
+            out.push(static_cast<std::int32_t>(sigma[key]));
+        out.push(static_cast<std::int32_t>(face.marker));
+        out.push(static_cast<std::uint8_t>(face.selected));
+    }
+    out.flush();
+
+    if (orientationError)
+    {
+        std::cerr << "WARNING(writePLY): The orientation of one or more faces "
+                  << "is not defined. Did you run compute_orientation()?"
+                  << std::endl;
+    }
+}
+
+std::unique_ptr<SurfaceMesh> readPLY(const std::string &filename,
+                                     std::map<std::string, std::vector<REAL> > *vertexFields)
+{
+    MappedFile file;
+    if (!file.open(filename))
+    {
+        std::stringstream ss;
+        ss << "File '" << filename << "' could not be read.";
+        throw std::runtime_error(ss.str());
+    }
+
+    try
+    {
+        // Parse the ASCII header
+        const char *pos = file.begin();
+        const char *end = file.end();
+        auto nextLine = [&pos, end]() -> std::string {
+                const char *begin = pos;
+                const char *nl = static_cast<const char*>(std::memchr(pos, '\n', end - pos));
+                if (nl == nullptr)
+                    throw std::runtime_error("Missing 'end_header'.");
+                pos = nl + 1;
+                if (nl > begin && nl[-1] == '\r')
+                    --nl;
+                return std::string(begin, nl);
+            };
+
+        if (nextLine() != "ply")
+            throw std::runtime_error("Missing 'ply' magic number.");
+
+        bool swap = false;
+        std::vector<PLYElement> elements;
+        std::string line;
+        while ((line = nextLine()) != "end_header")
+        {
+            std::stringstream ss(line);
+            std::string keyword;
+            ss >> keyword;
+            if (keyword == "format")
+            {
+                std::string format;
+                ss >> format;
+                if (format == "binary_little_endian")
+                    swap = hostIsBigEndian();
+                else if (format == "binary_big_endian")
+                    swap = !hostIsBigEndian();
+                else
+                    throw std::runtime_error("Only binary PLY files are supported.");
+            }
+            else if (keyword == "element")
+            {
+                PLYElement element;
+                ss >> element.name >> element.count;
+                elements.push_back(element);
+            }
+            else if (keyword == "property")
+            {
+                if (elements.empty())
+                    throw std::runtime_error("Property declared before any element.");
+                PLYProperty property;
+                std::string type;
+                ss >> type;
+                if (type == "list")
+                {
+                    std::string countType, valueType;
+                    ss >> countType >> valueType;
+                    property.isList    = true;
+                    property.countType = plyType(countType);
+                    property.type      = plyType(valueType);
+                }
+                else
+                    property.type = plyType(type);
+                ss >> property.name;
+                elements.back().properties.push_back(property);
+            }
+            // Comments and obj_info are ignored
+        }
+
+        PLYCursor cursor(pos, end, swap);
+        std::vector<REAL> vertices;
+        std::vector<int>  vertexMarkers, vertexSelected;
+        std::vector<REAL> vertexNormals;
+        std::vector<int>  faces, faceMarkers, faceSelected;
+        bool hasNormals = false;
+
+        for (const auto &element : elements)
+        {
+            if (element.name == "vertex")
+            {
+                vertices.assign(3*element.count, 0);
+                vertexMarkers.assign(element.count, -1);
+                vertexSelected.assign(element.count, 0);
+
+                // Route each property to its destination
+                std::vector<REAL*> target(element.properties.size(), nullptr);
+                std::vector<std::size_t> stride(element.properties.size(), 0);
+                std::vector<int*> intTarget(element.properties.size(), nullptr);
+                for (std::size_t p = 0; p < element.properties.size(); ++p)
+                {
+                    const auto &property = element.properties[p];
+                    if (property.isList)
+                        continue;
+                    const std::string &name = property.name;
+                    if (name == "x" || name == "y" || name == "z")
+                    {
+                        target[p] = &vertices[name[0] - 'x'];
+                        stride[p] = 3;
+                    }
+                    else if (name == "nx" || name == "ny" || name == "nz")
+                    {
+                        if (!hasNormals)
+                            vertexNormals.assign(3*element.count, 0);
+                        hasNormals = true;
+                        target[p] = &vertexNormals[name[1] - 'x'];
+                        stride[p] = 3;
+                    }
+                    else if (name == "marker")
+                        intTarget[p] = vertexMarkers.data();
+                    else if (name == "selected")
+                        intTarget[p] = vertexSelected.data();
+                    else if (vertexFields)
+                    {
+                        auto &field = (*vertexFields)[name];
+                        field.assign(element.count, 0);
+                        target[p] = field.data();
+                        stride[p] = 1;
+                    }
+                }
+
+                for (std::size_t i = 0; i < element.count; ++i)
+                {
+                    for (std::size_t p = 0; p < element.properties.size(); ++p)
+                    {
+                        const auto &property = element.properties[p];
+                        if (property.isList)
+                        {
+                            auto n = static_cast<std::size_t>(cursor.read(property.countType));
+                            for (std::size_t j = 0; j < n; ++j)
+                                cursor.read(property.type);
+                            continue;
+                        }
+                        double value = cursor.read(property.type);
+                        if (target[p])
+                            target[p][stride[p]*i] = value;
+                        else if (intTarget[p])
+                            intTarget[p][i] = static_cast<int>(value);
+                    }
+                }
+            }
+            else if (element.name == "face")
+            {
+                faces.reserve(3*element.count);
+                faceMarkers.assign(element.count, -1);
+                faceSelected.assign(element.count, 0);
+                for (std::size_t i = 0; i < element.count; ++i)
+                {
+                    for (const auto &property : element.properties)
+                    {
+                        if (property.isList)
+                        {
+                            auto n = static_cast<std::size_t>(cursor.read(property.countType));
+                            bool indices = property.name == "vertex_indices"
+                                           || property.name == "vertex_index";
+                            if (indices && n != 3)
+                                throw std::runtime_error("Unsupported: Found face that is not a triangle!");
+                            for (std::size_t j = 0; j < n; ++j)
+                            {
+                                double value = cursor.read(property.type);
+                                if (indices)
+                                    faces.push_back(static_cast<int>(value));
+                            }
+                            continue;
+                        }
+                        double value = cursor.read(property.type);
+                        if (property.name == "marker")
+                            faceMarkers[i] = static_cast<int>(value);
+                        else if (property.name == "selected")
+                            faceSelected[i] = static_cast<int>(value);
+                    }
+                }
+                if (faces.size() != 3*element.count)
+                    throw std::runtime_error("Faces are missing the vertex_indices property.");
+            }
+            else
+            {
+                // Skip unknown elements
+                for (std::size_t i = 0; i < element.count; ++i)
+                {
+                    for (const auto &property : element.properties)
+                    {
+                        std::size_t n = 1;
+                        if (property.isList)
+                            n = static_cast<std::size_t>(cursor.read(property.countType));
+                        for (std::size_t j = 0; j < n; ++j)
+                            cursor.read(property.type);
+                    }
+                }
+            }
+        }
+
+        const std::size_t nVertices = vertexMarkers.size();
+        auto mesh = surfaceMeshFromArrays(nVertices, vertices.data(),
+                                          vertexMarkers.data(),
+                                          faceMarkers.size(), faces.data(),
+                                          faceMarkers.data());
+
+        for (std::size_t i = 0; i < nVertices; ++i)
+        {
+            if (!vertexSelected[i] && !hasNormals)
+                continue;
+            auto &vertex = *mesh->get_simplex_up({static_cast<int>(i)});
+            vertex.selected = vertexSelected[i];
+            if (hasNormals)
+                vertex.normal = Vector({vertexNormals[3*i], vertexNormals[3*i+1], vertexNormals[3*i+2]});
+        }
+        for (std::size_t i = 0; i < faceSelected.size(); ++i)
+        {
+            if (faceSelected[i])
+                (*mesh->get_simplex_up({faces[3*i], faces[3*i+1], faces[3*i+2]})).selected = true;
+        }
+        return mesh;
+    }
+    catch (const std::runtime_error &e)
+    {
+        std::stringstream ss;
+        ss << "readPLY: In file '" << filename << "': " << e.what();
+        throw std::runtime_error(ss.str());
+    }
+}
+} // end namespace gamer
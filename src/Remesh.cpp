@@ -0,0 +1,1118 @@
+/*
+ * ***************************************************************************
+ * This file is part of the GAMer software.
+ * Copyright (C) 2016-2018
+ * by Christopher Lee, John Moody, Rommie Amaro, J. Andrew McCammon,
+ *    and Michael Holst
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * ***************************************************************************
+ */
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "gamer/BVH.h"
+#include "gamer/DenseIndex.h"
+#include "gamer/SurfaceMesh.h"
+
+/// Namespace for all things gamer
+namespace gamer
+{
+/// @cond detail
+namespace
+{
+using Sizing = std::function<REAL(const Vector&)>;
+
+constexpr std::size_t kNone = std::numeric_limits<std::size_t>::max();
+
+/**
+ * @brief      Flat triangle mesh the remeshing operators work on. Faces are
+ *             stored in winding order.
+ */
+struct RemeshData
+{
+    std::vector<Vector>                       positions;
+    std::vector<int>                          vertexMarkers;
+    std::vector<char>                         vertexSelected;
+    std::vector<std::array<std::size_t, 3> >  faces;
+    std::vector<SMFaceProperties>             faceProperties;
+    /// Selected edges as pairs of vertex indices
+    std::vector<std::array<std::size_t, 2> >  selectedEdges;
+};
+
+/**
+ * @brief      Edge (a, b) with a < b of local edge `local` of a face. The
+ *             local edge k runs from vertex k to vertex k+1 of the face.
+ */
+struct EdgeEntry
+{
+    std::size_t a;
+    std::size_t b;
+    std::size_t face;
+    std::size_t local;
+};
+
+/**
+ * @brief      Edges of a RemeshData sorted by their endpoints. The faces of
+ *             edge e are entries[start[e]] to entries[start[e+1]-1].
+ */
+struct EdgeTable
+{
+    std::vector<EdgeEntry>   entries;
+    std::vector<std::size_t> start;
+
+    std::size_t size() const
+    {
+        return start.size() - 1;
+    }
+
+    std::size_t nFaces(std::size_t e) const
+    {
+        return start[e+1] - start[e];
+    }
+};
+
+EdgeTable buildEdges(const RemeshData &data)
+{
+    const long nFaces = data.faces.size();
+    EdgeTable  table;
+    table.entries.resize(3*nFaces);
+
+    #pragma omp parallel for schedule(static)
+    for (long f = 0; f < nFaces; ++f)
+    {
+        for (std::size_t k = 0; k < 3; ++k)
+        {
+            std::size_t u = data.faces[f][k];
+            std::size_t v = data.faces[f][(k+1)%3];
+            table.entries[3*f+k] = EdgeEntry{std::min(u, v), std::max(u, v),
+                                             static_cast<std::size_t>(f), k};
+        }
+    }
+    std::sort(table.entries.begin(), table.entries.end(), [](const EdgeEntry &x, const EdgeEntry &y){
+        return x.a < y.a || (x.a == y.a && (x.b < y.b || (x.b == y.b && x.face < y.face)));
+    });
+
+    for (std::size_t i = 0; i < table.entries.size(); ++i)
+    {
+        if (i == 0 || table.entries[i].a != table.entries[i-1].a
+            || table.entries[i].b != table.entries[i-1].b)
+            table.start.push_back(i);
+    }
+    table.start.push_back(table.entries.size());
+    return table;
+}
+
+/**
+ * @brief      Index of the edge between two vertices or kNone
+ */
+std::size_t findEdge(const EdgeTable &table, std::size_t u, std::size_t v)
+{
+    const std::size_t a = std::min(u, v), b = std::max(u, v);
+    auto it = std::lower_bound(table.start.begin(), table.start.end() - 1, std::make_pair(a, b),
+                               [&table](std::size_t i, const std::pair<std::size_t, std::size_t> &key){
+            const auto &entry = table.entries[i];
+            return entry.a < key.first || (entry.a == key.first && entry.b < key.second);
+        });
+    if (it == table.start.end() - 1 || table.entries[*it].a != a || table.entries[*it].b != b)
+        return kNone;
+    return it - table.start.begin();
+}
+
+/**
+ * @brief      Whether an edge is a feature: a boundary or non-manifold edge,
+ *             or one between faces with different markers.
+ */
+bool isFeatureEdge(const RemeshData &data, const EdgeTable &table, std::size_t e)
+{
+    if (table.nFaces(e) != 2)
+        return true;
+    return data.faceProperties[table.entries[table.start[e]].face].marker
+           != data.faceProperties[table.entries[table.start[e]+1].face].marker;
+}
+
+/**
+ * @brief      Number of feature edges at each vertex. Vertices with none are
+ *             free, those with two lie on a feature line and all others are
+ *             corners which never move.
+ */
+std::vector<std::size_t> featureValence(const RemeshData &data, const EdgeTable &table)
+{
+    std::vector<std::size_t> valence(data.positions.size(), 0);
+    for (std::size_t e = 0; e < table.size(); ++e)
+    {
+        if (isFeatureEdge(data, table, e))
+        {
+            ++valence[table.entries[table.start[e]].a];
+            ++valence[table.entries[table.start[e]].b];
+        }
+    }
+    return valence;
+}
+
+std::vector<std::vector<std::size_t> > buildVertexFaces(const RemeshData &data)
+{
+    std::vector<std::vector<std::size_t> > vertexFaces(data.positions.size());
+    for (std::size_t f = 0; f < data.faces.size(); ++f)
+    {
+        for (auto v : data.faces[f])
+            vertexFaces[v].push_back(f);
+    }
+    return vertexFaces;
+}
+
+Vector faceNormal(const Vector &a, const Vector &b, const Vector &c)
+{
+    return cross(b - a, c - a);
+}
+
+REAL edgeLength(const Vector &a, const Vector &b)
+{
+    Vector d = b - a;
+    return std::sqrt(dot(d, d));
+}
+
+/**
+ * @brief      Split the flagged edges of a table at their midpoints and
+ *             retriangulate the faces with one, two or three split edges.
+ *             Selected edges pass their flag on to both halves.
+ *
+ * @param      data     The data
+ * @param[in]  table    The edges of data
+ * @param[in]  split    Whether to split each edge
+ * @param      parents  If not null, receives the index of the face each new
+ *                      face was cut from
+ *
+ * @return     The number of split edges
+ */
+std::size_t splitEdges(RemeshData &data, const EdgeTable &table, const std::vector<char> &split,
+                       std::vector<std::size_t> *parents = nullptr)
+{
+    const long nEdges = table.size();
+    const long nFaces = data.faces.size();
+
+    std::vector<std::size_t> midpoint(nEdges, kNone);
+    std::size_t nVertices = data.positions.size();
+    for (long e = 0; e < nEdges; ++e)
+    {
+        if (split[e])
+            midpoint[e] = nVertices++;
+    }
+    const std::size_t nSplit = nVertices - data.positions.size();
+    if (parents)
+    {
+        parents->resize(nFaces);
+        std::iota(parents->begin(), parents->end(), 0);
+    }
+    if (nSplit == 0)
+        return 0;
+
+    data.positions.resize(nVertices);
+    data.vertexMarkers.resize(nVertices);
+    data.vertexSelected.resize(nVertices);
+    std::vector<std::array<std::size_t, 3> > faceMidpoints(nFaces, {{kNone, kNone, kNone}});
+
+    #pragma omp parallel for schedule(static)
+    for (long e = 0; e < nEdges; ++e)
+    {
+        if (!split[e])
+            continue;
+        const auto &entry = table.entries[table.start[e]];
+        const std::size_t m = midpoint[e];
+        data.positions[m] = (data.positions[entry.a] + data.positions[entry.b])/2;
+        data.vertexMarkers[m] = data.vertexMarkers[entry.a] == data.vertexMarkers[entry.b]
+                                ? data.vertexMarkers[entry.a] : 0;
+        data.vertexSelected[m] = data.vertexSelected[entry.a] && data.vertexSelected[entry.b];
+        for (std::size_t i = table.start[e]; i < table.start[e+1]; ++i)
+            faceMidpoints[table.entries[i].face][table.entries[i].local] = m;
+    }
+
+    // Each face becomes one more face than it has split edges
+    std::vector<std::size_t> first(nFaces + 1, 0);
+    for (long f = 0; f < nFaces; ++f)
+    {
+        const auto &mid = faceMidpoints[f];
+        first[f+1] = first[f] + 1 + (mid[0] != kNone) + (mid[1] != kNone) + (mid[2] != kNone);
+    }
+
+    std::vector<std::array<std::size_t, 3> > faces(first[nFaces]);
+    std::vector<SMFaceProperties>            properties(first[nFaces], SMFaceProperties(0, false));
+    const auto &positions = data.positions;
+
+    #pragma omp parallel for schedule(static)
+    for (long f = 0; f < nFaces; ++f)
+    {
+        const auto &v   = data.faces[f];
+        const auto &mid = faceMidpoints[f];
+        const std::size_t nMid = first[f+1] - first[f] - 1;
+        auto out = faces.begin() + first[f];
+
+        if (nMid == 0)
+        {
+            out[0] = v;
+        }
+        else if (nMid == 1)
+        {
+            std::size_t k = (mid[0] != kNone) ? 0 : (mid[1] != kNone) ? 1 : 2;
+            std::size_t a = v[k], b = v[(k+1)%3], c = v[(k+2)%3], m = mid[k];
+            out[0] = {{a, m, c}};
+            out[1] = {{m, b, c}};
+        }
+        else if (nMid == 2)
+        {
+            // Rotate so that the edge from c to a is not split
+            std::size_t k = (mid[2] == kNone) ? 0 : (mid[0] == kNone) ? 1 : 2;
+            std::size_t a = v[k], b = v[(k+1)%3], c = v[(k+2)%3];
+            std::size_t m1 = mid[k], m2 = mid[(k+1)%3];
+            out[0] = {{m1, b, m2}};
+            // Split the remaining quad along its shorter diagonal
+            if (edgeLength(positions[a], positions[m2]) <= edgeLength(positions[m1], positions[c]))
+            {
+                out[1] = {{a, m1, m2}};
+                out[2] = {{a, m2, c}};
+            }
+            else
+            {
+                out[1] = {{a, m1, c}};
+                out[2] = {{m1, m2, c}};
+            }
+        }
+        else
+        {
+            out[0] = {{v[0], mid[0], mid[2]}};
+            out[1] = {{mid[0], v[1], mid[1]}};
+            out[2] = {{mid[2], mid[1], v[2]}};
+            out[3] = {{mid[0], mid[1], mid[2]}};
+        }
+        for (std::size_t i = first[f]; i < first[f+1]; ++i)
+            properties[i] = data.faceProperties[f];
+    }
+
+    data.faces.swap(faces);
+    data.faceProperties.swap(properties);
+    if (parents)
+    {
+        parents->resize(first[nFaces]);
+        for (long f = 0; f < nFaces; ++f)
+            std::fill(parents->begin() + first[f], parents->begin() + first[f+1], f);
+    }
+
+    std::vector<std::array<std::size_t, 2> > selectedEdges;
+    for (const auto &edge : data.selectedEdges)
+    {
+        std::size_t e = findEdge(table, edge[0], edge[1]);
+        if (e != kNone && split[e])
+        {
+            selectedEdges.push_back({{edge[0], midpoint[e]}});
+            selectedEdges.push_back({{edge[1], midpoint[e]}});
+        }
+        else
+        {
+            selectedEdges.push_back(edge);
+        }
+    }
+    data.selectedEdges.swap(selectedEdges);
+    return nSplit;
+}
+
+/**
+ * @brief      Split every edge longer than 4/3 of the target length.
+ *
+ * @return     The number of split edges
+ */
+std::size_t splitLongEdges(RemeshData &data, const Sizing &sizing)
+{
+    EdgeTable  table  = buildEdges(data);
+    const long nEdges = table.size();
+
+    std::vector<char> split(nEdges);
+    #pragma omp parallel for schedule(static)
+    for (long e = 0; e < nEdges; ++e)
+    {
+        const auto &entry = table.entries[table.start[e]];
+        const Vector &a = data.positions[entry.a];
+        const Vector &b = data.positions[entry.b];
+        split[e] = edgeLength(a, b) > REAL(4)/3*sizing((a + b)/2);
+    }
+    return splitEdges(data, table, split);
+}
+
+/**
+ * @brief      Red-green closure of a set of split edges. A face with two
+ *             split edges has its third split as well until every face has
+ *             none, one (green bisection) or three (red quadrisection).
+ *
+ * Faces which came from a green bisection have poor angles which another
+ * bisection would halve again. If any of their edges is split, so is their
+ * longest edge, which bounds the angles like longest edge bisection.
+ *
+ * @param[in]  data       The data
+ * @param[in]  table      The edges of data
+ * @param      split      Whether to split each edge
+ * @param[in]  bisected   If not null, whether each face came from a green
+ *                        bisection
+ */
+void closeRedGreen(const RemeshData &data, const EdgeTable &table, std::vector<char> &split,
+                   const std::vector<char> *bisected = nullptr)
+{
+    const long nEdges = table.size();
+    const long nFaces = data.faces.size();
+
+    std::vector<std::array<std::size_t, 3> > faceEdges(nFaces);
+    #pragma omp parallel for schedule(static)
+    for (long e = 0; e < nEdges; ++e)
+    {
+        for (std::size_t i = table.start[e]; i < table.start[e+1]; ++i)
+            faceEdges[table.entries[i].face][table.entries[i].local] = e;
+    }
+
+    std::vector<std::size_t> longest(nFaces, kNone);
+    if (bisected)
+    {
+        #pragma omp parallel for schedule(static)
+        for (long f = 0; f < nFaces; ++f)
+        {
+            if (!(*bisected)[f])
+                continue;
+            const auto &v = data.faces[f];
+            REAL best = -1;
+            for (std::size_t k = 0; k < 3; ++k)
+            {
+                REAL length = edgeLength(data.positions[v[k]], data.positions[v[(k+1)%3]]);
+                if (length > best)
+                {
+                    best       = length;
+                    longest[f] = faceEdges[f][k];
+                }
+            }
+        }
+    }
+
+    // Edge which each face needs split next or kNone
+    std::vector<std::size_t> pending(nFaces, kNone);
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        #pragma omp parallel for schedule(static)
+        for (long f = 0; f < nFaces; ++f)
+        {
+            const auto &edges = faceEdges[f];
+            const int nSplit = split[edges[0]] + split[edges[1]] + split[edges[2]];
+            pending[f] = kNone;
+            if (nSplit == 2)
+                pending[f] = edges[!split[edges[0]] ? 0 : !split[edges[1]] ? 1 : 2];
+            else if (nSplit == 1 && longest[f] != kNone && !split[longest[f]])
+                pending[f] = longest[f];
+        }
+        #pragma omp parallel for schedule(static) reduction(||:changed)
+        for (long e = 0; e < nEdges; ++e)
+        {
+            if (split[e])
+                continue;
+            for (std::size_t i = table.start[e]; i < table.start[e+1]; ++i)
+            {
+                if (pending[table.entries[i].face] == static_cast<std::size_t>(e))
+                {
+                    split[e] = 1;
+                    changed  = true;
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief      Drop dead faces and merged vertices and renumber the rest
+ *
+ * @param      data        The data
+ * @param[in]  faceDead    Whether each face was removed
+ * @param[in]  mergedInto  Vertex each removed vertex was merged into, kNone
+ *                         for vertices which remain
+ */
+void compact(RemeshData &data, const std::vector<char> &faceDead, const std::vector<std::size_t> &mergedInto)
+{
+    auto representative = [&mergedInto](std::size_t v){
+        while (mergedInto[v] != kNone)
+            v = mergedInto[v];
+        return v;
+    };
+
+    std::vector<std::size_t> newIndex(data.positions.size(), kNone);
+    std::size_t nVertices = 0;
+    for (std::size_t v = 0; v < data.positions.size(); ++v)
+    {
+        if (mergedInto[v] != kNone)
+            continue;
+        newIndex[v] = nVertices;
+        data.positions[nVertices]      = data.positions[v];
+        data.vertexMarkers[nVertices]  = data.vertexMarkers[v];
+        data.vertexSelected[nVertices] = data.vertexSelected[v];
+        ++nVertices;
+    }
+    data.positions.resize(nVertices);
+    data.vertexMarkers.resize(nVertices);
+    data.vertexSelected.resize(nVertices);
+
+    std::size_t nFaces = 0;
+    for (std::size_t f = 0; f < data.faces.size(); ++f)
+    {
+        if (faceDead[f])
+            continue;
+        for (std::size_t k = 0; k < 3; ++k)
+            data.faces[nFaces][k] = newIndex[data.faces[f][k]];
+        data.faceProperties[nFaces] = data.faceProperties[f];
+        ++nFaces;
+    }
+    data.faces.resize(nFaces);
+    data.faceProperties.erase(data.faceProperties.begin() + nFaces, data.faceProperties.end());
+
+    std::size_t nSelected = 0;
+    for (const auto &edge : data.selectedEdges)
+    {
+        std::size_t a = representative(edge[0]), b = representative(edge[1]);
+        if (a != b)
+            data.selectedEdges[nSelected++] = {{newIndex[a], newIndex[b]}};
+    }
+    data.selectedEdges.resize(nSelected);
+}
+
+/**
+ * @brief      Collapse edges shorter than 4/5 of the target length, shortest
+ *             first.
+ *
+ * A collapse is rejected if it changes the topology (link condition), leaves
+ * a vertex with fewer than three neighbours, creates an edge longer than
+ * 4/3 of the target length or flips a face. Corners are never removed and a
+ * vertex on a feature line may only slide along that line.
+ *
+ * @return     The number of collapsed edges
+ */
+std::size_t collapseShortEdges(RemeshData &data, const Sizing &sizing)
+{
+    EdgeTable table   = buildEdges(data);
+    auto      feature = featureValence(data, table);
+    auto      vertexFaces = buildVertexFaces(data);
+
+    std::vector<std::pair<REAL, std::size_t> > candidates;
+    for (std::size_t e = 0; e < table.size(); ++e)
+    {
+        const auto &entry = table.entries[table.start[e]];
+        const Vector &a = data.positions[entry.a];
+        const Vector &b = data.positions[entry.b];
+        REAL ratio = edgeLength(a, b)/sizing((a + b)/2);
+        if (ratio < REAL(4)/5)
+            candidates.emplace_back(ratio, e);
+    }
+    std::sort(candidates.begin(), candidates.end());
+
+    std::vector<char> faceDead(data.faces.size(), 0);
+    std::vector<std::size_t> mergedInto(data.positions.size(), kNone);
+    auto contains = [&data](std::size_t f, std::size_t v){
+        const auto &face = data.faces[f];
+        return face[0] == v || face[1] == v || face[2] == v;
+    };
+    auto neighbours = [&](std::size_t v){
+        std::vector<std::size_t> result;
+        for (auto f : vertexFaces[v])
+        {
+            for (auto u : data.faces[f])
+            {
+                if (u != v)
+                    result.push_back(u);
+            }
+        }
+        std::sort(result.begin(), result.end());
+        result.erase(std::unique(result.begin(), result.end()), result.end());
+        return result;
+    };
+    // Same as featureValence for a single vertex of the current faces
+    auto localValence = [&](std::size_t v){
+        std::size_t count = 0;
+        for (auto x : neighbours(v))
+        {
+            std::size_t nFaces = 0;
+            bool        differ = false;
+            int         marker = 0;
+            for (auto f : vertexFaces[v])
+            {
+                if (!contains(f, x))
+                    continue;
+                if (nFaces++ == 0)
+                    marker = data.faceProperties[f].marker;
+                else
+                    differ = differ || data.faceProperties[f].marker != marker;
+            }
+            if (nFaces != 2 || differ)
+                ++count;
+        }
+        return count;
+    };
+
+    std::size_t nCollapsed = 0;
+    for (const auto &candidate : candidates)
+    {
+        const auto &entry = table.entries[table.start[candidate.second]];
+        const std::size_t a = entry.a, b = entry.b;
+        if (mergedInto[a] != kNone || mergedInto[b] != kNone)
+            continue;
+
+        std::vector<std::size_t> shared;
+        for (auto f : vertexFaces[a])
+        {
+            if (contains(f, b))
+                shared.push_back(f);
+        }
+        // Removed by an earlier collapse
+        if (shared.empty())
+            continue;
+
+        const Vector &pa = data.positions[a];
+        const Vector &pb = data.positions[b];
+        if (edgeLength(pa, pb) >= REAL(4)/5*sizing((pa + pb)/2))
+            continue;
+
+        bool featureEdge = shared.size() != 2
+                           || data.faceProperties[shared[0]].marker != data.faceProperties[shared[1]].marker;
+        auto removable = [&](std::size_t v){
+            return feature[v] == 0 || (feature[v] == 2 && featureEdge);
+        };
+        bool removeA = removable(a), removeB = removable(b);
+        if (!removeA && !removeB)
+            continue;
+
+        std::size_t u, w;
+        Vector      position;
+        if (removeA && removeB)
+        {
+            u = a; w = b; position = (pa + pb)/2;
+        }
+        else if (removeA)
+        {
+            u = a; w = b; position = pb;
+        }
+        else
+        {
+            u = b; w = a; position = pa;
+        }
+
+        // Link condition: the common neighbours are exactly the vertices
+        // opposite the edge
+        auto nu = neighbours(u);
+        auto nw = neighbours(w);
+        std::vector<std::size_t> common;
+        std::set_intersection(nu.begin(), nu.end(), nw.begin(), nw.end(), std::back_inserter(common));
+        if (common.size() != shared.size())
+            continue;
+        bool degenerate = false;
+        for (auto x : common)
+            degenerate = degenerate || neighbours(x).size() <= 3;
+        if (degenerate)
+            continue;
+
+        // Geometric checks on the faces which survive and move
+        bool valid = true;
+        for (auto v : {u, w})
+        {
+            for (auto f : vertexFaces[v])
+            {
+                if (!valid || (contains(f, u) && contains(f, w)))
+                    continue;
+                auto face = data.faces[f];
+                std::array<Vector, 3> corners;
+                for (std::size_t k = 0; k < 3; ++k)
+                    corners[k] = (face[k] == v) ? position : data.positions[face[k]];
+                Vector before = faceNormal(data.positions[face[0]], data.positions[face[1]], data.positions[face[2]]);
+                Vector after  = faceNormal(corners[0], corners[1], corners[2]);
+                if (dot(before, after) <= 0)
+                    valid = false;
+                for (std::size_t k = 0; k < 3 && valid; ++k)
+                {
+                    if (face[k] == v)
+                        continue;
+                    const Vector &p = data.positions[face[k]];
+                    if (edgeLength(position, p) > REAL(4)/3*sizing((position + p)/2))
+                        valid = false;
+                }
+            }
+        }
+        if (!valid)
+            continue;
+
+        for (auto f : shared)
+        {
+            faceDead[f] = 1;
+            for (auto v : data.faces[f])
+            {
+                auto &list = vertexFaces[v];
+                list.erase(std::remove(list.begin(), list.end(), f), list.end());
+            }
+        }
+        for (auto f : vertexFaces[u])
+        {
+            for (auto &v : data.faces[f])
+            {
+                if (v == u)
+                    v = w;
+            }
+            vertexFaces[w].push_back(f);
+        }
+        vertexFaces[u].clear();
+        mergedInto[u] = w;
+        data.positions[w] = position;
+        // Edges to the opposite vertices merged, which may start or end a
+        // feature line there
+        feature[w] = localValence(w);
+        for (auto x : common)
+            feature[x] = localValence(x);
+        ++nCollapsed;
+    }
+
+    if (nCollapsed > 0)
+        compact(data, faceDead, mergedInto);
+    return nCollapsed;
+}
+
+/**
+ * @brief      Flip interior edges which bring the valences of the four
+ *             vertices involved closer to six, or four on the boundary.
+ *             Feature edges are never flipped.
+ *
+ * @return     The number of flipped edges
+ */
+std::size_t flipEdges(RemeshData &data)
+{
+    EdgeTable table = buildEdges(data);
+    auto      vertexFaces = buildVertexFaces(data);
+
+    std::vector<long> valence(data.positions.size(), 0);
+    std::vector<char> boundary(data.positions.size(), 0);
+    for (std::size_t e = 0; e < table.size(); ++e)
+    {
+        const auto &entry = table.entries[table.start[e]];
+        ++valence[entry.a];
+        ++valence[entry.b];
+        if (table.nFaces(e) == 1)
+            boundary[entry.a] = boundary[entry.b] = 1;
+    }
+    auto deviation = [&](std::size_t v, long delta){
+        long d = valence[v] + delta - (boundary[v] ? 4 : 6);
+        return d*d;
+    };
+    // Position of the directed edge x->y in face f or 3 if absent
+    auto findEdge = [&data](std::size_t f, std::size_t x, std::size_t y){
+        const auto &face = data.faces[f];
+        for (std::size_t k = 0; k < 3; ++k)
+        {
+            if (face[k] == x && face[(k+1)%3] == y)
+                return k;
+        }
+        return std::size_t(3);
+    };
+
+    std::size_t nFlipped = 0;
+    for (std::size_t e = 0; e < table.size(); ++e)
+    {
+        if (isFeatureEdge(data, table, e))
+            continue;
+        const auto &entry = table.entries[table.start[e]];
+        std::size_t f1 = entry.face;
+        std::size_t f2 = table.entries[table.start[e]+1].face;
+        std::size_t x = entry.a, y = entry.b;
+
+        // Orient the edge along the winding of f1. Earlier flips may have
+        // removed the edge altogether.
+        std::size_t k1 = findEdge(f1, x, y);
+        if (k1 == 3)
+        {
+            std::swap(x, y);
+            k1 = findEdge(f1, x, y);
+        }
+        std::size_t k2 = findEdge(f2, y, x);
+        if (k1 == 3 || k2 == 3)
+            continue;
+        std::size_t c = data.faces[f1][(k1+2)%3];
+        std::size_t d = data.faces[f2][(k2+2)%3];
+        if (c == d)
+            continue;
+
+        bool exists = false;
+        for (auto f : vertexFaces[c])
+        {
+            const auto &face = data.faces[f];
+            exists = exists || face[0] == d || face[1] == d || face[2] == d;
+        }
+        if (exists)
+            continue;
+
+        long before = deviation(x, 0) + deviation(y, 0) + deviation(c, 0) + deviation(d, 0);
+        long after  = deviation(x, -1) + deviation(y, -1) + deviation(c, 1) + deviation(d, 1);
+        if (after >= before)
+            continue;
+
+        const auto &p = data.positions;
+        Vector old1 = faceNormal(p[x], p[y], p[c]);
+        Vector old2 = faceNormal(p[y], p[x], p[d]);
+        Vector new1 = faceNormal(p[c], p[x], p[d]);
+        Vector new2 = faceNormal(p[d], p[y], p[c]);
+        if (dot(new1, old1) <= 0 || dot(new1, old2) <= 0
+            || dot(new2, old1) <= 0 || dot(new2, old2) <= 0)
+            continue;
+
+        data.faces[f1] = {{c, x, d}};
+        data.faces[f2] = {{d, y, c}};
+        --valence[x];
+        --valence[y];
+        ++valence[c];
+        ++valence[d];
+        auto &fx = vertexFaces[x];
+        fx.erase(std::remove(fx.begin(), fx.end(), f2), fx.end());
+        auto &fy = vertexFaces[y];
+        fy.erase(std::remove(fy.begin(), fy.end(), f1), fy.end());
+        vertexFaces[c].push_back(f2);
+        vertexFaces[d].push_back(f1);
+        ++nFlipped;
+    }
+    return nFlipped;
+}
+
+/**
+ * @brief      Move every free vertex toward the centroid of its neighbours
+ *             within its tangent plane and optionally project it back onto
+ *             the original surface. A vertex on a feature line slides along
+ *             the line toward the midpoint of its two feature neighbours and
+ *             corners stay fixed. Vertices are updated from a copy of the
+ *             positions so the result does not depend on the order.
+ */
+void relaxVertices(RemeshData &data, const FaceBVH *surface)
+{
+    EdgeTable table   = buildEdges(data);
+    auto      feature = featureValence(data, table);
+    const long nVertices = data.positions.size();
+
+    // Neighbours and area weighted normals of each vertex
+    std::vector<std::size_t> start(nVertices + 1, 0);
+    for (std::size_t e = 0; e < table.size(); ++e)
+    {
+        ++start[table.entries[table.start[e]].a + 1];
+        ++start[table.entries[table.start[e]].b + 1];
+    }
+    for (long v = 0; v < nVertices; ++v)
+        start[v+1] += start[v];
+    std::vector<std::size_t> neighbours(start[nVertices]);
+    std::vector<std::size_t> fill(start.begin(), start.end() - 1);
+    std::vector<std::array<std::size_t, 2> > featureNeighbours(nVertices, {{kNone, kNone}});
+    for (std::size_t e = 0; e < table.size(); ++e)
+    {
+        const auto &entry = table.entries[table.start[e]];
+        neighbours[fill[entry.a]++] = entry.b;
+        neighbours[fill[entry.b]++] = entry.a;
+        if (isFeatureEdge(data, table, e))
+        {
+            for (auto ends : {std::make_pair(entry.a, entry.b), std::make_pair(entry.b, entry.a)})
+            {
+                auto &slot = featureNeighbours[ends.first];
+                if (slot[0] == kNone)
+                    slot[0] = ends.second;
+                else
+                    slot[1] = ends.second;
+            }
+        }
+    }
+    std::vector<Vector> normals(nVertices);
+    for (const auto &face : data.faces)
+    {
+        Vector n = faceNormal(data.positions[face[0]], data.positions[face[1]], data.positions[face[2]]);
+        for (auto v : face)
+            normals[v] += n;
+    }
+
+    std::vector<Vector> positions(data.positions);
+    #pragma omp parallel for schedule(static)
+    for (long v = 0; v < nVertices; ++v)
+    {
+        const Vector &p = data.positions[v];
+        if (feature[v] == 2)
+        {
+            // Keep the vertex on the polyline through its feature neighbours
+            const Vector &a = data.positions[featureNeighbours[v][0]];
+            const Vector &b = data.positions[featureNeighbours[v][1]];
+            Vector target = (a + b)/2;
+            Vector best   = p;
+            REAL   bestDistance = std::numeric_limits<REAL>::infinity();
+            for (const Vector *end : {&a, &b})
+            {
+                Vector d = *end - p;
+                REAL   t = dot(d, d);
+                t = (t > 0) ? std::max(REAL(0), std::min(REAL(1), dot(target - p, d)/t)) : 0;
+                Vector q = p + t*d;
+                Vector r = target - q;
+                if (dot(r, r) < bestDistance)
+                {
+                    bestDistance = dot(r, r);
+                    best = q;
+                }
+            }
+            positions[v] = best;
+            continue;
+        }
+        if (feature[v] > 0 || start[v] == start[v+1])
+            continue;
+        Vector centroid;
+        for (std::size_t i = start[v]; i < start[v+1]; ++i)
+            centroid += data.positions[neighbours[i]];
+        centroid /= static_cast<REAL>(start[v+1] - start[v]);
+
+        Vector n = normals[v];
+        REAL   length = std::sqrt(dot(n, n));
+        Vector d = centroid - p;
+        if (length > 0)
+        {
+            n /= length;
+            d -= dot(d, n)*n;
+        }
+        positions[v] = p + d;
+        if (surface)
+            positions[v] = surface->closestPoint(positions[v]).point;
+    }
+    data.positions.swap(positions);
+}
+
+RemeshData extractRemeshData(const SurfaceMesh &mesh)
+{
+    RemeshData data;
+    DenseIndex<SurfaceMesh> index(mesh);
+    for (const auto vertexID : mesh.get_level_id<1>())
+    {
+        const auto &vertex = *vertexID;
+        data.positions.push_back(vertex.position);
+        data.vertexMarkers.push_back(vertex.marker);
+        data.vertexSelected.push_back(vertex.selected);
+    }
+    for (const auto faceID : mesh.get_level_id<3>())
+    {
+        auto name = mesh.get_name(faceID);
+        std::array<std::size_t, 3> face = {{index[name[0]], index[name[1]], index[name[2]]}};
+        if ((*faceID).orientation == -1)
+            std::swap(face[0], face[2]);
+        data.faces.push_back(face);
+        data.faceProperties.push_back(*faceID);
+    }
+    for (const auto edgeID : mesh.get_level_id<2>())
+    {
+        if ((*edgeID).selected)
+        {
+            auto name = mesh.get_name(edgeID);
+            data.selectedEdges.push_back({{index[name[0]], index[name[1]]}});
+        }
+    }
+    return data;
+}
+
+std::unique_ptr<SurfaceMesh> toSurfaceMesh(const RemeshData &data, const SurfaceMesh &original)
+{
+    std::vector<REAL> vertices;
+    vertices.reserve(3*data.positions.size());
+    for (const auto &p : data.positions)
+        vertices.insert(vertices.end(), {p[0], p[1], p[2]});
+    std::vector<int> faces, faceMarkers;
+    faces.reserve(3*data.faces.size());
+    for (std::size_t f = 0; f < data.faces.size(); ++f)
+    {
+        for (auto v : data.faces[f])
+            faces.push_back(static_cast<int>(v));
+        faceMarkers.push_back(data.faceProperties[f].marker);
+    }
+
+    auto result = surfaceMeshFromArrays(data.positions.size(), vertices.data(),
+                                        data.vertexMarkers.data(),
+                                        data.faces.size(), faces.data(), faceMarkers.data());
+    *result->get_simplex_up() = *original.get_simplex_up();
+    for (std::size_t v = 0; v < data.positions.size(); ++v)
+        (*result->get_simplex_up({static_cast<int>(v)})).selected = data.vertexSelected[v];
+    for (std::size_t f = 0; f < data.faces.size(); ++f)
+    {
+        const int *w = &faces[3*f];
+        auto &properties = static_cast<SMFaceProperties&>(*result->get_simplex_up({w[0], w[1], w[2]}));
+        properties = data.faceProperties[f];
+    }
+    // Edges removed by flips are skipped
+    for (const auto &edge : data.selectedEdges)
+    {
+        auto edgeID = result->get_simplex_up({static_cast<int>(edge[0]), static_cast<int>(edge[1])});
+        if (edgeID != nullptr)
+            (*edgeID).selected = true;
+    }
+    return result;
+}
+/**
+ * @brief      Sizing field given at the vertices of a mesh and interpolated
+ *             linearly over its closest face.
+ */
+class VertexSizing
+{
+public:
+    VertexSizing(const SurfaceMesh &mesh, const std::vector<REAL> &values, const char *caller) :
+        surface(mesh), values(values)
+    {
+        if (values.size() != mesh.size<1>())
+            throw std::runtime_error(std::string(caller) + ": The sizing field must have one value per vertex.");
+        for (auto value : values)
+        {
+            if (!(value > 0))
+                throw std::runtime_error(std::string(caller) + ": The sizing field must be positive.");
+        }
+    }
+
+    REAL operator()(const Vector &p) const
+    {
+        auto closest = surface.closestPoint(p);
+        const auto &face = surface.face(closest.face);
+        auto   tri  = surface.triangle(closest.face);
+        Vector n    = cross(tri[1] - tri[0], tri[2] - tri[0]);
+        REAL   area = dot(n, n);
+        if (!(area > 0))
+            return values[face[0]];
+        REAL w1 = dot(cross(closest.point - tri[0], tri[2] - tri[0]), n)/area;
+        REAL w2 = dot(cross(tri[1] - tri[0], closest.point - tri[0]), n)/area;
+        return (1 - w1 - w2)*values[face[0]] + w1*values[face[1]] + w2*values[face[2]];
+    }
+
+private:
+    FaceBVH                  surface;
+    const std::vector<REAL> &values;
+};
+} // end anonymous namespace
+/// @endcond
+
+std::unique_ptr<SurfaceMesh> isotropicRemesh(const SurfaceMesh                       &mesh,
+                                             const std::function<REAL(const Vector&)> &sizing,
+                                             std::size_t                               iterations,
+                                             bool                                      project)
+{
+    RemeshData data = extractRemeshData(mesh);
+    std::unique_ptr<FaceBVH> surface;
+    if (project)
+        surface.reset(new FaceBVH(mesh));
+
+    for (std::size_t iter = 0; iter < iterations; ++iter)
+    {
+        // Long edges may need several rounds of halving
+        for (std::size_t round = 0; round < 10 && splitLongEdges(data, sizing) > 0; ++round);
+        collapseShortEdges(data, sizing);
+        flipEdges(data);
+        relaxVertices(data, surface.get());
+    }
+    return toSurfaceMesh(data, mesh);
+}
+
+std::unique_ptr<SurfaceMesh> isotropicRemesh(const SurfaceMesh &mesh,
+                                             REAL               targetLength,
+                                             std::size_t        iterations,
+                                             bool               project)
+{
+    if (!(targetLength > 0))
+        throw std::runtime_error("isotropicRemesh: The target edge length must be positive.");
+    return isotropicRemesh(mesh, [targetLength](const Vector&){ return targetLength; },
+                           iterations, project);
+}
+
+std::unique_ptr<SurfaceMesh> isotropicRemesh(const SurfaceMesh       &mesh,
+                                             const std::vector<REAL> &vertexSizing,
+                                             std::size_t              iterations,
+                                             bool                     project)
+{
+    VertexSizing sizing(mesh, vertexSizing, "isotropicRemesh");
+    return isotropicRemesh(mesh, std::cref(sizing), iterations, project);
+}
+
+std::unique_ptr<SurfaceMesh> adaptiveRefine(const SurfaceMesh &mesh)
+{
+    RemeshData data  = extractRemeshData(mesh);
+    EdgeTable  table = buildEdges(data);
+    const long nEdges = table.size();
+
+    std::vector<char> split(nEdges, 0);
+    #pragma omp parallel for schedule(static)
+    for (long e = 0; e < nEdges; ++e)
+    {
+        for (std::size_t i = table.start[e]; i < table.start[e+1]; ++i)
+        {
+            if (data.faceProperties[table.entries[i].face].selected)
+                split[e] = 1;
+        }
+    }
+    closeRedGreen(data, table, split);
+    splitEdges(data, table, split);
+    return toSurfaceMesh(data, mesh);
+}
+
+std::unique_ptr<SurfaceMesh> adaptiveRefine(const SurfaceMesh                        &mesh,
+                                            const std::function<REAL(const Vector&)> &sizing,
+                                            std::size_t                               maxLevels)
+{
+    RemeshData data = extractRemeshData(mesh);
+    // Faces which came from a green bisection, directly or through the
+    // quadrisection of one
+    std::vector<char> bisected(data.faces.size(), 0);
+    for (std::size_t level = 0; level < maxLevels; ++level)
+    {
+        EdgeTable  table  = buildEdges(data);
+        const long nEdges = table.size();
+
+        std::vector<char> split(nEdges);
+        #pragma omp parallel for schedule(static)
+        for (long e = 0; e < nEdges; ++e)
+        {
+            const auto &entry = table.entries[table.start[e]];
+            const Vector &a = data.positions[entry.a];
+            const Vector &b = data.positions[entry.b];
+            split[e] = edgeLength(a, b) > sizing((a + b)/2);
+        }
+        if (std::find(split.begin(), split.end(), 1) == split.end())
+            break;
+        closeRedGreen(data, table, split, &bisected);
+
+        std::vector<std::size_t> parents;
+        splitEdges(data, table, split, &parents);
+        std::vector<std::size_t> nChildren(bisected.size(), 0);
+        for (auto f : parents)
+            ++nChildren[f];
+        std::vector<char> next(parents.size());
+        for (std::size_t f = 0; f < parents.size(); ++f)
+            next[f] = bisected[parents[f]] || nChildren[parents[f]] == 2;
+        bisected.swap(next);
+    }
+    return toSurfaceMesh(data, mesh);
+}
+
+std::unique_ptr<SurfaceMesh> adaptiveRefine(const SurfaceMesh       &mesh,
+                                            const std::vector<REAL> &vertexSizing,
+                                            std::size_t              maxLevels)
+{
+    VertexSizing sizing(mesh, vertexSizing, "adaptiveRefine");
+    return adaptiveRefine(mesh, std::cref(sizing), maxLevels);
+}
+} // end namespace gamer
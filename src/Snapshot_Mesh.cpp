@@ -0,0 +1,692 @@
+/*
+ * ***************************************************************************
+ * This file is part of the GAMer software.
+ * Copyright (C) 2016-2018
+ * by Christopher Lee, John Moody, Rommie Amaro, J. Andrew McCammon,
+ *    and Michael Holst
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * ***************************************************************************
+ */
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <casc/casc>
+
+#include "gamer/DenseIndex.h"
+#include "gamer/MappedFile.h"
+#include "gamer/SurfaceMesh.h"
+#include "gamer/TetMesh.h"
+
+/// Namespace for all things gamer
+namespace gamer
+{
+/// @cond detail
+namespace
+{
+/*
+ * Layout of a snapshot file. All values are stored in host byte order, which
+ * the reader verifies against the byte order mark.
+ *
+ *   SnapshotHeader                      64 bytes
+ *   SnapshotEntry[nSections]            64 bytes each
+ *   section data, each starting on a 64 byte boundary
+ *
+ * Sections are dense arrays of count*components values. Vertices are
+ * numbered in get_level_id<1>() order. Surface faces and tetrahedra are
+ * stored in winding order and the loader derives their orientation from the
+ * parity of the indices. Other simplices are stored by their vertex indices
+ * in any order.
+ */
+constexpr char          snapshotMagic[8] = {'G', 'A', 'M', 'E', 'R', 'S', 'N', 'P'};
+constexpr std::uint32_t snapshotVersion  = 2;
+constexpr std::uint32_t snapshotByteOrder = 0x01020304;
+constexpr std::size_t   snapshotAlignment = 64;
+
+enum SnapshotKind : std::uint32_t
+{
+    SURFACE_MESH = 1,
+    TET_MESH     = 2
+};
+
+struct SnapshotHeader
+{
+    char          magic[8];
+    std::uint32_t version;
+    std::uint32_t byteOrder;
+    std::uint32_t kind;
+    std::uint32_t nSections;
+    char          reserved[40];
+};
+
+struct SnapshotEntry
+{
+    char          name[40];
+    std::uint32_t dtype;
+    std::uint32_t components;
+    std::uint64_t count;
+    std::uint64_t offset;
+};
+
+static_assert(sizeof(SnapshotHeader) == 64, "Unexpected snapshot header size");
+static_assert(sizeof(SnapshotEntry) == 64, "Unexpected snapshot entry size");
+
+/// Type codes of section values
+template <typename T> struct SnapshotType;
+template <> struct SnapshotType<std::int8_t>   { static constexpr std::uint32_t code = 1; };
+template <> struct SnapshotType<std::uint8_t>  { static constexpr std::uint32_t code = 2; };
+template <> struct SnapshotType<std::int32_t>  { static constexpr std::uint32_t code = 3; };
+template <> struct SnapshotType<double>        { static constexpr std::uint32_t code = 4; };
+
+/// Prefix of the section names of user supplied vertex fields
+const std::string fieldPrefix = "field:";
+
+/**
+ * @brief      Accumulates sections and writes them out as a snapshot.
+ */
+class SnapshotWriter
+{
+public:
+    template <typename T>
+    void add(const std::string &name, std::size_t components, std::vector<T> &&values)
+    {
+        if (name.size() >= sizeof(SnapshotEntry::name))
+        {
+            std::stringstream ss;
+            ss << "Section name '" << name << "' is longer than "
+               << sizeof(SnapshotEntry::name) - 1 << " characters.";
+            throw std::runtime_error(ss.str());
+        }
+        Section section;
+        section.name       = name;
+        section.dtype      = SnapshotType<T>::code;
+        section.components = components;
+        section.count      = values.size()/components;
+        section.bytes.resize(values.size()*sizeof(T));
+        if (!values.empty())
+            std::memcpy(section.bytes.data(), values.data(), section.bytes.size());
+        sections.push_back(std::move(section));
+    }
+
+    void write(const std::string &filename, SnapshotKind kind) const
+    {
+        std::ofstream fout(filename, std::ios::out | std::ios::binary);
+        if (!fout.is_open())
+        {
+            std::stringstream ss;
+            ss << "File '" << filename
+               << "' could not be written to.";
+            throw std::runtime_error(ss.str());
+        }
+
+        SnapshotHeader header = {};
+        std::memcpy(header.magic, snapshotMagic, sizeof(snapshotMagic));
+        header.version   = snapshotVersion;
+        header.byteOrder = snapshotByteOrder;
+        header.kind      = kind;
+        header.nSections = static_cast<std::uint32_t>(sections.size());
+
+        std::vector<SnapshotEntry> table(sections.size());
+        std::uint64_t offset = sizeof(SnapshotHeader) + table.size()*sizeof(SnapshotEntry);
+        for (std::size_t i = 0; i < sections.size(); ++i)
+        {
+            const auto &section = sections[i];
+            auto       &entry = table[i];
+            std::memset(&entry, 0, sizeof(entry));
+            std::memcpy(entry.name, section.name.data(), section.name.size());
+            entry.dtype      = section.dtype;
+            entry.components = section.components;
+            entry.count      = section.count;
+            entry.offset     = offset;
+            offset = align(offset + section.bytes.size());
+        }
+
+        fout.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        fout.write(reinterpret_cast<const char*>(table.data()),
+                   table.size()*sizeof(SnapshotEntry));
+        std::uint64_t position = sizeof(SnapshotHeader) + table.size()*sizeof(SnapshotEntry);
+        const char padding[snapshotAlignment] = {};
+        for (std::size_t i = 0; i < sections.size(); ++i)
+        {
+            fout.write(padding, table[i].offset - position);
+            fout.write(sections[i].bytes.data(), sections[i].bytes.size());
+            position = table[i].offset + sections[i].bytes.size();
+        }
+        fout.write(padding, align(position) - position);
+    }
+
+private:
+    struct Section
+    {
+        std::string       name;
+        std::uint32_t     dtype;
+        std::uint32_t     components;
+        std::uint64_t     count;
+        std::vector<char> bytes;
+    };
+
+    static std::uint64_t align(std::uint64_t offset)
+    {
+        return (offset + snapshotAlignment - 1) / snapshotAlignment * snapshotAlignment;
+    }
+
+    std::vector<Section> sections;
+};
+
+/**
+ * @brief      Typed views of the sections of a mapped snapshot.
+ */
+class SnapshotReader
+{
+public:
+    SnapshotReader(const std::string &filename, SnapshotKind kind)
+    {
+        if (!file.open(filename))
+        {
+            std::stringstream ss;
+            ss << "File '" << filename << "' could not be read.";
+            throw std::runtime_error(ss.str());
+        }
+
+        SnapshotHeader header;
+        if (file.size() < sizeof(header))
+            throw std::runtime_error("File is too short to be a snapshot.");
+        std::memcpy(&header, file.data(), sizeof(header));
+        if (std::memcmp(header.magic, snapshotMagic, sizeof(snapshotMagic)) != 0)
+            throw std::runtime_error("Missing snapshot magic number.");
+        if (header.byteOrder != snapshotByteOrder)
+            throw std::runtime_error("Snapshot was written on a machine of different byte order.");
+        if (header.version != snapshotVersion)
+        {
+            std::stringstream ss;
+            ss << "Unsupported snapshot version " << header.version << ".";
+            throw std::runtime_error(ss.str());
+        }
+        if (header.kind != kind)
+        {
+            throw std::runtime_error(header.kind == SURFACE_MESH
+                                     ? "Snapshot contains a surface mesh."
+                                     : "Snapshot contains a tetrahedral mesh.");
+        }
+
+        std::uint64_t tableEnd = sizeof(header) +
+                                 std::uint64_t(header.nSections)*sizeof(SnapshotEntry);
+        if (tableEnd > file.size())
+            throw std::runtime_error("Section table is truncated.");
+        for (std::uint32_t i = 0; i < header.nSections; ++i)
+        {
+            SnapshotEntry entry;
+            std::memcpy(&entry, file.data() + sizeof(header) + i*sizeof(SnapshotEntry),
+                        sizeof(entry));
+            entry.name[sizeof(entry.name) - 1] = '\0';
+            entries[entry.name] = entry;
+        }
+    }
+
+    /**
+     * @brief      Get the values of a section
+     *
+     * @param[in]  name        Section name
+     * @param[in]  components  Expected number of values per item
+     * @param[in]  count       Expected number of items
+     * @param[in]  required    Throw if the section is missing
+     *
+     * @return     Pointer to the first value or nullptr if absent
+     */
+    template <typename T>
+    const T *get(const std::string &name, std::size_t components,
+                 std::size_t count, bool required = true) const
+    {
+        auto it = entries.find(name);
+        if (it == entries.end())
+        {
+            if (required)
+                throw std::runtime_error("Missing section '" + name + "'.");
+            return nullptr;
+        }
+        const auto &entry = it->second;
+        if (entry.dtype != SnapshotType<T>::code || entry.components != components
+            || entry.count != count)
+        {
+            throw std::runtime_error("Section '" + name + "' has unexpected type or size.");
+        }
+        return data<T>(entry);
+    }
+
+    /**
+     * @brief      Number of items in a section
+     */
+    std::size_t count(const std::string &name) const
+    {
+        auto it = entries.find(name);
+        if (it == entries.end())
+            throw std::runtime_error("Missing section '" + name + "'.");
+        return it->second.count;
+    }
+
+    /**
+     * @brief      Collect all vertex field sections
+     */
+    void fields(std::size_t nVertices,
+                std::map<std::string, std::vector<REAL> > &vertexFields) const
+    {
+        for (const auto &kv : entries)
+        {
+            if (kv.first.compare(0, fieldPrefix.size(), fieldPrefix) != 0)
+                continue;
+            const double *values = get<double>(kv.first, 1, nVertices);
+            vertexFields[kv.first.substr(fieldPrefix.size())]
+                .assign(values, values + nVertices);
+        }
+    }
+
+private:
+    template <typename T>
+    const T *data(const SnapshotEntry &entry) const
+    {
+        std::uint64_t bytes = entry.count*entry.components*sizeof(T);
+        if (entry.offset % snapshotAlignment != 0 || entry.offset > file.size()
+            || bytes > file.size() - entry.offset)
+        {
+            throw std::runtime_error(std::string("Section '") + entry.name + "' is truncated.");
+        }
+        return reinterpret_cast<const T*>(file.data() + entry.offset);
+    }
+
+    MappedFile                           file;
+    std::map<std::string, SnapshotEntry> entries;
+};
+
+/**
+ * @brief      Adds the user supplied vertex fields to a snapshot
+ */
+void addFields(SnapshotWriter &writer, std::size_t nVertices,
+               const std::map<std::string, std::vector<REAL> > &vertexFields)
+{
+    for (const auto &field : vertexFields)
+    {
+        if (field.second.size() != nVertices)
+        {
+            std::stringstream ss;
+            ss << "writeSnapshot: Field '" << field.first << "' has "
+               << field.second.size() << " values but the mesh has "
+               << nVertices << " vertices.";
+            throw std::runtime_error(ss.str());
+        }
+        writer.add(fieldPrefix + field.first, 1,
+                   std::vector<double>(field.second.begin(), field.second.end()));
+    }
+}
+
+/**
+ * @brief      Vertex indices of an oriented simplex in winding order
+ *
+ * Swapping the first and last vertex reverses the winding.
+ */
+template <typename Complex, typename SimplexID>
+std::vector<std::int32_t> windingOrder(const Complex &mesh, SimplexID id,
+                                       const DenseIndex<Complex> &sigma)
+{
+    std::vector<std::int32_t> indices;
+    for (auto key : mesh.get_name(id))
+        indices.push_back(static_cast<std::int32_t>(sigma[key]));
+    if ((*id).orientation == -1)
+        std::swap(indices.front(), indices.back());
+    return indices;
+}
+
+/**
+ * @brief      Orientation of a simplex given in winding order
+ *
+ * Names are stored with sorted keys. An even permutation of the sorted
+ * indices has the same winding.
+ */
+int windingOrientation(const std::int32_t *indices, std::size_t n)
+{
+    int inversions = 0;
+    for (std::size_t i = 0; i < n; ++i)
+        for (std::size_t j = i + 1; j < n; ++j)
+            inversions += indices[i] > indices[j];
+    return (inversions % 2 == 0) ? 1 : -1;
+}
+
+/**
+ * @brief      Checks that simplices reference existing vertices
+ */
+void checkIndices(const std::int32_t *indices, std::size_t n, std::size_t nVertices,
+                  const std::string &name)
+{
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        if (indices[i] < 0 || static_cast<std::size_t>(indices[i]) >= nVertices)
+            throw std::runtime_error("Section '" + name + "' references a vertex which is out of range.");
+    }
+}
+} // end anonymous namespace
+/// @endcond
+
+void writeSnapshot(const std::string &filename,
+                   const SurfaceMesh &mesh,
+                   const std::map<std::string, std::vector<REAL> > &vertexFields)
+{
+    SnapshotWriter writer;
+
+    const auto &global = *mesh.get_simplex_up();
+    writer.add("global", 4, std::vector<double>{
+            static_cast<double>(global.marker),
+            static_cast<double>(global.volumeConstraint),
+            static_cast<double>(global.useVolumeConstraint),
+            static_cast<double>(global.ishole)});
+
+    const std::size_t nVertices = mesh.size<1>();
+    DenseIndex<SurfaceMesh> sigma(mesh);
+    std::vector<double>       vertices;
+    std::vector<std::int32_t> vertexMarkers;
+    std::vector<std::uint8_t> vertexSelected;
+    vertices.reserve(3*nVertices);
+    vertexMarkers.reserve(nVertices);
+    vertexSelected.reserve(nVertices);
+    for (const auto &vertex : mesh.get_level<1>())
+    {
+        vertices.insert(vertices.end(), {vertex[0], vertex[1], vertex[2]});
+        vertexMarkers.push_back(vertex.marker);
+        vertexSelected.push_back(vertex.selected);
+    }
+    writer.add("vertices", 3, std::move(vertices));
+    writer.add("vertex_markers", 1, std::move(vertexMarkers));
+    writer.add("vertex_selected", 1, std::move(vertexSelected));
+
+    std::vector<std::int32_t> selectedEdges;
+    for (const auto edgeID : mesh.get_level_id<2>())
+    {
+        if ((*edgeID).selected)
+        {
+            for (auto key : mesh.get_name(edgeID))
+                selectedEdges.push_back(static_cast<std::int32_t>(sigma[key]));
+        }
+    }
+    writer.add("selected_edges", 2, std::move(selectedEdges));
+
+    const std::size_t nFaces = mesh.size<3>();
+    std::vector<std::int32_t> faces;
+    std::vector<std::int32_t> faceMarkers;
+    std::vector<std::uint8_t> faceSelected;
+    faces.reserve(3*nFaces);
+    faceMarkers.reserve(nFaces);
+    faceSelected.reserve(nFaces);
+    for (const auto faceID : mesh.get_level_id<3>())
+    {
+        auto w = windingOrder(mesh, faceID, sigma);
+        faces.insert(faces.end(), w.begin(), w.end());
+        faceMarkers.push_back((*faceID).marker);
+        faceSelected.push_back((*faceID).selected);
+    }
+    writer.add("faces", 3, std::move(faces));
+    writer.add("face_markers", 1, std::move(faceMarkers));
+    writer.add("face_selected", 1, std::move(faceSelected));
+
+    addFields(writer, nVertices, vertexFields);
+    writer.write(filename, SURFACE_MESH);
+}
+
+std::unique_ptr<SurfaceMesh> readSnapshot_SurfaceMesh(const std::string &filename,
+                                                      std::map<std::string, std::vector<REAL> > *vertexFields)
+{
+    try
+    {
+        SnapshotReader reader(filename, SURFACE_MESH);
+        std::unique_ptr<SurfaceMesh> mesh(new SurfaceMesh);
+
+        const double *global = reader.get<double>("global", 4, 1);
+        auto &metadata = *mesh->get_simplex_up();
+        metadata.marker              = static_cast<int>(global[0]);
+        metadata.volumeConstraint    = static_cast<float>(global[1]);
+        metadata.useVolumeConstraint = global[2] != 0;
+        metadata.ishole              = global[3] != 0;
+
+        const std::size_t   nVertices = reader.count("vertices");
+        const double       *vertices  = reader.get<double>("vertices", 3, nVertices);
+        const std::int32_t *vertexMarkers  = reader.get<std::int32_t>("vertex_markers", 1, nVertices);
+        const std::uint8_t *vertexSelected = reader.get<std::uint8_t>("vertex_selected", 1, nVertices);
+        for (std::size_t i = 0; i < nVertices; ++i)
+        {
+            const double *ptr = &vertices[3*i];
+            mesh->insert<1>({static_cast<int>(i)},
+                            SMVertex(ptr[0], ptr[1], ptr[2],
+                                     vertexMarkers[i], vertexSelected[i] != 0));
+        }
+
+        const std::size_t   nFaces = reader.count("faces");
+        const std::int32_t *faces  = reader.get<std::int32_t>("faces", 3, nFaces);
+        const std::int32_t *faceMarkers  = reader.get<std::int32_t>("face_markers", 1, nFaces);
+        const std::uint8_t *faceSelected = reader.get<std::uint8_t>("face_selected", 1, nFaces);
+        checkIndices(faces, 3*nFaces, nVertices, "faces");
+        for (std::size_t i = 0; i < nFaces; ++i)
+        {
+            const std::int32_t *ptr = &faces[3*i];
+            mesh->insert<3>({ptr[0], ptr[1], ptr[2]},
+                            SMFace(windingOrientation(ptr, 3), faceMarkers[i], faceSelected[i] != 0));
+        }
+
+        const std::size_t   nSelectedEdges = reader.count("selected_edges");
+        const std::int32_t *selectedEdges  = reader.get<std::int32_t>("selected_edges", 2, nSelectedEdges);
+        checkIndices(selectedEdges, 2*nSelectedEdges, nVertices, "selected_edges");
+        for (std::size_t i = 0; i < nSelectedEdges; ++i)
+        {
+            auto edgeID = mesh->get_simplex_up({selectedEdges[2*i], selectedEdges[2*i+1]});
+            if (edgeID != nullptr)
+                (*edgeID).selected = true;
+        }
+
+        // Face orientations follow the stored winding. Only the edge
+        // orientations between levels need to be initialized.
+        casc::init_orientation(*mesh);
+
+        if (vertexFields)
+            reader.fields(nVertices, *vertexFields);
+        return mesh;
+    }
+    catch (const std::runtime_error &e)
+    {
+        std::stringstream ss;
+        ss << "readSnapshot: In file '" << filename << "': " << e.what();
+        throw std::runtime_error(ss.str());
+    }
+}
+
+void writeSnapshot(const std::string &filename,
+                   const TetMesh &mesh,
+                   const std::map<std::string, std::vector<REAL> > &vertexFields)
+{
+    SnapshotWriter writer;
+
+    const bool higher_order = (*mesh.get_simplex_up()).higher_order;
+    writer.add("global", 1, std::vector<double>{static_cast<double>(higher_order)});
+
+    const std::size_t nVertices = mesh.size<1>();
+    DenseIndex<TetMesh> sigma(mesh);
+    std::vector<double>       vertices;
+    std::vector<std::int32_t> vertexMarkers;
+    std::vector<std::uint8_t> vertexSelected;
+    std::vector<double>       vertexError;
+    vertices.reserve(3*nVertices);
+    vertexMarkers.reserve(nVertices);
+    vertexSelected.reserve(nVertices);
+    vertexError.reserve(nVertices);
+    for (const auto &vertex : mesh.get_level<1>())
+    {
+        vertices.insert(vertices.end(), {vertex[0], vertex[1], vertex[2]});
+        vertexMarkers.push_back(vertex.marker);
+        vertexSelected.push_back(vertex.selected);
+        vertexError.push_back(vertex.error);
+    }
+    writer.add("vertices", 3, std::move(vertices));
+    writer.add("vertex_markers", 1, std::move(vertexMarkers));
+    writer.add("vertex_selected", 1, std::move(vertexSelected));
+    writer.add("vertex_error", 1, std::move(vertexError));
+
+    if (higher_order)
+    {
+        std::vector<std::int32_t> edges;
+        std::vector<double>       edgePositions;
+        for (const auto edgeID : mesh.get_level_id<2>())
+        {
+            for (auto key : mesh.get_name(edgeID))
+                edges.push_back(static_cast<std::int32_t>(sigma[key]));
+            const auto &edge = *edgeID;
+            edgePositions.insert(edgePositions.end(), {edge[0], edge[1], edge[2]});
+        }
+        writer.add("edges", 2, std::move(edges));
+        writer.add("edge_positions", 3, std::move(edgePositions));
+    }
+
+    const std::size_t nFaces = mesh.size<3>();
+    std::vector<std::int32_t> faces;
+    std::vector<std::int32_t> faceMarkers;
+    std::vector<std::uint8_t> faceSelected;
+    faces.reserve(3*nFaces);
+    faceMarkers.reserve(nFaces);
+    faceSelected.reserve(nFaces);
+    for (const auto faceID : mesh.get_level_id<3>())
+    {
+        for (auto key : mesh.get_name(faceID))
+            faces.push_back(static_cast<std::int32_t>(sigma[key]));
+        faceMarkers.push_back((*faceID).marker);
+        faceSelected.push_back((*faceID).selected);
+    }
+    writer.add("faces", 3, std::move(faces));
+    writer.add("face_markers", 1, std::move(faceMarkers));
+    writer.add("face_selected", 1, std::move(faceSelected));
+
+    const std::size_t nCells = mesh.size<4>();
+    std::vector<std::int32_t> cells;
+    std::vector<std::int32_t> cellMarkers;
+    std::vector<std::uint8_t> cellSelected;
+    cells.reserve(4*nCells);
+    cellMarkers.reserve(nCells);
+    cellSelected.reserve(nCells);
+    for (const auto cellID : mesh.get_level_id<4>())
+    {
+        auto w = windingOrder(mesh, cellID, sigma);
+        cells.insert(cells.end(), w.begin(), w.end());
+        cellMarkers.push_back((*cellID).marker);
+        cellSelected.push_back((*cellID).selected);
+    }
+    writer.add("cells", 4, std::move(cells));
+    writer.add("cell_markers", 1, std::move(cellMarkers));
+    writer.add("cell_selected", 1, std::move(cellSelected));
+
+    addFields(writer, nVertices, vertexFields);
+    writer.write(filename, TET_MESH);
+}
+
+std::unique_ptr<TetMesh> readSnapshot_TetMesh(const std::string &filename,
+                                              std::map<std::string, std::vector<REAL> > *vertexFields)
+{
+    try
+    {
+        SnapshotReader reader(filename, TET_MESH);
+        std::unique_ptr<TetMesh> mesh(new TetMesh);
+
+        const double *global = reader.get<double>("global", 1, 1);
+        const bool higher_order = global[0] != 0;
+        (*mesh->get_simplex_up()).higher_order = higher_order;
+
+        const std::size_t   nVertices = reader.count("vertices");
+        const double       *vertices  = reader.get<double>("vertices", 3, nVertices);
+        const std::int32_t *vertexMarkers  = reader.get<std::int32_t>("vertex_markers", 1, nVertices);
+        const std::uint8_t *vertexSelected = reader.get<std::uint8_t>("vertex_selected", 1, nVertices);
+        const double       *vertexError    = reader.get<double>("vertex_error", 1, nVertices);
+        for (std::size_t i = 0; i < nVertices; ++i)
+        {
+            const double *ptr = &vertices[3*i];
+            TMVertex vertex(ptr[0], ptr[1], ptr[2], vertexMarkers[i], vertexSelected[i] != 0);
+            vertex.error = vertexError[i];
+            mesh->insert<1>({static_cast<int>(i)}, vertex);
+        }
+
+        const std::size_t   nCells = reader.count("cells");
+        const std::int32_t *cells  = reader.get<std::int32_t>("cells", 4, nCells);
+        const std::int32_t *cellMarkers  = reader.get<std::int32_t>("cell_markers", 1, nCells);
+        const std::uint8_t *cellSelected = reader.get<std::uint8_t>("cell_selected", 1, nCells);
+        checkIndices(cells, 4*nCells, nVertices, "cells");
+        for (std::size_t i = 0; i < nCells; ++i)
+        {
+            const std::int32_t *ptr = &cells[4*i];
+            mesh->insert<4>({ptr[0], ptr[1], ptr[2], ptr[3]},
+                            TMCell(windingOrientation(ptr, 4), cellMarkers[i], cellSelected[i] != 0));
+        }
+
+        const std::size_t   nFaces = reader.count("faces");
+        const std::int32_t *faces  = reader.get<std::int32_t>("faces", 3, nFaces);
+        const std::int32_t *faceMarkers  = reader.get<std::int32_t>("face_markers", 1, nFaces);
+        const std::uint8_t *faceSelected = reader.get<std::uint8_t>("face_selected", 1, nFaces);
+        checkIndices(faces, 3*nFaces, nVertices, "faces");
+        for (std::size_t i = 0; i < nFaces; ++i)
+        {
+            const std::int32_t *ptr = &faces[3*i];
+            auto faceID = mesh->get_simplex_up({ptr[0], ptr[1], ptr[2]});
+            if (faceID != nullptr)
+            {
+                (*faceID).marker   = faceMarkers[i];
+                (*faceID).selected = faceSelected[i] != 0;
+            }
+        }
+
+        if (higher_order)
+        {
+            const std::size_t   nEdges = reader.count("edges");
+            const std::int32_t *edges  = reader.get<std::int32_t>("edges", 2, nEdges);
+            const double       *edgePositions = reader.get<double>("edge_positions", 3, nEdges);
+            checkIndices(edges, 2*nEdges, nVertices, "edges");
+            for (std::size_t i = 0; i < nEdges; ++i)
+            {
+                auto edgeID = mesh->get_simplex_up({edges[2*i], edges[2*i+1]});
+                if (edgeID != nullptr)
+                {
+                    const double *ptr = &edgePositions[3*i];
+                    (*edgeID).position = Vector({static_cast<REAL>(ptr[0]),
+                                                 static_cast<REAL>(ptr[1]),
+                                                 static_cast<REAL>(ptr[2])});
+                }
+            }
+        }
+
+        // Cell orientations follow the stored winding. Only the edge
+        // orientations between levels need to be initialized.
+        casc::init_orientation(*mesh);
+
+        if (vertexFields)
+            reader.fields(nVertices, *vertexFields);
+        return mesh;
+    }
+    catch (const std::runtime_error &e)
+    {
+        std::stringstream ss;
+        ss << "readSnapshot: In file '" << filename << "': " << e.what();
+        throw std::runtime_error(ss.str());
+    }
+}
+} // end namespace gamer
@@ -28,17 +28,23 @@
 #include <algorithm>
 #include <cmath>
 #include <iomanip>
+#include <limits>
 #include <map>
 #include <ostream>
+#include <sstream>
 #include <stdexcept>
 #include <strstream>
+#include <tuple>
 #include <vector>
 #include <casc/casc>
 
 #include <Eigen/Dense>
 #include <Eigen/Eigenvalues>
 
+#include "gamer/BVH.h"
+#include "gamer/DenseIndex.h"
 #include "gamer/EigenDiagonalization.h"
+#include "gamer/KRingCache.h"
 #include "gamer/SurfaceMesh.h"
 #include "gamer/Vertex.h"
 
@@ -254,6 +260,213 @@ std::tuple<double, double, int, int> getMinMaxAngles(
     return std::make_tuple(minAngle, maxAngle, small, large);
 }
 
+/// @cond detail
+namespace
+{
+/**
+ * @brief      Merge two summaries which hold running sums
+ */
+void mergeQuality(SurfaceQualitySummary &lhs, const SurfaceQualitySummary &rhs)
+{
+    lhs.nFaces          += rhs.nFaces;
+    lhs.nEdges          += rhs.nEdges;
+    lhs.nVertices       += rhs.nVertices;
+    lhs.minAngle        = std::min(lhs.minAngle, rhs.minAngle);
+    lhs.maxAngle        = std::max(lhs.maxAngle, rhs.maxAngle);
+    lhs.nSmallAngles    += rhs.nSmallAngles;
+    lhs.nLargeAngles    += rhs.nLargeAngles;
+    lhs.minArea         = std::min(lhs.minArea, rhs.minArea);
+    lhs.maxArea         = std::max(lhs.maxArea, rhs.maxArea);
+    lhs.totalArea       += rhs.totalArea;
+    lhs.meanAspectRatio += rhs.meanAspectRatio;
+    lhs.maxAspectRatio  = std::max(lhs.maxAspectRatio, rhs.maxAspectRatio);
+    lhs.minEdgeLength   = std::min(lhs.minEdgeLength, rhs.minEdgeLength);
+    lhs.maxEdgeLength   = std::max(lhs.maxEdgeLength, rhs.maxEdgeLength);
+    lhs.meanEdgeLength  += rhs.meanEdgeLength;
+    lhs.minValence      = std::min(lhs.minValence, rhs.minValence);
+    lhs.maxValence      = std::max(lhs.maxValence, rhs.maxValence);
+}
+} // end anonymous namespace
+/// @endcond
+
+SurfaceQualityStats computeQualityStats(const SurfaceMesh& mesh,
+                                        REAL               smallAngle,
+                                        REAL               largeAngle,
+                                        std::size_t        nBins)
+{
+    if (nBins == 0)
+        throw std::runtime_error("computeQualityStats: The number of bins must be positive.");
+
+    std::vector<SurfaceMesh::SimplexID<1> > vertexIDs;
+    std::vector<SurfaceMesh::SimplexID<2> > edgeIDs;
+    std::vector<SurfaceMesh::SimplexID<3> > faceIDs;
+    vertexIDs.reserve(mesh.size<1>());
+    edgeIDs.reserve(mesh.size<2>());
+    faceIDs.reserve(mesh.size<3>());
+    for (auto vertexID : mesh.get_level_id<1>())
+        vertexIDs.push_back(vertexID);
+    for (auto edgeID : mesh.get_level_id<2>())
+        edgeIDs.push_back(edgeID);
+    for (auto faceID : mesh.get_level_id<3>())
+        faceIDs.push_back(faceID);
+    const long nVertices = vertexIDs.size();
+    const long nEdges    = edgeIDs.size();
+    const long nFaces    = faceIDs.size();
+
+    SurfaceQualityStats stats;
+    stats.area.resize(nFaces);
+    stats.minAngle.resize(nFaces);
+    stats.maxAngle.resize(nFaces);
+    stats.aspectRatio.resize(nFaces);
+    stats.edgeLength.resize(nEdges);
+    stats.valence.resize(nVertices);
+    stats.angleHistogram.assign(nBins, 0);
+
+    #pragma omp parallel
+    {
+        SurfaceQualitySummary    summary;
+        std::vector<std::size_t> angleHistogram(nBins, 0);
+        std::vector<std::size_t> valenceHistogram;
+
+        #pragma omp for schedule(static) nowait
+        for (long i = 0; i < nFaces; ++i)
+        {
+            auto name = faceIDs[i].indices();
+            std::array<Vector, 3> p;
+            for (std::size_t j = 0; j < 3; ++j)
+                p[j] = (*mesh.get_simplex_up({name[j]})).position;
+
+            REAL twiceArea = length(cross(p[1] - p[0], p[2] - p[0]));
+            REAL minAngle  = 180, maxAngle = 0, maxEdge = 0, perimeter = 0;
+            for (std::size_t j = 0; j < 3; ++j)
+            {
+                Vector u = p[(j+1)%3] - p[j];
+                Vector v = p[(j+2)%3] - p[j];
+                REAL angle = std::atan2(twiceArea, dot(u, v))*180/M_PI;
+                minAngle = std::min(minAngle, angle);
+                maxAngle = std::max(maxAngle, angle);
+                summary.nSmallAngles += angle < smallAngle;
+                summary.nLargeAngles += angle > largeAngle;
+                std::size_t bin = static_cast<std::size_t>(angle/180.0*nBins);
+                ++angleHistogram[std::min(bin, nBins-1)];
+
+                REAL len = length(u);
+                maxEdge    = std::max(maxEdge, len);
+                perimeter += len;
+            }
+            // Inradius is area over semiperimeter
+            REAL inradius = (perimeter > 0) ? twiceArea/perimeter : 0;
+            REAL aspect   = (inradius > 0) ? maxEdge/(2*std::sqrt(REAL(3))*inradius)
+                                           : std::numeric_limits<REAL>::infinity();
+
+            stats.area[i]        = twiceArea/2;
+            stats.minAngle[i]    = minAngle;
+            stats.maxAngle[i]    = maxAngle;
+            stats.aspectRatio[i] = aspect;
+
+            ++summary.nFaces;
+            summary.minAngle        = std::min(summary.minAngle, minAngle);
+            summary.maxAngle        = std::max(summary.maxAngle, maxAngle);
+            summary.minArea         = std::min(summary.minArea, twiceArea/2);
+            summary.maxArea         = std::max(summary.maxArea, twiceArea/2);
+            summary.totalArea      += twiceArea/2;
+            summary.meanAspectRatio += aspect;
+            summary.maxAspectRatio  = std::max(summary.maxAspectRatio, aspect);
+        }
+
+        #pragma omp for schedule(static) nowait
+        for (long i = 0; i < nEdges; ++i)
+        {
+            auto name = edgeIDs[i].indices();
+            REAL len  = length(*mesh.get_simplex_up({name[0]}) - *mesh.get_simplex_up({name[1]}));
+            stats.edgeLength[i] = len;
+
+            ++summary.nEdges;
+            summary.minEdgeLength   = std::min(summary.minEdgeLength, len);
+            summary.maxEdgeLength   = std::max(summary.maxEdgeLength, len);
+            summary.meanEdgeLength += len;
+        }
+
+        #pragma omp for schedule(static) nowait
+        for (long i = 0; i < nVertices; ++i)
+        {
+            std::size_t valence = getValence(mesh, vertexIDs[i]);
+            stats.valence[i] = valence;
+            if (valence >= valenceHistogram.size())
+                valenceHistogram.resize(valence + 1, 0);
+            ++valenceHistogram[valence];
+
+            ++summary.nVertices;
+            summary.minValence = std::min(summary.minValence, valence);
+            summary.maxValence = std::max(summary.maxValence, valence);
+        }
+
+        #pragma omp critical
+        {
+            mergeQuality(stats.summary, summary);
+            for (std::size_t b = 0; b < nBins; ++b)
+                stats.angleHistogram[b] += angleHistogram[b];
+            if (valenceHistogram.size() > stats.valenceHistogram.size())
+                stats.valenceHistogram.resize(valenceHistogram.size(), 0);
+            for (std::size_t v = 0; v < valenceHistogram.size(); ++v)
+                stats.valenceHistogram[v] += valenceHistogram[v];
+        }
+    }
+
+    if (nFaces > 0)
+        stats.summary.meanAspectRatio /= nFaces;
+    if (nEdges > 0)
+        stats.summary.meanEdgeLength /= nEdges;
+    return stats;
+}
+
+SurfaceQualitySummary computeAngleSummary(const SurfaceMesh& mesh,
+                                          REAL               smallAngle,
+                                          REAL               largeAngle)
+{
+    std::vector<SurfaceMesh::SimplexID<3> > faceIDs;
+    faceIDs.reserve(mesh.size<3>());
+    for (auto faceID : mesh.get_level_id<3>())
+        faceIDs.push_back(faceID);
+    const long nFaces = faceIDs.size();
+
+    SurfaceQualitySummary result;
+    #pragma omp parallel
+    {
+        SurfaceQualitySummary summary;
+
+        #pragma omp for schedule(static) nowait
+        for (long i = 0; i < nFaces; ++i)
+        {
+            auto name = faceIDs[i].indices();
+            std::array<Vector, 3> p;
+            for (std::size_t j = 0; j < 3; ++j)
+                p[j] = (*mesh.get_simplex_up({name[j]})).position;
+
+            REAL twiceArea = length(cross(p[1] - p[0], p[2] - p[0]));
+            for (std::size_t j = 0; j < 3; ++j)
+            {
+                Vector u = p[(j+1)%3] - p[j];
+                Vector v = p[(j+2)%3] - p[j];
+                REAL angle = std::atan2(twiceArea, dot(u, v))*180/M_PI;
+                summary.minAngle = std::min(summary.minAngle, angle);
+                summary.maxAngle = std::max(summary.maxAngle, angle);
+                summary.nSmallAngles += angle < smallAngle;
+                summary.nLargeAngles += angle > largeAngle;
+            }
+
+            ++summary.nFaces;
+            summary.minArea    = std::min(summary.minArea, twiceArea/2);
+            summary.maxArea    = std::max(summary.maxArea, twiceArea/2);
+            summary.totalArea += twiceArea/2;
+        }
+
+        #pragma omp critical
+        mergeQuality(result, summary);
+    }
+    return result;
+}
+
 double getArea(const SurfaceMesh& mesh)
 {
     double area = 0.0;
@@ -400,12 +613,181 @@ void centeralize(SurfaceMesh& mesh)
     translate(mesh, -center);
 }
 
-void normalSmooth(SurfaceMesh& mesh, double k)
+/// @cond detail
+namespace
 {
-    for (auto nid : mesh.get_level_id<1>())
+/**
+ * @brief      Rotate a point about the line through a point along a unit
+ *             axis (Rodrigues' formula)
+ */
+Vector rotateAbout(const Vector &p, const Vector &center, const Vector &axis, double angle)
+{
+    Vector d = p - center;
+    double c = std::cos(angle), s = std::sin(angle);
+    return center + c*d + s*cross(axis, d) + (1 - c)*dot(axis, d)*axis;
+}
+} // end anonymous namespace
+/// @endcond
+
+void normalSmooth(SurfaceMesh& mesh, double k, double relaxation)
+{
+    if (!(relaxation > 0 && relaxation <= 1))
+        throw std::runtime_error("normalSmooth: relaxation must be in (0, 1].");
+
+    // Same update as normalSmoothH but every vertex is computed from the
+    // positions before the pass (Jacobi iteration), so the result does not
+    // depend on the vertex order and vertices can be updated concurrently.
+    const std::size_t       nVertices = mesh.size<1>();
+    DenseIndex<SurfaceMesh> index(mesh);
+
+    std::vector<SurfaceMesh::SimplexID<1> > vertexIDs;
+    std::vector<Vector>                     positions;
+    vertexIDs.reserve(nVertices);
+    positions.reserve(nVertices);
+    for (const auto vertexID : mesh.get_level_id<1>())
+    {
+        vertexIDs.push_back(vertexID);
+        positions.push_back((*vertexID).position);
+    }
+
+    // Faces in winding order
+    std::vector<std::array<std::size_t, 3> > faces;
+    faces.reserve(mesh.size<3>());
+    for (const auto faceID : mesh.get_level_id<3>())
+    {
+        if ((*faceID).orientation == 0)
+            throw std::runtime_error("ERROR(normalSmooth): Orientation undefined, cannot compute normal. Did you call compute_orientation()?");
+        auto name = mesh.get_name(faceID);
+        std::array<std::size_t, 3> face = {{index[name[0]], index[name[1]], index[name[2]]}};
+        if ((*faceID).orientation == -1)
+            std::swap(face[0], face[2]);
+        faces.push_back(face);
+    }
+    const long nFaces = faces.size();
+
+    // Faces sharing an edge with each face
+    std::vector<std::array<std::size_t, 3> > edges(3*nFaces);
+    for (long f = 0; f < nFaces; ++f)
+    {
+        for (std::size_t j = 0; j < 3; ++j)
+        {
+            std::size_t u = faces[f][j], v = faces[f][(j+1)%3];
+            edges[3*f+j] = {{std::min(u, v), std::max(u, v), static_cast<std::size_t>(f)}};
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+    std::vector<std::vector<std::size_t> > faceNeighbours(nFaces);
+    for (std::size_t i = 0; i < edges.size(); )
+    {
+        std::size_t j = i;
+        while (j < edges.size() && edges[j][0] == edges[i][0] && edges[j][1] == edges[i][1])
+            ++j;
+        for (std::size_t a = i; a < j; ++a)
+        {
+            for (std::size_t b = i; b < j; ++b)
+            {
+                if (a != b)
+                    faceNeighbours[edges[a][2]].push_back(edges[b][2]);
+            }
+        }
+        i = j;
+    }
+
+    std::vector<Vector> normals(nFaces);
+    std::vector<double> areas(nFaces);
+    #pragma omp parallel for schedule(static)
+    for (long f = 0; f < nFaces; ++f)
+    {
+        const auto &face = faces[f];
+        Vector n = cross(positions[face[1]] - positions[face[0]],
+                         positions[face[2]] - positions[face[0]]);
+        double norm = std::sqrt(n|n);
+        areas[f]   = norm/2;
+        normals[f] = (norm > 0) ? n/norm : n;
+    }
+
+    // Rotation of each face toward the anisotropic average of the normals
+    // of its neighbours
+    std::vector<Vector> rotationAxes(nFaces);
+    std::vector<double> angles(nFaces, 0);
+    #pragma omp parallel for schedule(static)
+    for (long f = 0; f < nFaces; ++f)
+    {
+        const Vector &normal = normals[f];
+        Vector avgNorm;
+        double sumWeight = 0;
+        for (auto g : faceNeighbours[f])
+        {
+            double weight = std::exp(k*(normal|normals[g]));
+            avgNorm   += weight*normals[g];
+            sumWeight += weight;
+        }
+        if (sumWeight > 0)
+            avgNorm /= sumWeight;
+        Vector axis = cross(normal, avgNorm);
+        double norm = std::sqrt(axis|axis);
+        double angle = std::acos(normal|avgNorm);
+        // Catch for floating point dot product issues
+        if (norm > 0 && !std::isnan(angle))
+        {
+            rotationAxes[f] = axis/norm;
+            angles[f]       = angle;
+        }
+    }
+
+    // Vertices rotate about their opposite edge, weighted by face area
+    std::vector<std::size_t> start(nVertices + 1, 0);
+    for (const auto &face : faces)
     {
-        surfacemesh_detail::normalSmoothH(mesh, nid, k);
+        for (auto v : face)
+            ++start[v+1];
     }
+    for (std::size_t v = 0; v < nVertices; ++v)
+        start[v+1] += start[v];
+    std::vector<std::size_t> vertexFaces(start[nVertices]);
+    std::vector<std::size_t> fill(start.begin(), start.end() - 1);
+    for (long f = 0; f < nFaces; ++f)
+    {
+        for (auto v : faces[f])
+            vertexFaces[fill[v]++] = f;
+    }
+
+    std::vector<Vector> smoothed(positions);
+    #pragma omp parallel for schedule(static)
+    for (long v = 0; v < static_cast<long>(nVertices); ++v)
+    {
+        Vector newPos;
+        double areaSum = 0;
+        for (std::size_t i = start[v]; i < start[v+1]; ++i)
+        {
+            const std::size_t f = vertexFaces[i];
+            const auto &face = faces[f];
+            std::size_t j = (face[0] == static_cast<std::size_t>(v)) ? 0 : (face[1] == static_cast<std::size_t>(v)) ? 1 : 2;
+            const Vector &a = positions[face[(j+1)%3]];
+            const Vector &b = positions[face[(j+2)%3]];
+
+            // Only the component of the rotation about the edge moves the
+            // vertex, as in normalSmoothH
+            Vector ab = a - b;
+            double length = std::sqrt(ab|ab);
+            Vector rotated = positions[v];
+            if (length > 0)
+            {
+                ab /= length;
+                double angle = std::copysign(angles[f], dot(rotationAxes[f], ab));
+                rotated = rotateAbout(positions[v], b, ab, angle);
+            }
+            newPos  += areas[f]*rotated;
+            areaSum += areas[f];
+        }
+        // All corners of a face rotate toward the same normal at once, so
+        // the full step overshoots
+        if (areaSum > 0)
+            smoothed[v] = positions[v] + relaxation*(newPos/areaSum - positions[v]);
+    }
+
+    for (std::size_t v = 0; v < nVertices; ++v)
+        (*vertexIDs[v]).position = smoothed[v];
     double min, max;
     int nSmall, nLarge;
     std::tie(min, max, nSmall, nLarge) = getMinMaxAngles(mesh, 15, 150);
@@ -486,32 +868,32 @@ void smoothMesh(SurfaceMesh& mesh, int maxIter, bool preserveRidges, std::size_t
 {
     double maxMinAngle = 15;
     double minMaxAngle = 165;
-    double minAngle, maxAngle;
-    int nSmall, nLarge;
     int nIter = 1;
 
     if (verbose)
     {
-        std::tie(minAngle, maxAngle, nSmall, nLarge) = getMinMaxAngles(mesh, maxMinAngle, minMaxAngle);
-        std::cout << "Initial Quality: Min Angle = " << minAngle << ", "
-                  << "Max Angle = " << maxAngle << ", "
-                  << "# smaller-than-" << maxMinAngle << " = " << nSmall << ", "
-                  << "# larger-than-" << minMaxAngle << " = " << nLarge << std::endl;
+        auto quality = computeAngleSummary(mesh, maxMinAngle, minMaxAngle);
+        std::cout << "Initial Quality: Min Angle = " << quality.minAngle << ", "
+                  << "Max Angle = " << quality.maxAngle << ", "
+                  << "# smaller-than-" << maxMinAngle << " = " << quality.nSmallAngles << ", "
+                  << "# larger-than-" << minMaxAngle << " = " << quality.nLargeAngles << std::endl;
     }
 
     std::vector<std::pair<SurfaceMesh::SimplexID<1>, Vector>> delta;
 
-    // Cache normals before entering loop
+    // Cache normals and neighbourhoods before entering loop
     cacheNormals(mesh);
+    KRingCache cache(mesh, rings);
     for (int nIter = 1; nIter <= maxIter; ++nIter)
     {
+        cache.refresh();
         for (auto vertex : mesh.get_level_id<1>())
         {
             if ((*vertex).selected == true)
             {
                 // surfacemesh_detail::weightedVertexSmooth(mesh, vertex,
                 // rings);
-                delta.push_back(std::make_pair(vertex, surfacemesh_detail::weightedVertexSmoothCache(mesh, vertex, rings)));
+                delta.push_back(std::make_pair(vertex, surfacemesh_detail::weightedVertexSmoothCache(mesh, vertex, cache)));
             }
             //barycenterVertexSmooth(mesh, vertex);
         }
@@ -532,17 +914,18 @@ void smoothMesh(SurfaceMesh& mesh, int maxIter, bool preserveRidges, std::size_t
                                             std::back_inserter(edgesToFlip));
         for (auto edgeID : edgesToFlip)
         {
+            cache.invalidate(mesh.get_simplex_up({mesh.get_name(edgeID)[0]}));
             surfacemesh_detail::edgeFlipCache(mesh, edgeID);
         }
 
         if (verbose)
         {
-            std::tie(minAngle, maxAngle, nSmall, nLarge) = getMinMaxAngles(mesh, maxMinAngle, minMaxAngle);
+            auto quality = computeAngleSummary(mesh, maxMinAngle, minMaxAngle);
             std::cout << "Iteration " << nIter << ":" << std::endl;
-            std::cout << "Min Angle = " << minAngle << ", "
-                      << "Max Angle = " << maxAngle << ", "
-                      << "# smaller-than-" << maxMinAngle << " = " << nSmall << ", "
-                      << "# larger-than-" << minMaxAngle << " = " << nLarge << std::endl;
+            std::cout << "Min Angle = " << quality.minAngle << ", "
+                      << "Max Angle = " << quality.maxAngle << ", "
+                      << "# smaller-than-" << maxMinAngle << " = " << quality.nSmallAngles << ", "
+                      << "# larger-than-" << minMaxAngle << " = " << quality.nLargeAngles << std::endl;
         }
     }
 }
@@ -634,6 +1017,10 @@ void coarse(SurfaceMesh& mesh, double coarseRate, double flatRate, double denseW
     double sparsenessRatio = 1;
     double flatnessRatio   = 1;
 
+    // Neighbourhoods for the LST. The smoothing after each decimation keeps
+    // its fixed 2-ring.
+    KRingCache cache(mesh, rings);
+
     auto range = mesh.get_level_id<1>();
 
     for (auto vertexIDIT = range.begin(); vertexIDIT != range.end();)
@@ -669,7 +1056,7 @@ void coarse(SurfaceMesh& mesh, double coarseRate, double flatRate, double denseW
         // Curvature as coarsening criteria
         if (flatRate > 0)
         {
-            auto lst = surfacemesh_detail::computeLocalStructureTensor(mesh, vertexID, rings);
+            auto lst = surfacemesh_detail::computeLocalStructureTensor(mesh, vertexID, cache);
 
             EigenVector eigenvalues;
             EigenMatrix eigenvectors;
@@ -683,7 +1070,7 @@ void coarse(SurfaceMesh& mesh, double coarseRate, double flatRate, double denseW
         // Add vertex to delete list
         if (sparsenessRatio * flatnessRatio < coarseRate)
         {
-            surfacemesh_detail::decimateVertex(mesh, vertexID);
+            surfacemesh_detail::decimateVertex(mesh, vertexID, cache);
         }
     }
 }
@@ -702,6 +1089,7 @@ void coarse_dense(SurfaceMesh& mesh, REAL threshold, REAL weight, std::size_t ri
     avgLen /= static_cast<REAL>(mesh.size<2>());
 
     REAL sparsenessRatio = 1;
+    KRingCache cache(mesh, rings);
 
     auto range = mesh.get_level_id<1>();
     for (auto vertexIDIT = range.begin(); vertexIDIT != range.end();)
@@ -733,13 +1121,15 @@ void coarse_dense(SurfaceMesh& mesh, REAL threshold, REAL weight, std::size_t ri
         // Decimate if under the threshold
         if (sparsenessRatio < threshold)
         {
-            surfacemesh_detail::decimateVertex(mesh, vertexID, rings);
+            surfacemesh_detail::decimateVertex(mesh, vertexID, cache, rings);
         }
     }
 }
 
 void coarse_flat(SurfaceMesh& mesh, REAL threshold, REAL weight, std::size_t rings, bool verbose){
     REAL flatnessRatio = 1;
+    // Neighbourhoods for the LST; decimation smooths with a 2-ring
+    KRingCache cache(mesh, rings);
 
     auto range = mesh.get_level_id<1>();
     for (auto vertexIDIT = range.begin(); vertexIDIT != range.end();)
@@ -755,7 +1145,7 @@ void coarse_flat(SurfaceMesh& mesh, REAL threshold, REAL weight, std::size_t rin
         }
 
         // Curvature as coarsening criteria
-        auto lst = surfacemesh_detail::computeLocalStructureTensor(mesh, vertexID, rings);
+        auto lst = surfacemesh_detail::computeLocalStructureTensor(mesh, vertexID, cache);
 
         EigenVector eigenvalues;
         EigenMatrix eigenvectors;
@@ -768,7 +1158,7 @@ void coarse_flat(SurfaceMesh& mesh, REAL threshold, REAL weight, std::size_t rin
         // Add vertex to delete list
         if (flatnessRatio < threshold)
         {
-            surfacemesh_detail::decimateVertex(mesh, vertexID);
+            surfacemesh_detail::decimateVertex(mesh, vertexID, cache);
         }
     }
 }
@@ -809,6 +1199,265 @@ bool hasHole(const SurfaceMesh& mesh)
     return false;
 }
 
+/// @cond detail
+namespace
+{
+/**
+ * @brief      Test two faces for an intersection which is not explained by
+ *             shared vertices.
+ *
+ * Faces sharing an edge lie in different planes through the edge unless
+ * they fold onto each other. Faces sharing a single vertex overlap beyond
+ * it iff the edge opposite the shared vertex of one face meets the other
+ * face. Within a mesh corners are shared if they are the same vertex;
+ * between meshes if they are at the same position, so that surfaces which
+ * share an interface only intersect where they cross. Coincident faces of
+ * different meshes are part of such an interface and do not intersect.
+ *
+ * @param[in]  bvh1      The BVH of the first face
+ * @param[in]  f1        Index of the first face
+ * @param[in]  bvh2      The BVH of the second face
+ * @param[in]  f2        Index of the second face
+ * @param[in]  sameMesh  Whether both faces belong to the same mesh
+ */
+bool facesIntersect(const FaceBVH &bvh1, std::size_t f1,
+                    const FaceBVH &bvh2, std::size_t f2,
+                    bool sameMesh)
+{
+    auto A = bvh1.triangle(f1);
+    auto B = bvh2.triangle(f2);
+
+    std::size_t nShared = 0;
+    std::array<std::size_t, 3> sharedA, sharedB;
+    const auto &faceA = bvh1.face(f1);
+    const auto &faceB = bvh2.face(f2);
+    for (std::size_t i = 0; i < 3; ++i)
+    {
+        for (std::size_t j = 0; j < 3; ++j)
+        {
+            bool shared = sameMesh ? faceA[i] == faceB[j] : A[i] == B[j];
+            if (shared && nShared < 3)
+            {
+                sharedA[nShared] = i;
+                sharedB[nShared] = j;
+                ++nShared;
+                break;
+            }
+        }
+    }
+
+    if (nShared == 3)
+        return false;
+
+    if (nShared == 0)
+        return trianglesIntersect(A[0], A[1], A[2], B[0], B[1], B[2]);
+
+    if (nShared == 1)
+    {
+        const Vector &a1 = A[(sharedA[0]+1)%3], &a2 = A[(sharedA[0]+2)%3];
+        const Vector &b1 = B[(sharedB[0]+1)%3], &b2 = B[(sharedB[0]+2)%3];
+        return trianglesIntersect(a1, a2, a2, B[0], B[1], B[2])
+               || trianglesIntersect(b1, b2, b2, A[0], A[1], A[2]);
+    }
+
+    // Shared edge: the faces fold over each other when the planes through the
+    // edge and the opposite vertices coincide on the same side of the edge.
+    const Vector &p = A[sharedA[0]];
+    Vector edge     = A[sharedA[1]] - p;
+    Vector normalA  = cross(edge, A[3 - sharedA[0] - sharedA[1]] - p);
+    Vector normalB  = cross(edge, B[3 - sharedB[0] - sharedB[1]] - p);
+    REAL   cosine   = dot(normalA, normalB);
+    Vector sine     = cross(normalA, normalB);
+    REAL   tol      = std::sqrt(std::numeric_limits<REAL>::epsilon())*cosine;
+    return cosine > 0 && dot(sine, sine) <= tol*tol;
+}
+} // end anonymous namespace
+/// @endcond
+
+std::vector<FaceIntersection> findIntersections(const std::vector<SurfaceMesh*> &meshes,
+                                                bool select,
+                                                int  marker)
+{
+    std::vector<FaceBVH> bvhs;
+    bvhs.reserve(meshes.size());
+    for (const auto mesh : meshes)
+        bvhs.emplace_back(*mesh);
+    return findFaceIntersections(bvhs, select, marker);
+}
+
+std::vector<FaceIntersection> findFaceIntersections(const std::vector<FaceBVH> &bvhs,
+                                                    bool select,
+                                                    int  marker)
+{
+    const std::size_t nMeshes = bvhs.size();
+
+    // (first mesh, first face, second mesh, second face)
+    std::vector<std::array<std::size_t, 4> > pairs;
+    for (std::size_t i = 0; i < nMeshes; ++i)
+    {
+        const long nFaces = bvhs[i].size();
+        #pragma omp parallel
+        {
+            std::vector<std::array<std::size_t, 4> > local;
+
+            #pragma omp for schedule(dynamic, 256)
+            for (long f = 0; f < nFaces; ++f)
+            {
+                AABB box;
+                for (const auto &corner : bvhs[i].triangle(f))
+                    box.expand(corner);
+
+                for (std::size_t j = i; j < nMeshes; ++j)
+                {
+                    bvhs[j].forEachOverlap(box, [&](std::size_t g){
+                        if (j == i && g <= static_cast<std::size_t>(f))
+                            return;
+                        if (facesIntersect(bvhs[i], f, bvhs[j], g, i == j))
+                            local.push_back({{i, static_cast<std::size_t>(f), j, g}});
+                    });
+                }
+            }
+
+            #pragma omp critical
+            pairs.insert(pairs.end(), local.begin(), local.end());
+        }
+    }
+    std::sort(pairs.begin(), pairs.end());
+
+    std::vector<FaceIntersection> intersections;
+    intersections.reserve(pairs.size());
+    for (const auto &pair : pairs)
+    {
+        intersections.push_back(FaceIntersection{
+            pair[0], bvhs[pair[0]].faceID(pair[1]),
+            pair[2], bvhs[pair[2]].faceID(pair[3])});
+    }
+
+    if (select || marker != 0)
+    {
+        for (const auto &intersection : intersections)
+        {
+            for (auto faceID : {intersection.firstFace, intersection.secondFace})
+            {
+                if (select)
+                    (*faceID).selected = true;
+                if (marker != 0)
+                    (*faceID).marker = marker;
+            }
+        }
+    }
+    return intersections;
+}
+
+/// @cond detail
+namespace
+{
+/**
+ * @brief      Sample the faces of source and measure the distance to target
+ */
+DistanceStats distanceBetween(const FaceBVH &source,
+                              const FaceBVH &target,
+                              std::size_t    subdivisions,
+                              bool           deviations)
+{
+    if (target.size() == 0)
+        throw std::runtime_error("The target surface has no faces.");
+
+    const long nVertices = source.numVertices();
+    std::vector<REAL> vertexDistance(nVertices);
+    #pragma omp parallel for schedule(static)
+    for (long i = 0; i < nVertices; ++i)
+        vertexDistance[i] = std::sqrt(target.closestPoint(source.position(i)).squaredDistance);
+
+    const std::size_t n       = std::max<std::size_t>(subdivisions, 1);
+    const REAL        nPoints = (n+1)*(n+2)/2;
+    const long        nFaces  = source.size();
+
+    DistanceStats stats;
+    double        sumWeight = 0, sumDist = 0, sumDist2 = 0;
+    for (const auto d : vertexDistance)
+        stats.max = std::max(stats.max, d);
+
+    #pragma omp parallel
+    {
+        REAL   localMax = 0;
+        double localWeight = 0, localDist = 0, localDist2 = 0;
+
+        #pragma omp for schedule(dynamic, 256)
+        for (long f = 0; f < nFaces; ++f)
+        {
+            const auto &face = source.face(f);
+            auto        tri  = source.triangle(f);
+            Vector      nrm  = cross(tri[1] - tri[0], tri[2] - tri[0]);
+            REAL        w    = std::sqrt(dot(nrm, nrm))/2/nPoints;
+
+            for (std::size_t i = 0; i <= n; ++i)
+            {
+                for (std::size_t j = 0; i + j <= n; ++j)
+                {
+                    std::size_t k = n - i - j;
+                    REAL        d;
+                    if (k == n)
+                        d = vertexDistance[face[0]];
+                    else if (i == n)
+                        d = vertexDistance[face[1]];
+                    else if (j == n)
+                        d = vertexDistance[face[2]];
+                    else
+                    {
+                        Vector p = (static_cast<REAL>(k)*tri[0] + static_cast<REAL>(i)*tri[1]
+                                    + static_cast<REAL>(j)*tri[2])/static_cast<REAL>(n);
+                        d = std::sqrt(target.closestPoint(p).squaredDistance);
+                        localMax = std::max(localMax, d);
+                    }
+                    localWeight += w;
+                    localDist   += w*d;
+                    localDist2  += w*d*d;
+                }
+            }
+        }
+
+        #pragma omp critical
+        {
+            stats.max  = std::max(stats.max, localMax);
+            sumWeight += localWeight;
+            sumDist   += localDist;
+            sumDist2  += localDist2;
+        }
+    }
+
+    if (sumWeight > 0)
+    {
+        stats.mean = sumDist/sumWeight;
+        stats.rms  = std::sqrt(sumDist2/sumWeight);
+    }
+    if (deviations)
+        stats.deviations = std::move(vertexDistance);
+    return stats;
+}
+} // end anonymous namespace
+/// @endcond
+
+DistanceStats oneSidedDistance(const SurfaceMesh &from,
+                               const SurfaceMesh &to,
+                               std::size_t        subdivisions,
+                               bool               deviations)
+{
+    return distanceBetween(FaceBVH(from), FaceBVH(to), subdivisions, deviations);
+}
+
+SurfaceDistance surfaceDistance(const SurfaceMesh &a,
+                                const SurfaceMesh &b,
+                                std::size_t        subdivisions,
+                                bool               deviations)
+{
+    FaceBVH bvhA(a), bvhB(b);
+    SurfaceDistance distance;
+    distance.forward  = distanceBetween(bvhA, bvhB, subdivisions, deviations);
+    distance.backward = distanceBetween(bvhB, bvhA, subdivisions, deviations);
+    return distance;
+}
+
 std::unique_ptr<SurfaceMesh> sphere(int order)
 {
     std::unique_ptr<SurfaceMesh> mesh(new SurfaceMesh);
@@ -996,63 +1645,393 @@ std::unique_ptr<SurfaceMesh> cube(int order)
     return mesh;
 }
 
-std::vector<std::unique_ptr<SurfaceMesh>> splitSurfaces(SurfaceMesh& mesh)
+std::unique_ptr<SurfaceMesh> surfaceMeshFromArrays(std::size_t nVertices,
+                                                   const REAL *vertices,
+                                                   const int *vertexMarkers,
+                                                   std::size_t nFaces,
+                                                   const int *faces,
+                                                   const int *faceMarkers,
+                                                   int firstKey)
 {
-    // Queue to store the next edges to visit
-    std::deque<SurfaceMesh::SimplexID<2>>     frontier;
-    // Set of visited edges
-    std::set<SurfaceMesh::SimplexID<2>>       visited;
+    std::unique_ptr<SurfaceMesh> mesh(new SurfaceMesh);
 
-    std::vector<std::unique_ptr<SurfaceMesh>> meshes;
+    for (std::size_t i = 0; i < nVertices; ++i)
+    {
+        const REAL *ptr = &vertices[3*i];
+        int marker = (vertexMarkers) ? vertexMarkers[i] : -1;
+        mesh->insert<1>({static_cast<int>(i) + firstKey},
+                        SMVertex(ptr[0], ptr[1], ptr[2], marker, false));
+    }
 
-    using SimplexSet = typename casc::SimplexSet<SurfaceMesh>;
-    SimplexSet surface;
+    for (std::size_t i = 0; i < nFaces; ++i)
+    {
+        const int *ptr = &faces[3*i];
+        for (std::size_t j = 0; j < 3; ++j)
+        {
+            if (ptr[j] < 0 || static_cast<std::size_t>(ptr[j]) >= nVertices)
+            {
+                std::stringstream ss;
+                ss << "surfaceMeshFromArrays: Face " << i << " references vertex "
+                   << ptr[j] << " which is out of range.";
+                throw std::runtime_error(ss.str());
+            }
+        }
+        if (ptr[0] == ptr[1] || ptr[0] == ptr[2] || ptr[1] == ptr[2])
+        {
+            std::stringstream ss;
+            ss << "surfaceMeshFromArrays: Face " << i << " {" << ptr[0] << ","
+               << ptr[1] << "," << ptr[2] << "} repeats a vertex.";
+            throw std::runtime_error(ss.str());
+        }
+        // The face is stored with sorted keys. An even permutation of the
+        // sorted keys has the same winding.
+        int inversions = (ptr[0] > ptr[1]) + (ptr[0] > ptr[2]) + (ptr[1] > ptr[2]);
+        int orientation = (inversions % 2 == 0) ? 1 : -1;
+        int marker = (faceMarkers) ? faceMarkers[i] : -1;
+        mesh->insert<3>({ptr[0] + firstKey, ptr[1] + firstKey, ptr[2] + firstKey},
+                        SMFace(orientation, marker, false));
+    }
+    // Keep the given orientations while checking for consistency
+    bool orientable;
+    casc::init_orientation(*mesh);
+    std::tie(std::ignore, orientable, std::ignore) = casc::check_orientation(*mesh);
+    if (!orientable)
+    {
+        // Reorient each component from scratch as the readers used to
+        std::tie(std::ignore, orientable, std::ignore) = casc::compute_orientation(*mesh);
+        std::cerr << "WARNING(surfaceMeshFromArrays): "
+                  << (orientable ? "Faces with inconsistent windings were reoriented."
+                                 : "The surface is not orientable.")
+                  << std::endl;
+    }
+    return mesh;
+}
 
-    int connected_components = 0;
-    for (auto edgeID : mesh.get_level_id<2>())
+/// @cond detail
+namespace
+{
+/**
+ * @brief      Disjoint sets which track the parity of each element relative
+ *             to the representative of its set.
+ *
+ * Used to group faces into components while solving for the flips which
+ * give every face of a component a consistent orientation.
+ */
+class ParityUnionFind
+{
+public:
+    explicit ParityUnionFind(std::size_t n) : parent(n), rank(n, 0), parity(n, 0)
+    {
+        for (std::size_t i = 0; i < n; ++i)
+            parent[i] = i;
+    }
+
+    std::size_t find(std::size_t x)
+    {
+        if (parent[x] != x)
+        {
+            std::size_t p = parent[x];
+            parent[x] = find(p);
+            parity[x] ^= parity[p];
+        }
+        return parent[x];
+    }
+
+    /// Parity of x relative to its representative
+    bool odd(std::size_t x)
+    {
+        find(x);
+        return parity[x];
+    }
+
+    /**
+     * @brief      Merge the sets of a and b
+     *
+     * @param[in]  a     First element
+     * @param[in]  b     Second element
+     * @param[in]  odd   Whether a and b must have different parity
+     *
+     * @return     False if the requested parity contradicts earlier merges
+     */
+    bool unite(std::size_t a, std::size_t b, bool odd)
+    {
+        std::size_t ra = find(a), rb = find(b);
+        bool parityAB = parity[a] ^ parity[b] ^ odd;
+        if (ra == rb)
+            return !parityAB;
+        if (rank[ra] < rank[rb])
+            std::swap(ra, rb);
+        parent[rb] = ra;
+        parity[rb] = parityAB;
+        if (rank[ra] == rank[rb])
+            ++rank[ra];
+        return true;
+    }
+
+private:
+    std::vector<std::size_t>   parent;
+    std::vector<unsigned char> rank;
+    std::vector<unsigned char> parity;
+};
+
+/**
+ * @brief      Edge of a face, stored with sorted dense vertex indices
+ */
+struct FaceEdge
+{
+    std::size_t u, v;       // u < v
+    std::size_t face;
+    bool        forward;    // The face winding runs from u to v
+
+    bool operator<(const FaceEdge& rhs) const
+    {
+        return std::tie(u, v, face) < std::tie(rhs.u, rhs.v, rhs.face);
+    }
+};
+
+/**
+ * @brief      Face components of a mesh and how to orient them
+ */
+struct TopologyData
+{
+    SurfaceTopology                        topology;
+    std::vector<std::array<std::size_t, 3> > faces;  // Consistent windings
+    std::vector<SurfaceMesh::SimplexID<3> > faceIDs;
+    std::vector<SurfaceMesh::SimplexID<1> > vertexIDs;
+    std::vector<std::size_t>               order;  // Faces grouped by component
+    std::vector<std::size_t>               start;  // Offset of each component in order
+};
+
+/**
+ * @brief      Label the edge connected components of the faces and
+ *             summarize their topology in a near linear pass.
+ */
+TopologyData analyzeFaces(const SurfaceMesh& mesh)
+{
+    TopologyData data;
+    auto& topology = data.topology;
+
+    DenseIndex<SurfaceMesh> sigma(mesh);
+    const std::size_t nVertices = mesh.size<1>();
+    const std::size_t nFaces    = mesh.size<3>();
+
+    data.vertexIDs.reserve(nVertices);
+    for (const auto vertexID : mesh.get_level_id<1>())
+        data.vertexIDs.push_back(vertexID);
+
+    // Windings of each face as stored
+    data.faceIDs.reserve(nFaces);
+    data.faces.reserve(nFaces);
+    std::vector<FaceEdge> edges;
+    edges.reserve(3*nFaces);
+    for (const auto faceID : mesh.get_level_id<3>())
+    {
+        auto name = mesh.get_name(faceID);
+        std::array<std::size_t, 3> w = {sigma[name[0]], sigma[name[1]], sigma[name[2]]};
+        if ((*faceID).orientation == -1)
+            std::swap(w[0], w[2]);
+        const std::size_t f = data.faceIDs.size();
+        for (std::size_t i = 0; i < 3; ++i)
+        {
+            std::size_t a = w[i], b = w[(i+1)%3];
+            edges.push_back(FaceEdge{std::min(a, b), std::max(a, b), f, a < b});
+        }
+        data.faceIDs.push_back(faceID);
+        data.faces.push_back(w);
+    }
+    std::sort(edges.begin(), edges.end());
+
+    // Faces sharing an edge belong together. Two faces sharing a manifold
+    // edge are consistently oriented if they traverse it in opposite
+    // directions.
+    ParityUnionFind faceSets(nFaces);
+    std::vector<unsigned char> nonOrientable(nFaces, false);
+    std::vector<unsigned char> nonManifold(nFaces, false);
+    std::vector<const FaceEdge*> boundaryEdges;
+    for (std::size_t i = 0, j; i < edges.size(); i = j)
     {
-        // This is a new edge if we haven't visited before
-        if (visited.find(edgeID) == visited.end())
+        j = i + 1;
+        while (j < edges.size() && edges[j].u == edges[i].u && edges[j].v == edges[i].v)
+            ++j;
+        if (j - i == 1)
+        {
+            boundaryEdges.push_back(&edges[i]);
+        }
+        else if (j - i == 2)
+        {
+            bool odd = edges[i].forward == edges[i+1].forward;
+            if (!faceSets.unite(edges[i].face, edges[i+1].face, odd))
+                nonOrientable[edges[i].face] = true;
+        }
+        else
         {
-            ++connected_components;
-            frontier.push_back(edgeID);
-            surface.insert(edgeID);
+            // Orient the fan of faces relative to the first one
+            for (std::size_t k = i + 1; k < j; ++k)
+                faceSets.unite(edges[i].face, edges[k].face,
+                               edges[i].forward == edges[k].forward);
+            nonManifold[edges[i].face] = true;
+        }
+    }
 
-            // Traverse across connected edges.
-            while (!frontier.empty())
+    // Label components in order of their first face
+    std::vector<std::size_t> rootLabel(nFaces, nFaces);
+    topology.faceComponent.resize(nFaces);
+    for (std::size_t f = 0; f < nFaces; ++f)
+    {
+        std::size_t root = faceSets.find(f);
+        if (rootLabel[root] == nFaces)
+        {
+            rootLabel[root] = topology.components.size();
+            topology.components.push_back(SurfaceComponent());
+        }
+        topology.faceComponent[f] = rootLabel[root];
+    }
+    for (std::size_t f = 0; f < nFaces; ++f)
+    {
+        auto& component = topology.components[topology.faceComponent[f]];
+        ++component.nFaces;
+        if (nonOrientable[f])
+            component.orientable = false;
+        if (nonManifold[f])
+            component.manifold = false;
+        if (faceSets.odd(f))
+            std::swap(data.faces[f][0], data.faces[f][2]);
+    }
+
+    // Bucket the faces by component
+    const std::size_t nComponents = topology.components.size();
+    data.start.assign(nComponents + 1, 0);
+    for (auto c : topology.faceComponent)
+        ++data.start[c + 1];
+    for (std::size_t c = 0; c < nComponents; ++c)
+        data.start[c + 1] += data.start[c];
+    data.order.resize(nFaces);
+    {
+        std::vector<std::size_t> next(data.start.begin(), data.start.end() - 1);
+        for (std::size_t f = 0; f < nFaces; ++f)
+            data.order[next[topology.faceComponent[f]]++] = f;
+    }
+
+    // Count the distinct edges and vertices of each component
+    for (std::size_t i = 0; i < edges.size(); ++i)
+    {
+        if (i == 0 || edges[i].u != edges[i-1].u || edges[i].v != edges[i-1].v)
+            ++topology.components[topology.faceComponent[edges[i].face]].nEdges;
+    }
+    std::vector<std::size_t> stamp(nVertices, nFaces);
+    for (std::size_t c = 0; c < nComponents; ++c)
+    {
+        for (std::size_t i = data.start[c]; i < data.start[c + 1]; ++i)
+        {
+            for (auto v : data.faces[data.order[i]])
             {
-                SurfaceMesh::SimplexID<2> curr = frontier.front();
-                if (visited.find(curr) == visited.end())
+                if (stamp[v] != c)
                 {
-                    visited.insert(curr);
-                    surface.insert(curr);
-                    neighbors_up(mesh, curr, std::back_inserter(frontier));
+                    stamp[v] = c;
+                    ++topology.components[c].nVertices;
                 }
-                frontier.pop_front();
             }
+        }
+    }
 
-            // Extract out the surface
-            SimplexSet tmp;
-            casc::getClosure(mesh, surface, tmp);
-            surface.clear();
-            casc::getStar(mesh, tmp, surface);
+    // Boundary loops are the connected sets of boundary edges
+    ParityUnionFind loops(nVertices);
+    for (const auto edge : boundaryEdges)
+        loops.unite(edge->u, edge->v, false);
+    std::fill(stamp.begin(), stamp.end(), nFaces);
+    for (const auto edge : boundaryEdges)
+    {
+        std::size_t root = loops.find(edge->u);
+        if (stamp[root] == nFaces)
+        {
+            stamp[root] = 0;
+            ++topology.components[topology.faceComponent[edge->face]].nBoundaryLoops;
+        }
+    }
+    return data;
+}
+} // end anonymous namespace
+/// @endcond
 
-            std::unique_ptr<SurfaceMesh> newSMPtr(new SurfaceMesh);
-            auto& newSM = *newSMPtr;
+SurfaceTopology analyzeTopology(const SurfaceMesh& mesh)
+{
+    return analyzeFaces(mesh).topology;
+}
+
+std::vector<std::unique_ptr<SurfaceMesh>> splitSurfaces(SurfaceMesh& mesh)
+{
+    TopologyData data = analyzeFaces(mesh);
+    const auto& topology = data.topology;
+    const std::size_t nComponents = topology.components.size();
 
-            util::int_for_each<std::size_t, typename SimplexSet::cLevelIndex>(surfacemesh_detail::CopyHelper<SurfaceMesh>(), mesh, newSM, surface);
+    const auto& start = data.start;
+    const auto& order = data.order;
 
-            compute_orientation(newSM);
-            if (getVolume(newSM) < 0)
+    const auto& global = *mesh.get_simplex_up();
+    std::vector<int> localIndex(data.vertexIDs.size(), -1);
+    std::vector<std::size_t> localVertices;
+    std::vector<REAL> vertices;
+    std::vector<int>  faces, faceMarkers;
+
+    std::vector<std::unique_ptr<SurfaceMesh>> meshes;
+    meshes.reserve(nComponents);
+    for (std::size_t c = 0; c < nComponents; ++c)
+    {
+        localVertices.clear();
+        vertices.clear();
+        faces.clear();
+        faceMarkers.clear();
+        for (std::size_t i = start[c]; i < start[c + 1]; ++i)
+        {
+            const std::size_t f = order[i];
+            for (auto v : data.faces[f])
             {
-                flipNormals(newSM);
+                if (localIndex[v] < 0)
+                {
+                    localIndex[v] = localVertices.size();
+                    localVertices.push_back(v);
+                    const auto& position = (*data.vertexIDs[v]).position;
+                    vertices.insert(vertices.end(), {position[0], position[1], position[2]});
+                }
+                faces.push_back(localIndex[v]);
             }
+            faceMarkers.push_back((*data.faceIDs[f]).marker);
+        }
 
-            meshes.push_back(std::move(newSMPtr));
-            surface.clear();
+        auto newSMPtr = surfaceMeshFromArrays(localVertices.size(), vertices.data(), nullptr,
+                                              faceMarkers.size(), faces.data(), faceMarkers.data());
+        auto& newSM = *newSMPtr;
+        *newSM.get_simplex_up() = global;
+
+        // Carry over the remaining vertex, edge, and face data
+        for (std::size_t i = 0; i < localVertices.size(); ++i)
+            *newSM.get_simplex_up({static_cast<int>(i)}) = *data.vertexIDs[localVertices[i]];
+        for (auto edgeID : newSM.get_level_id<2>())
+        {
+            auto name = newSM.get_name(edgeID);
+            *edgeID = *mesh.get_simplex_up({data.vertexIDs[localVertices[name[0]]].indices()[0],
+                                            data.vertexIDs[localVertices[name[1]]].indices()[0]});
+        }
+        for (std::size_t i = start[c]; i < start[c + 1]; ++i)
+        {
+            const std::size_t f = order[i];
+            const int *w = &faces[3*(i - start[c])];
+            auto& properties = static_cast<SMFaceProperties&>(*newSM.get_simplex_up({w[0], w[1], w[2]}));
+            properties = *data.faceIDs[f];
         }
-    }
 
+        for (auto v : localVertices)
+            localIndex[v] = -1;
+
+        const auto& component = topology.components[c];
+        if (!component.orientable || !component.manifold)
+            casc::compute_orientation(newSM);
+        if (getVolume(newSM) < 0)
+        {
+            flipNormals(newSM);
+        }
+        meshes.push_back(std::move(newSMPtr));
+    }
     return meshes;
 }
 
@@ -1075,97 +2054,39 @@ void cacheNormals(SurfaceMesh& mesh){
     }
 }
 
-// http://pub.ist.ac.at/~edels/Papers/1995-J-03-IncrementalBettiNumbers.pdf
 std::tuple<bool, int, int, int> getBettiNumbers(SurfaceMesh& mesh){
-    bool valid = true;
-    int connected_components = mesh.size<1>();
-    int holes = 0;
-    int voids = 0;
+    const SurfaceTopology topology = analyzeTopology(mesh);
 
-    std::deque<SurfaceMesh::SimplexID<2>> frontier_edges;
-    std::set<SurfaceMesh::SimplexID<2>> visited_edges;
-    std::set<SurfaceMesh::SimplexID<3>> faces;
-
-    std::set<SurfaceMesh::KeyType> visited_verts;
-    SurfaceMesh::SimplexID<2> curr;
-
-    for (auto eid : mesh.get_level_id<2>())
+    // Vertex connected components, including vertices and edges without
+    // faces.
+    DenseIndex<SurfaceMesh> sigma(mesh);
+    ParityUnionFind vertexSets(mesh.size<1>());
+    int connected_components = mesh.size<1>();
+    for (auto edgeID : mesh.get_level_id<2>())
     {
-        if (visited_edges.find(eid) == visited_edges.end())
+        auto name = edgeID.indices();
+        std::size_t a = sigma[name[0]], b = sigma[name[1]];
+        if (vertexSets.find(a) != vertexSets.find(b))
         {
-            // Does this surface have a boundary edgee?
-            bool hasboundary = false;
-            // Does this surface have consistent normals?
-            bool orientable = true;
-            // Is this surface have weird 3+ face intersections?
-            bool pseudo_manifold = true;
-            frontier_edges.push_back(eid);
-
-            while (!frontier_edges.empty())
-            {
-                curr = frontier_edges.front();
-                if (visited_edges.find(curr) == visited_edges.end())
-                {
-                    std::array<SurfaceMesh::KeyType, 2> n = curr.indices();
-                    if (visited_verts.find(n[0]) == visited_verts.end()) {
-                        // Have never visited n[0]
-                        visited_verts.insert(n[0]);
-                        --connected_components;
-
-                        if (visited_verts.find(n[1]) == visited_verts.end()) {
-                            // Both vertices unvisited
-                            visited_verts.insert(n[1]);
-                        }
-                    }
-                    else{
-                        if (visited_verts.find(n[1]) == visited_verts.end()) {
-                            visited_verts.insert(n[1]);
-                            --connected_components;
-                        } else {
-                            //found a closed cycle
-                            ++holes;
-                        }
-                    }
-                    visited_edges.insert(curr);
-                    // If on a boundary stop otherwise add neighboring edges to
-                    // the queue
-                    auto w = mesh.get_cover(curr);
-                    if (w.size() <= 1) {hasboundary = true;
-                    }
-                    else if (w.size() == 2)
-                    {
-                        neighbors_up(mesh, curr, std::back_inserter(frontier_edges));
-                    }
-                    else {
-                        pseudo_manifold = false;
-                        valid = false;
-                    }
-                    neighbors_up(mesh, curr, std::back_inserter(frontier_edges));
-                    for(auto n : w ){
-                        auto fid = curr.get_simplex_up(n);
-                        faces.insert(fid);
-                    }
-                }
-                frontier_edges.pop_front();
-            }
-
-            int sz = faces.size();
-            if (pseudo_manifold){
-                if (orientable && !hasboundary){
-                    // Local space should be a sphere
-                    ++voids;
-                    --sz;
-                }
-                holes -= sz;
-            } else{
-                // TODO: Implement better detection of faces which complete 2-cycles s.t. this can be complete.
-            }
-            faces.clear();
+            vertexSets.unite(a, b, false);
+            --connected_components;
         }
     }
 
-    visited_edges.clear();
-    visited_verts.clear();
+    // Each closed orientable surface encloses a void
+    bool valid = true;
+    int voids = 0;
+    for (const auto& component : topology.components)
+    {
+        valid = valid && component.manifold;
+        if (component.manifold && component.orientable && component.nBoundaryLoops == 0)
+            ++voids;
+    }
+
+    // Euler-Poincare: V - E + F = b0 - b1 + b2
+    int euler = static_cast<int>(mesh.size<1>()) - static_cast<int>(mesh.size<2>())
+                + static_cast<int>(mesh.size<3>());
+    int holes = connected_components + voids - euler;
 
     return std::make_tuple(valid, connected_components, holes, voids);
 }
@@ -36,6 +36,7 @@
 #include <Eigen/Eigenvalues>
 
 #include "gamer/EigenDiagonalization.h"
+#include "gamer/KRingCache.h"
 #include "gamer/SurfaceMesh.h"
 #include "gamer/Vertex.h"
 
@@ -44,14 +45,15 @@ namespace gamer
 {
 namespace surfacemesh_detail
 {
-tensor<double, 3, 2> computeLocalStructureTensor(const SurfaceMesh              &mesh,
-                                                 const SurfaceMesh::SimplexID<1> vertexID,
-                                                 const int                       rings)
+namespace
+{
+/**
+ * @brief      Sum the tensor products of the normalized vertex normals over a
+ *             neighbourhood
+ */
+template <typename Neighbours>
+tensor<double, 3, 2> structureTensor(const SurfaceMesh &mesh, const Neighbours &nbors)
 {
-    // Set of neighbors
-    std::set<SurfaceMesh::SimplexID<1> > nbors;
-    // Get list of neighbors
-    casc::kneighbors_up(mesh, vertexID, rings, nbors);
     // local structure tensor
     tensor<double, 3, 2> lst = tensor<double, 3, 2>();
     for (SurfaceMesh::SimplexID<1> nid : nbors)
@@ -65,16 +67,43 @@ tensor<double, 3, 2> computeLocalStructureTensor(const SurfaceMesh
         norm /= mag;               // normalize
         lst  += norm*norm;         // tensor product
     }
+    return lst;
+}
 
-    // Print the LST nicely
-    // std::cout << "LST:\n" << std::endl;
-    // for(int i = 0; i < 3; ++i){
-    //     for(int j = 0; j < 3; ++j)
-    //         std::cout << lst.get(i,j) << " ";
-    //     std::cout << "\n";
-    // }
+/**
+ * @brief      Sum the tensor products of the cached vertex normals over a
+ *             neighbourhood
+ */
+template <typename Neighbours>
+tensor<double, 3, 2> cachedStructureTensor(const Neighbours &nbors)
+{
+    tensor<double, 3, 2> lst = tensor<double, 3, 2>();
+    for (SurfaceMesh::SimplexID<1> vID : nbors)
+    {
+        auto norm = (*vID).normal;           // Get Vector normal
+        lst  += norm*norm;         // tensor product
+    }
     return lst;
 }
+} // end anonymous namespace
+
+tensor<double, 3, 2> computeLocalStructureTensor(const SurfaceMesh              &mesh,
+                                                 const SurfaceMesh::SimplexID<1> vertexID,
+                                                 const int                       rings)
+{
+    // Set of neighbors
+    std::set<SurfaceMesh::SimplexID<1> > nbors;
+    // Get list of neighbors
+    casc::kneighbors_up(mesh, vertexID, rings, nbors);
+    return structureTensor(mesh, nbors);
+}
+
+tensor<double, 3, 2> computeLocalStructureTensor(const SurfaceMesh              &mesh,
+                                                 const SurfaceMesh::SimplexID<1> vertexID,
+                                                 KRingCache                     &cache)
+{
+    return structureTensor(mesh, cache[vertexID]);
+}
 
 tensor<double, 3, 2> computeLSTFromCache(const SurfaceMesh              &mesh,
                                                  const SurfaceMesh::SimplexID<1> vertexID,
@@ -84,17 +113,24 @@ tensor<double, 3, 2> computeLSTFromCache(const SurfaceMesh              &mesh,
     std::set<SurfaceMesh::SimplexID<1> > nbors;
     // Get list of neighbors
     casc::kneighbors_up(mesh, vertexID, rings, nbors);
-    // local structure tensor
-    tensor<double, 3, 2> lst = tensor<double, 3, 2>();
-    for (SurfaceMesh::SimplexID<1> vID : nbors)
-    {
-        auto norm = (*vID).normal;           // Get Vector normal
-        lst  += norm*norm;         // tensor product
-    }
-    return lst;
+    return cachedStructureTensor(nbors);
 }
 
-void decimateVertex(SurfaceMesh &mesh, SurfaceMesh::SimplexID<1> vertexID, std::size_t rings)
+tensor<double, 3, 2> computeLSTFromCache(const SurfaceMesh              &mesh,
+                                         const SurfaceMesh::SimplexID<1> vertexID,
+                                         KRingCache                     &cache)
+{
+    return cachedStructureTensor(cache[vertexID]);
+}
+
+namespace
+{
+/**
+ * @brief      Remove a vertex, triangulate the hole and smooth the vertices
+ *             around it with the given smoothing operator
+ */
+template <typename Smooth>
+void removeAndFill(SurfaceMesh &mesh, SurfaceMesh::SimplexID<1> vertexID, Smooth &&smooth)
 {
     // TODO: (10) Come up with a better scheme
     // Pick an arbitrary face's data
@@ -173,9 +209,28 @@ void decimateVertex(SurfaceMesh &mesh, SurfaceMesh::SimplexID<1> vertexID, std::
     // Smooth vertices around the filled hole
     for (auto v : backupBoundary)
     {
-        weightedVertexSmooth(mesh, v, rings);
+        smooth(v);
     }
 }
+} // end anonymous namespace
+
+void decimateVertex(SurfaceMesh &mesh, SurfaceMesh::SimplexID<1> vertexID, std::size_t rings)
+{
+    removeAndFill(mesh, vertexID, [&](SurfaceMesh::SimplexID<1> v){
+        weightedVertexSmooth(mesh, v, rings);
+    });
+}
+
+void decimateVertex(SurfaceMesh &mesh, SurfaceMesh::SimplexID<1> vertexID, KRingCache &cache, std::size_t rings)
+{
+    cache.invalidate(vertexID);
+    removeAndFill(mesh, vertexID, [&](SurfaceMesh::SimplexID<1> v){
+        if (cache.rings() == rings)
+            weightedVertexSmooth(mesh, v, cache);
+        else
+            weightedVertexSmooth(mesh, v, rings);
+    });
+}
 
 void triangulateHoleHelper(SurfaceMesh                                                        &mesh,
                            std::vector<SurfaceMesh::SimplexID<1> >                            &boundary,
@@ -352,9 +407,16 @@ bool computeLocalOrientation(SurfaceMesh                                   &mesh
     return orientable;
 }
 
-void weightedVertexSmooth(SurfaceMesh              &mesh,
-                          SurfaceMesh::SimplexID<1> vertexID,
-                          int                       rings)
+namespace
+{
+/**
+ * @brief      Move a vertex according to Section 2.2.2 of GAMer paper, with
+ *             the LST supplied by lstOf.
+ */
+template <typename LST>
+void weightedVertexSmoothImpl(SurfaceMesh              &mesh,
+                              SurfaceMesh::SimplexID<1> vertexID,
+                              LST                     &&lstOf)
 {
     auto   centerName = mesh.get_name(vertexID)[0];
     auto  &center = *vertexID; // get the vertex data
@@ -448,7 +510,7 @@ void weightedVertexSmooth(SurfaceMesh              &mesh,
      * \bar{x} = x + \sum_{k=1}^3 \frac{1}{1+\lambda_k}((\bar{x} - x)\cdot
      * \vec{e_k})\vec{e_k}
      */
-    auto lst = surfacemesh_detail::computeLocalStructureTensor(mesh, vertexID, rings);
+    auto lst = lstOf();
 
     EigenVector eigenvalues;
     EigenMatrix eigenvectors;
@@ -475,7 +537,8 @@ void weightedVertexSmooth(SurfaceMesh              &mesh,
     center.position += newPos;
 }
 
-Vector weightedVertexSmoothCache(SurfaceMesh &mesh, SurfaceMesh::SimplexID<1> vertexID, std::size_t rings){
+template <typename LST>
+Vector weightedVertexSmoothCacheImpl(SurfaceMesh &mesh, SurfaceMesh::SimplexID<1> vertexID, LST &&lstOf){
     auto   centerName = mesh.get_name(vertexID)[0];
     auto  &center = *vertexID; // get the vertex data
 
@@ -569,7 +632,7 @@ Vector weightedVertexSmoothCache(SurfaceMesh &mesh, SurfaceMesh::SimplexID<1> ve
      * \bar{x} = x + \sum_{k=1}^3 \frac{1}{1+\lambda_k}((\bar{x} - x)\cdot
      * \vec{e_k})\vec{e_k}
      */
-    auto lst = computeLocalStructureTensor(mesh, vertexID, rings);
+    auto lst = lstOf();
 
     EigenVector eigenvalues;
     EigenMatrix eigenvectors;
@@ -594,6 +657,37 @@ Vector weightedVertexSmoothCache(SurfaceMesh &mesh, SurfaceMesh::SimplexID<1> ve
     // center.position += newPos;
     return newPos;
 }
+} // end anonymous namespace
+
+void weightedVertexSmooth(SurfaceMesh              &mesh,
+                          SurfaceMesh::SimplexID<1> vertexID,
+                          int                       rings)
+{
+    weightedVertexSmoothImpl(mesh, vertexID, [&](){
+        return computeLocalStructureTensor(mesh, vertexID, rings);
+    });
+}
+
+void weightedVertexSmooth(SurfaceMesh              &mesh,
+                          SurfaceMesh::SimplexID<1> vertexID,
+                          KRingCache               &cache)
+{
+    weightedVertexSmoothImpl(mesh, vertexID, [&](){
+        return computeLocalStructureTensor(mesh, vertexID, cache);
+    });
+}
+
+Vector weightedVertexSmoothCache(SurfaceMesh &mesh, SurfaceMesh::SimplexID<1> vertexID, std::size_t rings){
+    return weightedVertexSmoothCacheImpl(mesh, vertexID, [&](){
+        return computeLocalStructureTensor(mesh, vertexID, rings);
+    });
+}
+
+Vector weightedVertexSmoothCache(SurfaceMesh &mesh, SurfaceMesh::SimplexID<1> vertexID, KRingCache &cache){
+    return weightedVertexSmoothCacheImpl(mesh, vertexID, [&](){
+        return computeLocalStructureTensor(mesh, vertexID, cache);
+    });
+}
 
 
 /**
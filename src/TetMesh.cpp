@@ -24,21 +24,29 @@
 
 #include <array>
 #include <algorithm>
+#include <cctype>
 #include <cmath>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <iostream>
-#include <iomanip>
+#include <limits>
 #include <map>
 #include <memory>
+#include <numeric>
 #include <ostream>
-#include <regex>
 #include <set>
 #include <strstream>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 #include <casc/casc>
 
+#include "gamer/BVH.h"
+#include "gamer/BufferedWriter.h"
+#include "gamer/DenseIndex.h"
+#include "gamer/MappedFile.h"
 #include "gamer/TetMesh.h"
 #include "gamer/SurfaceMesh.h"
 
@@ -46,9 +54,115 @@
 namespace gamer
 {
 
+/// @cond detail
+namespace
+{
+/**
+ * @brief      Pick a point strictly inside a shell and outside the shells
+ *             nested within it.
+ *
+ * Candidates are the midpoints between one of the largest faces and the
+ * next surface crossed by the ray along either of its normals. Every
+ * candidate is verified with inside/outside queries and the one with the
+ * largest distance to all surfaces is returned.
+ *
+ * @param[in]  bvhs   Face BVHs of all shells
+ * @param[in]  shell  Index of the shell of interest
+ *
+ * @return     The region point
+ */
+Vector pickRegionPoint(const std::vector<FaceBVH> &bvhs, std::size_t shell)
+{
+    const FaceBVH &bvh = bvhs[shell];
+
+    // Shells nested within this one must not contain the point
+    std::vector<std::size_t> nested;
+    for (std::size_t j = 0; j < bvhs.size(); ++j)
+    {
+        if (j != shell && bvhs[j].size() > 0
+            && bvh.contains(bvhs[j].position(bvhs[j].face(0)[0])))
+            nested.push_back(j);
+    }
+
+    std::vector<REAL> areas(bvh.size());
+    for (std::size_t i = 0; i < bvh.size(); ++i)
+    {
+        auto   tri    = bvh.triangle(i);
+        Vector normal = cross(tri[1] - tri[0], tri[2] - tri[0]);
+        areas[i] = dot(normal, normal);
+    }
+    std::vector<std::size_t> candidates(bvh.size());
+    std::iota(candidates.begin(), candidates.end(), 0);
+    const std::size_t nCandidates = std::min<std::size_t>(candidates.size(), 32);
+    std::partial_sort(candidates.begin(), candidates.begin() + nCandidates, candidates.end(),
+                      [&areas](std::size_t a, std::size_t b){
+        return areas[a] > areas[b];
+    });
+
+    bool   found = false;
+    REAL   bestClearance = 0;
+    Vector best;
+    for (std::size_t c = 0; c < nCandidates; ++c)
+    {
+        const std::size_t face = candidates[c];
+        auto   tri      = bvh.triangle(face);
+        Vector centroid = (tri[0] + tri[1] + tri[2])/3;
+        Vector normal   = cross(tri[1] - tri[0], tri[2] - tri[0]);
+        normal /= std::sqrt(areas[face]);
+
+        for (REAL sign : {-1.0, 1.0})
+        {
+            Vector dir  = sign*normal;
+            REAL   tHit = std::numeric_limits<REAL>::infinity();
+            for (std::size_t j = 0; j < bvhs.size(); ++j)
+            {
+                for (const auto &hit : bvhs[j].intersectRayAll(centroid, dir))
+                {
+                    if (hit.t > 0 && !(j == shell && hit.face == face))
+                        tHit = std::min(tHit, hit.t);
+                }
+            }
+            // The ray leaves all shells on this side
+            if (tHit == std::numeric_limits<REAL>::infinity())
+                continue;
+
+            Vector point = centroid + (tHit/2)*dir;
+            if (!bvh.contains(point))
+                continue;
+            bool inNested = false;
+            for (auto j : nested)
+                inNested = inNested || bvhs[j].contains(point);
+            if (inNested)
+                continue;
+
+            REAL clearance = std::numeric_limits<REAL>::infinity();
+            for (const auto &other : bvhs)
+                clearance = std::min(clearance, other.closestPoint(point).squaredDistance);
+            if (!found || clearance > bestClearance)
+            {
+                found = true;
+                bestClearance = clearance;
+                best = point;
+            }
+        }
+    }
+
+    if (!found)
+    {
+        std::stringstream ss;
+        ss << "Could not find a point inside SurfaceMesh " << shell
+           << ". Is the mesh closed and consistently nested?";
+        throw std::runtime_error(ss.str());
+    }
+    return best;
+}
+} // end anonymous namespace
+/// @endcond
+
 std::unique_ptr<TetMesh> makeTetMesh(
     const std::vector<SurfaceMesh*> &surfmeshes,
-    std::string                      tetgen_params)
+    std::string                      tetgen_params,
+    bool                             strict)
 {
 
     // Create new tetmesh object
@@ -92,6 +206,48 @@ std::unique_ptr<TetMesh> makeTetMesh(
         throw std::runtime_error("No non-hole Surface Meshes found. makeTetMesh expects at least one non-hole SurfaceMesh");
     }
 
+    // The BVHs serve both the intersection check and the region points
+    std::vector<FaceBVH> bvhs;
+    bvhs.reserve(surfmeshes.size());
+    for (const auto surfmesh : surfmeshes)
+        bvhs.emplace_back(*surfmesh);
+
+    // Tetgen only reports self intersections after most of its work is done
+    auto intersections = findFaceIntersections(bvhs);
+    if (!intersections.empty())
+    {
+        auto printFace = [&](std::ostream &out, std::size_t mesh, SurfaceMesh::SimplexID<3> faceID){
+            auto name = surfmeshes[mesh]->get_name(faceID);
+            out << "SurfaceMesh " << mesh << " face {"
+                << name[0] << "," << name[1] << "," << name[2] << "}";
+        };
+
+        std::stringstream ss;
+        ss << "Found " << intersections.size() << " pairs of intersecting faces.";
+        if (strict)
+            ss << " Cannot tetrahedralize self-intersecting surfaces.";
+        const std::size_t nReport = std::min<std::size_t>(intersections.size(), 10);
+        for (std::size_t j = 0; j < nReport; ++j)
+        {
+            ss << "\n    ";
+            printFace(ss, intersections[j].firstMesh, intersections[j].firstFace);
+            ss << " and ";
+            printFace(ss, intersections[j].secondMesh, intersections[j].secondFace);
+        }
+        if (nReport < intersections.size())
+            ss << "\n    ...";
+        ss << "\nUse findIntersections to select or mark all of them.";
+        if (strict)
+            throw std::runtime_error(ss.str());
+        std::cerr << "WARNING(makeTetMesh): " << ss.str() << std::endl;
+    }
+
+    // Region and hole points verified by inside/outside queries
+    std::vector<Vector> regionPoints;
+    regionPoints.reserve(surfmeshes.size());
+    for (std::size_t shell = 0; shell < surfmeshes.size(); ++shell)
+        regionPoints.push_back(pickRegionPoint(bvhs, shell));
+
     std::cout << "Number of vertices: " << nVertices << std::endl;
     std::cout << "Number of Faces: " << nFaces << std::endl;
     std::cout << "Number of Regions: " << nRegions << std::endl;
@@ -122,16 +278,16 @@ std::unique_ptr<TetMesh> makeTetMesh(
     // Reset counters
     nFaces = nRegions = nHoles = 0;
     typename TetMesh::KeyType cnt = 0;
+    std::size_t shell = 0;
 
     for (auto &surfmesh : surfmeshes)
     {
-        std::map<typename TetMesh::KeyType, typename TetMesh::KeyType> sigma;
+        // Vertices of this surface follow those of the previous ones
+        DenseIndex<SurfaceMesh> sigma(*surfmesh, cnt);
 
         // Assign vertex information
         for (const auto vertexID : surfmesh->template get_level_id<1>())
         {
-            sigma[surfmesh->get_name(vertexID)[0]] = cnt;
-
             auto vertex = *vertexID;
             auto idx = cnt*3;
             in.pointlist[idx]   = vertex[0];
@@ -165,24 +321,7 @@ std::unique_ptr<TetMesh> makeTetMesh(
 
         auto metadata = *surfmesh->get_simplex_up();
 
-        // TODO: (25) Improve region point picking strategy
-        // Pick a point inside the region
-        auto   faceID = *surfmesh->template get_level_id<3>().begin();
-        Vector normal = getNormal(*surfmesh, faceID);
-        normal /= std::sqrt(normal|normal);
-
-        auto   fname = surfmesh->get_name(faceID);
-        Vector a = (*surfmesh->get_simplex_up({fname[0]})).position;
-        Vector b = (*surfmesh->get_simplex_up({fname[1]})).position;
-        Vector c = (*surfmesh->get_simplex_up({fname[2]})).position;
-
-        Vector d = a-b;
-        double weight = std::sqrt(d|d);
-
-        // flip normal and scale by weight
-        normal *= weight;
-        Vector regionPoint((a+b+c)/3.0 - normal);
-
+        Vector regionPoint = regionPoints[shell++];
         std::cout << "Region point: " << regionPoint << std::endl;
 
         if (metadata.ishole)
@@ -257,6 +396,43 @@ std::unique_ptr<TetMesh> makeTetMesh(
     return tetgenioToTetMesh(out);
 }
 
+/// @cond detail
+namespace
+{
+/**
+ * @brief      Compute a consistent orientation such that the first cell has
+ *             positive volume.
+ *
+ * @param      mesh  The mesh
+ */
+void orientTetMesh(TetMesh &mesh)
+{
+    casc::compute_orientation(mesh);
+
+    if (mesh.size<4>() == 0)
+        return;
+
+    auto cellID = *(mesh.get_level_id<4>().begin());
+    auto indices = cellID.indices();
+    auto p0 = (*mesh.get_simplex_down(cellID, {indices[1],indices[2],indices[3]})).position;
+    auto p1 = (*mesh.get_simplex_down(cellID, {indices[0],indices[2],indices[3]})).position;
+    auto p2 = (*mesh.get_simplex_down(cellID, {indices[0],indices[1],indices[3]})).position;
+    auto p3 = (*mesh.get_simplex_down(cellID, {indices[0],indices[1],indices[2]})).position;
+    p1 = p1-p0;
+    p2 = p2-p0;
+    p3 = p3-p0;
+    auto norm12 = cross(p1,p2);
+    auto det = dot(norm12, p3);
+
+    if (det*(*cellID).orientation < 0) {
+        for (auto& cell : mesh.get_level<4>()){
+            cell.orientation *= -1;
+        }
+    }
+}
+} // end anonymous namespace
+/// @endcond
+
 std::unique_ptr<TetMesh> tetgenioToTetMesh(tetgenio &tetio)
 {
     std::unique_ptr<TetMesh> mesh(new TetMesh);
@@ -356,26 +532,69 @@ std::unique_ptr<TetMesh> tetgenioToTetMesh(tetgenio &tetio)
             }
         }
     }
-    casc::compute_orientation(*mesh);
+    orientTetMesh(*mesh);
+    return mesh;
+}
 
-    auto cellID = *(mesh->get_level_id<4>().begin());
-    auto indices = cellID.indices();
-    auto p0 = (*mesh->get_simplex_down(cellID, {indices[1],indices[2],indices[3]})).position;
-    auto p1 = (*mesh->get_simplex_down(cellID, {indices[0],indices[2],indices[3]})).position;
-    auto p2 = (*mesh->get_simplex_down(cellID, {indices[0],indices[1],indices[3]})).position;
-    auto p3 = (*mesh->get_simplex_down(cellID, {indices[0],indices[1],indices[2]})).position;
-    p1 = p1-p0;
-    p2 = p2-p0;
-    p3 = p3-p0;
-    auto norm12 = cross(p1,p2);
-    auto det = dot(norm12, p3);
+std::unique_ptr<TetMesh> tetMeshFromArrays(std::size_t nVertices,
+                                           const REAL *vertices,
+                                           const int *vertexMarkers,
+                                           std::size_t nCells,
+                                           const int *cells,
+                                           const int *cellMarkers,
+                                           std::size_t nFaces,
+                                           const int *faces,
+                                           const int *faceMarkers)
+{
+    std::unique_ptr<TetMesh> mesh(new TetMesh);
+    (*mesh->get_simplex_up()).higher_order = false;
 
-    if (det*(*cellID).orientation < 0) {
-        for (auto& cell : mesh->get_level<4>()){
-            cell.orientation *= -1;
+    for (std::size_t i = 0; i < nVertices; ++i)
+    {
+        const REAL *ptr = &vertices[3*i];
+        int marker = (vertexMarkers) ? vertexMarkers[i] : -1;
+        mesh->insert<1>({static_cast<int>(i)},
+                        TMVertex(ptr[0], ptr[1], ptr[2], marker, false));
+    }
+
+    for (std::size_t i = 0; i < nCells; ++i)
+    {
+        const int *ptr = &cells[4*i];
+        for (std::size_t j = 0; j < 4; ++j)
+        {
+            if (ptr[j] < 0 || static_cast<std::size_t>(ptr[j]) >= nVertices)
+            {
+                std::stringstream ss;
+                ss << "tetMeshFromArrays: Cell " << i << " references vertex "
+                   << ptr[j] << " which is out of range.";
+                throw std::runtime_error(ss.str());
+            }
         }
+        int marker = (cellMarkers) ? cellMarkers[i] : 0;
+        mesh->insert<4>({ptr[0], ptr[1], ptr[2], ptr[3]},
+                        TMCell(marker, false));
     }
 
+    for (auto &fdata : mesh->get_level<3>())
+    {
+        fdata.marker = 0;   // Initialize markers
+    }
+
+    for (std::size_t i = 0; i < nFaces; ++i)
+    {
+        const int *ptr  = &faces[3*i];
+        auto       face = mesh->get_simplex_up({ptr[0], ptr[1], ptr[2]});
+        if (face == nullptr)
+        {
+            std::stringstream ss;
+            ss << "tetMeshFromArrays: Marked face " << i << " {" << ptr[0] << ","
+               << ptr[1] << "," << ptr[2] << "} is not a face of any cell.";
+            throw std::runtime_error(ss.str());
+        }
+        (*face).marker = faceMarkers[i];
+    }
+
+    orientTetMesh(*mesh);
     return mesh;
 }
 
@@ -416,75 +635,65 @@ void writeVTK(const std::string &filename, const TetMesh &mesh)
         throw std::runtime_error(ss.str());
     }
 
-    fout << "# vtk DataFile Version 2.0\n"
-         << "Unstructured Grid\n"
-         << "ASCII\n"  // BINARY
-         << "DATASET UNSTRUCTURED_GRID\n";
+    BufferedWriter out(fout);
+    out << "# vtk DataFile Version 2.0\n"
+        << "Unstructured Grid\n"
+        << "ASCII\n"  // BINARY
+        << "DATASET UNSTRUCTURED_GRID\n";
 
-    std::map<typename TetMesh::KeyType, typename TetMesh::KeyType> sigma;
-    typename TetMesh::KeyType cnt = 0;
+    DenseIndex<TetMesh> sigma(mesh);
 
     // Output vertices
-    fout << "POINTS " << mesh.size<1>() << " double" << std::endl;
-    for (auto vertexID : mesh.get_level_id<1>())
+    out << "POINTS " << mesh.size<1>() << " double\n";
+    out.precision(17);
+    for (const auto &vertex : mesh.get_level<1>())
     {
-        sigma[mesh.get_name(vertexID)[0]] = cnt++;
-        auto vertex = *vertexID;
-        fout << std::setprecision(17) << vertex[0] << " "
-             << vertex[1] << " "
-             << vertex[2] << "\n";
+        out << vertex[0] << " "
+            << vertex[1] << " "
+            << vertex[2] << "\n";
     }
-    fout << "\n";
+    out << "\n";
 
     bool orientationError = false;
 
-    fout << "CELLS " << mesh.size<4>() << " " << mesh.size<4>()*(4+1) << "\n";
+    out << "CELLS " << mesh.size<4>() << " " << mesh.size<4>()*(4+1) << "\n";
     for (auto cellID : mesh.get_level_id<4>())
     {
         auto w = mesh.get_name(cellID);
         auto orientation = (*cellID).orientation;
 
-        if (orientation == 1)
-        {
-            fout << "4 " << std::setw(4) << sigma[w[0]] << " "
-                 << std::setw(4) << sigma[w[1]] << " "
-                 << std::setw(4) << sigma[w[2]] << " "
-                 << std::setw(4) << sigma[w[3]] << "\n";
-        }
-        else if (orientation == -1)
+        if (orientation == -1)
         {
-            fout << "4 " << std::setw(4) << sigma[w[3]] << " "
-                 << std::setw(4) << sigma[w[1]] << " "
-                 << std::setw(4) << sigma[w[2]] << " "
-                 << std::setw(4) << sigma[w[0]] << "\n";
+            std::swap(w[0], w[3]);
         }
-        else
+        else if (orientation != 1)
         {
             orientationError = true;
-            fout << "4 " << std::setw(4) << sigma[w[0]] << " "
-                 << std::setw(4) << sigma[w[1]] << " "
-                 << std::setw(4) << sigma[w[2]] << " "
-                 << std::setw(4) << sigma[w[3]] << "\n";
         }
+        out << "4 " << FieldWidth{4} << sigma[w[0]] << " "
+            << FieldWidth{4} << sigma[w[1]] << " "
+            << FieldWidth{4} << sigma[w[2]] << " "
+            << FieldWidth{4} << sigma[w[3]] << "\n";
     }
-    fout << "\n";
+    out << "\n";
 
-    fout << "CELL_TYPES " << mesh.size<4>() << "\n";
-    for (int i = 0; i < mesh.size<4>(); ++i)
+    out << "CELL_TYPES " << mesh.size<4>() << "\n";
+    for (std::size_t i = 0; i < mesh.size<4>(); ++i)
     {
-        fout << "10\n";
+        out << "10\n";
     }
-    fout << "\n";
+    out << "\n";
 
-    fout << "CELL_DATA " << mesh.size<4>() << "\n";
-    fout << "SCALARS cell_scalars int 1\n";
-    fout << "LOOKUP_TABLE default\n";
+    out << "CELL_DATA " << mesh.size<4>() << "\n";
+    out << "SCALARS cell_scalars int 1\n";
+    out << "LOOKUP_TABLE default\n";
     // This should output in the same order...
-    for (auto cell : mesh.get_level<4>())
+    for (const auto &cell : mesh.get_level<4>())
     {
-        fout << cell.marker << "\n";
+        out << cell.marker << "\n";
     }
-    fout << "\n";
+    out << "\n";
+    out.flush();
 
     if (orientationError)
     {
@@ -506,24 +715,21 @@ void writeOFF(const std::string &filename, const TetMesh &mesh)
         throw std::runtime_error(ss.str());
     }
 
-    fout << "OFF\n";
-    fout << mesh.size<1>() << " "
-         << mesh.size<4>() << " "
-         << mesh.size<2>() << "\n";
+    BufferedWriter out(fout);
+    out << "OFF\n";
+    out << mesh.size<1>() << " "
+        << mesh.size<4>() << " "
+        << mesh.size<2>() << "\n";
 
-    std::map<typename TetMesh::KeyType, typename TetMesh::KeyType> sigma;
-    typename TetMesh::KeyType cnt = 0;
+    DenseIndex<TetMesh> sigma(mesh);
 
-    fout.precision(10);
-    for (const auto vertexID : mesh.get_level_id<1>())
+    out.precision(10);
+    for (const auto &vertex : mesh.get_level<1>())
     {
-        sigma[mesh.get_name(vertexID)[0]] = cnt++;
-        auto vertex = *vertexID;
-
-        fout << vertex[0] << " "
-             << vertex[1] << " "
-             << vertex[2] << " "
-             << "\n";
+        out << vertex[0] << " "
+            << vertex[1] << " "
+            << vertex[2] << " "
+            << "\n";
     }
 
     bool orientationError = false;
@@ -533,29 +739,20 @@ void writeOFF(const std::string &filename, const TetMesh &mesh)
         auto w = mesh.get_name(cellID);
         auto orientation = (*cellID).orientation;
 
-        if (orientation == 1)
+        if (orientation == -1)
         {
-            fout << "4 " << std::setw(4) << sigma[w[0]] << " "
-                 << std::setw(4) << sigma[w[1]] << " "
-                 << std::setw(4) << sigma[w[2]] << " "
-                 << std::setw(4) << sigma[w[3]] << "\n";
+            std::swap(w[0], w[3]);
         }
-        else if (orientation == -1)
-        {
-            fout << "4 " << std::setw(4) << sigma[w[3]] << " "
-                 << std::setw(4) << sigma[w[1]] << " "
-                 << std::setw(4) << sigma[w[2]] << " "
-                 << std::setw(4) << sigma[w[0]] << "\n";
-        }
-        else
+        else if (orientation != 1)
         {
             orientationError = true;
-            fout << "4 " << std::setw(4) << sigma[w[0]] << " "
-                 << std::setw(4) << sigma[w[1]] << " "
-                 << std::setw(4) << sigma[w[2]] << " "
-                 << std::setw(4) << sigma[w[3]] << "\n";
         }
+        out << "4 " << FieldWidth{4} << sigma[w[0]] << " "
+            << FieldWidth{4} << sigma[w[1]] << " "
+            << FieldWidth{4} << sigma[w[2]] << " "
+            << FieldWidth{4} << sigma[w[3]] << "\n";
     }
+    out.flush();
 
     if (orientationError)
     {
@@ -583,39 +780,34 @@ void writeDolfin(const std::string &filename, const TetMesh &mesh)
         throw std::runtime_error(ss.str());
     }
 
-    fout << "<?xml version=\"1.0\"?>\n"
-         << "<dolfin xmlns:dolfin=\"http://fenicsproject.org\">\n"
-         << "  <mesh celltype=\"tetrahedron\" dim=\"3\">\n"
-         << "    <vertices size=\"" << mesh.size<1>() <<  "\">\n";
+    BufferedWriter out(fout);
+    out << "<?xml version=\"1.0\"?>\n"
+        << "<dolfin xmlns:dolfin=\"http://fenicsproject.org\">\n"
+        << "  <mesh celltype=\"tetrahedron\" dim=\"3\">\n"
+        << "    <vertices size=\"" << mesh.size<1>() <<  "\">\n";
 
-    std::map<typename TetMesh::KeyType, typename TetMesh::KeyType> sigma;
+    DenseIndex<TetMesh> sigma(mesh);
     size_t cnt = 0;
 
     // Print out Vertices
-    // std::cout << "Printing Vertices" << std::endl;
-    fout.precision(6);
-    for (const auto vertexID : mesh.get_level_id<1>())
+    out.precision(6);
+    for (const auto &vertex : mesh.get_level<1>())
     {
-        size_t idx = cnt;
-        sigma[mesh.get_name(vertexID)[0]] = cnt++;
-        auto   vertex = *vertexID;
-
-        fout << "      <vertex index=\"" << vertexID.indices()[0] << "\" "
-             << "x=\"" << vertex[0] << "\" "
-             << "y=\"" << vertex[1] << "\" "
-             << "z=\"" << vertex[2] << "\" />\n";
+        out << "      <vertex index=\"" << cnt++ << "\" "
+            << "x=\"" << vertex[0] << "\" "
+            << "y=\"" << vertex[1] << "\" "
+            << "z=\"" << vertex[2] << "\" />\n";
     }
-    fout << "    </vertices>\n";
+    out << "    </vertices>\n";
 
 
     // Print out Tetrahedra
-    // std::cout << "Printing Tetrahedra" << std::endl;
     cnt = 0;
     std::vector<std::tuple<std::size_t, std::size_t, int> > faceMarkerList;
     std::vector<std::tuple<std::size_t, int> > cellMarkerList;
     bool orientationError = false;
 
-    fout << "    <cells size=\"" << mesh.size<4>() << "\">\n";
+    out << "    <cells size=\"" << mesh.size<4>() << "\">\n";
     for (const auto tetID :  mesh.get_level_id<4>())
     {
         std::size_t idx = cnt++;
@@ -623,34 +815,21 @@ void writeDolfin(const std::string &filename, const TetMesh &mesh)
         auto orientation = (*tetID).orientation;
 
 
-        if (orientation == 1)
-        {
-            fout << "      <tetrahedron index=\"" << idx << "\" "
-                 << "v0=\"" << tetName[0] << "\" "
-                 << "v1=\"" << tetName[1] << "\" "
-                 << "v2=\"" << tetName[2] << "\" "
-                 << "v3=\"" << tetName[3] << "\" />\n";
-        }
-        else if (orientation == -1)
+        if (orientation == -1)
         {
-           fout << "      <tetrahedron index=\"" << idx << "\" "
-                << "v0=\"" << tetName[3] << "\" "
-                << "v1=\"" << tetName[1] << "\" "
-                << "v2=\"" << tetName[2] << "\" "
-                << "v3=\"" << tetName[0] << "\" />\n";
+            std::swap(tetName[0], tetName[3]);
         }
-        else
+        else if (orientation != 1)
         {
-           orientationError = true;
-           fout << "      <tetrahedron index=\"" << idx << "\" "
-                << "v0=\"" << tetName[0] << "\" "
-                << "v1=\"" << tetName[1] << "\" "
-                << "v2=\"" << tetName[2] << "\" "
-                << "v3=\"" << tetName[3] << "\" />\n";
+            orientationError = true;
         }
+        out << "      <tetrahedron index=\"" << idx << "\" "
+            << "v0=\"" << sigma[tetName[0]] << "\" "
+            << "v1=\"" << sigma[tetName[1]] << "\" "
+            << "v2=\"" << sigma[tetName[2]] << "\" "
+            << "v3=\"" << sigma[tetName[3]] << "\" />\n";
 
-        // First face = vertices 2,3,4
-        // Second face = vertices 1,3,4 etc...
+        // Local entity i is the face opposite of the i-th written vertex
         for (std::size_t i = 0; i < 4; ++i)
         {
             auto        faceID = mesh.get_simplex_down(tetID, tetName[i]);
@@ -666,36 +845,37 @@ void writeDolfin(const std::string &filename, const TetMesh &mesh)
                   << "is not defined. Did you run compute_orientation()?"
                   << std::endl;
     }
-    fout << "    </cells>\n";
-    fout << "    <domains>\n";
+    out << "    </cells>\n";
+    out << "    <domains>\n";
 
-    fout << "      <mesh_value_collection name=\"m\" type=\"uint\" dim=\"2\" size=\"" << faceMarkerList.size() << "\">\n";
+    out << "      <mesh_value_collection name=\"m\" type=\"uint\" dim=\"2\" size=\"" << faceMarkerList.size() << "\">\n";
     for (const auto markerItem : faceMarkerList)
     {
         std::size_t idx, local_entity;
         int marker;
         std::tie(idx, local_entity, marker) = markerItem;
-        fout << "        <value cell_index=\"" << idx << "\" "
-             << " local_entity=\"" << local_entity << "\" "
-             << " value=\"" << marker << "\" />\n";
+        out << "        <value cell_index=\"" << idx << "\" "
+            << " local_entity=\"" << local_entity << "\" "
+            << " value=\"" << marker << "\" />\n";
     }
 
-    fout << "      </mesh_value_collection>\n";
-    fout << "      <mesh_value_collection name=\"m\" type=\"uint\" dim=\"3\" size=\"" << mesh.size<4>() << "\">\n";
+    out << "      </mesh_value_collection>\n";
+    out << "      <mesh_value_collection name=\"m\" type=\"uint\" dim=\"3\" size=\"" << mesh.size<4>() << "\">\n";
 
     for (const auto markerItem : cellMarkerList)
     {
         std::size_t idx;
         int marker;
         std::tie(idx, marker) = markerItem;
-        fout << "        <value cell_index=\"" << idx  << "\" "
-             << " local_entity=\"0\" "
-             << " value=\"" << marker << "\" />\n";
+        out << "        <value cell_index=\"" << idx  << "\" "
+            << " local_entity=\"0\" "
+            << " value=\"" << marker << "\" />\n";
     }
-    fout << "      </mesh_value_collection>\n";
-    fout << "    </domains>\n";
-    fout << "  </mesh>\n";
-    fout << "</dolfin>\n";
+    out << "      </mesh_value_collection>\n";
+    out << "    </domains>\n";
+    out << "  </mesh>\n";
+    out << "</dolfin>\n";
+    out.flush();
 
     fout.close();
 }
@@ -711,26 +891,24 @@ void writeTriangle(const std::string &filename, const TetMesh &mesh)
         throw std::runtime_error(ss.str());
     }
 
-    std::map<typename TetMesh::KeyType, typename TetMesh::KeyType> sigma;
+    DenseIndex<TetMesh> sigma(mesh, 1);
     size_t cnt = 1;
 
     // Print out Vertices
-    // std::cout << "Printing Vertices" << std::endl;
-    // nVertices, dimension, nattributes, nmarkers
-    fout << mesh.size<1>() << " 3 " << " 0 " << " 1\n";
-
-    fout.precision(6);
-    for (const auto vertexID : mesh.get_level_id<1>())
     {
-        size_t idx = cnt;
-        sigma[mesh.get_name(vertexID)[0]] = cnt++;
-        auto   vertex = *vertexID;
+        BufferedWriter out(fout);
+        // nVertices, dimension, nattributes, nmarkers
+        out << mesh.size<1>() << " 3 " << " 0 " << " 1\n";
 
-        fout << idx << " "
-             << vertex[0] << " "
-             << vertex[1] << " "
-             << vertex[2] << " "
-             << (*vertexID).marker << "\n";
+        out.precision(6);
+        for (const auto &vertex : mesh.get_level<1>())
+        {
+            out << cnt++ << " "
+                << vertex[0] << " "
+                << vertex[1] << " "
+                << vertex[2] << " "
+                << vertex.marker << "\n";
+        }
     }
     fout.close(); // Close .node file
 
@@ -745,19 +923,21 @@ void writeTriangle(const std::string &filename, const TetMesh &mesh)
         throw std::runtime_error(ss.str());
     }
 
-    // nTetrahedra, nodes per tet, nAttributes
-    foutEle << mesh.size<4>() << " 4 1\n";
-    cnt = 1;
-    for (const auto tetID :  mesh.get_level_id<4>())
     {
-        std::size_t idx = cnt++;
-        auto        tetName = mesh.get_name(tetID);
-        foutEle << idx << " "
+        BufferedWriter out(foutEle);
+        // nTetrahedra, nodes per tet, nAttributes
+        out << mesh.size<4>() << " 4 1\n";
+        cnt = 1;
+        for (const auto tetID :  mesh.get_level_id<4>())
+        {
+            auto tetName = mesh.get_name(tetID);
+            out << cnt++ << " "
                 << sigma[tetName[0]] << " "
                 << sigma[tetName[1]] << " "
                 << sigma[tetName[2]] << " "
                 << sigma[tetName[3]] << " "
                 << (*tetID).marker << "\n";
+        }
     }
     foutEle.close(); // Close .ele file
 }
@@ -794,161 +974,798 @@ void smoothMesh(TetMesh &mesh)
     }
 }
 
-std::unique_ptr<TetMesh> readDolfin(const std::string &filename)
+/// @cond detail
+namespace
 {
-    // Instantiate mesh!
-    std::unique_ptr<TetMesh> mesh(new TetMesh);
-
-    std::ifstream            fin(filename);
-    if (!fin.is_open())
+/**
+ * @brief      Minimum dihedral angle and radius ratio over a set of cells
+ */
+struct LocalQuality
+{
+    REAL minDihedral = 180;
+    REAL minRadiusRatio = 1;
+    bool valid = true;      ///< False if any cell is inverted or degenerate
+
+    /**
+     * @brief      Check if this quality is strictly better than another.
+     *
+     * One measure must improve while the other does not worsen.
+     */
+    bool improves(const LocalQuality &other) const
     {
-        std::cerr << "Read Error: File '" << filename << "' could not be read." << std::endl;
-        mesh.reset();
-        return mesh;
+        constexpr REAL eps = 1e-6;
+        if (!valid)
+            return false;
+        if (!other.valid)
+            return true;
+        bool dihedralOK = minDihedral >= other.minDihedral - eps;
+        bool ratioOK    = minRadiusRatio >= other.minRadiusRatio - eps;
+        return dihedralOK && ratioOK
+               && (minDihedral > other.minDihedral + eps
+                   || minRadiusRatio > other.minRadiusRatio + eps);
+    }
+};
+/**
+ * @brief      Quality guarded relocation of vertices in dense arrays.
+ *
+ * @param      positions  Vertex positions
+ * @param[in]  cells      Cells with positive volume
+ * @param[in]  fixed      Flags for vertices which may not move
+ * @param[in]  maxIter    Maximum number of sweeps
+ *
+ * @return     Number of accepted vertex moves
+ */
+std::size_t optimizeVertexPositions(std::vector<Vector>                    &positions,
+                                    const std::vector<std::array<int, 4> > &cells,
+                                    const std::vector<char>                &fixed,
+                                    std::size_t                             maxIter)
+{
+    const std::size_t nVertices = positions.size();
+
+    // Vertex to cell incidence in compressed row format
+    std::vector<std::size_t> starOffsets(nVertices + 1, 0);
+    for (const auto &cell : cells)
+        for (auto v : cell)
+            ++starOffsets[v+1];
+    for (std::size_t i = 0; i < nVertices; ++i)
+        starOffsets[i+1] += starOffsets[i];
+    std::vector<int> stars(starOffsets.back());
+    {
+        std::vector<std::size_t> fill(starOffsets.begin(), starOffsets.end() - 1);
+        for (std::size_t c = 0; c < cells.size(); ++c)
+            for (auto v : cells[c])
+                stars[fill[v]++] = c;
     }
 
-    std::string line;
-    getline(fin, line);
-    getline(fin, line);
-    getline(fin, line);
-
-    // read number of vertices
-    getline(fin, line);
-    std::regex  vertexnum("<vertices size=\"([[:digit:]]+)\">",  std::regex_constants::ECMAScript | std::regex_constants::icase);
-
-    std::smatch match;
-    std::regex_search(line, match, vertexnum);
+    // Greedy coloring such that no two vertices of a color share a cell
+    std::vector<int> color(nVertices, -1);
+    std::vector<std::vector<int> > colorClasses;
+    {
+        std::vector<int> lastSeen;
+        for (std::size_t v = 0; v < nVertices; ++v)
+        {
+            if (fixed[v])
+                continue;
+            for (std::size_t k = starOffsets[v]; k < starOffsets[v+1]; ++k)
+            {
+                for (auto u : cells[stars[k]])
+                {
+                    if (color[u] >= 0)
+                    {
+                        if (static_cast<std::size_t>(color[u]) >= lastSeen.size())
+                            lastSeen.resize(color[u] + 1, -1);
+                        lastSeen[color[u]] = v;
+                    }
+                }
+            }
+            int c = 0;
+            while (static_cast<std::size_t>(c) < lastSeen.size() && lastSeen[c] == static_cast<int>(v))
+                ++c;
+            color[v] = c;
+            if (static_cast<std::size_t>(c) >= colorClasses.size())
+                colorClasses.resize(c + 1);
+            colorClasses[c].push_back(v);
+        }
+    }
 
-    int        nvertices = std::stoi(match[1].str());
+    // Quality of the star of v with v placed at x
+    auto starQuality = [&](int v, const Vector &x){
+                           LocalQuality q;
+                           for (std::size_t k = starOffsets[v]; k < starOffsets[v+1]; ++k)
+                           {
+                               std::array<const Vector*, 4> p;
+                               const auto &cell = cells[stars[k]];
+                               for (std::size_t j = 0; j < 4; ++j)
+                                   p[j] = (cell[j] == v) ? &x : &positions[cell[j]];
+                               REAL ratio = tetmesh_detail::radiusRatio(*p[0], *p[1], *p[2], *p[3]);
+                               if (ratio <= 0)
+                               {
+                                   q.valid = false;
+                                   return q;
+                               }
+                               q.minRadiusRatio = std::min(q.minRadiusRatio, ratio);
+                               for (auto angle : tetmesh_detail::dihedralAngles(*p[0], *p[1], *p[2], *p[3]))
+                                   q.minDihedral = std::min(q.minDihedral, angle);
+                           }
+                           return q;
+                       };
+
+    std::size_t totalMoves = 0;
+    for (std::size_t iter = 0; iter < maxIter; ++iter)
+    {
+        std::size_t moves = 0;
+        for (const auto &vertices : colorClasses)
+        {
+            const long nClass = vertices.size();
+            #pragma omp parallel for schedule(dynamic, 64) reduction(+:moves)
+            for (long i = 0; i < nClass; ++i)
+            {
+                const int     v = vertices[i];
+                const Vector &current = positions[v];
+                LocalQuality  best = starQuality(v, current);
+
+                // Candidate positions: volume weighted circumcenters (ODT)
+                // and the barycenter of the neighboring vertices
+                Vector odt, barycenter;
+                REAL   totalVolume = 0;
+                std::size_t nNbors = 0;
+                for (std::size_t k = starOffsets[v]; k < starOffsets[v+1]; ++k)
+                {
+                    const auto &cell = cells[stars[k]];
+                    const Vector &a = positions[cell[0]], &b = positions[cell[1]];
+                    const Vector &c = positions[cell[2]], &d = positions[cell[3]];
+                    REAL volume = std::abs(tetmesh_detail::signedVolume(a, b, c, d));
+                    odt += volume*tetmesh_detail::circumcenter(a, b, c, d);
+                    totalVolume += volume;
+                    for (auto u : cell)
+                    {
+                        if (u != v)
+                        {
+                            barycenter += positions[u];
+                            ++nNbors;
+                        }
+                    }
+                }
+                if (nNbors == 0)
+                    continue;
+                barycenter /= nNbors;
+
+                // Without volume the ODT target is undefined; only try the
+                // barycenter then
+                std::array<Vector, 2> targets = {odt, barycenter};
+                std::size_t firstTarget = 1;
+                if (totalVolume > 0)
+                {
+                    targets[0] = odt/totalVolume;
+                    firstTarget = 0;
+                }
+
+                Vector bestPosition = current;
+                bool   moved = false;
+                for (std::size_t t = firstTarget; t < targets.size(); ++t)
+                {
+                    const Vector &target = targets[t];
+                    // Backtrack towards the current position until the
+                    // move improves quality
+                    for (REAL step = 1; step > 0.1; step *= 0.5)
+                    {
+                        Vector candidate = current + step*(target - current);
+                        LocalQuality q = starQuality(v, candidate);
+                        if (q.improves(best))
+                        {
+                            best = q;
+                            bestPosition = candidate;
+                            moved = true;
+                            break;
+                        }
+                    }
+                }
+                if (moved)
+                {
+                    positions[v] = bestPosition;
+                    ++moves;
+                }
+            }
+        }
+        totalMoves += moves;
+        if (moves == 0)
+            break;
+    }
 
-    std::regex vertexLineRegex("<vertex index=\"([[:digit:]]+)\" x=\"(.*)\" y=\"(.*)\" z=\"(.*)\" />",  std::regex_constants::ECMAScript | std::regex_constants::icase);
+    return totalMoves;
+}
+} // end anonymous namespace
+/// @endcond
 
-    for (int i = 0; i < nvertices; ++i)
+std::size_t optimizeMesh(TetMesh &mesh, std::size_t maxIter)
+{
+    if ((*mesh.get_simplex_up()).higher_order == true)
     {
-        getline(fin, line);
+        throw std::runtime_error("optimizeMesh does not support higher order meshes.");
+    }
 
-        std::regex_search(line, match, vertexLineRegex);
+    // Gather the mesh into dense arrays
+    std::vector<TetMesh::SimplexID<1> > vertexIDs;
+    vertexIDs.reserve(mesh.size<1>());
+    for (auto vertexID : mesh.get_level_id<1>())
+        vertexIDs.push_back(vertexID);
+    const std::size_t nVertices = vertexIDs.size();
+    if (nVertices == 0)
+        return 0;
+
+    // Dense indices follow get_level_id<1>() like vertexIDs
+    DenseIndex<TetMesh> sigma(mesh);
+    std::vector<Vector> positions(nVertices);
+    for (std::size_t i = 0; i < nVertices; ++i)
+        positions[i] = (*vertexIDs[i]).position;
+
+    // Cells are stored with positive volume
+    std::vector<std::array<int, 4> > cells;
+    cells.reserve(mesh.size<4>());
+    for (auto cellID : mesh.get_level_id<4>())
+    {
+        std::array<int, 4> cell;
+        auto name = cellID.indices();
+        for (std::size_t j = 0; j < 4; ++j)
+            cell[j] = sigma[name[j]];
+        if (tetmesh_detail::signedVolume(positions[cell[0]], positions[cell[1]],
+                                         positions[cell[2]], positions[cell[3]]) < 0)
+            std::swap(cell[0], cell[1]);
+        cells.push_back(cell);
+    }
 
-        mesh->insert<1>({std::stoi(match[1].str())}, Vertex(std::stod(match[2].str()), std::stod(match[3].str()), std::stod(match[4].str())));
-        // for (int j=0; j < match.size(); ++j){
-        //     std::cout << match[j].str() << std::endl;
-        // }
+    // Vertices on the boundary, marked faces, or interfaces between
+    // differently marked cells must not move.
+    std::vector<char> fixed(nVertices, false);
+    for (auto faceID : mesh.get_level_id<3>())
+    {
+        auto cover = mesh.up(faceID);
+        bool keep  = cover.size() != 2 || (*faceID).marker != 0;
+        if (!keep)
+        {
+            auto it = cover.begin();
+            int  marker = (**it).marker;
+            keep = (**(++it)).marker != marker;
+        }
+        if (keep)
+        {
+            for (auto key : faceID.indices())
+                fixed[sigma[key]] = true;
+        }
     }
 
-    // for(auto vid : mesh->get_level_id<1>()){
-    //     std::cout << vid << " " << *vid << std::endl;
-    // }
+    std::size_t totalMoves = optimizeVertexPositions(positions, cells, fixed, maxIter);
 
-    getline(fin, line);
-    getline(fin, line);
+    for (std::size_t i = 0; i < nVertices; ++i)
+        (*vertexIDs[i]).position = positions[i];
+    return totalMoves;
+}
 
-    std::regex cellnum("<cells size=\"([[:digit:]]+)\">",  std::regex_constants::ECMAScript | std::regex_constants::icase);
+/// @cond detail
+namespace
+{
+/**
+ * @brief      Add the measures of one cell to a summary
+ */
+void accumulateQuality(TetQualitySummary &summary, REAL volume,
+                       REAL minDihedral, REAL maxDihedral, REAL radiusRatio,
+                       REAL aspectRatio, REAL minEdge, REAL maxEdge, REAL sumEdge)
+{
+    ++summary.nCells;
+    if (volume <= 0)
+        ++summary.nInverted;
+    summary.minDihedral     = std::min(summary.minDihedral, minDihedral);
+    summary.maxDihedral     = std::max(summary.maxDihedral, maxDihedral);
+    summary.minRadiusRatio  = std::min(summary.minRadiusRatio, radiusRatio);
+    summary.meanRadiusRatio += radiusRatio;
+    summary.maxAspectRatio  = std::max(summary.maxAspectRatio, aspectRatio);
+    summary.minVolume       = std::min(summary.minVolume, volume);
+    summary.maxVolume       = std::max(summary.maxVolume, volume);
+    summary.totalVolume     += volume;
+    summary.minEdgeLength   = std::min(summary.minEdgeLength, minEdge);
+    summary.maxEdgeLength   = std::max(summary.maxEdgeLength, maxEdge);
+    summary.meanEdgeLength  += sumEdge;
+}
+
+/**
+ * @brief      Merge two summaries which hold running sums
+ */
+void mergeQuality(TetQualitySummary &lhs, const TetQualitySummary &rhs)
+{
+    lhs.nCells          += rhs.nCells;
+    lhs.nInverted       += rhs.nInverted;
+    lhs.minDihedral     = std::min(lhs.minDihedral, rhs.minDihedral);
+    lhs.maxDihedral     = std::max(lhs.maxDihedral, rhs.maxDihedral);
+    lhs.minRadiusRatio  = std::min(lhs.minRadiusRatio, rhs.minRadiusRatio);
+    lhs.meanRadiusRatio += rhs.meanRadiusRatio;
+    lhs.maxAspectRatio  = std::max(lhs.maxAspectRatio, rhs.maxAspectRatio);
+    lhs.minVolume       = std::min(lhs.minVolume, rhs.minVolume);
+    lhs.maxVolume       = std::max(lhs.maxVolume, rhs.maxVolume);
+    lhs.totalVolume     += rhs.totalVolume;
+    lhs.minEdgeLength   = std::min(lhs.minEdgeLength, rhs.minEdgeLength);
+    lhs.maxEdgeLength   = std::max(lhs.maxEdgeLength, rhs.maxEdgeLength);
+    lhs.meanEdgeLength  += rhs.meanEdgeLength;
+}
 
-    std::regex_search(line, match, cellnum);
+/**
+ * @brief      Convert running sums into means
+ */
+void finalizeQuality(TetQualitySummary &summary)
+{
+    if (summary.nCells > 0)
+    {
+        summary.meanRadiusRatio /= summary.nCells;
+        summary.meanEdgeLength  /= 6*summary.nCells;
+    }
+}
+} // end anonymous namespace
+/// @endcond
 
-    int        ncells = std::stoi(match[1].str());
+TetQualityStats computeQualityStats(const TetMesh &mesh, std::size_t nBins)
+{
+    if (nBins == 0)
+        throw std::runtime_error("computeQualityStats: The number of bins must be positive.");
 
-    std::regex tetLineRegex("<tetrahedron index=\"([[:digit:]]+)\" v0=\"([[:digit:]]+)\" v1=\"([[:digit:]]+)\" v2=\"([[:digit:]]+)\" v3=\"([[:digit:]]+)\" />",  std::regex_constants::ECMAScript | std::regex_constants::icase);
+    std::vector<TetMesh::SimplexID<4> > cellIDs;
+    cellIDs.reserve(mesh.size<4>());
+    for (auto cellID : mesh.get_level_id<4>())
+        cellIDs.push_back(cellID);
+    const long nCells = cellIDs.size();
+
+    TetQualityStats stats;
+    stats.marker.resize(nCells);
+    stats.volume.resize(nCells);
+    stats.minDihedral.resize(nCells);
+    stats.maxDihedral.resize(nCells);
+    stats.radiusRatio.resize(nCells);
+    stats.aspectRatio.resize(nCells);
+    stats.minEdgeLength.resize(nCells);
+    stats.maxEdgeLength.resize(nCells);
+    stats.dihedralHistogram.assign(nBins, 0);
+    stats.radiusRatioHistogram.assign(nBins, 0);
+
+    #pragma omp parallel
+    {
+        TetQualitySummary                summary;
+        std::map<int, TetQualitySummary> markerSummary;
+        std::vector<std::size_t>         dihedralHistogram(nBins, 0);
+        std::vector<std::size_t>         radiusRatioHistogram(nBins, 0);
 
-    std::cout << "Reading in " << ncells << " cells" << std::endl;
+        #pragma omp for schedule(static)
+        for (long i = 0; i < nCells; ++i)
+        {
+            auto cellID = cellIDs[i];
+            auto name   = cellID.indices();
+            std::array<Vector, 4> p;
+            for (std::size_t j = 0; j < 4; ++j)
+                p[j] = (*mesh.get_simplex_up({name[j]})).position;
+
+            REAL volume = tetmesh_detail::signedVolume(p[0], p[1], p[2], p[3]);
+            int  orientation = (*cellID).orientation;
+            volume = (orientation == 1 || orientation == -1) ? volume*orientation : std::abs(volume);
+
+            auto angles = tetmesh_detail::dihedralAngles(p[0], p[1], p[2], p[3]);
+            REAL minAngle = *std::min_element(angles.begin(), angles.end());
+            REAL maxAngle = *std::max_element(angles.begin(), angles.end());
+            for (auto angle : angles)
+            {
+                std::size_t bin = static_cast<std::size_t>(angle/180.0*nBins);
+                ++dihedralHistogram[std::min(bin, nBins-1)];
+            }
 
-    std::map<int, std::array<int, 4> > cellMap;
+            REAL ratio = std::abs(tetmesh_detail::radiusRatio(p[0], p[1], p[2], p[3]));
+            std::size_t bin = static_cast<std::size_t>(ratio*nBins);
+            ++radiusRatioHistogram[std::min(bin, nBins-1)];
 
-    for (int i = 0; i < ncells; ++i)
-    {
-        getline(fin, line);
-        std::regex_search(line, match, tetLineRegex);
+            REAL minEdge = std::numeric_limits<REAL>::max();
+            REAL maxEdge = 0;
+            REAL sumEdge = 0;
+            for (std::size_t a = 0; a < 4; ++a)
+            {
+                for (std::size_t b = a+1; b < 4; ++b)
+                {
+                    REAL len = length(p[a] - p[b]);
+                    minEdge  = std::min(minEdge, len);
+                    maxEdge  = std::max(maxEdge, len);
+                    sumEdge += len;
+                }
+            }
 
-        std::array<int, 4> vals;
+            REAL area = 0.5*(length(cross(p[1] - p[0], p[2] - p[0]))
+                             + length(cross(p[1] - p[0], p[3] - p[0]))
+                             + length(cross(p[2] - p[0], p[3] - p[0]))
+                             + length(cross(p[2] - p[1], p[3] - p[1])));
+            REAL inradius = (area > 0) ? 3.0*std::abs(volume)/area : 0;
+            REAL aspect   = (inradius > 0) ? maxEdge/(2.0*std::sqrt(6.0)*inradius)
+                                           : std::numeric_limits<REAL>::infinity();
+
+            int marker = (*cellID).marker;
+            stats.marker[i]        = marker;
+            stats.volume[i]        = volume;
+            stats.minDihedral[i]   = minAngle;
+            stats.maxDihedral[i]   = maxAngle;
+            stats.radiusRatio[i]   = ratio;
+            stats.aspectRatio[i]   = aspect;
+            stats.minEdgeLength[i] = minEdge;
+            stats.maxEdgeLength[i] = maxEdge;
+
+            accumulateQuality(summary, volume, minAngle, maxAngle, ratio,
+                              aspect, minEdge, maxEdge, sumEdge);
+            accumulateQuality(markerSummary[marker], volume, minAngle, maxAngle,
+                              ratio, aspect, minEdge, maxEdge, sumEdge);
+        }
 
-        for (int j = 0; j < 4; ++j)
+        #pragma omp critical
         {
-            vals[j] = std::stoi(match[j+2].str());
+            mergeQuality(stats.summary, summary);
+            for (const auto &item : markerSummary)
+                mergeQuality(stats.markerSummary[item.first], item.second);
+            for (std::size_t b = 0; b < nBins; ++b)
+            {
+                stats.dihedralHistogram[b]    += dihedralHistogram[b];
+                stats.radiusRatioHistogram[b] += radiusRatioHistogram[b];
+            }
         }
-
-        mesh->insert<4>(vals);
-        cellMap.emplace(std::make_pair(std::stoi(match[1].str()), vals));
     }
 
-    getline(fin, line);
-    getline(fin, line);
-    getline(fin, line);
-
-    std::regex collectionRegex("<mesh_value_collection name=\"m\" type=\"uint\" dim=\"([[:digit:]]+)\" size=\"([[:digit:]]+)\">",  std::regex_constants::ECMAScript | std::regex_constants::icase);
+    finalizeQuality(stats.summary);
+    for (auto &item : stats.markerSummary)
+        finalizeQuality(item.second);
+    return stats;
+}
 
-    std::regex_search(line, match, collectionRegex);
+/// @cond detail
+namespace
+{
+/**
+ * @brief      Forward scanner over the start tags of an XML document.
+ *
+ * Only the subset of XML used by mesh formats is supported. Declarations,
+ * comments, and closing tags are skipped. Attributes may appear in any
+ * order, use either quote character, and be separated by arbitrary
+ * whitespace including newlines.
+ */
+class XMLTagScanner
+{
+public:
+    XMLTagScanner(const char *begin, const char *end) : pos(begin), last(end)
+    {
+        attributes.reserve(8);
+    }
 
-    int        ncollect = std::stoi(match[2].str());
+    /**
+     * @brief      Advance to the next start tag
+     *
+     * @return     False if there are no more tags
+     */
+    bool next()
+    {
+        while (pos < last)
+        {
+            const char *lt = static_cast<const char*>(std::memchr(pos, '<', last - pos));
+            if (lt == nullptr || lt + 1 >= last)
+            {
+                pos = last;
+                return false;
+            }
+            pos = lt + 1;
 
-    std::regex collectLineRegex("<value cell_index=\"([[:digit:]]+)\" local_entity=\"([[:digit:]]+)\" value=\"([[:digit:]]+)\" />",  std::regex_constants::ECMAScript | std::regex_constants::icase);
+            if (*pos == '!' && last - pos >= 3 && pos[1] == '-' && pos[2] == '-')
+            {
+                skipPast("-->");
+                continue;
+            }
+            if (*pos == '?' || *pos == '!' || *pos == '/')
+            {
+                skipPast(">");
+                continue;
+            }
 
-    std::cout << "Reading in " << ncollect << " collections" << std::endl;
+            nameBegin = pos;
+            while (pos < last && !std::isspace(static_cast<unsigned char>(*pos))
+                   && *pos != '>' && *pos != '/')
+                ++pos;
+            nameEnd = pos;
+            parseAttributes();
+            return true;
+        }
+        return false;
+    }
 
-    for (auto face : mesh->get_level_id<3>())
+    /**
+     * @brief      Check the name of the current tag
+     *
+     * @param[in]  name  The name
+     *
+     * @return     True if the current tag has this name
+     */
+    bool is(const char *name) const
     {
-        (*face).marker = 0;
+        std::size_t len = std::strlen(name);
+        return static_cast<std::size_t>(nameEnd - nameBegin) == len
+               && std::strncmp(nameBegin, name, len) == 0;
     }
 
-    for (int i = 0; i < ncollect; ++i)
+    /**
+     * @brief      Get the name of the current tag
+     *
+     * @return     The tag name
+     */
+    std::string name() const
     {
-        getline(fin, line);
-        std::regex_search(line, match, collectLineRegex);
-
-        int                idx = std::stoi(match[1].str());
-        int                entity = std::stoi(match[2].str());
-        int                value  = std::stoi(match[3].str());
+        return std::string(nameBegin, nameEnd);
+    }
 
-        auto               key = cellMap[idx];
+    /**
+     * @brief      Find the value of an attribute of the current tag
+     *
+     * @param[in]  name    The attribute name
+     * @param[out] vbegin  Start of the value
+     * @param[out] vend    One past the end of the value
+     *
+     * @return     True if the attribute was found
+     */
+    bool find(const char *name, const char *&vbegin, const char *&vend) const
+    {
+        std::size_t len = std::strlen(name);
+        for (const auto &attr : attributes)
+        {
+            if (static_cast<std::size_t>(attr[1] - attr[0]) == len
+                && std::strncmp(attr[0], name, len) == 0)
+            {
+                vbegin = attr[2];
+                vend   = attr[3];
+                return true;
+            }
+        }
+        return false;
+    }
 
-        std::array<int, 3> faceKey;
+    /**
+     * @brief      Get the value of an attribute as a number
+     *
+     * @param[in]  name  The attribute name
+     *
+     * @tparam     T     Numeric type
+     *
+     * @return     The parsed value
+     */
+    template <typename T>
+    T get(const char *name) const
+    {
+        const char *vbegin, *vend;
+        if (!find(name, vbegin, vend))
+        {
+            std::stringstream ss;
+            ss << "Missing attribute '" << name << "' in <" << this->name() << ">.";
+            throw std::runtime_error(ss.str());
+        }
+        // Values are terminated by their closing quote so the conversion
+        // never reads past the mapped region.
+        char *parsed;
+        T value = std::is_floating_point<T>::value
+                  ? static_cast<T>(std::strtod(vbegin, &parsed))
+                  : static_cast<T>(std::strtol(vbegin, &parsed, 10));
+        while (parsed < vend && std::isspace(static_cast<unsigned char>(*parsed)))
+            ++parsed;
+        if (parsed == vbegin || parsed != vend)
+        {
+            std::stringstream ss;
+            ss << "Could not parse attribute '" << name << "' in <"
+               << this->name() << "> with value '" << std::string(vbegin, vend) << "'.";
+            throw std::runtime_error(ss.str());
+        }
+        return value;
+    }
 
-        int                k = 0;
-        for (int j = 0; j < 4; ++j)
+private:
+    void skipPast(const char *token)
+    {
+        std::size_t len = std::strlen(token);
+        while (pos + len <= last)
         {
-            if (j == entity)
-                continue;
-            else
+            if (std::strncmp(pos, token, len) == 0)
             {
-                faceKey[k] = key[j];
-                ++k;
+                pos += len;
+                return;
             }
+            ++pos;
         }
-
-        (*mesh->get_simplex_up(faceKey)).marker = value;
+        pos = last;
     }
 
-    getline(fin, line);
-    getline(fin, line);
+    void parseAttributes()
+    {
+        attributes.clear();
+        while (pos < last)
+        {
+            while (pos < last && std::isspace(static_cast<unsigned char>(*pos)))
+                ++pos;
+            if (pos >= last)
+                break;
+            if (*pos == '>')
+            {
+                ++pos;
+                return;
+            }
+            if (*pos == '/')
+            {
+                ++pos;
+                continue;
+            }
 
-    std::regex tetCollectionRegex("<mesh_value_collection name=\"m\" type=\"uint\" dim=\"([[:digit:]]+)\" size=\"([[:digit:]]+)\">",  std::regex_constants::ECMAScript | std::regex_constants::icase);
+            const char *aBegin = pos;
+            while (pos < last && *pos != '=' && *pos != '>'
+                   && !std::isspace(static_cast<unsigned char>(*pos)))
+                ++pos;
+            const char *aEnd = pos;
+            while (pos < last && std::isspace(static_cast<unsigned char>(*pos)))
+                ++pos;
+            if (pos >= last || *pos != '=')
+                continue;   // Attribute without value
+            ++pos;
+            while (pos < last && std::isspace(static_cast<unsigned char>(*pos)))
+                ++pos;
+            if (pos >= last || (*pos != '"' && *pos != '\''))
+                throw std::runtime_error("Malformed attribute value in <" + name() + ">.");
+            const char  quote  = *pos++;
+            const char *vBegin = pos;
+            const char *vEnd   = static_cast<const char*>(std::memchr(pos, quote, last - pos));
+            if (vEnd == nullptr)
+                throw std::runtime_error("Unterminated attribute value in <" + name() + ">.");
+            pos = vEnd + 1;
+            attributes.push_back({aBegin, aEnd, vBegin, vEnd});
+        }
+    }
 
-    std::regex_search(line, match, tetCollectionRegex);
+    const char *pos;
+    const char *last;
+    const char *nameBegin = nullptr;
+    const char *nameEnd   = nullptr;
+    /// Attribute name begin/end and value begin/end
+    std::vector<std::array<const char*, 4> > attributes;
+};
+} // end anonymous namespace
+/// @endcond
 
-    ncollect = std::stoi(match[2].str());
+std::unique_ptr<TetMesh> readDolfin(const std::string &filename)
+{
+    std::unique_ptr<TetMesh> mesh;
 
-    std::regex collectTetRegex("<value cell_index=\"([[:digit:]]+)\" local_entity=\"([[:digit:]]+)\" value=\"([[:digit:]]+)\" />",  std::regex_constants::ECMAScript | std::regex_constants::icase);
+    MappedFile file;
+    if (!file.open(filename))
+    {
+        std::cerr << "Read Error: File '" << filename << "' could not be read." << std::endl;
+        return mesh;
+    }
 
-    std::cout << "Reading in " << ncollect << " collections" << std::endl;
+    std::size_t nVertices = 0;
+    std::size_t nCells    = 0;
+    std::vector<REAL> vertices;
+    std::vector<int>  cells;
+    std::vector<int>  cellMarkers;
+    // Tuples of cell index, local entity, and marker value
+    std::vector<std::array<int, 3> > faceValues;
+    int collectionDim = -1;
+
+    // Sizes are parsed as signed to catch negative values. Every entry takes
+    // at least an empty tag so the size is also bounded by the file length.
+    auto getSize = [&file](const XMLTagScanner &tag, const char *entry) -> std::size_t {
+                       long size = tag.get<long>("size");
+                       const std::size_t minBytes = std::strlen(entry) + 3;    // <entry/>
+                       if (size < 0 || static_cast<std::size_t>(size) > file.size()/minBytes)
+                       {
+                           std::stringstream ss;
+                           ss << "Invalid size " << size << " of <" << tag.name() << ">.";
+                           throw std::runtime_error(ss.str());
+                       }
+                       return size;
+                   };
+
+    auto checkIndex = [](long idx, std::size_t size, const char *what){
+                          if (idx < 0 || static_cast<std::size_t>(idx) >= size)
+                          {
+                              std::stringstream ss;
+                              ss << what << " index " << idx << " is out of range.";
+                              throw std::runtime_error(ss.str());
+                          }
+                      };
 
-    for (auto tet : mesh->get_level_id<4>())
+    try
+    {
+        XMLTagScanner tag(file.begin(), file.end());
+        while (tag.next())
+        {
+            if (tag.is("vertex"))
+            {
+                long idx = tag.get<long>("index");
+                checkIndex(idx, nVertices, "Vertex");
+                REAL *ptr = &vertices[3*idx];
+                ptr[0] = tag.get<REAL>("x");
+                ptr[1] = tag.get<REAL>("y");
+                ptr[2] = tag.get<REAL>("z");
+            }
+            else if (tag.is("tetrahedron"))
+            {
+                long idx = tag.get<long>("index");
+                checkIndex(idx, nCells, "Cell");
+                int *ptr = &cells[4*idx];
+                ptr[0] = tag.get<int>("v0");
+                ptr[1] = tag.get<int>("v1");
+                ptr[2] = tag.get<int>("v2");
+                ptr[3] = tag.get<int>("v3");
+            }
+            else if (tag.is("value"))
+            {
+                long idx = tag.get<long>("cell_index");
+                checkIndex(idx, nCells, "Cell");
+                int value = tag.get<int>("value");
+                if (collectionDim == 2)
+                {
+                    int entity = tag.get<int>("local_entity");
+                    checkIndex(entity, 4, "Local entity");
+                    faceValues.push_back({static_cast<int>(idx), entity, value});
+                }
+                else if (collectionDim == 3)
+                {
+                    cellMarkers[idx] = value;
+                }
+            }
+            else if (tag.is("vertices"))
+            {
+                nVertices = getSize(tag, "vertex");
+                vertices.assign(3*nVertices, 0);
+            }
+            else if (tag.is("cells"))
+            {
+                nCells = getSize(tag, "tetrahedron");
+                cells.assign(4*nCells, 0);
+                cellMarkers.assign(nCells, 0);
+            }
+            else if (tag.is("mesh_value_collection"))
+            {
+                collectionDim = tag.get<int>("dim");
+                if (collectionDim == 2)
+                    faceValues.reserve(faceValues.size() + getSize(tag, "value"));
+            }
+            else if (tag.is("mesh"))
+            {
+                const char *vbegin, *vend;
+                if (tag.find("celltype", vbegin, vend)
+                    && std::string(vbegin, vend) != "tetrahedron")
+                {
+                    throw std::runtime_error("Only tetrahedral meshes are supported. Found celltype '"
+                                             + std::string(vbegin, vend) + "'.");
+                }
+            }
+        }
+    }
+    catch (const std::runtime_error &e)
     {
-        (*tet).marker = 0;
+        std::stringstream ss;
+        ss << "readDolfin: In file '" << filename << "': " << e.what();
+        throw std::runtime_error(ss.str());
     }
 
-    for (int i = 0; i < ncollect; ++i)
+    // Convert cell local entities to faces
+    std::vector<int> faces;
+    std::vector<int> faceMarkers;
+    faces.reserve(3*faceValues.size());
+    faceMarkers.reserve(faceValues.size());
+    for (const auto &fv : faceValues)
     {
-        getline(fin, line);
-        std::regex_search(line, match, collectTetRegex);
-
-        int  idx   = std::stoi(match[1].str());
-        int  value = std::stoi(match[3].str());
-
-        auto key = cellMap[idx];
-
-        (*mesh->get_simplex_up(key)).marker = value;
+        const int *cell = &cells[4*fv[0]];
+        for (int j = 0; j < 4; ++j)
+        {
+            if (j != fv[1])
+                faces.push_back(cell[j]);
+        }
+        faceMarkers.push_back(fv[2]);
     }
 
-    return mesh;
+    return tetMeshFromArrays(nVertices, vertices.data(), nullptr,
+                             nCells, cells.data(), cellMarkers.data(),
+                             faceMarkers.size(), faces.data(), faceMarkers.data());
 }
 
 } // end namespace gamer
@@ -0,0 +1,108 @@
+/*
+ * ***************************************************************************
+ * This file is part of the GAMer software.
+ * Copyright (C) 2016-2018
+ * by Christopher Lee, John Moody, Rommie Amaro, J. Andrew McCammon,
+ *    and Michael Holst
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * ***************************************************************************
+ */
+
+#define _USE_MATH_DEFINES
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#include "gamer/TetMesh.h"
+#include "gamer/Vertex.h"
+
+/// Namespace for all things gamer
+namespace gamer
+{
+/// Namespace for tetmesh detail functions
+namespace tetmesh_detail
+{
+REAL signedVolume(const Vector &a, const Vector &b, const Vector &c, const Vector &d)
+{
+    return dot(b - a, cross(c - a, d - a))/6.0;
+}
+
+Vector circumcenter(const Vector &a, const Vector &b, const Vector &c, const Vector &d)
+{
+    Vector u = b - a;
+    Vector v = c - a;
+    Vector w = d - a;
+    REAL   denom = 2.0*dot(u, cross(v, w));
+    if (denom == 0)
+        return (a + b + c + d)/4.0;
+    Vector num = (u|u)*cross(v, w) + (v|v)*cross(w, u) + (w|w)*cross(u, v);
+    return a + num/denom;
+}
+
+REAL radiusRatio(const Vector &a, const Vector &b, const Vector &c, const Vector &d)
+{
+    REAL volume = signedVolume(a, b, c, d);
+    if (volume == 0)
+        return 0;
+
+    REAL area = length(cross(b - a, c - a)) + length(cross(b - a, d - a))
+                + length(cross(c - a, d - a)) + length(cross(c - b, d - b));
+    area *= 0.5;
+
+    // inradius = 3V/A
+    REAL inradius     = 3.0*std::abs(volume)/area;
+    REAL circumradius = length(circumcenter(a, b, c, d) - a);
+    if (circumradius == 0)
+        return 0;
+    return std::copysign(3.0*inradius/circumradius, volume);
+}
+
+std::array<REAL, 6> dihedralAngles(const Vector &a, const Vector &b, const Vector &c, const Vector &d)
+{
+    const std::array<const Vector*, 4> p = {&a, &b, &c, &d};
+
+    // Outward facing normal of the face opposite each vertex
+    std::array<Vector, 4> normals;
+    for (std::size_t i = 0; i < 4; ++i)
+    {
+        const Vector &p0 = *p[(i+1)%4];
+        const Vector &p1 = *p[(i+2)%4];
+        const Vector &p2 = *p[(i+3)%4];
+        Vector n = cross(p1 - p0, p2 - p0);
+        if (dot(n, *p[i] - p0) > 0)
+            n *= -1;
+        REAL mag = length(n);
+        if (mag > 0)
+            n /= mag;
+        normals[i] = n;
+    }
+
+    // The dihedral at edge ij is between the faces opposite k and l
+    static const std::array<std::array<std::size_t, 2>, 6> opposite = {{
+        {2, 3}, {1, 3}, {1, 2}, {0, 3}, {0, 2}, {0, 1}
+    }};
+    std::array<REAL, 6> angles;
+    for (std::size_t e = 0; e < 6; ++e)
+    {
+        REAL cosine = dot(normals[opposite[e][0]], normals[opposite[e][1]]);
+        cosine    = std::max<REAL>(-1, std::min<REAL>(1, cosine));
+        angles[e] = 180.0 - std::acos(cosine)*180.0/M_PI;
+    }
+    return angles;
+}
+} // end namespace tetmesh_detail
+} // end namespace gamer
@@ -0,0 +1,241 @@
+/*
+ * ***************************************************************************
+ * This file is part of the GAMer software.
+ * Copyright (C) 2016-2018
+ * by Christopher Lee, John Moody, Rommie Amaro, J. Andrew McCammon,
+ *    and Michael Holst
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * ***************************************************************************
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <casc/casc>
+
+#include "gamer/BufferedWriter.h"
+#include "gamer/DenseIndex.h"
+#include "gamer/TetMesh.h"
+
+/// Namespace for all things gamer
+namespace gamer
+{
+/// @cond detail
+namespace
+{
+/// VTK cell type identifiers
+constexpr std::uint8_t VTK_TRIANGLE = 5;
+constexpr std::uint8_t VTK_TETRA    = 10;
+} // end anonymous namespace
+/// @endcond
+
+void writeVTU(const std::string                                 &filename,
+              const TetMesh                                     &mesh,
+              const std::map<std::string, std::vector<REAL> >  &vertexFields)
+{
+    const std::size_t nVertices = mesh.size<1>();
+    const std::size_t nCells    = mesh.size<4>();
+
+    // Validate the per-vertex fields before touching the file
+    std::vector<std::size_t> nComponents;
+    for (const auto &field : vertexFields)
+    {
+        const std::size_t sz = field.second.size();
+        if (nVertices == 0 || sz == 0 || sz % nVertices != 0)
+        {
+            std::stringstream ss;
+            ss << "writeVTU: Vertex field '" << field.first << "' has "
+               << sz << " values which is not a multiple of the number of "
+               << "vertices (" << nVertices << ").";
+            throw std::runtime_error(ss.str());
+        }
+        nComponents.push_back(sz / nVertices);
+    }
+
+    // Only faces carrying a marker are exported as triangles
+    std::size_t nFaces = 0;
+    for (const auto &fdata : mesh.get_level<3>())
+    {
+        if (fdata.marker != 0)
+            ++nFaces;
+    }
+    const std::size_t nElements = nCells + nFaces;
+
+    std::ofstream fout(filename, std::ios::out | std::ios::binary);
+    if (!fout.is_open())
+    {
+        std::stringstream ss;
+        ss << "File '" << filename
+           << "' could not be written to.";
+        throw std::runtime_error(ss.str());
+    }
+
+    const std::uint16_t endianTest = 1;
+    const bool littleEndian = *reinterpret_cast<const std::uint8_t*>(&endianTest) == 1;
+
+    // Each appended block is prefixed by its size
+    const std::uint64_t header = sizeof(std::uint64_t);
+
+    std::ostringstream xml;
+    std::uint64_t offset = 0;
+    auto dataArray = [&](const std::string &type, const std::string &name,
+                         std::size_t ncomp, std::uint64_t nbytes){
+                         xml << "        <DataArray type=\"" << type << "\" Name=\"" << name
+                             << "\" NumberOfComponents=\"" << ncomp
+                             << "\" format=\"appended\" offset=\"" << offset << "\"/>\n";
+                         offset += header + nbytes;
+                     };
+
+    xml << "<?xml version=\"1.0\"?>\n"
+        << "<VTKFile type=\"UnstructuredGrid\" version=\"1.0\" byte_order=\""
+        << (littleEndian ? "LittleEndian" : "BigEndian")
+        << "\" header_type=\"UInt64\">\n"
+        << "  <UnstructuredGrid>\n"
+        << "    <Piece NumberOfPoints=\"" << nVertices
+        << "\" NumberOfCells=\"" << nElements << "\">\n";
+
+    xml << "      <PointData>\n";
+    dataArray("Int32", "vertex_marker", 1, nVertices*sizeof(std::int32_t));
+    std::size_t fieldIdx = 0;
+    for (const auto &field : vertexFields)
+    {
+        dataArray("Float64", field.first, nComponents[fieldIdx],
+                  field.second.size()*sizeof(double));
+        ++fieldIdx;
+    }
+    xml << "      </PointData>\n";
+
+    xml << "      <CellData>\n";
+    dataArray("Int32", "marker", 1, nElements*sizeof(std::int32_t));
+    dataArray("UInt8", "dimension", 1, nElements*sizeof(std::uint8_t));
+    xml << "      </CellData>\n";
+
+    xml << "      <Points>\n";
+    dataArray("Float64", "Points", 3, 3*nVertices*sizeof(double));
+    xml << "      </Points>\n";
+
+    xml << "      <Cells>\n";
+    dataArray("Int64", "connectivity", 1, (4*nCells + 3*nFaces)*sizeof(std::int64_t));
+    dataArray("Int64", "offsets", 1, nElements*sizeof(std::int64_t));
+    dataArray("UInt8", "types", 1, nElements*sizeof(std::uint8_t));
+    xml << "      </Cells>\n";
+
+    xml << "    </Piece>\n"
+        << "  </UnstructuredGrid>\n"
+        << "  <AppendedData encoding=\"raw\">\n"
+        << "_";
+    BufferedWriter out(fout);
+    out.write(xml.str());
+
+    // Write the appended data blocks in the same order as declared above.
+    // Each block is prefixed by its size in bytes.
+    out.push(static_cast<std::uint64_t>(nVertices*sizeof(std::int32_t)));
+    for (const auto &vdata : mesh.get_level<1>())
+        out.push(static_cast<std::int32_t>(vdata.marker));
+
+    for (const auto &field : vertexFields)
+    {
+        out.push(static_cast<std::uint64_t>(field.second.size()*sizeof(double)));
+        for (const auto value : field.second)
+            out.push(static_cast<double>(value));
+    }
+
+    out.push(static_cast<std::uint64_t>(nElements*sizeof(std::int32_t)));
+    for (const auto &cdata : mesh.get_level<4>())
+        out.push(static_cast<std::int32_t>(cdata.marker));
+    for (const auto &fdata : mesh.get_level<3>())
+    {
+        if (fdata.marker != 0)
+            out.push(static_cast<std::int32_t>(fdata.marker));
+    }
+
+    out.push(static_cast<std::uint64_t>(nElements*sizeof(std::uint8_t)));
+    for (std::size_t i = 0; i < nCells; ++i)
+        out.push(static_cast<std::uint8_t>(3));
+    for (std::size_t i = 0; i < nFaces; ++i)
+        out.push(static_cast<std::uint8_t>(2));
+
+    out.push(static_cast<std::uint64_t>(3*nVertices*sizeof(double)));
+    for (const auto &vdata : mesh.get_level<1>())
+    {
+        out.push(static_cast<double>(vdata[0]));
+        out.push(static_cast<double>(vdata[1]));
+        out.push(static_cast<double>(vdata[2]));
+    }
+
+    // Build the dense vertex map once for the connectivity
+    DenseIndex<TetMesh> sigma(mesh);
+    bool orientationError = false;
+    out.push(static_cast<std::uint64_t>((4*nCells + 3*nFaces)*sizeof(std::int64_t)));
+    for (const auto cellID : mesh.get_level_id<4>())
+    {
+        auto w = cellID.indices();
+        auto orientation = (*cellID).orientation;
+        if (orientation == -1)
+        {
+            std::swap(w[0], w[3]);
+        }
+        else if (orientation != 1)
+        {
+            orientationError = true;
+        }
+        for (auto key : w)
+            out.push(static_cast<std::int64_t>(sigma[key]));
+    }
+    for (const auto faceID : mesh.get_level_id<3>())
+    {
+        if ((*faceID).marker != 0)
+        {
+            for (auto key : faceID.indices())
+                out.push(static_cast<std::int64_t>(sigma[key]));
+        }
+    }
+
+    out.push(static_cast<std::uint64_t>(nElements*sizeof(std::int64_t)));
+    std::int64_t end = 0;
+    for (std::size_t i = 0; i < nCells; ++i)
+        out.push(end += 4);
+    for (std::size_t i = 0; i < nFaces; ++i)
+        out.push(end += 3);
+
+    out.push(static_cast<std::uint64_t>(nElements*sizeof(std::uint8_t)));
+    for (std::size_t i = 0; i < nCells; ++i)
+        out.push(VTK_TETRA);
+    for (std::size_t i = 0; i < nFaces; ++i)
+        out.push(VTK_TRIANGLE);
+
+    out << "\n  </AppendedData>\n"
+        << "</VTKFile>\n";
+    out.flush();
+
+    if (orientationError)
+    {
+        std::cerr << "WARNING(writeVTU): The orientation of one or more cells "
+                  << "is not defined. Did you run compute_orientation()?"
+                  << std::endl;
+    }
+    fout.close();
+}
+} // end namespace gamer
@@ -151,3 +151,176 @@ class TestSurfaceMesh(object):
         assert data.marker == -1
         assert data.selected == False
 
+
+    def test_from_ndarray(self):
+        import numpy as np
+        vertices = np.array([[0,0,0],[1,0,0],[0,1,0],[0,0,1]], dtype=float)
+        faces = np.array([[0,2,1],[0,1,3],[0,3,2],[1,2,3]], dtype=np.int32)
+        mesh = sm.SurfaceMesh.from_ndarray(vertices, faces,
+                face_markers=[1,2,3,4],
+                vertex_selected=[True,False,False,False])
+        assert mesh.nVertices == 4
+        assert mesh.nEdges == 6
+        assert mesh.nFaces == 4
+        assert mesh.getFace([1,2,3]).data().marker == 4
+        assert mesh.getVertex([0]).data().selected == True
+        assert mesh.getVolume() > 0
+
+        with pytest.raises(ValueError):
+            sm.SurfaceMesh.from_ndarray(vertices, faces[:, :2])
+
+
+    def test_attribute_arrays(self):
+        import numpy as np
+        vertices = np.array([[0,0,0],[1,0,0],[0,1,0],[0,0,1]], dtype=float)
+        faces = np.array([[0,2,1],[0,1,3],[0,3,2],[1,2,3]], dtype=np.int32)
+        mesh = sm.SurfaceMesh.from_ndarray(vertices, faces)
+
+        positions, _, _ = mesh.to_ndarray()
+        assert np.allclose(mesh.vertex_positions(), positions)
+        mesh.set_vertex_positions(2*positions)
+        assert np.allclose(mesh.vertex_positions(), 2*positions)
+
+        mesh.set_face_markers(np.arange(4))
+        assert list(mesh.face_markers()) == [0,1,2,3]
+        mesh.set_vertex_selected(np.array([True,False,True,False]))
+        assert list(mesh.vertex_selected()) == [True,False,True,False]
+
+        with pytest.raises(ValueError):
+            mesh.set_face_markers(np.arange(3))
+
+
+    def test_face_bvh(self):
+        import numpy as np
+        vertices = np.array([[0,0,0],[1,0,0],[0,1,0],[0,0,1]], dtype=float)
+        faces = np.array([[0,2,1],[0,1,3],[0,3,2],[1,2,3]], dtype=np.int32)
+        mesh = sm.SurfaceMesh.from_ndarray(vertices, faces)
+        bvh = sm.FaceBVH(mesh)
+        assert len(bvh) == 4
+
+        face, t, u, v = bvh.intersect_ray(pygamer.Vector(0.1,0.1,-1), pygamer.Vector(0,0,1))
+        assert t == pytest.approx(1)
+        assert bvh.face_id(face).data().marker == 0
+        assert bvh.intersect_ray(pygamer.Vector(2,2,-1), pygamer.Vector(0,0,1)) is None
+
+        _, point, distance = bvh.closest_point(pygamer.Vector(0.2,0.2,-0.5))
+        assert distance == pytest.approx(0.5)
+        faces, points, distances = bvh.closest_points(np.array([[0.2,0.2,-0.5],[2,0,0]]))
+        assert np.allclose(distances, [0.5, 1])
+
+        mesh.set_vertex_positions(2*vertices)
+        bvh.refit()
+        assert bvh.closest_points(np.array([[2.5,0,0]]))[2][0] == pytest.approx(0.5)
+
+
+    def test_find_intersections(self):
+        import numpy as np
+        vertices = np.array([[0,0,0],[1,0,0],[0,1,0],[0,0,1]], dtype=float)
+        faces = np.array([[0,2,1],[0,1,3],[0,3,2],[1,2,3]], dtype=np.int32)
+        mesh = sm.SurfaceMesh.from_ndarray(vertices, faces)
+        other = sm.SurfaceMesh.from_ndarray(vertices + 0.25, faces)
+        assert pygamer.findIntersections([mesh]) == []
+
+        intersections = pygamer.findIntersections([mesh, other], select=True)
+        assert len(intersections) > 0
+        for first, face, second, _ in intersections:
+            assert (first, second) == (0, 1)
+            assert face.data().selected
+
+
+    def test_surface_distance(self):
+        mesh = sm.sphere(1)
+        shifted = sm.sphere(1)
+        shifted.translate(pygamer.Vector(0,0,0.1))
+        distance = sm.surfaceDistance(mesh, shifted, deviations=True)
+        assert 0 < distance['hausdorff'] <= 0.1 + 1e-6
+        assert len(distance['forward']['deviations']) == mesh.nVertices
+        one_sided = sm.oneSidedDistance(mesh, shifted)
+        assert one_sided['max'] == pytest.approx(distance['forward']['max'])
+        assert 'deviations' not in one_sided
+
+
+    def test_isotropic_remesh(self):
+        import numpy as np
+        mesh = sm.sphere(3)
+        result = mesh.isotropicRemesh(target_length=0.2)
+        assert result.nFaces > 0
+        assert sm.surfaceDistance(mesh, result)['hausdorff'] < 0.05
+        graded = mesh.isotropicRemesh(sizing=np.full(mesh.nVertices, 0.4), iterations=3)
+        assert graded.nFaces < result.nFaces
+        with pytest.raises(ValueError):
+            mesh.isotropicRemesh()
+
+    def test_adaptive_refine(self):
+        mesh = sm.sphere(1)
+        face = next(iter(mesh.faceIDs))
+        face.data().selected = True
+        refined = mesh.adaptiveRefine()
+        assert refined.nFaces == mesh.nFaces + 6
+        uniform = mesh.adaptiveRefine(max_length=0.3)
+        assert uniform.nFaces > refined.nFaces
+
+
+    def test_implicit_fairing(self):
+        mesh = sm.sphere(1)
+        volume = mesh.getVolume()
+        mesh.implicitFairing(time_step=0.1)
+        assert 0 < mesh.getVolume() < volume
+        with pytest.raises(RuntimeError):
+            mesh.implicitFairing(time_step=0)
+
+    def test_quality_stats(self):
+        mesh = sm.sphere(1)
+        stats = mesh.getQualityStats()
+        assert stats['area'].shape == (mesh.nFaces,)
+        assert stats['edge_length'].shape == (mesh.nEdges,)
+        assert stats['valence'].shape == (mesh.nVertices,)
+        assert stats['angle_histogram'].sum() == 3*mesh.nFaces
+        assert stats['summary']['total_area'] == pytest.approx(stats['area'].sum())
+        assert stats['summary']['min_valence'] == 5
+
+
+class TestTetMesh(object):
+    def test_from_ndarray(self):
+        import numpy as np
+        vertices = np.array([[0,0,0],[1,0,0],[0,1,0],[0,0,1],[1,1,1]], dtype=float)
+        cells = np.array([[0,1,2,3],[1,2,3,4]], dtype=np.int32)
+        mesh = tm.TetMesh.from_ndarray(vertices, cells, cell_markers=[5,7],
+                faces=[[0,1,2]], face_markers=[23])
+        assert mesh.nVertices == 5
+        assert mesh.nCells == 2
+        assert mesh.getFace([0,1,2]).data().marker == 23
+        assert mesh.getCell([1,2,3,4]).data().marker == 7
+
+    def test_attribute_arrays(self):
+        import numpy as np
+        vertices = np.array([[0,0,0],[1,0,0],[0,1,0],[0,0,1],[1,1,1]], dtype=float)
+        cells = np.array([[0,1,2,3],[1,2,3,4]], dtype=np.int32)
+        mesh = tm.TetMesh.from_ndarray(vertices, cells, cell_markers=[5,7])
+
+        assert np.allclose(mesh.vertex_positions(), vertices)
+        assert sorted(mesh.cell_markers()) == [5,7]
+        mesh.set_cell_markers([1,1])
+        assert list(mesh.cell_markers()) == [1,1]
+        assert len(mesh.face_markers()) == mesh.nFaces
+
+    def test_to_ndarray(self):
+        import numpy as np
+        vertices = np.array([[0,0,0],[1,0,0],[0,1,0],[0,0,1],[1,1,1]], dtype=float)
+        cells = np.array([[0,2,1,3],[1,2,3,4]], dtype=np.int32)
+        mesh = tm.TetMesh.from_ndarray(vertices, cells, cell_markers=[5,7],
+                faces=[[0,1,2]], face_markers=[23])
+
+        verts, tets, cell_markers, faces, face_markers = mesh.to_ndarray()
+        assert verts.shape == (5,3)
+        assert tets.shape == (2,4)
+        assert sorted(cell_markers) == [5,7]
+        assert faces.shape == (6,3)
+        assert sorted(face_markers)[-1] == 23
+
+        # Cells are positively oriented and faces point outward
+        a, b, c, d = (verts[tets[:,i]] for i in range(4))
+        assert np.all(np.einsum('ij,ij->i', b-a, np.cross(c-a, d-a)) > 0)
+        p, q, r = (verts[faces[:,i]] for i in range(3))
+        volume = np.einsum('ij,ij->i', p, np.cross(q, r)).sum()/6
+        assert math.isclose(volume, 0.5)
@@ -1,13 +1,30 @@
 
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
 #include <iostream>
 #include <map>
 #include <cmath>
+#include <tuple>
 #include <vector>
 #include <array>
+#include <set>
 #include <memory>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include "gamer/BVH.h"
+#include "gamer/BufferedWriter.h"
+#include "gamer/DenseIndex.h"
+#include "gamer/KRingCache.h"
 #include "gamer/SurfaceMesh.h"
 #include "gtest/gtest.h"
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 /// Namespace for all things gamer
 namespace gamer
 {
@@ -64,4 +81,804 @@ TEST_F(SurfaceMeshTest, Smooth){
     EXPECT_EQ(fbefore, 80);
 }
 
-} // end namespace gamer
\ No newline at end of file
+TEST(SurfaceMeshNormalSmooth, ReducesNoise){
+    auto roughness = [](const SurfaceMesh &mesh){
+        REAL mean = 0, var = 0;
+        for (const auto vertexID : mesh.get_level_id<1>())
+            mean += length(*vertexID);
+        mean /= mesh.size<1>();
+        for (const auto vertexID : mesh.get_level_id<1>())
+            var += std::pow(length(*vertexID) - mean, 2);
+        return std::sqrt(var/mesh.size<1>())/mean;
+    };
+
+    auto mesh = sphere(3);
+    std::size_t i = 0;
+    for (const auto vertexID : mesh->get_level_id<1>())
+        (*vertexID).position *= 1 + 0.01*(static_cast<REAL>(i++ % 3) - 1);
+
+    // The same surface with vertices and faces inserted in reverse order
+    const std::size_t       nVertices = mesh->size<1>();
+    DenseIndex<SurfaceMesh> index(*mesh);
+    std::vector<REAL>       vertices(3*nVertices);
+    for (const auto vertexID : mesh->get_level_id<1>())
+    {
+        std::size_t v = nVertices - 1 - index[mesh->get_name(vertexID)[0]];
+        for (std::size_t k = 0; k < 3; ++k)
+            vertices[3*v+k] = (*vertexID)[k];
+    }
+    std::vector<std::array<int, 3> > faces;
+    for (const auto faceID : mesh->get_level_id<3>())
+    {
+        auto name = mesh->get_name(faceID);
+        if ((*faceID).orientation == -1)
+            std::swap(name[0], name[2]);
+        std::array<int, 3> face;
+        for (std::size_t k = 0; k < 3; ++k)
+            face[k] = static_cast<int>(nVertices - 1 - index[name[k]]);
+        faces.push_back(face);
+    }
+    std::reverse(faces.begin(), faces.end());
+    auto copy = surfaceMeshFromArrays(nVertices, vertices.data(), nullptr,
+                                      faces.size(), faces.data()->data(), nullptr);
+
+    REAL before = roughness(*mesh);
+    for (int iter = 0; iter < 3; ++iter)
+        normalSmooth(*mesh);
+    // Smooth the copy on a single thread
+#ifdef _OPENMP
+    const int nThreads = omp_get_max_threads();
+    omp_set_num_threads(1);
+#endif
+    for (int iter = 0; iter < 3; ++iter)
+        normalSmooth(*copy);
+#ifdef _OPENMP
+    omp_set_num_threads(nThreads);
+#endif
+    EXPECT_LT(roughness(*mesh), before/2);
+
+    // Independent of threading and iteration order up to rounding
+    for (const auto vertexID : mesh->get_level_id<1>())
+    {
+        int v = static_cast<int>(nVertices - 1 - index[mesh->get_name(vertexID)[0]]);
+        EXPECT_NEAR(length(*vertexID - *copy->get_simplex_up({v})), 0, 1e-12);
+    }
+}
+
+TEST(SurfaceMeshNormalSmooth, Relaxation){
+    auto noisy = [](){
+        auto mesh = sphere(2);
+        std::size_t i = 0;
+        for (const auto vertexID : mesh->get_level_id<1>())
+            (*vertexID).position *= 1 + 0.01*(static_cast<REAL>(i++ % 3) - 1);
+        return mesh;
+    };
+    auto full = noisy(), half = noisy(), original = noisy();
+    normalSmooth(*full, 1.0, 1.0);
+    normalSmooth(*half);
+
+    // The default takes half of the full step of every vertex
+    for (const auto vertexID : original->get_level_id<1>())
+    {
+        auto key = original->get_name(vertexID)[0];
+        Vector step = *full->get_simplex_up({key}) - *vertexID;
+        Vector halfStep = *half->get_simplex_up({key}) - *vertexID;
+        EXPECT_NEAR(length(step/2 - halfStep), 0, 1e-12);
+    }
+    EXPECT_THROW(normalSmooth(*full, 1.0, 0.0), std::runtime_error);
+    EXPECT_THROW(normalSmooth(*full, 1.0, 1.5), std::runtime_error);
+}
+
+TEST_F(SurfaceMeshTest, ImplicitFairing){
+    auto spike = *mesh->get_level_id<1>().begin();
+    (*spike).position *= 1.5;
+    (*spike).selected  = true;
+
+    auto fixed = sphere(0);
+    auto fixedSpike = *fixed->get_level_id<1>().begin();
+    (*fixedSpike).position *= 1.5;
+    (*fixedSpike).selected  = true;
+
+    // Only the selected vertex may move
+    implicitFairing(*fixed, 2.0, 1, true);
+    EXPECT_LT(length(*fixedSpike), 1.5);
+    for (const auto vertexID : fixed->get_level_id<1>())
+    {
+        if (vertexID != fixedSpike)
+            EXPECT_NEAR(length(*vertexID), 1, 1e-5);
+    }
+
+    REAL volume = getVolume(*mesh);
+    implicitFairing(*mesh, 0.1, 2);
+    EXPECT_LT(length(*spike), 1.5);
+    EXPECT_LT(getVolume(*mesh), volume);
+
+    EXPECT_THROW(implicitFairing(*mesh, -1.0), std::runtime_error);
+}
+
+TEST_F(SurfaceMeshTest, QualityStats){
+    auto stats = computeQualityStats(*mesh, 15, 150);
+
+    double minAngle, maxAngle;
+    int    nSmall, nLarge;
+    std::tie(minAngle, maxAngle, nSmall, nLarge) = getMinMaxAngles(*mesh, 15, 150);
+    EXPECT_NEAR(stats.summary.minAngle, minAngle, 1e-6);
+    EXPECT_NEAR(stats.summary.maxAngle, maxAngle, 1e-6);
+    EXPECT_EQ(stats.summary.nSmallAngles, nSmall);
+    EXPECT_EQ(stats.summary.nLargeAngles, nLarge);
+    EXPECT_NEAR(stats.summary.totalArea, getArea(*mesh), 1e-9);
+
+    auto angles = computeAngleSummary(*mesh, 15, 150);
+    EXPECT_EQ(angles.nFaces, 80);
+    EXPECT_EQ(angles.minAngle, stats.summary.minAngle);
+    EXPECT_EQ(angles.maxAngle, stats.summary.maxAngle);
+    EXPECT_EQ(angles.nSmallAngles, stats.summary.nSmallAngles);
+    EXPECT_EQ(angles.nLargeAngles, stats.summary.nLargeAngles);
+    EXPECT_NEAR(angles.totalArea, stats.summary.totalArea, 1e-9);
+
+    ASSERT_EQ(stats.area.size(), 80);
+    ASSERT_EQ(stats.edgeLength.size(), 120);
+    ASSERT_EQ(stats.valence.size(), 42);
+    EXPECT_EQ(stats.summary.minValence, 5);
+    EXPECT_EQ(stats.summary.maxValence, 6);
+    ASSERT_EQ(stats.valenceHistogram.size(), 7);
+    EXPECT_EQ(stats.valenceHistogram[5], 12);
+    EXPECT_EQ(stats.valenceHistogram[6], 30);
+    EXPECT_GE(stats.summary.maxAspectRatio, stats.summary.meanAspectRatio);
+    EXPECT_GE(stats.summary.meanAspectRatio, 1 - 1e-9);
+
+    std::size_t nAngles = 0;
+    for (auto count : stats.angleHistogram)
+        nAngles += count;
+    EXPECT_EQ(nAngles, 240);
+}
+
+TEST_F(SurfaceMeshTest, Curvature){
+    casc::compute_orientation(*mesh);
+    auto mdsb = curvatureViaMDSB(*mesh);
+    ASSERT_EQ(mdsb.size(), mesh->size<1>());
+    EXPECT_TRUE(mdsb.d1.empty());
+    for (std::size_t i = 0; i < mdsb.size(); ++i)
+    {
+        EXPECT_TRUE(mdsb.valid[i]);
+        EXPECT_GT(mdsb.kg[i], 0);
+    }
+
+    auto jets = curvatureViaJets(*mesh, 2, 2, true);
+    ASSERT_EQ(jets.size(), mesh->size<1>());
+    ASSERT_EQ(jets.d1.size(), mesh->size<1>());
+    for (std::size_t i = 0; i < jets.size(); ++i)
+    {
+        EXPECT_TRUE(jets.valid[i]);
+        EXPECT_NEAR(dot(jets.d1[i], jets.d2[i]), 0, 1e-6);
+    }
+
+    smoothCurvatures(*mesh, mdsb, 2);
+    for (std::size_t i = 0; i < mdsb.size(); ++i)
+        EXPECT_GT(mdsb.kg[i], 0);
+}
+
+TEST_F(SurfaceMeshTest, Topology){
+    auto betti = getBettiNumbers(*mesh);
+    EXPECT_TRUE(std::get<0>(betti));
+    EXPECT_EQ(std::get<1>(betti), 1);
+    EXPECT_EQ(std::get<2>(betti), 0);
+    EXPECT_EQ(std::get<3>(betti), 1);
+
+    auto topology = analyzeTopology(*mesh);
+    ASSERT_EQ(topology.components.size(), 1);
+    EXPECT_EQ(topology.components[0].eulerCharacteristic(), 2);
+    EXPECT_EQ(topology.components[0].nBoundaryLoops, 0);
+    EXPECT_TRUE(topology.components[0].orientable);
+}
+
+TEST(SurfaceMeshSplit, Components){
+    // Two tetrahedra, the second with inconsistent windings, and a triangle
+    std::vector<REAL> vertices = {0,0,0, 1,0,0, 0,1,0, 0,0,1,
+                                  5,0,0, 6,0,0, 5,1,0, 5,0,1,
+                                  9,0,0, 10,0,0, 9,1,0};
+    std::vector<int> faces = {0,2,1, 0,1,3, 0,3,2, 1,2,3,
+                              4,6,5, 4,5,7, 4,7,6, 5,7,6,
+                              8,9,10};
+    auto mesh = surfaceMeshFromArrays(11, vertices.data(), nullptr,
+                                      9, faces.data(), nullptr);
+
+    auto topology = analyzeTopology(*mesh);
+    ASSERT_EQ(topology.components.size(), 3);
+    EXPECT_EQ(topology.components[0].nFaces, 4);
+    EXPECT_EQ(topology.components[1].nEdges, 6);
+    EXPECT_EQ(topology.components[2].nBoundaryLoops, 1);
+    EXPECT_EQ(topology.components[2].eulerCharacteristic(), 1);
+
+    auto betti = getBettiNumbers(*mesh);
+    EXPECT_EQ(std::get<1>(betti), 3);
+    EXPECT_EQ(std::get<2>(betti), 0);
+    EXPECT_EQ(std::get<3>(betti), 2);
+
+    auto meshes = splitSurfaces(*mesh);
+    ASSERT_EQ(meshes.size(), 3);
+    EXPECT_NEAR(getVolume(*meshes[0]), 1.0/6, 1e-12);
+    EXPECT_NEAR(getVolume(*meshes[1]), 1.0/6, 1e-12);
+    EXPECT_EQ(meshes[2]->size<3>(), 1);
+}
+
+TEST(SurfaceMeshFromArrays, OrientationAndDegenerateFaces){
+    std::vector<REAL> vertices = {0,0,0, 1,0,0, 0,1,0, 0,0,1};
+    // The last face is wound against the others
+    std::vector<int> faces = {0,2,1, 0,1,3, 0,3,2, 1,3,2};
+    auto mesh = surfaceMeshFromArrays(4, vertices.data(), nullptr,
+                                      4, faces.data(), nullptr);
+    EXPECT_TRUE(std::get<1>(casc::check_orientation(*mesh)));
+    EXPECT_NEAR(std::abs(getVolume(*mesh)), 1.0/6, 1e-12);
+
+    std::vector<int> degenerate = {0,2,1, 0,1,1};
+    EXPECT_THROW(surfaceMeshFromArrays(4, vertices.data(), nullptr,
+                                       2, degenerate.data(), nullptr),
+                 std::runtime_error);
+}
+
+TEST_F(SurfaceMeshTest, BVH){
+    casc::compute_orientation(*mesh);
+    FaceBVH bvh(*mesh);
+    ASSERT_EQ(bvh.size(), mesh->size<3>());
+    EXPECT_EQ(bvh.overlapBox(bvh.bounds()).size(), bvh.size());
+
+    RayHit hit;
+    ASSERT_TRUE(bvh.intersectRay(Vector({0,0,0}), Vector({1,0,0}), hit));
+    EXPECT_GT(hit.t, 0.9);
+    EXPECT_LE(hit.t, 1.0 + 1e-6);
+    // Triangles are stored in winding order with outward normals
+    auto tri = bvh.triangle(hit.face);
+    EXPECT_GT(dot(cross(tri[1]-tri[0], tri[2]-tri[0]), Vector({1,0,0})), 0);
+    EXPECT_EQ(bvh.intersectRayAll(Vector({-2,0.1,0.05}), Vector({1,0,0})).size(), 2);
+
+    auto closest = bvh.closestPoint(Vector({0,0,2}));
+    ASSERT_LT(closest.face, bvh.size());
+    EXPECT_NEAR(std::sqrt(closest.squaredDistance), 1, 1e-5);
+    EXPECT_EQ(bvh.closestPoint(Vector({0,0,2}), 0.5).face, bvh.size());
+
+    EXPECT_TRUE(bvh.contains(Vector({0.1,0.2,0.3})));
+    EXPECT_FALSE(bvh.contains(Vector({2,0,0})));
+
+    // A face touches itself and its neighbours
+    auto face = bvh.triangle(0);
+    EXPECT_GE(bvh.overlapTriangle(face[0], face[1], face[2]).size(), 4);
+
+    scale(*mesh, 2.0);
+    bvh.refit();
+    ASSERT_TRUE(bvh.intersectRay(Vector({0,0,0}), Vector({1,0,0}), hit));
+    EXPECT_GT(hit.t, 1.8);
+}
+
+TEST_F(SurfaceMeshTest, KRingCache){
+    casc::compute_orientation(*mesh);
+    KRingCache cache(*mesh, 2);
+
+    auto matches = [&](){
+        for (const auto vertexID : mesh->get_level_id<1>())
+        {
+            std::set<SurfaceMesh::SimplexID<1> > expected;
+            casc::kneighbors_up(*mesh, vertexID, 2, expected);
+            auto ring = cache[vertexID];
+            if (ring.empty() || ring[0] != vertexID)
+                return false;
+            std::set<SurfaceMesh::SimplexID<1> > nbors(ring.begin(), ring.end());
+            if (nbors != expected || nbors.size() != ring.size())
+                return false;
+            // Same order as vertexGrabber, which curvatureViaJets relies on
+            std::vector<SurfaceMesh::SimplexID<1> > grabbed = {vertexID};
+            surfacemesh_detail::vertexGrabber(*mesh, ring.size() - 1, grabbed, vertexID);
+            if (!std::equal(grabbed.begin(), grabbed.end(), ring.begin()))
+                return false;
+        }
+        return true;
+    };
+    EXPECT_TRUE(matches());
+    // Vertex 0 of the icosphere has valence 5
+    EXPECT_EQ(cache[mesh->get_simplex_up({0})].size(), 16);
+
+    surfacemesh_detail::decimateVertex(*mesh, mesh->get_simplex_up({0}), cache);
+    surfacemesh_detail::decimateVertex(*mesh, mesh->get_simplex_up({8}), cache);
+    EXPECT_EQ(mesh->size<1>(), 40);
+    EXPECT_TRUE(matches());
+
+    // Flip an edge away from the decimated vertices
+    auto vertexID = mesh->get_simplex_up({30});
+    cache.invalidate(vertexID);
+    surfacemesh_detail::edgeFlip(*mesh, *mesh->up(vertexID).begin());
+    cache.refresh();
+    EXPECT_TRUE(matches());
+}
+
+TEST_F(SurfaceMeshTest, DecimateVertexSmoothingRings){
+    // A wider cache for the LST must not widen the smoothing
+    auto reference = sphere(0);
+    casc::compute_orientation(*mesh);
+    casc::compute_orientation(*reference);
+    KRingCache cache(*mesh, 3);
+    surfacemesh_detail::decimateVertex(*mesh, mesh->get_simplex_up({0}), cache);
+    surfacemesh_detail::decimateVertex(*reference, reference->get_simplex_up({0}), 2);
+
+    ASSERT_EQ(mesh->size<1>(), reference->size<1>());
+    for (const auto vertexID : reference->get_level_id<1>())
+    {
+        auto key = reference->get_name(vertexID)[0];
+        auto other = mesh->get_simplex_up({key});
+        ASSERT_NE(other, nullptr);
+        EXPECT_LT(length((*other).position - (*vertexID).position), 1e-12);
+    }
+}
+
+TEST_F(SurfaceMeshTest, Intersections){
+    casc::compute_orientation(*mesh);
+    EXPECT_TRUE(findIntersections({mesh.get()}).empty());
+
+    // Coincident surfaces share an interface rather than intersect
+    auto other = sphere(0);
+    EXPECT_TRUE(findIntersections({mesh.get(), other.get()}).empty());
+
+    // Overlapping spheres intersect each other but not themselves
+    translate(*other, Vector({0.5, 0, 0}));
+    auto between = findIntersections({mesh.get(), other.get()}, false, 7);
+    ASSERT_FALSE(between.empty());
+    for (const auto &intersection : between)
+    {
+        EXPECT_EQ(intersection.firstMesh, 0);
+        EXPECT_EQ(intersection.secondMesh, 1);
+        EXPECT_EQ((*intersection.firstFace).marker, 7);
+        EXPECT_EQ((*intersection.secondFace).marker, 7);
+    }
+
+    // Pushing the north pole through the south pole folds the surface
+    (*mesh->get_simplex_up({11})).position = Vector({0, 0, -1.5});
+    auto within = findIntersections({mesh.get()}, true);
+    ASSERT_FALSE(within.empty());
+    EXPECT_TRUE((*within[0].firstFace).selected);
+    EXPECT_TRUE((*within[0].secondFace).selected);
+}
+
+TEST_F(SurfaceMeshTest, Distance){
+    auto same = surfaceDistance(*mesh, *mesh);
+    EXPECT_NEAR(same.hausdorff(), 0, 1e-12);
+    EXPECT_NEAR(same.forward.rms, 0, 1e-12);
+
+    auto shifted = sphere(0);
+    translate(*shifted, Vector({0, 0, 0.1}));
+    auto distance = surfaceDistance(*mesh, *shifted, 3, true);
+    EXPECT_GT(distance.hausdorff(), 0.05);
+    EXPECT_LE(distance.hausdorff(), 0.1 + 1e-6);
+    EXPECT_LE(distance.forward.mean, distance.forward.rms);
+    EXPECT_LE(distance.forward.rms, distance.forward.max);
+    ASSERT_EQ(distance.forward.deviations.size(), mesh->size<1>());
+    for (auto d : distance.forward.deviations)
+        EXPECT_LE(d, distance.forward.max);
+
+    auto oneSided = oneSidedDistance(*mesh, *shifted, 3);
+    EXPECT_DOUBLE_EQ(oneSided.max, distance.forward.max);
+    EXPECT_TRUE(oneSided.deviations.empty());
+}
+
+TEST(SurfaceMeshRemesh, TargetLength){
+    auto input  = sphere(3);
+    auto result = isotropicRemesh(*input, 0.2);
+
+    REAL total = 0;
+    for (const auto edgeID : result->get_level_id<2>())
+    {
+        auto name = result->get_name(edgeID);
+        total += length(*result->get_simplex_up({name[0]}) - *result->get_simplex_up({name[1]}));
+    }
+    EXPECT_NEAR(total/result->size<2>(), 0.2, 0.03);
+
+    auto topology = analyzeTopology(*result);
+    ASSERT_EQ(topology.components.size(), 1);
+    EXPECT_TRUE(topology.components[0].manifold);
+    EXPECT_EQ(topology.components[0].nBoundaryLoops, 0);
+    EXPECT_EQ(topology.components[0].eulerCharacteristic(), 2);
+    EXPECT_LT(surfaceDistance(*input, *result).hausdorff(), 0.05);
+
+    EXPECT_THROW(isotropicRemesh(*input, 0.0), std::runtime_error);
+}
+
+TEST(SurfaceMeshRemesh, FeatureLines){
+    // Vertices where the two markers meet must stay on the input interface
+    auto input = sphere(3);
+    for (const auto faceID : input->get_level_id<3>())
+    {
+        auto name = input->get_name(faceID);
+        Vector centroid;
+        for (auto key : name)
+            centroid += (*input->get_simplex_up({key})).position;
+        (*faceID).marker = (centroid[0] > 0) ? 2 : 1;
+    }
+    auto interfaceVertices = [](const SurfaceMesh &surface){
+        std::map<int, std::set<int> > markers;
+        for (const auto faceID : surface.get_level_id<3>())
+        {
+            for (auto key : surface.get_name(faceID))
+                markers[key].insert((*faceID).marker);
+        }
+        std::set<int> keys;
+        for (const auto &entry : markers)
+        {
+            if (entry.second.size() > 1)
+                keys.insert(entry.first);
+        }
+        return keys;
+    };
+    auto inputInterface = interfaceVertices(*input);
+    std::vector<std::array<Vector, 2> > segments;
+    for (const auto edgeID : input->get_level_id<2>())
+    {
+        auto name = input->get_name(edgeID);
+        std::set<int> markers;
+        for (auto faceID : input->up(edgeID))
+            markers.insert((*faceID).marker);
+        if (markers.size() > 1)
+            segments.push_back({{(*input->get_simplex_up({name[0]})).position,
+                                 (*input->get_simplex_up({name[1]})).position}});
+    }
+    ASSERT_FALSE(segments.empty());
+
+    auto result = isotropicRemesh(*input, 0.15);
+    auto resultInterface = interfaceVertices(*result);
+    EXPECT_FALSE(resultInterface.empty());
+    for (auto key : resultInterface)
+    {
+        Vector p = (*result->get_simplex_up({key})).position;
+        REAL   distance = std::numeric_limits<REAL>::infinity();
+        for (const auto &segment : segments)
+        {
+            Vector d = segment[1] - segment[0];
+            REAL   t = std::max(REAL(0), std::min(REAL(1), dot(p - segment[0], d)/dot(d, d)));
+            Vector r = p - (segment[0] + t*d);
+            distance = std::min(distance, std::sqrt(dot(r, r)));
+        }
+        EXPECT_LT(distance, 1e-9);
+    }
+}
+
+TEST_F(SurfaceMeshTest, AdaptiveRefine){
+    auto faceID = *mesh->get_level_id<3>().begin();
+    (*faceID).selected = true;
+    (*faceID).marker   = 7;
+    auto name = mesh->get_name(faceID);
+    (*mesh->get_simplex_up({name[0], name[1]})).selected = true;
+
+    // One face quadrisected and its three neighbours bisected
+    auto refined = adaptiveRefine(*mesh);
+    EXPECT_EQ(refined->size<3>(), mesh->size<3>() + 6);
+    EXPECT_EQ(refined->size<1>(), mesh->size<1>() + 3);
+    std::size_t nSelected = 0, nMarked = 0, nSelectedEdges = 0;
+    for (const auto face : refined->get_level_id<3>())
+    {
+        nSelected += (*face).selected;
+        nMarked   += (*face).marker == 7;
+    }
+    for (const auto edge : refined->get_level_id<2>())
+        nSelectedEdges += (*edge).selected;
+    EXPECT_EQ(nSelected, 4);
+    EXPECT_EQ(nMarked, 4);
+    EXPECT_EQ(nSelectedEdges, 2);
+
+    auto topology = analyzeTopology(*refined);
+    ASSERT_EQ(topology.components.size(), 1);
+    EXPECT_EQ(topology.components[0].nBoundaryLoops, 0);
+    EXPECT_EQ(topology.components[0].eulerCharacteristic(), 2);
+
+    auto graded = adaptiveRefine(*mesh, [](const Vector &p){ return p[2] > 0.5 ? 0.3 : 10; });
+    EXPECT_GT(graded->size<3>(), mesh->size<3>());
+    for (const auto edgeID : graded->get_level_id<2>())
+    {
+        auto edge = graded->get_name(edgeID);
+        Vector a = *graded->get_simplex_up({edge[0]});
+        Vector b = *graded->get_simplex_up({edge[1]});
+        if ((a + b)[2]/2 > 0.5)
+            EXPECT_LE(length(a - b), 0.3);
+    }
+}
+
+TEST_F(SurfaceMeshTest, AdaptiveRefineAngles){
+    auto minAngle = [](const SurfaceMesh &surface){
+        REAL result = M_PI;
+        for (const auto faceID : surface.get_level_id<3>())
+        {
+            auto name = surface.get_name(faceID);
+            for (std::size_t k = 0; k < 3; ++k)
+            {
+                result = std::min(result, angle(*surface.get_simplex_up({name[(k+1)%3]}),
+                                                *surface.get_simplex_up({name[k]}),
+                                                *surface.get_simplex_up({name[(k+2)%3]})));
+            }
+        }
+        return result;
+    };
+
+    // Each level bisects the faces next to the previous one. Bisecting the
+    // same faces again would halve the smallest angle at every level.
+    REAL before = minAngle(*mesh);
+    for (REAL target : {0.2, 0.1, 0.05})
+    {
+        auto graded = adaptiveRefine(*mesh, [target](const Vector &p){ return p[2] > 0.3 ? target : 10; }, 8);
+        EXPECT_GT(minAngle(*graded), before/3);
+    }
+}
+
+/**
+ * @brief      Write a mesh to a file, read it back and delete the file
+ */
+template <typename Write, typename Read>
+std::unique_ptr<SurfaceMesh> roundTrip(const SurfaceMesh &mesh, const std::string &filename,
+                                       Write &&write, Read &&read)
+{
+    write(filename, mesh);
+    auto result = read(filename);
+    std::remove(filename.c_str());
+    return result;
+}
+
+/**
+ * @brief      Check that a mesh read back has the connectivity and volume of
+ *             the mesh written
+ */
+void expectSameSurface(const SurfaceMesh &result, const SurfaceMesh &mesh, REAL tolerance)
+{
+    EXPECT_EQ(result.size<1>(), mesh.size<1>());
+    EXPECT_EQ(result.size<2>(), mesh.size<2>());
+    EXPECT_EQ(result.size<3>(), mesh.size<3>());
+    EXPECT_NEAR(getVolume(result), getVolume(mesh), tolerance);
+}
+
+TEST_F(SurfaceMeshTest, MSHRoundTrip){
+    for (auto &fdata : mesh->get_level<3>())
+        fdata.marker = 3;
+    auto result = roundTrip(*mesh, "gamer_surfmesh_test.msh",
+        [](const std::string &filename, const SurfaceMesh &surface){ writeMSH(filename, surface); },
+        [](const std::string &filename){ return readMSH_SurfaceMesh(filename); });
+
+    ASSERT_NE(result, nullptr);
+    expectSameSurface(*result, *mesh, 1e-10);
+    for (const auto &fdata : result->get_level<3>())
+        EXPECT_EQ(fdata.marker, 3);
+    // Vertices keep their order
+    auto before = mesh->get_level<1>().begin();
+    for (const auto &vdata : result->get_level<1>())
+        EXPECT_EQ(vdata.position, (*before++).position);
+}
+
+TEST_F(SurfaceMeshTest, MSHUnmarkedFaces){
+    // Faces without a physical tag read back with the default marker
+    auto result = roundTrip(*mesh, "gamer_surfmesh_test_unmarked.msh",
+        [](const std::string &filename, const SurfaceMesh &surface){ writeMSH(filename, surface); },
+        [](const std::string &filename){ return readMSH_SurfaceMesh(filename); });
+    for (const auto &fdata : result->get_level<3>())
+        EXPECT_EQ(fdata.marker, -1);
+
+    // Nodes need an entity to belong to
+    SurfaceMesh points;
+    points.insert<1>({0});
+    EXPECT_THROW(writeMSH("gamer_surfmesh_test_points.msh", points), std::runtime_error);
+}
+
+TEST(SurfaceMeshIO, MSHSkipsUnknownElements){
+    const std::string filename = "gamer_surfmesh_test_unknown.msh";
+    {
+        std::ofstream fout(filename, std::ios::binary);
+        auto put = [&fout](auto value){
+            fout.write(reinterpret_cast<const char*>(&value), sizeof(value));
+        };
+        fout << "$MeshFormat\n4.1 1 8\n";
+        put(int(1));
+        fout << "\n$EndMeshFormat\n$Nodes\n";
+        for (std::uint64_t v : {1, 3, 1, 3})
+            put(v);
+        for (int v : {2, 1, 0})
+            put(v);
+        put(std::uint64_t(3));
+        for (std::uint64_t tag : {1, 2, 3})
+            put(tag);
+        for (double x : {0, 0, 0, 1, 0, 0, 0, 1, 0})
+            put(x);
+        fout << "\n$EndNodes\n$Elements\n";
+        for (std::uint64_t v : {2, 2, 1, 2})
+            put(v);
+        // A block of a type which is not in the table, with five nodes
+        for (int v : {2, 1, 999})
+            put(v);
+        for (std::uint64_t v : {1, 1, 1, 2, 3, 1, 2})
+            put(v);
+        for (int v : {2, 1, 2})
+            put(v);
+        for (std::uint64_t v : {1, 2, 1, 2, 3})
+            put(v);
+        fout << "\n$EndElements\n";
+    }
+    auto result = readMSH_SurfaceMesh(filename);
+    std::remove(filename.c_str());
+
+    EXPECT_EQ(result->size<1>(), 3);
+    EXPECT_EQ(result->size<3>(), 1);
+}
+
+TEST_F(SurfaceMeshTest, PLYRoundTrip){
+    for (auto &fdata : mesh->get_level<3>())
+        fdata.marker = 3;
+    for (auto &vdata : mesh->get_level<1>())
+        vdata.marker = 2;
+    (**mesh->get_level_id<1>().begin()).selected = true;
+    std::vector<REAL> field(mesh->size<1>(), 1.5);
+    std::map<std::string, std::vector<REAL> > fields;
+    auto result = roundTrip(*mesh, "gamer_surfmesh_test.ply",
+        [&](const std::string &filename, const SurfaceMesh &surface){ writePLY(filename, surface, false, {{"kh", field}}); },
+        [&](const std::string &filename){ return readPLY(filename, &fields); });
+
+    ASSERT_NE(result, nullptr);
+    expectSameSurface(*result, *mesh, 1e-10);
+    for (const auto &fdata : result->get_level<3>())
+        EXPECT_EQ(fdata.marker, 3);
+    int selected = 0;
+    for (const auto &vdata : result->get_level<1>())
+    {
+        EXPECT_EQ(vdata.marker, 2);
+        selected += vdata.selected;
+    }
+    EXPECT_EQ(selected, 1);
+    ASSERT_EQ(fields.count("kh"), 1);
+    EXPECT_EQ(fields["kh"], field);
+}
+
+TEST_F(SurfaceMeshTest, SnapshotRoundTrip){
+    (*mesh->get_simplex_up()).marker = 9;
+    for (auto &fdata : mesh->get_level<3>())
+        fdata.marker = 3;
+    (**mesh->get_level_id<3>().begin()).selected = true;
+    std::vector<REAL> field(mesh->size<1>(), 1.5);
+    std::map<std::string, std::vector<REAL> > fields;
+    auto result = roundTrip(*mesh, "gamer_surfmesh_test.snap",
+        [&](const std::string &filename, const SurfaceMesh &surface){ writeSnapshot(filename, surface, {{"kh", field}}); },
+        [&](const std::string &filename){ return readSnapshot_SurfaceMesh(filename, &fields); });
+
+    ASSERT_NE(result, nullptr);
+    // Binary snapshots are exact
+    expectSameSurface(*result, *mesh, 0);
+    EXPECT_EQ((*result->get_simplex_up()).marker, 9);
+    int selected = 0;
+    for (const auto &fdata : result->get_level<3>())
+    {
+        EXPECT_EQ(fdata.marker, 3);
+        selected += fdata.selected;
+    }
+    EXPECT_EQ(selected, 1);
+    EXPECT_EQ(fields["kh"], field);
+}
+
+TEST_F(SurfaceMeshTest, SnapshotRoundTripAfterEdits){
+    // Reinserting a vertex moves it in get_level_id<1>() order, so the dense
+    // indices of its faces need not be in the order of their keys
+    auto vertexID = mesh->get_simplex_up({3});
+    SMVertex vertex = *vertexID;
+    std::vector<std::pair<std::array<int, 3>, int> > star;
+    for (auto faceID : mesh->get_level_id<3>())
+    {
+        auto w = mesh->get_name(faceID);
+        if (w[0] == 3 || w[1] == 3 || w[2] == 3)
+            star.emplace_back(w, (*faceID).orientation);
+    }
+    ASSERT_EQ(star.size(), 5);
+    mesh->remove({3});
+    mesh->insert<1>({3}, vertex);
+    for (const auto &face : star)
+    {
+        const auto &w = face.first;
+        mesh->insert<3>({w[0], w[1], w[2]}, SMFace(face.second, -1, false));
+    }
+    casc::init_orientation(*mesh);
+
+    auto result = roundTrip(*mesh, "gamer_surfmesh_test.snap",
+        [](const std::string &filename, const SurfaceMesh &surface){ writeSnapshot(filename, surface); },
+        [](const std::string &filename){ return readSnapshot_SurfaceMesh(filename); });
+
+    ASSERT_NE(result, nullptr);
+    expectSameSurface(*result, *mesh, 0);
+    DenseIndex<SurfaceMesh> sigma(*mesh);
+    for (auto faceID : mesh->get_level_id<3>())
+    {
+        auto w = mesh->get_name(faceID);
+        auto resultID = result->get_simplex_up({static_cast<int>(sigma[w[0]]),
+                                                static_cast<int>(sigma[w[1]]),
+                                                static_cast<int>(sigma[w[2]])});
+        ASSERT_NE(resultID, nullptr);
+        EXPECT_GT(dot(getNormal(*mesh, faceID), getNormal(*result, resultID)), 0);
+    }
+}
+
+TEST_F(SurfaceMeshTest, OBJRoundTrip){
+    auto result = roundTrip(*mesh, "gamer_surfmesh_test.obj",
+        [](const std::string &filename, const SurfaceMesh &surface){ writeOBJ(filename, surface); },
+        [](const std::string &filename){ return readOBJ(filename); });
+
+    ASSERT_NE(result, nullptr);
+    expectSameSurface(*result, *mesh, 1e-6);
+    // OBJ indices count from one and so do the vertex keys
+    int n = static_cast<int>(mesh->size<1>());
+    EXPECT_EQ(result->get_simplex_up({0}), nullptr);
+    EXPECT_NE(result->get_simplex_up({1}), nullptr);
+    EXPECT_NE(result->get_simplex_up({n}), nullptr);
+}
+
+TEST_F(SurfaceMeshTest, OFFRoundTrip){
+    auto result = roundTrip(*mesh, "gamer_surfmesh_test.off",
+        [](const std::string &filename, const SurfaceMesh &surface){ writeOFF(filename, surface); },
+        [](const std::string &filename){ return readOFF(filename); });
+
+    ASSERT_NE(result, nullptr);
+    expectSameSurface(*result, *mesh, 1e-6);
+    int n = static_cast<int>(mesh->size<1>());
+    EXPECT_NE(result->get_simplex_up({0}), nullptr);
+    EXPECT_EQ(result->get_simplex_up({n}), nullptr);
+}
+
+TEST(SurfaceMeshIO, OFFInconsistentWinding){
+    // A tetrahedron with its last face wound against the others
+    const std::string filename = "gamer_surfmesh_test_winding.off";
+    {
+        std::ofstream fout(filename);
+        fout << "OFF\n4 4 0\n0 0 0\n1 0 0\n0 1 0\n0 0 1\n"
+             << "3 0 2 1\n3 0 1 3\n3 0 3 2\n3 1 3 2\n";
+    }
+    auto result = readOFF(filename);
+    std::remove(filename.c_str());
+
+    EXPECT_TRUE(std::get<1>(casc::check_orientation(*result)));
+    EXPECT_NEAR(std::abs(getVolume(*result)), 1.0/6, 1e-12);
+}
+
+TEST(SurfaceMeshIO, MissingFileThrows){
+    const std::string filename = "gamer_surfmesh_test_missing";
+    EXPECT_THROW(readOBJ(filename), std::runtime_error);
+    EXPECT_THROW(readOFF(filename), std::runtime_error);
+    EXPECT_THROW(readPLY(filename), std::runtime_error);
+    EXPECT_THROW(readSnapshot_SurfaceMesh(filename), std::runtime_error);
+}
+
+TEST(SurfaceMeshIO, MalformedFileThrows){
+    const std::string filename = "gamer_surfmesh_test_bad.obj";
+    {
+        std::ofstream fout(filename);
+        fout << "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 4\n";
+    }
+    EXPECT_THROW(readOBJ(filename), std::runtime_error);
+    std::remove(filename.c_str());
+}
+
+TEST(DenseIndex, SparseKeys){
+    SurfaceMesh mesh;
+    mesh.insert<1>({7}, SMVertex(0, 0, 0));
+    mesh.insert<1>({3}, SMVertex(1, 0, 0));
+    mesh.insert<1>({12}, SMVertex(0, 1, 0));
+
+    DenseIndex<SurfaceMesh> sigma(mesh, 1);
+    EXPECT_EQ(sigma.size(), 3);
+    std::size_t expected = 1;
+    for (const auto vertexID : mesh.get_level_id<1>())
+        EXPECT_EQ(sigma[vertexID.indices()[0]], expected++);
+}
+
+TEST(BufferedWriter, FormatsLikeOstream){
+    std::ostringstream expected, result;
+    {
+        BufferedWriter out(result);
+        out.precision(10);
+        expected.precision(10);
+        for (double value : {0.0, -1.5, 1e-5, 123456789.123456, 1e20})
+        {
+            out << value << " ";
+            expected << value << " ";
+        }
+        out << FieldWidth{4} << 3 << " " << std::size_t(42) << " " << -17 << "\n";
+        expected << std::setw(4) << 3 << " " << std::size_t(42) << " " << -17 << "\n";
+    }
+    EXPECT_EQ(result.str(), expected.str());
+}
+
+} // end namespace gamer
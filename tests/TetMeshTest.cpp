@@ -0,0 +1,289 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+#include "gamer/TetMesh.h"
+#include "gtest/gtest.h"
+
+/// Namespace for all things gamer
+namespace gamer
+{
+
+
+class TetMeshTest : public testing::Test {
+protected:
+    TetMeshTest() {}
+    ~TetMeshTest() {}
+
+    virtual void SetUp() {
+        // Two tetrahedra sharing the face {1,2,3}
+        std::vector<REAL> vertices = {0,0,0, 1,0,0, 0,1,0, 0,0,1, 1,1,1};
+        std::vector<int>  cells    = {0,1,2,3, 1,2,3,4};
+        std::vector<int>  cellMarkers = {5, 7};
+        std::vector<int>  faces    = {0,1,2};
+        std::vector<int>  faceMarkers = {23};
+        mesh = tetMeshFromArrays(5, vertices.data(), nullptr,
+                                 2, cells.data(), cellMarkers.data(),
+                                 1, faces.data(), faceMarkers.data());
+    }
+    virtual void TearDown() {}
+
+    std::unique_ptr<TetMesh> mesh;
+};
+
+TEST_F(TetMeshTest, FromArrays){
+    EXPECT_EQ(mesh->size<1>(), 5);
+    EXPECT_EQ(mesh->size<2>(), 9);
+    EXPECT_EQ(mesh->size<3>(), 7);
+    EXPECT_EQ(mesh->size<4>(), 2);
+    EXPECT_EQ((*mesh->get_simplex_up({0,1,2,3})).marker, 5);
+    EXPECT_EQ((*mesh->get_simplex_up({0,1,2})).marker, 23);
+    EXPECT_EQ((*mesh->get_simplex_up({1,2,3})).marker, 0);
+}
+
+TEST_F(TetMeshTest, DolfinRoundTrip){
+    std::string filename = "gamer_tetmesh_test.xml";
+    writeDolfin(filename, *mesh);
+    auto result = readDolfin(filename);
+    std::remove(filename.c_str());
+
+    ASSERT_NE(result, nullptr);
+    EXPECT_EQ(result->size<1>(), mesh->size<1>());
+    EXPECT_EQ(result->size<3>(), mesh->size<3>());
+    EXPECT_EQ(result->size<4>(), mesh->size<4>());
+    EXPECT_EQ((*result->get_simplex_up({1,2,3,4})).marker, 7);
+    EXPECT_EQ((*result->get_simplex_up({0,1,2})).marker, 23);
+}
+
+TEST_F(TetMeshTest, DolfinWhitespaceAndAttributeOrder){
+    std::string filename = "gamer_tetmesh_test_ws.xml";
+    {
+        std::ofstream fout(filename);
+        fout << "<?xml version=\"1.0\"?>\n"
+             << "<!-- comment -->\n"
+             << "<dolfin><mesh dim='3' celltype='tetrahedron'>"
+             << "<vertices size=\"4\">\n"
+             << "<vertex x=\"0\" y=\"0\" z=\"0\" index=\"0\"/>"
+             << "<vertex index=\"1\"\n    x=\"1\" y=\"0\" z=\"0\" />\n"
+             << "<vertex  index = \"2\" x=\"0\" y=\"1\" z=\"0\"/>\n"
+             << "<vertex z=\"1\" y=\"0\" x=\"0\" index=\"3\"/>\n"
+             << "</vertices><cells size=\"1\">"
+             << "<tetrahedron v3=\"3\" v2=\"2\" v1=\"1\" v0=\"0\" index=\"0\"/>"
+             << "</cells><domains>"
+             << "<mesh_value_collection dim=\"2\" name=\"m\" type=\"uint\" size=\"1\">"
+             << "<value value=\"4\" local_entity=\"3\" cell_index=\"0\"/>"
+             << "</mesh_value_collection>"
+             << "</domains></mesh></dolfin>";
+    }
+    auto result = readDolfin(filename);
+    std::remove(filename.c_str());
+
+    ASSERT_NE(result, nullptr);
+    EXPECT_EQ(result->size<1>(), 4);
+    EXPECT_EQ(result->size<4>(), 1);
+    EXPECT_EQ((*result->get_simplex_up({0,1,2})).marker, 4);
+    EXPECT_EQ((*result->get_simplex_up({3})).position[2], 1);
+}
+
+TEST(TetMeshIO, DolfinInvalidSizes){
+    std::string filename = "gamer_tetmesh_test_size.xml";
+    for (const std::string size : {"-1", "1000000000"})
+    {
+        {
+            std::ofstream fout(filename);
+            fout << "<dolfin><mesh celltype='tetrahedron'><vertices size=\"" << size
+                 << "\"></vertices></mesh></dolfin>";
+        }
+        EXPECT_THROW(readDolfin(filename), std::runtime_error);
+    }
+    std::remove(filename.c_str());
+
+    // Marked faces must belong to a cell
+    std::vector<REAL> vertices = {0,0,0, 1,0,0, 0,1,0, 0,0,1, 1,1,1};
+    std::vector<int>  cells    = {0,1,2,3};
+    std::vector<int>  faces    = {1,2,4};
+    std::vector<int>  markers  = {5};
+    EXPECT_THROW(tetMeshFromArrays(5, vertices.data(), nullptr, 1, cells.data(), nullptr,
+                                   1, faces.data(), markers.data()),
+                 std::runtime_error);
+}
+
+TEST_F(TetMeshTest, MSHRoundTrip){
+    std::string filename = "gamer_tetmesh_test.msh";
+    writeMSH(filename, *mesh);
+    auto result = readMSH_TetMesh(filename);
+    std::remove(filename.c_str());
+
+    ASSERT_NE(result, nullptr);
+    EXPECT_EQ(result->size<1>(), mesh->size<1>());
+    EXPECT_EQ(result->size<3>(), mesh->size<3>());
+    EXPECT_EQ(result->size<4>(), mesh->size<4>());
+    EXPECT_EQ((*result->get_simplex_up({0,1,2,3})).marker, 5);
+    EXPECT_EQ((*result->get_simplex_up({1,2,3,4})).marker, 7);
+    EXPECT_EQ((*result->get_simplex_up({0,1,2})).marker, 23);
+    EXPECT_EQ((*result->get_simplex_up({4})).position[0], 1);
+}
+
+TEST_F(TetMeshTest, VTUWrite){
+    std::size_t nFaces = 0;
+    for (const auto &fdata : mesh->get_level<3>())
+        nFaces += fdata.marker != 0;
+    const std::size_t nElements = mesh->size<4>() + nFaces;
+
+    std::string filename = "gamer_tetmesh_test.vtu";
+    writeVTU(filename, *mesh, {{"kh", std::vector<REAL>(5, 0.5)}});
+    std::ifstream fin(filename, std::ios::binary);
+    std::string contents((std::istreambuf_iterator<char>(fin)), std::istreambuf_iterator<char>());
+    fin.close();
+    std::remove(filename.c_str());
+
+    EXPECT_EQ(contents.compare(0, 21, "<?xml version=\"1.0\"?>"), 0);
+    EXPECT_NE(contents.find("header_type=\"UInt64\""), std::string::npos);
+    EXPECT_NE(contents.find("NumberOfPoints=\"5\" NumberOfCells=\"" + std::to_string(nElements) + "\""),
+              std::string::npos);
+
+    // Block sizes in the order the arrays are declared
+    std::vector<std::uint64_t> sizes = {
+        5*sizeof(std::int32_t),                                  // vertex_marker
+        5*sizeof(double),                                        // kh
+        nElements*sizeof(std::int32_t),                          // marker
+        nElements,                                               // dimension
+        3*5*sizeof(double),                                      // Points
+        (4*mesh->size<4>() + 3*nFaces)*sizeof(std::int64_t),     // connectivity
+        nElements*sizeof(std::int64_t),                          // offsets
+        nElements                                                // types
+    };
+    std::vector<std::uint64_t> offsets;
+    for (std::size_t pos = contents.find("offset=\""); pos != std::string::npos;
+         pos = contents.find("offset=\"", pos + 1))
+        offsets.push_back(std::stoull(contents.substr(pos + 8)));
+    ASSERT_EQ(offsets.size(), sizes.size());
+
+    const std::string marker = "<AppendedData encoding=\"raw\">\n_";
+    const std::size_t start = contents.find(marker);
+    ASSERT_NE(start, std::string::npos);
+    const std::size_t base = start + marker.size();
+    std::uint64_t expected = 0;
+    for (std::size_t i = 0; i < sizes.size(); ++i)
+    {
+        EXPECT_EQ(offsets[i], expected);
+        std::uint64_t size;
+        std::memcpy(&size, contents.data() + base + offsets[i], sizeof(size));
+        EXPECT_EQ(size, sizes[i]);
+        expected += sizeof(std::uint64_t) + sizes[i];
+    }
+    EXPECT_EQ(contents.compare(base + expected, 17, "\n  </AppendedData"), 0);
+}
+
+TEST_F(TetMeshTest, SnapshotRoundTrip){
+    (*mesh->get_simplex_up({1,2,3})).selected = true;
+    std::string filename = "gamer_tetmesh_test.snap";
+    writeSnapshot(filename, *mesh);
+    auto result = readSnapshot_TetMesh(filename);
+    std::remove(filename.c_str());
+
+    ASSERT_NE(result, nullptr);
+    EXPECT_EQ(result->size<1>(), mesh->size<1>());
+    EXPECT_EQ(result->size<3>(), mesh->size<3>());
+    EXPECT_EQ(result->size<4>(), mesh->size<4>());
+    EXPECT_EQ((*result->get_simplex_up({0,1,2,3})).marker, 5);
+    EXPECT_EQ((*result->get_simplex_up({0,1,2,3})).orientation,
+              (*mesh->get_simplex_up({0,1,2,3})).orientation);
+    EXPECT_EQ((*result->get_simplex_up({1,2,3,4})).marker, 7);
+    EXPECT_EQ((*result->get_simplex_up({0,1,2})).marker, 23);
+    EXPECT_TRUE((*result->get_simplex_up({1,2,3})).selected);
+    EXPECT_EQ((*result->get_simplex_up({4})).position[0], 1);
+}
+
+TEST_F(TetMeshTest, QualityStats){
+    auto stats = computeQualityStats(*mesh, 18);
+
+    ASSERT_EQ(stats.volume.size(), 2);
+    EXPECT_EQ(stats.summary.nCells, 2);
+    EXPECT_EQ(stats.summary.nInverted, 0);
+    EXPECT_NEAR(stats.summary.totalVolume, 1.0/6 + 1.0/3, 1e-12);
+    EXPECT_NEAR(stats.summary.minDihedral, 54.7356103172, 1e-6);
+    EXPECT_EQ(stats.markerSummary.size(), 2);
+    EXPECT_EQ(stats.markerSummary[5].nCells, 1);
+
+    std::size_t nAngles = 0;
+    for (auto count : stats.dihedralHistogram)
+        nAngles += count;
+    EXPECT_EQ(nAngles, 12);
+}
+
+TEST(TetMeshMake, ThinNestedRegion){
+    // A flat inner region where offsetting a face by one edge length would
+    // leave the region
+    auto outer = sphere(1);
+    auto inner = sphere(1);
+    scale(*inner, Vector({0.5, 0.5, 0.03}));
+    (*outer->get_simplex_up()).marker = 1;
+    (*inner->get_simplex_up()).marker = 2;
+
+    auto tetmesh = makeTetMesh({outer.get(), inner.get()}, "pq1.4AQ");
+    ASSERT_GT(tetmesh->size<4>(), 0);
+    std::set<int> markers;
+    for (const auto &cell : tetmesh->get_level<4>())
+        markers.insert(cell.marker);
+    EXPECT_EQ(markers, std::set<int>({1, 2}));
+
+    // Intersecting shells are rejected before tetgen runs
+    translate(*inner, Vector({0.8, 0, 0}));
+    EXPECT_THROW(makeTetMesh({outer.get(), inner.get()}, "pq1.4AQ"), std::runtime_error);
+}
+
+TEST(TetMeshOptimize, ImprovesInteriorVertex){
+    // Unit cube coned to an off center interior vertex
+    std::vector<REAL> vertices;
+    for (int i = 0; i < 8; ++i)
+    {
+        vertices.push_back(i & 1);
+        vertices.push_back((i >> 1) & 1);
+        vertices.push_back((i >> 2) & 1);
+    }
+    vertices.insert(vertices.end(), {0.2, 0.4, 0.6});
+    std::vector<int> triangles = {0,2,6, 0,6,4, 1,3,7, 1,7,5, 0,1,5, 0,5,4,
+                                  2,3,7, 2,7,6, 0,1,3, 0,3,2, 4,5,7, 4,7,6};
+    std::vector<int> cells;
+    for (std::size_t i = 0; i < triangles.size(); i += 3)
+        cells.insert(cells.end(), {triangles[i], triangles[i+1], triangles[i+2], 8});
+    auto tetmesh = tetMeshFromArrays(9, vertices.data(), nullptr,
+                                     cells.size()/4, cells.data(), nullptr);
+
+    auto minDihedral = [&tetmesh](){
+        REAL result = 180;
+        for (auto cellID : tetmesh->get_level_id<4>())
+        {
+            auto w = cellID.indices();
+            auto angles = tetmesh_detail::dihedralAngles(
+                (*tetmesh->get_simplex_up({w[0]})).position,
+                (*tetmesh->get_simplex_up({w[1]})).position,
+                (*tetmesh->get_simplex_up({w[2]})).position,
+                (*tetmesh->get_simplex_up({w[3]})).position);
+            for (auto angle : angles)
+                result = std::min(result, angle);
+        }
+        return result;
+    };
+
+    REAL before = minDihedral();
+    std::size_t moves = optimizeMesh(*tetmesh, 10);
+    REAL after = minDihedral();
+
+    EXPECT_GT(moves, 0);
+    EXPECT_GT(after, before);
+    auto center = (*tetmesh->get_simplex_up({8})).position;
+    EXPECT_LT(length(center - Vector({0.5, 0.5, 0.5})),
+              length(Vector({0.2, 0.4, 0.6}) - Vector({0.5, 0.5, 0.5})));
+    // Boundary vertices are fixed
+    EXPECT_EQ((*tetmesh->get_simplex_up({7})).position, Vector({1, 1, 1}));
+}
+
+} // end namespace gamer
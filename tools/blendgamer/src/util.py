@@ -23,7 +23,6 @@ import bpy
 import bmesh
 
 import numpy as np
-from collections import deque
 from contextlib import contextmanager
 
 import blendgamer.pygamer as pygamer
@@ -255,34 +254,6 @@ def getActiveMeshObject():
         raise RuntimeError("No active object! Please select a MESH to use this feature.")
 
 
-def getMeshVertices(obj, get_selected_vertices=False):
-    """
-    Get the vertices of mesh object
-
-    Parameters
-    ----------
-    obj : TYPE
-        Description
-    get_selected_vertices : bool, optional
-        Description
-
-    Returns
-    -------
-    TYPE
-        Description
-    """
-    mesh = obj.data
-    vertToVec = lambda v : [v[0], v[1], v[2]]
-
-    vertices = [vertToVec(v.co) for v in mesh.vertices]
-
-    if get_selected_vertices:
-        selected_indices = [v.index for v in mesh.vertices if v.select and not v.hide]
-        return vertices, selected_indices
-    else:
-        return vertices
-
-
 def blenderToGamer(obj=None, map_boundaries=False, autocorrect_normals=True):
     """Convert object to GAMer mesh.
 
@@ -314,67 +285,56 @@ def blenderToGamer(obj=None, map_boundaries=False, autocorrect_normals=True):
             return False
 
     with ObjectMode():
-        # Grab vertices
-        vertices, selected_vertices = getMeshVertices(obj, get_selected_vertices = True)
-        # Get world location and offset each vertex with this value
-        gmesh = sm.SurfaceMesh()   # Init GAMer SurfaceMesh
-
-        def addVertex(co, sel): # functor to addVertices
-            gmesh.addVertex(sm.Vertex(
-                co[0],   # x position
-                co[1],   # y position
-                co[2],   # z position
-                0,
-                bool(sel)                 # selected flag
-            ))
-
-        # If all vertices are selected
-        if len(selected_vertices) == len(vertices):
-            selected_vertices = np.ones(len(vertices), dtype=bool)
-        else:
-            selection = np.zeros(len(vertices), dtype=bool)
-            selection[selected_vertices] = 1    # Set selected to True
-            selected_vertices = selection
+        mesh = obj.data
+        nVertices = len(mesh.vertices)
+        nFaces = len(mesh.polygons)
+
+        # Pull vertex data out of Blender in bulk
+        vertices = np.empty(3*nVertices, dtype=np.float64)
+        mesh.vertices.foreach_get('co', vertices)
+        vertices.shape = (nVertices, 3)
+
+        select = np.empty(nVertices, dtype=bool)
+        hide = np.empty(nVertices, dtype=bool)
+        mesh.vertices.foreach_get('select', select)
+        mesh.vertices.foreach_get('hide', hide)
+        # Hidden vertices are never selected
+        selected_vertices = np.logical_and(select, np.logical_not(hide))
 
-        # Zip args and pass to addVertex functor
-        [addVertex(*args) for args in zip(vertices, selected_vertices)]
+        # Get list of faces
+        loop_total = np.empty(nFaces, dtype=np.int32)
+        mesh.polygons.foreach_get('loop_total', loop_total)
+        if np.any(loop_total != 3):
+            raise RuntimeError("Encountered a non-triangular face. GAMer only works with triangulated meshes.")
+        faces = np.empty(3*nFaces, dtype=np.int32)
+        mesh.polygons.foreach_get('vertices', faces)
+        faces.shape = (nFaces, 3)
+
+        selected_faces = np.empty(nFaces, dtype=bool)
+        mesh.polygons.foreach_get('select', selected_faces)
 
         ml = getMarkerLayer(obj)
         # Transfer boundary information
+        boundaries = np.empty(nFaces, dtype=np.int32)
+        ml.foreach_get('value', boundaries)
         if map_boundaries:
             bdryMap = {UNSETID: UNSETMARKER}
             for bdry in obj.gamer.markers.boundary_list:
                 bdryMap[bdry.boundary_id] = bdry.marker
-            boundaries = [bdryMap[item.value] for item in ml.values()]
-        else:
-            boundaries = [item.value for item in ml.values()]
-
-        edges = obj.data.edges
-        for edge in edges:
-            gmesh.insertEdge(list(edge.vertices), sm.Edge(bool(edge.select)))
-
-        # Get list of faces
-        faces = obj.data.polygons
-
-        # Transfer data from blender mesh to gamer mesh
-        for face in faces:
-            vertices = deque(face.vertices)
-            if len(vertices) != 3:
-                raise RuntimeError("Encountered a non-triangular face. GAMer only works with triangulated meshes.")
-
-            # Get the orientation from Blender
-            max_val = max(vertices)
-            max_idx = vertices.index(max_val)
-            if max_idx != 2:
-                vertices.rotate(2-max_idx)
-            orientation = -1    # 1 < 0 < 2
-            if(vertices[0] < vertices[1]):
-                # 0 < 1 < 2
-                orientation = 1
-            gmesh.insertFace(list(vertices), sm.Face(orientation, boundaries[face.index], bool(face.select)))
-    # Ensure all face orientations are set
-    gmesh.init_orientation()
-    gmesh.check_orientation()
+            boundaries = np.array([bdryMap[item] for item in boundaries], dtype=np.int32)
+
+        # Face orientations follow the Blender winding
+        gmesh = sm.SurfaceMesh.from_ndarray(vertices, faces,
+                face_markers=boundaries,
+                vertex_markers=np.zeros(nVertices, dtype=np.int32),
+                vertex_selected=selected_vertices,
+                face_selected=selected_faces)
+
+        # Edges of faces already exist. Transfer the selection and keep
+        # loose edges which do not belong to any face.
+        for edge in mesh.edges:
+            if edge.select or edge.is_loose:
+                gmesh.insertEdge(list(edge.vertices), sm.Edge(bool(edge.select)))
     vol = gmesh.getVolume()
     if vol < 0:
         if autocorrect_normals: